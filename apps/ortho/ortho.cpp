@@ -26,6 +26,7 @@
 #include <memory>
 #include <iomanip>
 #include <fstream>
+#include <limits>
 
 #include <tidop/core/console.h>
 #include <tidop/core/messages.h>
@@ -35,18 +36,20 @@
 #include <tidop/img/imgreader.h>
 #include <tidop/img/imgwriter.h>
 #include <tidop/img/formats.h>
+#include <tidop/geometry/rtree.h>
 #include <tidop/vect/vectreader.h>
 #include <tidop/vect/vectwriter.h>
 #include <tidop/graphic/layer.h>
+#include <tidop/graphic/columnar.h>
 #include <tidop/graphic/datamodel.h>
 #include <tidop/geospatial/crs.h>
 #include <tidop/geospatial/camera.h>
 #include <tidop/geospatial/photo.h>
 #include <tidop/geospatial/ortho.h>
+#include <tidop/geospatial/mosaic.h>
 
 
 
-#include <opencv2/stitching.hpp>
 #include <opencv2/imgcodecs.hpp>
 
 using namespace tl;
@@ -54,8 +57,6 @@ using namespace geospatial;
 
 /// Busqueda de huella de vuelo optima. En caso contrario se usan todas las imagenes disponibles
 constexpr bool find_optimal_footprint = true;
-/// Factor de carga para la compensación de exposición
-constexpr double exposure_compensator_factor = 0.5;
 
 
 Point3D readOffset(tl::Path &offset_file)
@@ -252,10 +253,10 @@ std::vector<Photo> readBundleFile(tl::Path &bundle_file, std::vector<std::string
 }
 
 
-/// Busqueda de la imagen mas centrada en la huella de vuelo
-std::shared_ptr<graph::GPolygon> bestImage(const PointD &pt, const std::string &footprint_file)
+/// Lectura de la huella de vuelo
+std::vector<std::shared_ptr<graph::GPolygon>> readFootprint(const std::string &footprint_file)
 {
-  std::shared_ptr<graph::GPolygon> footprint_image;
+  std::vector<std::shared_ptr<graph::GPolygon>> footprint;
 
   std::unique_ptr<VectorReader> vectorReader = VectorReaderFactory::createReader(footprint_file);
   vectorReader->open();
@@ -263,29 +264,16 @@ std::shared_ptr<graph::GPolygon> bestImage(const PointD &pt, const std::string &
 
     if (vectorReader->layersCount() >= 1) {
 
-      std::map<double, std::shared_ptr<graph::GPolygon>> entities;
       std::shared_ptr<graph::GLayer> layer = vectorReader->read(0);
 
       for (const auto &entity : *layer) {
         graph::GraphicEntity::Type type = entity->type();
         if (type == graph::GraphicEntity::Type::polygon_2d) {
-
-          std::shared_ptr<graph::GPolygon> polygon = std::dynamic_pointer_cast<graph::GPolygon>(entity);
-          if (polygon->isInner(pt)) {
-            PointD center = polygon->window().center();
-            double distance = tl::distance(center, pt);
-            entities[distance] = polygon;
-          }
-
+          footprint.push_back(std::dynamic_pointer_cast<graph::GPolygon>(entity));
         } else {
           msgError("No es un fichero de huella de vuelo");
           break;
         }
-
-      }
-
-      if (!entities.empty()) {
-        footprint_image = entities.begin()->second;
       }
 
     }
@@ -294,6 +282,29 @@ std::shared_ptr<graph::GPolygon> bestImage(const PointD &pt, const std::string &
 
   }
 
+  return footprint;
+}
+
+/// Busqueda de la imagen mas centrada en la huella de vuelo
+std::shared_ptr<graph::GPolygon> bestImage(const PointD &pt,
+                                           const std::vector<std::shared_ptr<graph::GPolygon>> &footprint,
+                                           const RTree<WindowD> &rtree)
+{
+  std::shared_ptr<graph::GPolygon> footprint_image;
+  double min_distance = std::numeric_limits<double>::max();
+
+  for (size_t i : rtree.search(pt)) {
+    const std::shared_ptr<graph::GPolygon> &polygon = footprint[i];
+    if (polygon->isInner(pt)) {
+      PointD center = polygon->window().center();
+      double distance = tl::distance(center, pt);
+      if (distance < min_distance) {
+        min_distance = distance;
+        footprint_image = polygon;
+      }
+    }
+  }
+
   return footprint_image;
 }
 
@@ -309,19 +320,21 @@ std::vector<tl::WindowD> findGrid(const tl::Path &footprint_file)
   if (vectorReader->isOpen()) {
     if (vectorReader->layersCount() >= 1) {
 
-      std::map<double, std::shared_ptr<graph::GPolygon>> entities;
-      std::shared_ptr<graph::GLayer> layer = vectorReader->read(0);
-
-      /// Busqueda ventana total
+      /// Busqueda ventana total. Sólo se necesita la geometría
 
       double grid_step = -1;
 
-      for (const auto &entity : *layer) {
-        std::shared_ptr<graph::GPolygon> polygon = std::dynamic_pointer_cast<graph::GPolygon>(entity);
-        std::shared_ptr<TableRegister> data = polygon->data();
-        WindowD window = polygon->window();
-        grid_step = std::min(window.width(), window.height());
-        window_all = joinWindow(window_all, window);
+      VectorQuery query;
+      query.selectFields({});
+      std::unique_ptr<FeatureCursor> cursor = vectorReader->cursor(0, query);
+
+      graph::ColumnarLayer layer;
+      while (cursor->next(layer)) {
+        for (size_t i = 0; i < layer.size(); i++) {
+          WindowD window = layer.window(i);
+          grid_step = std::min(window.width(), window.height());
+          window_all = joinWindow(window_all, window);
+        }
       }
 
       grid_step /= 3.;
@@ -363,10 +376,20 @@ void findOptimalFootprint(const tl::Path &footprint_file,
 {
   std::map<std::string, std::shared_ptr<graph::GPolygon>> clean_footprint;
 
+  std::vector<std::shared_ptr<graph::GPolygon>> footprint = readFootprint(footprint_file.toString());
+
+  std::vector<WindowD> windows;
+  windows.reserve(footprint.size());
+  for (const auto &polygon : footprint) {
+    windows.push_back(polygon->window());
+  }
+
+  RTree<WindowD> rtree(windows);
+
   for (size_t i = 0; i < grid.size(); i++) {
 
     /// Busqueda de imagen mas centrada
-    std::shared_ptr<graph::GPolygon> polygon = bestImage(grid[i].center(), footprint_file.toString());
+    std::shared_ptr<graph::GPolygon> polygon = bestImage(grid[i].center(), footprint, rtree);
     if (polygon) {
       std::shared_ptr<TableRegister> data = polygon->data();
       std::string ortho_to_compensate = data->value(0);
@@ -409,299 +432,39 @@ void findOptimalFootprint(const tl::Path &footprint_file,
 void orthoMosaic(Path &optimal_footprint_path, 
                  Path &ortho_path, 
                  double res_ortho, 
-                 geospatial::Crs &crs, 
-                 std::vector<WindowD> &grid)
+                 geospatial::Crs &crs)
 {
-  std::vector<std::string> compensated_orthos;
-  std::vector<std::string> ortho_seams;
-  std::vector<cv::Point> corners;
-  std::vector<cv::Mat> mat_orthos;
-  std::vector<cv::UMat> umat_orthos;
-  std::vector<cv::UMat> ortho_masks;
-  WindowD window_all;
-
-  msgInfo("Exposure compensator");
+  std::vector<Path> orthos;
 
-  //int type = cv::detail::ExposureCompensator::NO;
-  int type = cv::detail::ExposureCompensator::GAIN;
-  //int type = cv::detail::ExposureCompensator::GAIN_BLOCKS;
-  //int type = cv::detail::ExposureCompensator::CHANNELS;
-  //int type = cv::detail::ExposureCompensator::CHANNELS_BLOCKS;
-  cv::Ptr<cv::detail::ExposureCompensator> compensator = cv::detail::ExposureCompensator::createDefault(type);
-
-  std::unique_ptr<VectorReader> vectorReader;
-  vectorReader = VectorReaderFactory::createReader(optimal_footprint_path.toString());
+  std::unique_ptr<VectorReader> vectorReader = VectorReaderFactory::createReader(optimal_footprint_path.toString());
   vectorReader->open();
-
   if (vectorReader->isOpen()) {
-
     if (vectorReader->layersCount() >= 1) {
-
-      std::map<double, std::shared_ptr<graph::GPolygon>> entities;
-      std::shared_ptr<graph::GLayer> layer = vectorReader->read(0);
-
-      for (const auto &entity : *layer) {
-
-        graph::GraphicEntity::Type type = entity->type();
-        if (type == graph::GraphicEntity::Type::polygon_2d) {
-
-          /// se carga la primera imagen y se busca las que intersectan
-          std::shared_ptr<graph::GPolygon> polygon = std::dynamic_pointer_cast<graph::GPolygon>(entity);
-          std::shared_ptr<TableRegister> data = polygon->data();
-          std::string ortho_to_compensate = data->value(0);
-          WindowD window = polygon->window();
-          PointD center = window.center();
-
-          /// Busqueda de imagenes que intersectan
-
-          std::vector<std::string> orthos;
-          orthos.push_back(ortho_to_compensate);
-          std::vector<WindowD> windows;
-          windows.push_back(window);
-
-          for (const auto &entity2 : *layer) {
-            std::shared_ptr<graph::GPolygon> polygon2 = std::dynamic_pointer_cast<graph::GPolygon>(entity2);
-            std::shared_ptr<TableRegister> data = polygon2->data();
-            std::string orto = data->value(0);
-
-            if (orto != ortho_to_compensate) {
-
-              //if (polygon2->isInner(polygon->at(0)) || 
-              //    polygon2->isInner(polygon->at(1)) || 
-              //    polygon2->isInner(polygon->at(2)) || 
-              //    polygon2->isInner(polygon->at(3))) {
-              /// No se si será suficiente o tengo que seleccionar todas las imagenes que intersecten...
-              if (polygon2->isInner(center)) {
-                orthos.push_back(orto);
-                windows.push_back(polygon2->window());
-                window_all = joinWindow(window_all, polygon2->window());
-              }
-
-            }
-
-          }
-
-          size_t n_orthos = orthos.size();
-          corners.resize(n_orthos);
-          ortho_masks.resize(n_orthos);
-          umat_orthos.resize(n_orthos);
-          mat_orthos.resize(n_orthos);
-
-          /// Aplicar un factor de escala para el calculo de la compensación de exposición
-          for (size_t i = 0; i < n_orthos; i++) {
-
-            std::unique_ptr<ImageReader> image_reader = ImageReaderFactory::createReader(orthos[i]);
-            image_reader->open();
-            if (!image_reader->isOpen()) throw std::runtime_error("Image open error");
-            cv::Mat image = image_reader->read(exposure_compensator_factor, exposure_compensator_factor);
-            mat_orthos[i] = image.clone();
-            double scale = image_reader->georeference().scaleX();
-
-            /// Esquinas
-            corners[i].x = (windows[i].pt1.x - window_all.pt1.x) * exposure_compensator_factor / scale;
-            corners[i].y = (window_all.pt2.y - windows[i].pt2.y) * exposure_compensator_factor / scale;
-
-            /// La mascara debería leerse si se creó en la generación del MDS.
-            ortho_masks[i].create(image.size(), CV_8U);
-            cv::Mat gray;
-            cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-            ortho_masks[i].setTo(cv::Scalar::all(0));
-            ortho_masks[i].setTo(cv::Scalar::all(255), gray > 0);
-          }
-
-          cv::InputArrayOfArrays(mat_orthos).getUMatVector(umat_orthos);
-          compensator->feed(corners, umat_orthos, ortho_masks);
-
-          msgInfo("Seam finder");
-
-          cv::Ptr<cv::detail::SeamFinder> seam_finder;
-          seam_finder = cv::makePtr<cv::detail::NoSeamFinder>();
-          //seam_finder = cv::makePtr<cv::detail::VoronoiSeamFinder>();
-          //seam_finder = cv::makePtr<cv::detail::DpSeamFinder>(cv::detail::DpSeamFinder::COLOR);
-          //seam_finder = cv::makePtr<cv::detail::DpSeamFinder>(cv::detail::DpSeamFinder::COLOR_GRAD);
-          seam_finder->find(umat_orthos, corners, ortho_masks);
-          umat_orthos.clear();
-          mat_orthos.clear();
-
-          std::unique_ptr<ImageReader> image_reader = ImageReaderFactory::createReader(ortho_to_compensate);
-          image_reader->open();
-          if (!image_reader->isOpen()) throw std::runtime_error("Image open error");
-          cv::Mat compensate_image = image_reader->read();
-
-          /// Se compensa la imagen
-          cv::Point corner = corners[0] / exposure_compensator_factor;
-          cv::Mat gray;
-          cv::cvtColor(compensate_image, gray, cv::COLOR_BGR2GRAY);
-          cv::Mat mask_full_size(compensate_image.size(), CV_8U);
-          mask_full_size.setTo(cv::Scalar::all(0));
-          mask_full_size.setTo(cv::Scalar::all(255), gray > 0);
-          cv::Mat element = getStructuringElement(cv::MorphShapes::MORPH_RECT,
-            cv::Size(2 * 2 + 1, 2 * 2 + 1),
-            cv::Point(2, 2));
-          cv::erode(mask_full_size, mask_full_size, element);
-          compensator->apply(0, corner, compensate_image, mask_full_size);
-
-          Path orto_compensate(ortho_to_compensate);
-          std::string name = orto_compensate.baseName().toString() + "_compensate.png";
-          orto_compensate.replaceFileName(name);
-          std::unique_ptr<ImageWriter> image_writer = ImageWriterFactory::createWriter(orto_compensate.toString());
-          image_writer->open();
-          if (image_writer->isOpen()) {
-            image_writer->create(image_reader->rows(), image_reader->cols(), image_reader->channels(), image_reader->dataType());
-            image_writer->setCRS(image_reader->crsWkt());
-            image_writer->setGeoreference(image_reader->georeference());
-            image_writer->write(compensate_image);
-            image_writer->close();
-            msgInfo("Image Compensate: %s", orto_compensate.fileName().toString().c_str());
-            compensated_orthos.push_back(orto_compensate.toString());
-          }
-
-          /// 2 - Busqueda de costuras (seam finder)
-
-          cv::Mat mask_finder = ortho_masks[0].getMat(cv::ACCESS_READ);
-          cv::erode(mask_finder, mask_finder, element);
-          cv::resize(mask_finder, mask_finder, compensate_image.size());
-          mask_finder = mask_finder & mask_full_size;
-
-          Path orto_seam(ortho_to_compensate);
-          name = orto_seam.baseName().toString() + "_seam.tif";
-          orto_seam.replaceFileName(name);
-          image_writer = ImageWriterFactory::createWriter(orto_seam.toString());
-          image_writer->open();
-          if (image_writer->isOpen()) {
-            image_writer->create(image_reader->rows(), image_reader->cols(), 1, image_reader->dataType());
-            image_writer->setCRS(image_reader->crsWkt());
-            image_writer->setGeoreference(image_reader->georeference());
-            image_writer->write(mask_finder);
-            image_writer->close();
-            msgInfo("Image seam: %s", orto_seam.fileName().toString().c_str());
-            ortho_seams.push_back(orto_seam.toString());
-          }
-
-          image_reader->close();
-
-        } else {
-          msgError("No es un fichero de huella de vuelo");
-          return;
+      VectorQuery query;
+      query.selectFields({"image"});
+      std::unique_ptr<FeatureCursor> cursor = vectorReader->cursor(0, query);
+
+      graph::ColumnarLayer layer;
+      while (cursor->next(layer)) {
+        for (size_t i = 0; i < layer.size(); i++) {
+          orthos.emplace_back(layer.column(0).toString(i));
         }
-
       }
-
     }
-
     vectorReader->close();
   }
 
-  /// 3 - mezcla (blender)
-
-  bool try_cuda = false;
-  //int blender_type = cv::detail::Blender::FEATHER;
-  int blender_type = cv::detail::Blender::MULTI_BAND;
-  cv::Ptr<cv::detail::Blender> blender;
-  float blend_strength = 5;
-
   Path ortho_final(ortho_path);
   ortho_final.append("ortho.tif");
-  std::unique_ptr<ImageWriter> image_writer = ImageWriterFactory::createWriter(ortho_final.toString());
-  image_writer->open();
-  int cols = static_cast<int>(std::round(window_all.width() / res_ortho));
-  int rows = static_cast<int>(std::round(window_all.height() / res_ortho));
-
-  if (image_writer->isOpen()) {
-    image_writer->create(rows, cols, 3, DataType::TL_8U);
-    image_writer->setCRS(crs.toWktFormat());
-    Affine<PointD> affine_ortho(window_all.pt1.x,
-      window_all.pt2.y,
-      res_ortho, -res_ortho, 0.0);
-    image_writer->setGeoreference(affine_ortho);
-
-    for (size_t i = 0; i < grid.size(); i++) {
-
-      blender = cv::detail::Blender::createDefault(blender_type, try_cuda);
-
-      int cols_grid = static_cast<int>(std::round(grid[i].width() / res_ortho));
-      int rows_grid = static_cast<int>(std::round(grid[i].height() / res_ortho));
-      cv::Rect rect(0, 0, cols_grid, rows_grid);
-
-      //cv::Size dst_sz = rect.size();
-      float blend_width = sqrt(static_cast<float>(rect.area())) * blend_strength / 100.f;
-      
-      if (blend_width < 1.f){
-        blender = cv::detail::Blender::createDefault(cv::detail::Blender::NO, try_cuda);
-      } else if (blender_type == cv::detail::Blender::MULTI_BAND) {
-        cv::detail::MultiBandBlender *multi_band_blender = dynamic_cast<cv::detail::MultiBandBlender *>(blender.get());
-        multi_band_blender->setNumBands(4/*static_cast<int>(ceil(log(blend_width) / log(2.)) - 1.)*/);
-        msgInfo("Multi-band blender, number of bands: %i", multi_band_blender->numBands());
-      } else if (blender_type == cv::detail::Blender::FEATHER) {
-        cv::detail::FeatherBlender *feather_blender = dynamic_cast<cv::detail::FeatherBlender *>(blender.get());
-        feather_blender->setSharpness(0.02f/*1.f / blend_width*/);
-        msgInfo("Feather blender, sharpness: %f", feather_blender->sharpness());
-      }
-
-      blender->prepare(rect);
-
-      for (size_t j = 0; j < compensated_orthos.size(); j++) {
-        std::unique_ptr<ImageReader> image_reader = ImageReaderFactory::createReader(compensated_orthos[j]);
-        std::unique_ptr<ImageReader> image_reader_seam = ImageReaderFactory::createReader(ortho_seams[j]);
-        image_reader->open();
-        image_reader_seam->open();
-        if (!image_reader->isOpen() || !image_reader_seam->isOpen()) throw std::runtime_error("Image open error");
-
-        if (!intersectWindows(image_reader->window(), grid[i]) ||
-            !intersectWindows(image_reader_seam->window(), grid[i])) continue;
-
-        double scale_x = image_reader->georeference().scaleX();
-        double scale_y = image_reader->georeference().scaleY();
-        double read_scale_x = scale_x / res_ortho;
-        double read_scale_y = scale_y / res_ortho;
-        PointD p1 = image_reader->georeference().transform(grid[i].pt1, tl::Transform::Order::inverse);
-        PointD p2 = image_reader->georeference().transform(grid[i].pt2, tl::Transform::Order::inverse);
-        WindowI window_to_read(static_cast<PointI>(p1), static_cast<PointI>(p2));
-        window_to_read.normalized();
-
-        Affine<PointI> affine;
-        cv::Mat compensate_image;
-        cv::Mat seam_image;
-        try {
-          compensate_image = image_reader->read(grid[i], read_scale_x, read_scale_y, &affine);
-          seam_image = image_reader_seam->read(grid[i], read_scale_x, read_scale_y);
-        } catch (...) {
-          continue;
-        }
-
-        if (!compensate_image.empty() && !seam_image.empty()) {
-
-          msgInfo("Ortho grid %i", i, compensated_orthos[j].c_str());
-
-          cv::Mat compensate_image_16s;
-          compensate_image.convertTo(compensate_image_16s, CV_16S);
-          compensate_image.release();
 
-          cv::Rect rect = cv::Rect(affine.tx, affine.ty, compensate_image_16s.cols, compensate_image_16s.rows);
-          blender->feed(compensate_image_16s, seam_image, rect.tl());
-        }
-      }
-      cv::Mat ortho_blend;
-      cv::Mat mask_blend;
-      blender->blend(ortho_blend, mask_blend);
-      ortho_blend.convertTo(ortho_blend, CV_8U);
-
-      affine_ortho.transform(grid[i].pt1);
-      affine_ortho.transform(grid[i].pt2);
-      PointD p1 = affine_ortho.transform(grid[i].pt1, tl::Transform::Order::inverse);
-      PointD p2 = affine_ortho.transform(grid[i].pt2, tl::Transform::Order::inverse);
-      WindowI window_to_write(static_cast<PointI>(p1), static_cast<PointI>(p2));
-      window_to_write.normalized();
-      image_writer->write(ortho_blend, window_to_write);
-
-    }
-
-    image_writer->close();
-  }
+  ProgressBarColor progress;
+  Mosaic mosaic(orthos);
+  mosaic.setResolution(res_ortho);
+  mosaic.setCRS(crs.toWktFormat());
+  mosaic.run(ortho_final, &progress);
 }
 
 
-
 int main(int argc, char** argv)
 {
 
@@ -811,7 +574,7 @@ int main(int argc, char** argv)
     optimal_footprint_path.replaceBaseName(name);
     findOptimalFootprint(graph_orthos, grid, optimal_footprint_path, crs);
     
-    orthoMosaic(optimal_footprint_path, ortho_path, res_ortho, crs, grid);
+    orthoMosaic(optimal_footprint_path, ortho_path, res_ortho, crs);
 
   } catch (const std::exception &e) {
     msgError(e.what());
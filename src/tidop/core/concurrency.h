@@ -28,12 +28,17 @@
 #include "config_tl.h"
 #include "tidop/core/defs.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <functional>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <queue>
 #include <condition_variable>
 #include <future>
+#include <vector>
 
 namespace tl
 {
@@ -211,6 +216,56 @@ void parallel_for_each_3(Iterator first,
   }
 }
 
+/*!
+ * \brief Iterates over a range of indices in parallel with per-thread state
+ *
+ * Each thread creates its own Worker_t object (clipper, work buffers, ...)
+ * and reuses it for every index it processes. Indices are handed out
+ * dynamically so uneven workloads stay balanced. The first exception thrown
+ * by f stops the remaining work and is rethrown in the calling thread.
+ * \param[in] ini Initial index
+ * \param[in] end End index
+ * \param[in] f Function or lambda with signature void(Worker_t &, size_t)
+ */
+template<typename Worker_t, typename Func>
+void parallel_for_worker(size_t ini,
+                         size_t end,
+                         Func f)
+{
+  if (end <= ini) return;
+
+  size_t size = end - ini;
+  size_t num_threads = std::max<size_t>(1, std::min<size_t>(optimalNumberOfThreads(), size));
+  std::atomic<size_t> next(ini);
+  std::exception_ptr error;
+  std::mutex mutex;
+
+  auto run = [&]() {
+    Worker_t worker;
+    for (size_t i = next++; i < end; i = next++) {
+      try {
+        f(worker, i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) error = std::current_exception();
+        next = end;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(run);
+  }
+  run();
+  for (auto &_thread : threads) {
+    _thread.join();
+  }
+
+  if (error) std::rethrow_exception(error);
+}
+
 /*--------------------------------------------------------------------------------*/
 
 
@@ -351,20 +406,20 @@ private:
 
 template<typename T>
 QueueSPSC<T>::QueueSPSC(size_t capacity)
-  : Queue(capacity)
+  : Queue<T>(capacity)
 {
 }
 
 template<typename T>
 void QueueSPSC<T>::push(const T &value)
 {
-  std::unique_lock<std::mutex> locker(mutex());
+  std::unique_lock<std::mutex> locker(this->mutex());
 
   mConditionVariable.wait(locker, [this]() {
-    return buffer().size() < capacity();
+    return this->buffer().size() < this->capacity();
   });
 
-  buffer().push(value);
+  this->buffer().push(value);
   locker.unlock();
   mConditionVariable.notify_one();
 }
@@ -372,14 +427,14 @@ void QueueSPSC<T>::push(const T &value)
 template<typename T>
 inline bool QueueSPSC<T>::pop(T &value)
 {
-  std::unique_lock<std::mutex> locker(mutex());
+  std::unique_lock<std::mutex> locker(this->mutex());
 
   mConditionVariable.wait(locker, [this]() {
-    return !buffer().empty();
+    return !this->buffer().empty();
   });
 
-  value = buffer().front();
-  buffer().pop();
+  value = this->buffer().front();
+  this->buffer().pop();
   locker.unlock();
   mConditionVariable.notify_one();
 
@@ -424,7 +479,7 @@ public:
 
   void stop()
   {
-    std::unique_lock<std::mutex> locker(mutex());
+    std::unique_lock<std::mutex> locker(this->mutex());
     mStop = true;
     mConditionVariable.notify_all();
   }
@@ -432,13 +487,13 @@ public:
 private:
 
   std::condition_variable mConditionVariable;
-  bool mStop;
+  bool mStop{false};
 };
 
 
 template<typename T>
 QueueMPMC<T>::QueueMPMC(size_t capacity)
-  : Queue(capacity),
+  : Queue<T>(capacity),
   mStop(false)
 {
 }
@@ -446,14 +501,14 @@ QueueMPMC<T>::QueueMPMC(size_t capacity)
 template<typename T>
 void QueueMPMC<T>::push(const T &value)
 {
-  std::unique_lock<std::mutex> locker(mutex());
+  std::unique_lock<std::mutex> locker(this->mutex());
 
   mConditionVariable.wait(locker, [this]() {
-    return buffer().size() < capacity() || mStop;
+    return this->buffer().size() < this->capacity() || mStop;
   });
 
   if (!mStop) {
-    buffer().push(value);
+    this->buffer().push(value);
   }
 
   locker.unlock();
@@ -463,17 +518,17 @@ void QueueMPMC<T>::push(const T &value)
 template<typename T>
 inline bool QueueMPMC<T>::pop(T &value)
 {
-  std::unique_lock<std::mutex> locker(mutex());
+  std::unique_lock<std::mutex> locker(this->mutex());
 
   mConditionVariable.wait(locker, [this]() {
-    return !buffer().empty() || mStop;
+    return !this->buffer().empty() || mStop;
   });
 
-  bool read_buffer = !buffer().empty();
+  bool read_buffer = !this->buffer().empty();
 
   if (read_buffer) {
-    value = buffer().front();
-    buffer().pop();
+    value = this->buffer().front();
+    this->buffer().pop();
   }
 
   locker.unlock();
@@ -400,8 +400,7 @@ Path Path::tempDirectory()
   temp_path.append("/tlXXXXXX");
   std::vector<char> c_path(temp_path.begin(), temp_path.end());
   c_path.push_back('\0');
-  int file_descriptor = mkstemp(c_path.data());
-  if (file_descriptor != -1) {
+  if (mkdtemp(c_path.data()) != nullptr) {
     temp_path.assign(c_path.begin(), c_path.end() - 1);
   } else {
     temp_path = "";
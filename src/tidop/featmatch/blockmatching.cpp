@@ -0,0 +1,419 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "blockmatching.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <list>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+#include "tidop/core/concurrency.h"
+#include "tidop/core/exception.h"
+#include "tidop/core/messages.h"
+#include "tidop/core/progress.h"
+#include "tidop/geometry/kdtree.h"
+#include "tidop/geometry/rtree.h"
+#include "tidop/featmatch/featio.h"
+#include "tidop/featmatch/matchio.h"
+
+namespace tl
+{
+
+namespace internal
+{
+
+struct ImageFeatures
+{
+  std::vector<cv::KeyPoint> keyPoints;
+  cv::Mat descriptors;
+};
+
+/*!
+ * \brief Caché LRU de características
+ *
+ * Cada imagen se lee una sola vez aunque la pidan varios hilos a la vez: el
+ * primero la carga y el resto espera al mismo resultado.
+ */
+class FeaturesCache
+{
+
+public:
+
+  using Value = std::shared_ptr<const ImageFeatures>;
+
+  FeaturesCache(const std::vector<Path> &features, size_t capacity)
+    : mFeatures(features),
+      mCapacity(std::max<size_t>(2, capacity)),
+      mLoads(0)
+  {
+  }
+
+  Value get(size_t image)
+  {
+    std::shared_future<Value> future;
+    std::promise<Value> promise;
+    bool load = false;
+
+    {
+      std::lock_guard<std::mutex> lck(mMutex);
+
+      auto it = mEntries.find(image);
+      if (it != mEntries.end()) {
+        mOrder.splice(mOrder.begin(), mOrder, it->second.first);
+        future = it->second.second;
+      } else {
+        load = true;
+        future = promise.get_future().share();
+        mOrder.push_front(image);
+        mEntries[image] = std::make_pair(mOrder.begin(), future);
+        while (mEntries.size() > mCapacity) {
+          mEntries.erase(mOrder.back());
+          mOrder.pop_back();
+        }
+      }
+    }
+
+    if (load) {
+      try {
+        std::unique_ptr<FeaturesReader> reader = FeaturesReaderFactory::create(mFeatures.at(image));
+        reader->read();
+        auto features = std::make_shared<ImageFeatures>();
+        features->keyPoints = reader->keyPoints();
+        features->descriptors = reader->descriptors();
+        promise.set_value(features);
+        mLoads++;
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lck(mMutex);
+        auto it = mEntries.find(image);
+        if (it != mEntries.end()) {
+          mOrder.erase(it->second.first);
+          mEntries.erase(it);
+        }
+      }
+    }
+
+    return future.get();
+  }
+
+  size_t loads() const
+  {
+    return mLoads;
+  }
+
+private:
+
+  const std::vector<Path> &mFeatures;
+  size_t mCapacity;
+  std::list<size_t> mOrder;
+  std::unordered_map<size_t, std::pair<std::list<size_t>::iterator, std::shared_future<Value>>> mEntries;
+  std::mutex mMutex;
+  std::atomic<size_t> mLoads;
+};
+
+/*!
+ * \brief Normaliza una lista de pares: (menor, mayor), sin repetidos ni pares de una imagen consigo misma
+ */
+inline std::vector<ImagePair> normalizePairs(std::vector<ImagePair> pairs)
+{
+  for (auto &pair : pairs) {
+    if (pair.first > pair.second) std::swap(pair.first, pair.second);
+  }
+
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+  pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [](const ImagePair &pair) {
+                return pair.first == pair.second;
+              }), pairs.end());
+
+  return pairs;
+}
+
+} // namespace internal
+
+
+std::vector<ImagePair> exhaustivePairs(size_t images)
+{
+  std::vector<ImagePair> pairs;
+  if (images < 2) return pairs;
+
+  pairs.reserve(images * (images - 1) / 2);
+  for (size_t i = 0; i < images; i++) {
+    for (size_t j = i + 1; j < images; j++) {
+      pairs.emplace_back(i, j);
+    }
+  }
+
+  return pairs;
+}
+
+std::vector<ImagePair> sequentialPairs(size_t images,
+                                       size_t window)
+{
+  std::vector<ImagePair> pairs;
+
+  for (size_t i = 0; i < images; i++) {
+    for (size_t j = i + 1; j < images && j <= i + window; j++) {
+      pairs.emplace_back(i, j);
+    }
+  }
+
+  return pairs;
+}
+
+std::vector<ImagePair> footprintPairs(const std::vector<WindowD> &footprints)
+{
+  std::vector<ImagePair> pairs;
+
+  RTree<WindowD> rtree(footprints);
+
+  for (size_t i = 0; i < footprints.size(); i++) {
+    rtree.search(footprints[i], [&pairs, i](size_t j) {
+      if (i < j) pairs.emplace_back(i, j);
+      return true;
+    });
+  }
+
+  return internal::normalizePairs(pairs);
+}
+
+std::vector<ImagePair> proximityPairs(const std::vector<Point3D> &positions,
+                                      size_t neighbors,
+                                      double maxDistance)
+{
+  std::vector<ImagePair> pairs;
+
+  KDTree<Point3D> tree(positions);
+
+  /// El primer vecino es la propia imagen
+  std::vector<std::vector<size_t>> nearest = tree.nearest(positions, neighbors + 1, maxDistance);
+  for (size_t i = 0; i < nearest.size(); i++) {
+    for (size_t j : nearest[i]) {
+      if (i != j) pairs.emplace_back(i, j);
+    }
+  }
+
+  return internal::normalizePairs(pairs);
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+BlockMatching::BlockMatching(MatchingFactory matchingFactory)
+  : mMatchingFactory(std::move(matchingFactory)),
+    mCacheSize(64),
+    mThreads(0),
+    mExtension(".bin"),
+    mResume(true)
+{
+}
+
+size_t BlockMatching::cacheSize() const
+{
+  return mCacheSize;
+}
+
+void BlockMatching::setCacheSize(size_t cacheSize)
+{
+  mCacheSize = cacheSize;
+}
+
+size_t BlockMatching::threads() const
+{
+  return mThreads;
+}
+
+void BlockMatching::setThreads(size_t threads)
+{
+  mThreads = threads;
+}
+
+std::string BlockMatching::extension() const
+{
+  return mExtension;
+}
+
+void BlockMatching::setExtension(const std::string &extension)
+{
+  mExtension = extension;
+}
+
+bool BlockMatching::resume() const
+{
+  return mResume;
+}
+
+void BlockMatching::setResume(bool resume)
+{
+  mResume = resume;
+}
+
+std::vector<Path> BlockMatching::run(const std::vector<Path> &features,
+                                     const std::vector<ImagePair> &pairs,
+                                     const Path &matchesDirectory,
+                                     Progress *progress)
+{
+  std::vector<Path> matches(pairs.size());
+
+  try {
+
+    TL_ASSERT(mMatchingFactory, "Matching factory not defined");
+
+    if (!matchesDirectory.exists() && !matchesDirectory.createDirectories())
+      TL_THROW_EXCEPTION("Can't create the directory: %s", matchesDirectory.toString().c_str());
+
+    for (size_t i = 0; i < pairs.size(); i++) {
+      TL_ASSERT(pairs[i].first < features.size() && pairs[i].second < features.size(), "Image pair out of range");
+      Path matches_file(matchesDirectory);
+      matches_file.append(features[pairs[i].first].baseName().toString() + "@" +
+                          features[pairs[i].second].baseName().toString() + mExtension);
+      matches[i] = matches_file;
+    }
+
+    /// Diario de pares terminados
+    Path journal_file(matchesDirectory);
+    journal_file.append("matches.journal");
+
+    std::set<std::string> done;
+    if (mResume && journal_file.exists()) {
+      std::ifstream journal(journal_file.toString());
+      std::string line;
+      while (std::getline(journal, line)) {
+        if (!line.empty()) done.insert(line);
+      }
+    }
+
+    /// Pares pendientes ordenados por la primera imagen para aprovechar la caché
+    std::vector<size_t> pending;
+    pending.reserve(pairs.size());
+    for (size_t i = 0; i < pairs.size(); i++) {
+      if (done.find(matches[i].fileName().toString()) != done.end() && matches[i].exists()) continue;
+      pending.push_back(i);
+    }
+
+    std::stable_sort(pending.begin(), pending.end(), [&pairs](size_t i, size_t j) {
+      return std::min(pairs[i].first, pairs[i].second) < std::min(pairs[j].first, pairs[j].second);
+    });
+
+    msgInfo("Matching %i image pairs (%i already matched)",
+            static_cast<int>(pending.size()),
+            static_cast<int>(pairs.size() - pending.size()));
+
+    if (progress) {
+      progress->setRange(0, pending.size());
+      progress->setText("Feature matching");
+    }
+
+    if (pending.empty()) return matches;
+
+    std::ofstream journal(journal_file.toString(), mResume ? std::ios::app : std::ios::trunc);
+    TL_ASSERT(journal.is_open(), "Can't open the matching journal");
+
+    internal::FeaturesCache cache(features, mCacheSize);
+
+    size_t num_threads = mThreads == 0 ? optimalNumberOfThreads() : mThreads;
+    num_threads = std::max<size_t>(1, std::min(num_threads, pending.size()));
+
+    std::atomic<size_t> next_pair(0);
+    std::atomic<size_t> failed_pairs(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex mutex;
+
+    auto worker = [&](size_t /*thread*/) {
+
+      try {
+
+        std::shared_ptr<MatchingAlgorithm> matching = mMatchingFactory();
+        TL_ASSERT(matching, "Invalid matching algorithm");
+
+        for (size_t p = next_pair++; p < pending.size() && !failed; p = next_pair++) {
+
+          size_t id = pending[p];
+          const ImagePair &pair = pairs[id];
+
+          try {
+
+            internal::FeaturesCache::Value features1 = cache.get(pair.first);
+            internal::FeaturesCache::Value features2 = cache.get(pair.second);
+
+            std::vector<cv::DMatch> good_matches;
+            std::vector<cv::DMatch> wrong_matches;
+            bool error_matching = matching->compute(features1->descriptors, features2->descriptors,
+                                                    features1->keyPoints, features2->keyPoints,
+                                                    &good_matches, &wrong_matches);
+            TL_ASSERT(!error_matching, "Matching error");
+
+            std::unique_ptr<MatchesWriter> writer = MatchesWriterFactory::create(matches[id]);
+            writer->setGoodMatches(good_matches);
+            writer->setWrongMatches(wrong_matches);
+            writer->write();
+
+            std::lock_guard<std::mutex> lck(mutex);
+            journal << matches[id].fileName().toString() << std::endl;
+            msgInfo("%i matches between %s and %s", static_cast<int>(good_matches.size()),
+                    features[pair.first].baseName().toString().c_str(),
+                    features[pair.second].baseName().toString().c_str());
+            if (progress) (*progress)();
+
+          } catch (const std::exception &e) {
+            msgError("Matching failed for %s: %s", matches[id].fileName().toString().c_str(), e.what());
+            failed_pairs++;
+            std::lock_guard<std::mutex> lck(mutex);
+            matches[id] = Path();
+            if (progress) (*progress)();
+          }
+        }
+
+      } catch (...) {
+        std::lock_guard<std::mutex> lck(mutex);
+        if (!failed) error = std::current_exception();
+        failed = true;
+      }
+    };
+
+    parallel_for(0, num_threads, worker);
+
+    if (error) std::rethrow_exception(error);
+
+    msgInfo("Features read %i times for %i pairs", static_cast<int>(cache.loads()), static_cast<int>(pending.size()));
+    if (failed_pairs > 0) msgWarning("%i image pairs failed", static_cast<int>(failed_pairs));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return matches;
+}
+
+} // namespace tl
@@ -0,0 +1,193 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_FEATMATCH_BLOCK_MATCHING_H
+#define TL_FEATMATCH_BLOCK_MATCHING_H
+
+#include "config_tl.h"
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/path.h"
+#include "tidop/geometry/entities/point.h"
+#include "tidop/geometry/entities/window.h"
+#include "tidop/featmatch/matcher.h"
+
+namespace tl
+{
+
+class Progress;
+
+/*! \addtogroup Features
+ *
+ *  \{
+ */
+
+/*! \addtogroup FeatureMatching
+ *
+ *  \{
+ */
+
+/*!
+ * \brief Image pair (indices of the images)
+ */
+using ImagePair = std::pair<size_t, size_t>;
+
+/*!
+ * \brief All the image pairs
+ * \param[in] images Number of images
+ * \return Image pairs
+ */
+TL_EXPORT std::vector<ImagePair> exhaustivePairs(size_t images);
+
+/*!
+ * \brief Pairs of each image with the next images of the sequence
+ * \param[in] images Number of images
+ * \param[in] window Number of following images paired with each image
+ * \return Image pairs
+ */
+TL_EXPORT std::vector<ImagePair> sequentialPairs(size_t images,
+                                                 size_t window);
+
+/*!
+ * \brief Pairs of images whose footprints overlap
+ * \param[in] footprints Ground footprint of each image
+ * \return Image pairs
+ */
+TL_EXPORT std::vector<ImagePair> footprintPairs(const std::vector<WindowD> &footprints);
+
+/*!
+ * \brief Pairs of each image with its nearest images by camera position (GPS)
+ * \param[in] positions Camera position of each image
+ * \param[in] neighbors Maximum number of neighbours of each image
+ * \param[in] maxDistance Maximum distance between the cameras
+ * \return Image pairs
+ */
+TL_EXPORT std::vector<ImagePair> proximityPairs(const std::vector<Point3D> &positions,
+                                                size_t neighbors,
+                                                double maxDistance = std::numeric_limits<double>::max());
+
+
+/*!
+ * \brief Feature matching of a block of images
+ *
+ * Matches a list of image pairs in parallel. Each worker thread owns its own
+ * matching algorithm, created with the factory. The features of the most
+ * recently used images are kept in a bounded cache (least recently used
+ * images are evicted first), and the pairs are processed in order of their
+ * first image so that concurrent workers share the images in the cache.
+ *
+ * The matches of each pair are written to the matches directory as
+ * <image1>@<image2><extension>. Every pair written is recorded in a journal
+ * file in the same directory, so an interrupted run resumes with the
+ * pending pairs.
+ *
+ * \code
+ * BlockMatching block_matching([]() {
+ *   auto matcher = std::make_shared<FlannMatcherImp>();
+ *   return std::make_shared<RobustMatchingImp>(matcher);
+ * });
+ * block_matching.run(features, sequentialPairs(features.size(), 10), "matches");
+ * \endcode
+ */
+class TL_EXPORT BlockMatching
+{
+
+public:
+
+  using MatchingFactory = std::function<std::shared_ptr<MatchingAlgorithm>()>;
+
+public:
+
+  /*!
+   * \brief Constructor
+   * \param[in] matchingFactory Creates a matching algorithm for each worker
+   */
+  explicit BlockMatching(MatchingFactory matchingFactory);
+  ~BlockMatching() = default;
+
+  TL_DISABLE_COPY(BlockMatching)
+  TL_DISABLE_MOVE(BlockMatching)
+
+  /*!
+   * \brief Maximum number of images in the features cache (default 64)
+   */
+  size_t cacheSize() const;
+  void setCacheSize(size_t cacheSize);
+
+  /*!
+   * \brief Number of matching threads. 0 (default) uses all the cores
+   */
+  size_t threads() const;
+  void setThreads(size_t threads);
+
+  /*!
+   * \brief Extension of the matches files, which selects the format (default ".bin")
+   * \see MatchesWriterFactory
+   */
+  std::string extension() const;
+  void setExtension(const std::string &extension);
+
+  /*!
+   * \brief Resume an interrupted run skipping the pairs in the journal (default true)
+   */
+  bool resume() const;
+  void setResume(bool resume);
+
+  /*!
+   * \brief Matches a list of image pairs
+   * \param[in] features Features file of each image
+   * \param[in] pairs Image pairs
+   * \param[in] matchesDirectory Output directory
+   * \param[in] progress Progress bar
+   * \return Matches file of each pair. Empty if the pair failed
+   */
+  std::vector<Path> run(const std::vector<Path> &features,
+                        const std::vector<ImagePair> &pairs,
+                        const Path &matchesDirectory,
+                        Progress *progress = nullptr);
+
+private:
+
+  MatchingFactory mMatchingFactory;
+  size_t mCacheSize;
+  size_t mThreads;
+  std::string mExtension;
+  bool mResume;
+
+};
+
+/*! \} */ // end of FeatureMatching
+
+/*! \} */ // end of Features
+
+} // namespace tl
+
+#endif // TL_FEATMATCH_BLOCK_MATCHING_H
@@ -0,0 +1,424 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "cascadehashing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include <opencv2/core/hal/hal.hpp>
+
+#include "tidop/core/messages.h"
+#include "tidop/core/exception.h"
+
+namespace tl
+{
+
+namespace internal
+{
+
+/*!
+ * \brief Descriptores en coma flotante de simple precisión
+ */
+inline cv::Mat floatDescriptors(const cv::Mat &descriptors)
+{
+  TL_ASSERT(descriptors.depth() != CV_8U, "Cascade hashing requires float descriptors");
+
+  cv::Mat float_descriptors = descriptors;
+  if (descriptors.depth() != CV_32F)
+    descriptors.convertTo(float_descriptors, CV_32F);
+
+  return float_descriptors;
+}
+
+} // namespace internal
+
+
+
+CascadeHasher::CascadeHasher(int dimension, unsigned int seed)
+{
+  TL_ASSERT(dimension > 0, "Invalid descriptor length");
+
+  /// Las 128 proyecciones del código binario seguidas de las de las tablas
+  int projections = code_bytes * 8 + tables * table_bits;
+  mProjections.create(projections, dimension, CV_32F);
+
+  std::mt19937 random(seed);
+  std::normal_distribution<float> normal(0.f, 1.f);
+  for (int r = 0; r < mProjections.rows; r++) {
+    float *projection = mProjections.ptr<float>(r);
+    for (int c = 0; c < dimension; c++) {
+      projection[c] = normal(random);
+    }
+  }
+
+  mThresholds = cv::Mat::zeros(1, projections, CV_32F);
+}
+
+void CascadeHasher::train(const cv::Mat &descriptors)
+{
+  try {
+
+    cv::Mat float_descriptors = internal::floatDescriptors(descriptors);
+    TL_ASSERT(!float_descriptors.empty() && float_descriptors.cols == dimension(), "Descriptors don't match the hasher");
+
+    cv::Mat mean;
+    cv::reduce(float_descriptors, mean, 0, cv::REDUCE_AVG, CV_32F);
+
+    /// Proyectar el descriptor centrado es comparar la proyección con la de la media
+    cv::gemm(mean, mProjections, 1., cv::Mat(), 0., mThresholds, cv::GEMM_2_T);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+int CascadeHasher::dimension() const
+{
+  return mProjections.cols;
+}
+
+void CascadeHasher::hash(const cv::Mat &descriptors,
+                         std::vector<uchar> &codes,
+                         std::vector<uchar> &buckets) const
+{
+  TL_ASSERT(descriptors.type() == CV_32F && descriptors.cols == dimension(), "Descriptors don't match the hasher");
+
+  size_t size = static_cast<size_t>(descriptors.rows);
+  codes.assign(size * static_cast<size_t>(code_bytes), 0);
+  buckets.assign(size * static_cast<size_t>(tables), 0);
+
+  if (size == 0) return;
+
+  cv::Mat projections;
+  cv::gemm(descriptors, mProjections, 1., cv::Mat(), 0., projections, cv::GEMM_2_T);
+
+  const float *thresholds = mThresholds.ptr<float>(0);
+
+  for (size_t i = 0; i < size; i++) {
+
+    const float *projection = projections.ptr<float>(static_cast<int>(i));
+
+    uchar *code = &codes[i * static_cast<size_t>(code_bytes)];
+    for (int b = 0; b < code_bytes * 8; b++) {
+      if (projection[b] > thresholds[b])
+        code[b / 8] |= static_cast<uchar>(1 << (b % 8));
+    }
+
+    uchar *bucket = &buckets[i * static_cast<size_t>(tables)];
+    for (int t = 0; t < tables; t++) {
+      int offset = code_bytes * 8 + t * table_bits;
+      for (int b = 0; b < table_bits; b++) {
+        if (projection[offset + b] > thresholds[offset + b])
+          bucket[t] |= static_cast<uchar>(1 << b);
+      }
+    }
+  }
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+CascadeHashingIndex::CascadeHashingIndex(const CascadeHasher &hasher,
+                                         const cv::Mat &descriptors)
+  : mDescriptors(internal::floatDescriptors(descriptors))
+{
+  hasher.hash(mDescriptors, mCodes, mBuckets);
+
+  /// Listas de cada cubeta de cada tabla (ordenación por conteo)
+  size_t size = this->size();
+  size_t tables = CascadeHasher::tables;
+  size_t buckets = CascadeHasher::buckets;
+  size_t lists = tables * buckets;
+  mBucketStart.assign(lists + 1, 0);
+  for (size_t i = 0; i < size; i++) {
+    for (size_t t = 0; t < tables; t++) {
+      size_t list = t * buckets + mBuckets[i * tables + t];
+      mBucketStart[list + 1]++;
+    }
+  }
+
+  for (size_t l = 1; l < mBucketStart.size(); l++) mBucketStart[l] += mBucketStart[l - 1];
+
+  std::vector<int> position(mBucketStart.begin(), mBucketStart.end() - 1);
+  mBucketIndices.resize(size * tables);
+  for (size_t i = 0; i < size; i++) {
+    for (size_t t = 0; t < tables; t++) {
+      size_t list = t * buckets + mBuckets[i * tables + t];
+      mBucketIndices[static_cast<size_t>(position[list]++)] = static_cast<int>(i);
+    }
+  }
+}
+
+size_t CascadeHashingIndex::size() const
+{
+  return static_cast<size_t>(mDescriptors.rows);
+}
+
+const cv::Mat &CascadeHashingIndex::descriptors() const
+{
+  return mDescriptors;
+}
+
+void CascadeHashingIndex::knnMatch(const CascadeHashingIndex &train,
+                                   std::vector<std::vector<cv::DMatch>> &matches,
+                                   int candidates) const
+{
+  TL_ASSERT(mDescriptors.cols == train.mDescriptors.cols, "Incompatible descriptors");
+
+  matches.assign(size(), std::vector<cv::DMatch>());
+
+  size_t max_candidates = static_cast<size_t>(std::max(candidates, 2));
+  size_t tables = CascadeHasher::tables;
+  size_t buckets = CascadeHasher::buckets;
+  size_t code_bytes = CascadeHasher::code_bytes;
+  int cols = mDescriptors.cols;
+
+  /// Marca del último descriptor query que ha visto cada descriptor train
+  std::vector<int> visited(train.size(), -1);
+  std::vector<std::pair<int, int>> hamming;
+
+  for (size_t i = 0; i < size(); i++) {
+
+    const uchar *code = &mCodes[i * code_bytes];
+
+    /// Primer nivel: descriptores que comparten cubeta en alguna tabla
+    hamming.clear();
+    for (size_t t = 0; t < tables; t++) {
+      size_t list = t * buckets + mBuckets[i * tables + t];
+      for (int k = train.mBucketStart[list]; k < train.mBucketStart[list + 1]; k++) {
+        int j = train.mBucketIndices[static_cast<size_t>(k)];
+        if (visited[static_cast<size_t>(j)] == static_cast<int>(i)) continue;
+        visited[static_cast<size_t>(j)] = static_cast<int>(i);
+        /// Segundo nivel: distancia de Hamming de los códigos
+        int distance = cv::hal::normHamming(code, &train.mCodes[static_cast<size_t>(j) * code_bytes],
+                                            CascadeHasher::code_bytes);
+        hamming.emplace_back(distance, j);
+      }
+    }
+
+    if (hamming.empty()) continue;
+
+    if (hamming.size() > max_candidates) {
+      std::nth_element(hamming.begin(), hamming.begin() + static_cast<std::ptrdiff_t>(max_candidates), hamming.end());
+      hamming.resize(max_candidates);
+    }
+
+    /// Tercer nivel: distancia L2 de los mejores candidatos
+    const float *query = mDescriptors.ptr<float>(static_cast<int>(i));
+    cv::DMatch best(static_cast<int>(i), -1, std::numeric_limits<float>::max());
+    cv::DMatch second(static_cast<int>(i), -1, std::numeric_limits<float>::max());
+    for (const auto &candidate : hamming) {
+      float distance = std::sqrt(cv::hal::normL2Sqr_(query, train.mDescriptors.ptr<float>(candidate.second), cols));
+      if (distance < best.distance) {
+        second = best;
+        best = cv::DMatch(static_cast<int>(i), candidate.second, distance);
+      } else if (distance < second.distance) {
+        second = cv::DMatch(static_cast<int>(i), candidate.second, distance);
+      }
+    }
+
+    matches[i].push_back(best);
+    if (second.trainIdx >= 0) matches[i].push_back(second);
+  }
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+CascadeHashingMatcherProperties::CascadeHashingMatcherProperties()
+  : mCandidates(10),
+    mCacheSize(8)
+{
+}
+
+void CascadeHashingMatcherProperties::reset()
+{
+  mCandidates = 10;
+  mCacheSize = 8;
+}
+
+std::string CascadeHashingMatcherProperties::name() const
+{
+  return std::string("Cascade Hashing Matching");
+}
+
+int CascadeHashingMatcherProperties::candidates() const
+{
+  return mCandidates;
+}
+
+void CascadeHashingMatcherProperties::setCandidates(int candidates)
+{
+  mCandidates = candidates;
+}
+
+int CascadeHashingMatcherProperties::cacheSize() const
+{
+  return mCacheSize;
+}
+
+void CascadeHashingMatcherProperties::setCacheSize(int cacheSize)
+{
+  mCacheSize = cacheSize;
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+CascadeHashingMatcherImp::CascadeHashingMatcherImp()
+{
+}
+
+CascadeHashingMatcherImp::CascadeHashingMatcherImp(int candidates,
+                                                   int cacheSize)
+{
+  CascadeHashingMatcherProperties::setCandidates(candidates);
+  CascadeHashingMatcherProperties::setCacheSize(cacheSize);
+}
+
+void CascadeHashingMatcherImp::train(const cv::Mat &descriptors)
+{
+  try {
+
+    auto hasher = std::make_shared<CascadeHasher>(descriptors.cols);
+    hasher->train(descriptors);
+
+    std::lock_guard<std::mutex> lck(mMutex);
+    mHasher = hasher;
+    mCache.clear();
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+std::shared_ptr<const CascadeHashingIndex> CascadeHashingMatcherImp::index(const cv::Mat &descriptors)
+{
+  std::shared_ptr<const CascadeHashingIndex> index;
+
+  try {
+
+    std::shared_ptr<CascadeHasher> hasher;
+
+    {
+      std::lock_guard<std::mutex> lck(mMutex);
+
+      /// La entrada conserva una referencia a los descriptores, de modo que
+      /// sus datos no se liberan ni se reutilizan mientras estén en la caché
+      for (auto it = mCache.begin(); it != mCache.end(); it++) {
+        if (it->descriptors.data == descriptors.data &&
+            it->descriptors.rows == descriptors.rows &&
+            it->descriptors.cols == descriptors.cols &&
+            it->descriptors.type() == descriptors.type()) {
+          mCache.splice(mCache.begin(), mCache, it);
+          return mCache.front().index;
+        }
+      }
+
+      if (!mHasher) {
+        mHasher = std::make_shared<CascadeHasher>(descriptors.cols);
+        mHasher->train(descriptors);
+      }
+
+      hasher = mHasher;
+    }
+
+    index = std::make_shared<CascadeHashingIndex>(*hasher, descriptors);
+
+    std::lock_guard<std::mutex> lck(mMutex);
+    if (hasher == mHasher) {
+      mCache.push_front(CacheEntry{descriptors, index});
+      while (mCache.size() > static_cast<size_t>(std::max(this->cacheSize(), 0)))
+        mCache.pop_back();
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return index;
+}
+
+void CascadeHashingMatcherImp::match(const cv::Mat &queryDescriptors,
+                                     const cv::Mat &trainDescriptors,
+                                     std::vector<cv::DMatch> &matches,
+                                     const cv::Mat mask)
+{
+  try {
+
+    std::vector<std::vector<cv::DMatch>> knn_matches;
+    this->match(queryDescriptors, trainDescriptors, knn_matches, mask);
+
+    matches.clear();
+    matches.reserve(knn_matches.size());
+    for (const auto &knn_match : knn_matches) {
+      if (!knn_match.empty()) matches.push_back(knn_match[0]);
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void CascadeHashingMatcherImp::match(const cv::Mat &queryDescriptors,
+                                     const cv::Mat &trainDescriptors,
+                                     std::vector<std::vector<cv::DMatch>> &matches,
+                                     const cv::Mat mask)
+{
+  try {
+
+    TL_ASSERT(mask.empty(), "Cascade hashing matcher doesn't support masks");
+
+    std::shared_ptr<const CascadeHashingIndex> query_index = this->index(queryDescriptors);
+    std::shared_ptr<const CascadeHashingIndex> train_index = this->index(trainDescriptors);
+
+    query_index->knnMatch(*train_index, matches, this->candidates());
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void CascadeHashingMatcherImp::reset()
+{
+  CascadeHashingMatcherProperties::reset();
+
+  std::lock_guard<std::mutex> lck(mMutex);
+  mHasher.reset();
+  mCache.clear();
+}
+
+} // namespace tl
@@ -0,0 +1,270 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_FEATMATCH_CASCADE_HASHING_H
+#define TL_FEATMATCH_CASCADE_HASHING_H
+
+#include "config_tl.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/featmatch/matcher.h"
+
+namespace tl
+{
+
+/*! \addtogroup Features
+ *
+ *  \{
+ */
+
+/*! \addtogroup FeatureMatching
+ *
+ *  \{
+ */
+
+/*!
+ * \brief Random projections of the cascade hashing
+ *
+ * Each descriptor is projected onto 128 random directions to get its binary
+ * code, used to rank the candidates by Hamming distance, and onto 6 x 8 random
+ * directions to get its bucket in each of the 6 hash tables.
+ * The projections are centred on the mean descriptor, so every image must be
+ * hashed with the same hasher.
+ */
+class TL_EXPORT CascadeHasher
+{
+
+public:
+
+  enum
+  {
+    code_bytes = 16,
+    tables = 6,
+    table_bits = 8,
+    buckets = 1 << table_bits
+  };
+
+public:
+
+  /*!
+   * \brief Constructor
+   * \param[in] dimension Descriptor length
+   * \param[in] seed Seed of the random projections
+   */
+  explicit CascadeHasher(int dimension, unsigned int seed = 0);
+  ~CascadeHasher() = default;
+
+  /*!
+   * \brief Computes the mean descriptor
+   * \param[in] descriptors Sample of descriptors of the images
+   */
+  void train(const cv::Mat &descriptors);
+
+  int dimension() const;
+
+  /*!
+   * \brief Hashes the descriptors
+   * \param[in] descriptors Descriptors (CV_32F)
+   * \param[out] codes Binary code of each descriptor (code_bytes per descriptor)
+   * \param[out] buckets Bucket of each descriptor in each table (tables per descriptor)
+   */
+  void hash(const cv::Mat &descriptors,
+            std::vector<uchar> &codes,
+            std::vector<uchar> &buckets) const;
+
+private:
+
+  cv::Mat mProjections;
+  cv::Mat mThresholds;
+
+};
+
+
+/*!
+ * \brief Cascade hashing index of the descriptors of an image
+ *
+ * Cheng J., Leng C., Wu J., Cui H., Lu H. (2014) Fast and Accurate Image
+ * Matching with Cascade Hashing for 3D Reconstruction. IEEE Conference on
+ * Computer Vision and Pattern Recognition
+ *
+ * The index is built once per image and can be shared between threads and
+ * reused for all the pairs of the image.
+ */
+class TL_EXPORT CascadeHashingIndex
+{
+
+public:
+
+  CascadeHashingIndex(const CascadeHasher &hasher,
+                      const cv::Mat &descriptors);
+  ~CascadeHashingIndex() = default;
+
+  size_t size() const;
+
+  const cv::Mat &descriptors() const;
+
+  /*!
+   * \brief Two nearest neighbours of each descriptor in the train index
+   * The candidates are the train descriptors that share a bucket with the
+   * query descriptor in any table. They are ranked by the Hamming distance
+   * of the binary codes and the best ones are re-ranked with the L2 distance.
+   * \param[in] train Train index
+   * \param[out] matches Nearest neighbours of each query descriptor
+   * \param[in] candidates Number of candidates re-ranked
+   */
+  void knnMatch(const CascadeHashingIndex &train,
+                std::vector<std::vector<cv::DMatch>> &matches,
+                int candidates) const;
+
+private:
+
+  cv::Mat mDescriptors;
+  std::vector<uchar> mCodes;
+  std::vector<uchar> mBuckets;
+  std::vector<int> mBucketStart;
+  std::vector<int> mBucketIndices;
+
+};
+
+
+/*----------------------------------------------------------------*/
+
+
+class TL_EXPORT CascadeHashingMatcherProperties
+  : public CascadeHashingMatcher
+{
+
+public:
+
+  CascadeHashingMatcherProperties();
+  ~CascadeHashingMatcherProperties() override = default;
+
+// MatchingMethod interface
+
+public:
+
+  void reset() override;
+  std::string name() const final;
+
+// CascadeHashingMatcher interface
+
+public:
+
+  int candidates() const override;
+  void setCandidates(int candidates) override;
+  int cacheSize() const override;
+  void setCacheSize(int cacheSize) override;
+
+private:
+
+  int mCandidates;
+  int mCacheSize;
+
+};
+
+
+/*----------------------------------------------------------------*/
+
+
+/*!
+ * \brief Cascade hashing matcher for float descriptors (SIFT, SURF, KAZE, ...)
+ *
+ * The indexes of the most recently matched images are kept, so the index of an
+ * image is built once and reused for the consecutive pairs of the image (the
+ * pairs sorted by their first image, as BlockMatching does). The hasher is
+ * trained with the first query image unless it is trained explicitly.
+ *
+ * \code
+ * auto matcher = std::make_shared<CascadeHashingMatcherImp>();
+ * auto robust_matcher = std::make_shared<RobustMatchingImp>(matcher);
+ * \endcode
+ */
+class TL_EXPORT CascadeHashingMatcherImp
+  : public CascadeHashingMatcherProperties,
+    public DescriptorMatcher
+{
+
+public:
+
+  CascadeHashingMatcherImp();
+  CascadeHashingMatcherImp(int candidates,
+                           int cacheSize);
+  ~CascadeHashingMatcherImp() override = default;
+
+  /*!
+   * \brief Trains the hasher with a sample of descriptors of the images
+   */
+  void train(const cv::Mat &descriptors);
+
+  /*!
+   * \brief Index of the descriptors, from the cache if they were already indexed
+   */
+  std::shared_ptr<const CascadeHashingIndex> index(const cv::Mat &descriptors);
+
+// DescriptorMatcher interface
+
+public:
+
+  void match(const cv::Mat &queryDescriptors,
+             const cv::Mat &trainDescriptors,
+             std::vector<cv::DMatch> &matches,
+             const cv::Mat mask = cv::Mat()) override;
+
+  void match(const cv::Mat &queryDescriptors,
+             const cv::Mat &trainDescriptors,
+             std::vector<std::vector<cv::DMatch>> &matches,
+             const cv::Mat mask = cv::Mat()) override;
+
+// MatchingMethod interface
+
+public:
+
+  void reset() override;
+
+private:
+
+  struct CacheEntry
+  {
+    cv::Mat descriptors;
+    std::shared_ptr<const CascadeHashingIndex> index;
+  };
+
+  std::shared_ptr<CascadeHasher> mHasher;
+  std::list<CacheEntry> mCache;
+  std::mutex mMutex;
+
+};
+
+/*! \} */ // end of FeatureMatching
+
+/*! \} */ // end of Features
+
+} // namespace tl
+
+#endif // TL_FEATMATCH_CASCADE_HASHING_H
@@ -0,0 +1,321 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "featextraction.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "tidop/core/concurrency.h"
+#include "tidop/core/exception.h"
+#include "tidop/core/messages.h"
+#include "tidop/core/progress.h"
+#include "tidop/featmatch/featio.h"
+
+namespace tl
+{
+
+namespace internal
+{
+
+struct DecodedImage
+{
+  size_t id;
+  cv::Mat image;
+  double scale;
+};
+
+struct ExtractedFeatures
+{
+  size_t id;
+  std::vector<cv::KeyPoint> keyPoints;
+  cv::Mat descriptors;
+};
+
+} // namespace internal
+
+
+FeatureExtractionPipeline::FeatureExtractionPipeline(DetectorFactory detectorFactory,
+                                                     DescriptorFactory descriptorFactory)
+  : mDetectorFactory(std::move(detectorFactory)),
+    mDescriptorFactory(std::move(descriptorFactory)),
+    mMaxImageSize(0),
+    mThreads(0),
+    mDecodeThreads(2),
+    mQueueCapacity(8),
+    mExtension(".bin")
+{
+}
+
+int FeatureExtractionPipeline::maxImageSize() const
+{
+  return mMaxImageSize;
+}
+
+void FeatureExtractionPipeline::setMaxImageSize(int maxImageSize)
+{
+  mMaxImageSize = maxImageSize;
+}
+
+size_t FeatureExtractionPipeline::threads() const
+{
+  return mThreads;
+}
+
+void FeatureExtractionPipeline::setThreads(size_t threads)
+{
+  mThreads = threads;
+}
+
+size_t FeatureExtractionPipeline::decodeThreads() const
+{
+  return mDecodeThreads;
+}
+
+void FeatureExtractionPipeline::setDecodeThreads(size_t decodeThreads)
+{
+  mDecodeThreads = decodeThreads;
+}
+
+size_t FeatureExtractionPipeline::queueCapacity() const
+{
+  return mQueueCapacity;
+}
+
+void FeatureExtractionPipeline::setQueueCapacity(size_t queueCapacity)
+{
+  mQueueCapacity = queueCapacity;
+}
+
+std::string FeatureExtractionPipeline::extension() const
+{
+  return mExtension;
+}
+
+void FeatureExtractionPipeline::setExtension(const std::string &extension)
+{
+  mExtension = extension;
+}
+
+void FeatureExtractionPipeline::run(const std::vector<Path> &images,
+                                    const Path &outputDirectory,
+                                    Progress *progress)
+{
+  try {
+
+    if (!outputDirectory.exists() && !outputDirectory.createDirectories())
+      TL_THROW_EXCEPTION("Can't create the directory: %s", outputDirectory.toString().c_str());
+
+    std::vector<Path> features;
+    features.reserve(images.size());
+    for (const auto &image : images) {
+      Path feature_file(outputDirectory);
+      feature_file.append(image.baseName());
+      feature_file.replaceExtension(mExtension);
+      features.push_back(feature_file);
+    }
+
+    run(images, features, progress);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void FeatureExtractionPipeline::run(const std::vector<Path> &images,
+                                    const std::vector<Path> &features,
+                                    Progress *progress)
+{
+  try {
+
+    TL_ASSERT(images.size() == features.size(), "The number of images and feature files doesn't match");
+    TL_ASSERT(mDetectorFactory && mDescriptorFactory, "Detector or descriptor factory not defined");
+
+    size_t size = images.size();
+    if (size == 0) return;
+
+    size_t workers = mThreads == 0 ? optimalNumberOfThreads() : mThreads;
+    workers = std::max<size_t>(1, std::min(workers, size));
+    size_t decoders = std::max<size_t>(1, std::min(mDecodeThreads, size));
+    size_t capacity = std::max<size_t>(1, mQueueCapacity);
+
+    if (progress) {
+      progress->setRange(0, size);
+      progress->setText("Feature extraction");
+    }
+
+    QueueMPMC<internal::DecodedImage> decoded(capacity);
+    QueueMPMC<internal::ExtractedFeatures> extracted(capacity);
+
+    std::atomic<size_t> next_image(0);
+    std::atomic<size_t> active_decoders(decoders);
+    std::atomic<size_t> active_workers(workers);
+    std::atomic<size_t> skipped(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex mutex;
+
+    auto advance = [&]() {
+      std::lock_guard<std::mutex> lck(mutex);
+      if (progress) (*progress)();
+    };
+
+    auto fail = [&]() {
+      {
+        std::lock_guard<std::mutex> lck(mutex);
+        if (!failed) error = std::current_exception();
+        failed = true;
+      }
+      decoded.stop();
+      extracted.stop();
+    };
+
+    /// Lectura de imágenes
+    auto decode = [&]() {
+
+      try {
+
+        for (size_t id = next_image++; id < size && !failed; id = next_image++) {
+
+          internal::DecodedImage item;
+          item.id = id;
+          item.scale = 1.;
+          item.image = cv::imread(images[id].toString(), cv::IMREAD_IGNORE_ORIENTATION | cv::IMREAD_GRAYSCALE);
+
+          if (item.image.empty()) {
+            msgError("Could not load image: %s", images[id].toString().c_str());
+            skipped++;
+            advance();
+            continue;
+          }
+
+          int max_dimension = std::max(item.image.rows, item.image.cols);
+          if (mMaxImageSize > 0 && max_dimension > mMaxImageSize) {
+            item.scale = static_cast<double>(mMaxImageSize) / max_dimension;
+            cv::resize(item.image, item.image, cv::Size(), item.scale, item.scale, cv::INTER_AREA);
+          }
+
+          decoded.push(item);
+        }
+
+      } catch (...) {
+        fail();
+      }
+
+      if (--active_decoders == 0) decoded.stop();
+    };
+
+    /// Detección y descripción. Cada hilo con su propio detector y descriptor
+    auto detect = [&]() {
+
+      try {
+
+        std::shared_ptr<KeypointDetector> detector = mDetectorFactory();
+        std::shared_ptr<DescriptorExtractor> descriptor = mDescriptorFactory(detector);
+        TL_ASSERT(detector && descriptor, "Invalid detector or descriptor");
+
+        internal::DecodedImage item;
+        while (!failed && decoded.pop(item)) {
+
+          try {
+
+            internal::ExtractedFeatures result;
+            result.id = item.id;
+            result.keyPoints = detector->detect(item.image);
+            result.descriptors = descriptor->extract(item.image, result.keyPoints);
+
+            if (item.scale != 1.) {
+              for (auto &key_point : result.keyPoints) {
+                key_point.pt.x = static_cast<float>((key_point.pt.x + 0.5) / item.scale - 0.5);
+                key_point.pt.y = static_cast<float>((key_point.pt.y + 0.5) / item.scale - 0.5);
+                key_point.size = static_cast<float>(key_point.size / item.scale);
+              }
+            }
+
+            extracted.push(result);
+
+          } catch (const std::exception &e) {
+            msgError("Feature extraction failed for image %s: %s", images[item.id].toString().c_str(), e.what());
+            skipped++;
+            advance();
+          }
+
+          item.image.release();
+        }
+
+      } catch (...) {
+        fail();
+      }
+
+      if (--active_workers == 0) extracted.stop();
+    };
+
+    /// Escritura
+    auto write = [&]() {
+
+      try {
+
+        internal::ExtractedFeatures item;
+        while (!failed && extracted.pop(item)) {
+
+          std::unique_ptr<FeaturesWriter> writer = FeaturesWriterFactory::create(features[item.id]);
+          writer->setKeyPoints(item.keyPoints);
+          writer->setDescriptors(item.descriptors);
+          writer->write();
+
+          msgInfo("%i keypoints extracted from %s", static_cast<int>(item.keyPoints.size()),
+                  images[item.id].fileName().toString().c_str());
+
+          advance();
+        }
+
+      } catch (...) {
+        fail();
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(decoders + workers + 1);
+    for (size_t i = 0; i < decoders; i++) threads.emplace_back(decode);
+    for (size_t i = 0; i < workers; i++) threads.emplace_back(detect);
+    threads.emplace_back(write);
+
+    for (auto &thread : threads) thread.join();
+
+    if (error) std::rethrow_exception(error);
+
+    if (skipped > 0) msgWarning("%i images skipped", static_cast<int>(skipped));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+} // namespace tl
@@ -0,0 +1,169 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_FEATMATCH_FEATURE_EXTRACTION_H
+#define TL_FEATMATCH_FEATURE_EXTRACTION_H
+
+#include "config_tl.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/path.h"
+#include "tidop/featmatch/features.h"
+
+namespace tl
+{
+
+class Progress;
+
+/*! \addtogroup Features
+ *
+ *  \{
+ */
+
+/*!
+ * \brief Feature extraction for a list of images
+ *
+ * The extraction runs as three overlapped stages connected by bounded queues:
+ * - decoding: images are read (grayscale) and optionally downscaled
+ * - detection and description: each worker thread owns its own detector and
+ *   descriptor instances, created with the factories, so no instance is ever
+ *   shared between threads
+ * - writing: one thread serializes the features while the other stages go on
+ *
+ * The bounded queues keep the memory in use independent of the number of
+ * images. Keypoints detected on a downscaled image are returned in the
+ * coordinates of the full resolution image. An image that can't be read or
+ * processed is reported and skipped; an error writing the features stops the
+ * extraction.
+ *
+ * \code
+ * FeatureExtractionPipeline pipeline([]() {
+ *                                      return std::make_shared<SiftDetectorDescriptor>();
+ *                                    },
+ *                                    [](std::shared_ptr<KeypointDetector> detector) {
+ *                                      return std::dynamic_pointer_cast<DescriptorExtractor>(detector);
+ *                                    });
+ * pipeline.setMaxImageSize(3000);
+ * pipeline.run(images, "features");
+ * \endcode
+ */
+class TL_EXPORT FeatureExtractionPipeline
+{
+
+public:
+
+  using DetectorFactory = std::function<std::shared_ptr<KeypointDetector>()>;
+  using DescriptorFactory = std::function<std::shared_ptr<DescriptorExtractor>(std::shared_ptr<KeypointDetector>)>;
+
+public:
+
+  /*!
+   * \brief Constructor
+   * \param[in] detectorFactory Creates a detector for each worker
+   * \param[in] descriptorFactory Creates a descriptor for each worker. It
+   * receives the worker detector so detector-descriptors can be reused
+   */
+  FeatureExtractionPipeline(DetectorFactory detectorFactory,
+                            DescriptorFactory descriptorFactory);
+  ~FeatureExtractionPipeline() = default;
+
+  TL_DISABLE_COPY(FeatureExtractionPipeline)
+  TL_DISABLE_MOVE(FeatureExtractionPipeline)
+
+  /*!
+   * \brief Maximum image size (rows or columns) for detection
+   * Larger images are downscaled. 0 (default) disables the downscaling
+   */
+  int maxImageSize() const;
+  void setMaxImageSize(int maxImageSize);
+
+  /*!
+   * \brief Number of detection workers. 0 (default) uses all the cores
+   */
+  size_t threads() const;
+  void setThreads(size_t threads);
+
+  /*!
+   * \brief Number of image decoding threads (default 2)
+   */
+  size_t decodeThreads() const;
+  void setDecodeThreads(size_t decodeThreads);
+
+  /*!
+   * \brief Capacity of the queues between stages (default 8)
+   */
+  size_t queueCapacity() const;
+  void setQueueCapacity(size_t queueCapacity);
+
+  /*!
+   * \brief Extension of the feature files, which selects the format (default ".bin")
+   * \see FeaturesWriterFactory
+   */
+  std::string extension() const;
+  void setExtension(const std::string &extension);
+
+  /*!
+   * \brief Extracts the features of a list of images
+   * The feature file of each image is written in the output directory with
+   * the base name of the image and the extension of the pipeline
+   * \param[in] images Images
+   * \param[in] outputDirectory Output directory
+   * \param[in] progress Progress bar
+   */
+  void run(const std::vector<Path> &images,
+           const Path &outputDirectory,
+           Progress *progress = nullptr);
+
+  /*!
+   * \brief Extracts the features of a list of images
+   * \param[in] images Images
+   * \param[in] features Feature file for each image
+   * \param[in] progress Progress bar
+   */
+  void run(const std::vector<Path> &images,
+           const std::vector<Path> &features,
+           Progress *progress = nullptr);
+
+private:
+
+  DetectorFactory mDetectorFactory;
+  DescriptorFactory mDescriptorFactory;
+  int mMaxImageSize;
+  size_t mThreads;
+  size_t mDecodeThreads;
+  size_t mQueueCapacity;
+  std::string mExtension;
+
+};
+
+/*! \} */ // end of Features
+
+} // namespace tl
+
+#endif // TL_FEATMATCH_FEATURE_EXTRACTION_H
@@ -24,6 +24,13 @@
 
 #include "flann.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+
+#include <opencv2/flann.hpp>
+
 #include "tidop/core/messages.h"
 #include "tidop/core/exception.h"
 
@@ -31,7 +38,8 @@ namespace tl
 {
 
 FlannMatcherProperties::FlannMatcherProperties()
-  : mIndex(FlannMatcherProperties::Index::kdtree)
+  : mIndex(FlannMatcherProperties::Index::kdtree),
+    mCacheSize(8)
 {
 }
 
@@ -42,6 +50,7 @@ FlannMatcherProperties::~FlannMatcherProperties()
 void FlannMatcherProperties::reset()
 {
   mIndex = FlannMatcherProperties::Index::kdtree;
+  mCacheSize = 8;
 }
 
 std::string FlannMatcherProperties::name() const
@@ -59,6 +68,194 @@ void FlannMatcherProperties::setIndex(FlannMatcher::Index index)
   mIndex = index;
 }
 
+int FlannMatcherProperties::cacheSize() const
+{
+  return mCacheSize;
+}
+
+void FlannMatcherProperties::setCacheSize(int cacheSize)
+{
+  mCacheSize = cacheSize;
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+namespace internal
+{
+
+/*!
+ * \brief Descriptores en el formato del índice: CV_32F para el KD-tree y CV_8U para LSH
+ */
+inline cv::Mat flannDescriptors(const cv::Mat &descriptors,
+                                FlannMatcher::Index index)
+{
+  cv::Mat flann_descriptors = descriptors;
+
+  if (index == FlannMatcher::Index::kdtree) {
+    if (descriptors.depth() != CV_32F)
+      descriptors.convertTo(flann_descriptors, CV_32F);
+  } else {
+    TL_ASSERT(descriptors.empty() || descriptors.depth() == CV_8U, "LSH index requires binary descriptors");
+  }
+
+  return flann_descriptors;
+}
+
+} // namespace internal
+
+
+FlannIndex::FlannIndex(const cv::Mat &descriptors,
+                       FlannMatcher::Index index)
+  : mDescriptors(internal::flannDescriptors(descriptors, index)),
+    mIndexType(index)
+{
+  if (mDescriptors.empty()) return;
+
+  if (index == FlannMatcher::Index::kdtree) {
+    mIndex = std::make_shared<cv::flann::Index>(mDescriptors,
+                                                cv::flann::KDTreeIndexParams(),
+                                                cvflann::FLANN_DIST_L2);
+  } else {
+    mIndex = std::make_shared<cv::flann::Index>(mDescriptors,
+                                                cv::flann::LshIndexParams(12, 20, 2),
+                                                cvflann::FLANN_DIST_HAMMING);
+  }
+}
+
+FlannIndex::FlannIndex(const cv::Mat &descriptors,
+                       FlannMatcher::Index index,
+                       const Path &file)
+  : mDescriptors(internal::flannDescriptors(descriptors, index)),
+    mIndexType(index)
+{
+  if (mDescriptors.empty()) return;
+
+  auto flann_index = std::make_shared<cv::flann::Index>();
+
+  bool loaded = false;
+  try {
+    loaded = flann_index->load(mDescriptors, file.toString());
+  } catch (...) {
+    loaded = false;
+  }
+
+  if (loaded) {
+    mIndex = flann_index;
+    if (!isIndexOf(mDescriptors)) mIndex.reset();
+  }
+}
+
+std::shared_ptr<FlannIndex> FlannIndex::create(const cv::Mat &descriptors,
+                                               FlannMatcher::Index index,
+                                               const Path &file)
+{
+  std::shared_ptr<FlannIndex> flann_index;
+
+  try {
+
+    if (!file.empty() && file.exists() && !descriptors.empty()) {
+      flann_index = std::shared_ptr<FlannIndex>(new FlannIndex(descriptors, index, file));
+      if (flann_index->mIndex) return flann_index;
+      msgWarning("Index file %s doesn't match the descriptors. The index is rebuilt", file.toString().c_str());
+    }
+
+    flann_index = std::make_shared<FlannIndex>(descriptors, index);
+
+    if (!file.empty() && flann_index->mIndex) {
+      try {
+        flann_index->save(file);
+      } catch (std::exception &e) {
+        msgWarning("Index file %s not saved: %s", file.toString().c_str(), e.what());
+      }
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return flann_index;
+}
+
+Path FlannIndex::indexFile(const Path &features)
+{
+  Path file(features);
+  file.replaceExtension(".flann");
+  return file;
+}
+
+void FlannIndex::save(const Path &file) const
+{
+  try {
+
+    TL_ASSERT(mIndex, "Empty index");
+
+    mIndex->save(file.toString());
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+size_t FlannIndex::size() const
+{
+  return static_cast<size_t>(mDescriptors.rows);
+}
+
+void FlannIndex::knnSearch(const cv::Mat &queryDescriptors,
+                           std::vector<std::vector<cv::DMatch>> &matches,
+                           int knn) const
+{
+  matches.assign(static_cast<size_t>(queryDescriptors.rows), std::vector<cv::DMatch>());
+
+  int k = std::min(knn, static_cast<int>(size()));
+  if (!mIndex || queryDescriptors.empty() || k <= 0) return;
+
+  cv::Mat query = internal::flannDescriptors(queryDescriptors, mIndexType);
+  TL_ASSERT(query.cols == mDescriptors.cols, "Incompatible descriptors");
+
+  cv::Mat indices;
+  cv::Mat dists;
+  mIndex->knnSearch(query, indices, dists, k, cv::flann::SearchParams());
+
+  /// Las distancias del KD-tree son L2 al cuadrado y las de LSH enteras (Hamming)
+  cv::Mat distances;
+  dists.convertTo(distances, CV_32F);
+
+  for (int i = 0; i < query.rows; i++) {
+    std::vector<cv::DMatch> &query_matches = matches[static_cast<size_t>(i)];
+    for (int j = 0; j < k; j++) {
+      int train_idx = indices.at<int>(i, j);
+      if (train_idx < 0) continue;
+      float distance = distances.at<float>(i, j);
+      if (mIndexType == FlannMatcher::Index::kdtree) distance = std::sqrt(distance);
+      query_matches.emplace_back(i, train_idx, distance);
+    }
+  }
+}
+
+bool FlannIndex::isIndexOf(const cv::Mat &descriptors) const
+{
+  cvflann::flann_algorithm_t algorithm = mIndex->getAlgorithm();
+  if ((mIndexType == FlannMatcher::Index::kdtree && algorithm != cvflann::FLANN_INDEX_KDTREE) ||
+      (mIndexType == FlannMatcher::Index::lsh && algorithm != cvflann::FLANN_INDEX_LSH))
+    return false;
+
+  /// Un índice de otro conjunto con el mismo tamaño no encuentra los descriptores a distancia cero
+  int samples = std::min(descriptors.rows, 8);
+  for (int s = 0; s < samples; s++) {
+    int row = static_cast<int>(static_cast<int64_t>(s) * descriptors.rows / samples);
+    std::vector<std::vector<cv::DMatch>> matches;
+    knnSearch(descriptors.row(row), matches, 1);
+    if (matches[0].empty() || matches[0][0].distance > 0.f) return false;
+  }
+
+  return true;
+}
+
 
 /*----------------------------------------------------------------*/
 
@@ -74,6 +271,70 @@ FlannMatcherImp::FlannMatcherImp(Index index)
   update();
 }
 
+std::shared_ptr<const FlannIndex> FlannMatcherImp::flannIndex(const cv::Mat &descriptors,
+                                                              const Path &features)
+{
+  std::shared_ptr<const FlannIndex> flann_index;
+
+  try {
+
+    std::promise<std::shared_ptr<const FlannIndex>> promise;
+    std::shared_future<std::shared_ptr<const FlannIndex>> future;
+    bool build = false;
+
+    {
+      std::lock_guard<std::mutex> lck(mMutex);
+
+      /// La entrada conserva una referencia a los descriptores, de modo que
+      /// sus datos no se liberan ni se reutilizan mientras estén en la caché
+      auto it = std::find_if(mCache.begin(), mCache.end(), [&descriptors](const CacheEntry &entry) {
+        return entry.descriptors.data == descriptors.data &&
+               entry.descriptors.rows == descriptors.rows &&
+               entry.descriptors.cols == descriptors.cols &&
+               entry.descriptors.type() == descriptors.type();
+      });
+
+      if (it != mCache.end()) {
+        mCache.splice(mCache.begin(), mCache, it);
+        future = it->index;
+      } else {
+        /// Las demás peticiones de la imagen esperan a que se construya el índice
+        future = promise.get_future().share();
+        mCache.push_front(CacheEntry{descriptors, future});
+        while (mCache.size() > static_cast<size_t>(std::max(this->cacheSize(), 1)))
+          mCache.pop_back();
+        build = true;
+      }
+    }
+
+    if (build) {
+      try {
+        Path file = features.empty() ? Path() : FlannIndex::indexFile(features);
+        promise.set_value(FlannIndex::create(descriptors, FlannMatcherProperties::index(), file));
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lck(mMutex);
+        mCache.remove_if([&descriptors](const CacheEntry &entry) {
+          return entry.descriptors.data == descriptors.data;
+        });
+      }
+    }
+
+    flann_index = future.get();
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return flann_index;
+}
+
+void FlannMatcherImp::clearCache()
+{
+  std::lock_guard<std::mutex> lck(mMutex);
+  mCache.clear();
+}
+
 void FlannMatcherImp::update()
 {
   cv::Ptr<cv::flann::IndexParams> indexParams;
@@ -92,7 +353,17 @@ void FlannMatcherImp::match(const cv::Mat &queryDescriptors,
 {
   try {
 
-    mFlannBasedMatcher->match(queryDescriptors, trainDescriptors, matches, mask);
+    if (!mask.empty()) {
+      mFlannBasedMatcher->match(queryDescriptors, trainDescriptors, matches, mask);
+    } else {
+      std::vector<std::vector<cv::DMatch>> knn_matches;
+      flannIndex(trainDescriptors)->knnSearch(queryDescriptors, knn_matches, 1);
+      matches.clear();
+      matches.reserve(knn_matches.size());
+      for (const auto &knn_match : knn_matches) {
+        if (!knn_match.empty()) matches.push_back(knn_match[0]);
+      }
+    }
 
   } catch (...) {
     TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
@@ -106,7 +377,11 @@ void FlannMatcherImp::match(const cv::Mat &queryDescriptors,
 {
   try {
 
-    mFlannBasedMatcher->knnMatch(queryDescriptors, trainDescriptors, matches, 2, mask);
+    if (!mask.empty()) {
+      mFlannBasedMatcher->knnMatch(queryDescriptors, trainDescriptors, matches, 2, mask);
+    } else {
+      flannIndex(trainDescriptors)->knnSearch(queryDescriptors, matches, 2);
+    }
 
   } catch (...) {
     TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
@@ -117,11 +392,14 @@ void FlannMatcherImp::reset()
 {
   FlannMatcherProperties::reset();
   update();
+  clearCache();
 }
 
 void FlannMatcherImp::setIndex(FlannMatcher::Index index)
 {
   FlannMatcherProperties::setIndex(index);
+  update();
+  clearCache();
 }
 
 
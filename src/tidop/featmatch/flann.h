@@ -25,8 +25,22 @@
 #ifndef TL_FEATMATCH_FLANN_MATCHER_H
 #define TL_FEATMATCH_FLANN_MATCHER_H
 
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+
+#include "tidop/core/path.h"
 #include "tidop/featmatch/matcher.h"
 
+namespace cv
+{
+namespace flann
+{
+class Index;
+}
+}
+
 namespace tl
 {
 
@@ -52,16 +66,108 @@ public:
 
   Index index() const override;
   virtual void setIndex(Index index) override;
+  int cacheSize() const override;
+  void setCacheSize(int cacheSize) override;
 
 private:
 
   Index mIndex;
+  int mCacheSize;
+};
+
+
+/*----------------------------------------------------------------*/
+
+
+/*!
+ * \brief FLANN index of the descriptors of an image
+ *
+ * KD-tree index (L2) for float descriptors or LSH index (Hamming) for binary
+ * descriptors. The index is built once and can be saved next to the features
+ * file to be loaded instead of rebuilt. Searches don't modify the index, so
+ * it can be queried from several threads.
+ */
+class TL_EXPORT FlannIndex
+{
+
+public:
+
+  /*!
+   * \brief Builds the index
+   * \param[in] descriptors Descriptors of the image
+   * \param[in] index Type of index
+   */
+  FlannIndex(const cv::Mat &descriptors,
+             FlannMatcher::Index index);
+  ~FlannIndex() = default;
+
+  /*!
+   * \brief Loads the index from file or builds it and saves it
+   * A saved index is only used if it belongs to the descriptors.
+   * \param[in] descriptors Descriptors of the image
+   * \param[in] index Type of index
+   * \param[in] file Index file. Empty to build the index without saving it
+   * \return Index
+   */
+  static std::shared_ptr<FlannIndex> create(const cv::Mat &descriptors,
+                                            FlannMatcher::Index index,
+                                            const Path &file = Path());
+
+  /*!
+   * \brief Index file of a features file (same name, extension .flann)
+   */
+  static Path indexFile(const Path &features);
+
+  void save(const Path &file) const;
+
+  size_t size() const;
+
+  /*!
+   * \brief k nearest neighbours of the query descriptors
+   * \param[in] queryDescriptors Query descriptors
+   * \param[out] matches Nearest neighbours of each query descriptor
+   * \param[in] knn Number of neighbours
+   */
+  void knnSearch(const cv::Mat &queryDescriptors,
+                 std::vector<std::vector<cv::DMatch>> &matches,
+                 int knn) const;
+
+private:
+
+  FlannIndex(const cv::Mat &descriptors,
+             FlannMatcher::Index index,
+             const Path &file);
+
+  bool isIndexOf(const cv::Mat &descriptors) const;
+
+private:
+
+  cv::Mat mDescriptors;
+  FlannMatcher::Index mIndexType;
+  std::shared_ptr<cv::flann::Index> mIndex;
+
 };
 
 
 /*----------------------------------------------------------------*/
 
 
+/*!
+ * \brief FLANN based matcher
+ *
+ * The index of the train descriptors is kept in a cache of the most recently
+ * used images, so an image is indexed once and not once per pair. The cache
+ * is thread safe: a matcher shared by several matching workers indexes each
+ * image once for all of them.
+ *
+ * \code
+ * auto matcher = std::make_shared<FlannMatcherImp>();
+ * matcher->setCacheSize(64);
+ * BlockMatching block_matching([matcher]() {
+ *   return std::make_shared<RobustMatchingImp>(matcher);
+ * });
+ * \endcode
+ */
 class TL_EXPORT FlannMatcherImp
   : public FlannMatcherProperties,
     public DescriptorMatcher
@@ -73,9 +179,23 @@ public:
   explicit FlannMatcherImp(FlannMatcher::Index index);
   ~FlannMatcherImp() override = default;
 
+  /*!
+   * \brief Index of the descriptors of an image
+   * The index is taken from the cache or, if the features file is given,
+   * loaded from the index file next to it. Otherwise it is built (and saved
+   * next to the features file).
+   * \param[in] descriptors Descriptors of the image
+   * \param[in] features Features file of the image
+   * \return Index
+   * \see FlannIndex::indexFile
+   */
+  std::shared_ptr<const FlannIndex> flannIndex(const cv::Mat &descriptors,
+                                               const Path &features = Path());
+
 private:
 
   void update();
+  void clearCache();
 
 // DescriptorMatcher interface
 
@@ -105,7 +225,16 @@ public:
 
 private:
 
+  struct CacheEntry
+  {
+    cv::Mat descriptors;
+    std::shared_future<std::shared_ptr<const FlannIndex>> index;
+  };
+
+  /// Sólo se utiliza con máscara, que el índice no admite
   cv::Ptr<cv::FlannBasedMatcher> mFlannBasedMatcher;
+  std::list<CacheEntry> mCache;
+  std::mutex mMutex;
 
 };
 
@@ -24,8 +24,12 @@
 
 #include "gsm.h"
 
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <utility>
 
+#include "tidop/core/concurrency.h"
 #include "tidop/core/messages.h"
 #include "tidop/core/exception.h"
 
@@ -111,48 +115,257 @@ bool GsmImp::compute(const cv::Mat &queryDescriptor,
 {  
   try {
 
-#ifdef HAVE_OPENCV_XFEATURES2D
-
-#if CV_VERSION_MAJOR >= 4 || (CV_VERSION_MAJOR >= 3 && CV_VERSION_MINOR >= 4 && CV_VERSION_REVISION >= 1 )
-
-
     if (goodMatches == nullptr) return true;
 
     std::vector<cv::DMatch> matches;
     mDescriptorMatcher->match(queryDescriptor, trainDescriptor, matches);
 
-    cv::xfeatures2d::matchGMS(queryImageSize, trainImageSize, keypoints1, keypoints2, matches, *goodMatches);
+    std::vector<bool> inliers = gmsInliers(keypoints1, queryImageSize,
+                                           keypoints2, trainImageSize,
+                                           matches,
+                                           GmsProperties::rotation(),
+                                           GmsProperties::scale(),
+                                           GmsProperties::threshold());
+
+    goodMatches->clear();
+    if (wrongMatches) wrongMatches->clear();
 
     for (size_t i = 0; i < matches.size(); i++) {
-      bool bWrong = true;
-      for (size_t j = 0; j < goodMatches->size(); j++) {
-        if (matches[i].queryIdx == (*goodMatches)[j].queryIdx &&
-            matches[i].trainIdx == (*goodMatches)[j].trainIdx) {
-          bWrong = false;
-          break;
-        }
-      }
-      if (bWrong) {
+      if (inliers[i]) {
+        goodMatches->push_back(matches[i]);
+      } else if (wrongMatches) {
         wrongMatches->push_back(matches[i]);
       }
     }
 
-    TL_TODO("devolver wrongMatches")
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return false;
+}
+
+
+/*----------------------------------------------------------------*/
+
+
+namespace internal
+{
+
+constexpr int gms_grid_size = 20;
+constexpr int gms_grid_cells = gms_grid_size * gms_grid_size;
+
+const double gms_scale_ratios[5] = {1., 1. / 2., 1. / std::sqrt(2.), std::sqrt(2.), 2.};
+
+/// Correspondencia de la vecindad 3x3 para cada una de las 8 rotaciones
+const int gms_rotation_patterns[8][9] = {
+  {1, 2, 3, 4, 5, 6, 7, 8, 9},
+  {4, 1, 2, 7, 5, 3, 8, 9, 6},
+  {7, 4, 1, 8, 5, 2, 9, 6, 3},
+  {8, 7, 4, 9, 5, 1, 6, 3, 2},
+  {9, 8, 7, 6, 5, 4, 3, 2, 1},
+  {6, 9, 8, 3, 5, 7, 2, 1, 4},
+  {3, 6, 9, 2, 5, 8, 1, 4, 7},
+  {2, 3, 6, 1, 5, 9, 4, 7, 8}
+};
+
+/*!
+ * \brief Celda vecina (0-8, por filas) de una celda. -1 fuera de la rejilla
+ */
+inline int gmsNeighbor(int cell, int gridSize, int neighbor)
+{
+  int x = cell % gridSize + neighbor % 3 - 1;
+  int y = cell / gridSize + neighbor / 3 - 1;
+  if (x < 0 || y < 0 || x >= gridSize || y >= gridSize) return -1;
+  return x + y * gridSize;
+}
+
+/*!
+ * \brief Buffers de cada hilo
+ */
+struct GmsWorker
+{
+  std::vector<int> motion;
+  std::vector<int> pointsPerCell;
+  std::vector<int> cellPairs;
+  std::vector<int> maxCount;
+  std::vector<int> leftCell;
+  std::vector<int> rightCell;
+  std::vector<bool> inliers;
+};
+
+/*!
+ * \brief Evaluación de una hipótesis de escala y rotación
+ * \return Número de inliers
+ */
+inline size_t gmsRun(GmsWorker &worker,
+                     const std::vector<cv::Point2f> &points1,
+                     const std::vector<cv::Point2f> &points2,
+                     int scale,
+                     int rotation,
+                     double threshold)
+{
+  size_t size = points1.size();
+  int grid_right = static_cast<int>(gms_grid_size * gms_scale_ratios[scale]);
+  int right_cells = grid_right * grid_right;
+  const int *pattern = gms_rotation_patterns[rotation];
+
+  /// La matriz de estadísticas se reserva una vez y solo se limpian las celdas usadas
+  size_t motion_size = static_cast<size_t>(gms_grid_cells) * static_cast<size_t>(right_cells);
+  if (worker.motion.size() < motion_size) worker.motion.assign(motion_size, 0);
+
+  worker.leftCell.resize(size);
+  worker.rightCell.resize(size);
+  worker.inliers.assign(size, false);
+
+  for (size_t i = 0; i < size; i++) {
+    int x = std::min(grid_right - 1, static_cast<int>(points2[i].x * grid_right));
+    int y = std::min(grid_right - 1, static_cast<int>(points2[i].y * grid_right));
+    worker.rightCell[i] = x + y * grid_right;
+  }
+
+  /// Cuatro rejillas desplazadas media celda
+  for (int grid_type = 0; grid_type < 4; grid_type++) {
+
+    double shift_x = (grid_type == 1 || grid_type == 3) ? 0.5 : 0.;
+    double shift_y = (grid_type == 2 || grid_type == 3) ? 0.5 : 0.;
+
+    worker.pointsPerCell.assign(gms_grid_cells, 0);
+    worker.cellPairs.assign(gms_grid_cells, -1);
+    worker.maxCount.assign(gms_grid_cells, 0);
+
+    for (size_t i = 0; i < size; i++) {
+
+      double x = points1[i].x * gms_grid_size + shift_x;
+      double y = points1[i].y * gms_grid_size + shift_y;
+
+      if (x >= gms_grid_size || y >= gms_grid_size) {
+        worker.leftCell[i] = -1;
+        continue;
+      }
+
+      int left = static_cast<int>(x) + static_cast<int>(y) * gms_grid_size;
+      int right = worker.rightCell[i];
+      worker.leftCell[i] = left;
+
+      int count = ++worker.motion[static_cast<size_t>(left) * right_cells + right];
+      worker.pointsPerCell[left]++;
+
+      /// Celda con más correspondencias. En caso de empate la de menor índice
+      if (count > worker.maxCount[left] ||
+          (count == worker.maxCount[left] && right < worker.cellPairs[left])) {
+        worker.maxCount[left] = count;
+        worker.cellPairs[left] = right;
+      }
+    }
+
+    for (int left = 0; left < gms_grid_cells; left++) {
+
+      if (worker.pointsPerCell[left] == 0) continue;
+
+      int right = worker.cellPairs[left];
+      int score = 0;
+      double points = 0.;
+      int pairs = 0;
+
+      for (int j = 0; j < 9; j++) {
+        int neighbor_left = gmsNeighbor(left, gms_grid_size, j);
+        int neighbor_right = gmsNeighbor(right, grid_right, pattern[j] - 1);
+        if (neighbor_left < 0 || neighbor_right < 0) continue;
+        score += worker.motion[static_cast<size_t>(neighbor_left) * right_cells + neighbor_right];
+        points += worker.pointsPerCell[neighbor_left];
+        pairs++;
+      }
+
+      if (score < threshold * std::sqrt(points / pairs))
+        worker.cellPairs[left] = -2;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+      int left = worker.leftCell[i];
+      if (left < 0) continue;
+      if (worker.cellPairs[left] == worker.rightCell[i]) worker.inliers[i] = true;
+      worker.motion[static_cast<size_t>(left) * right_cells + worker.rightCell[i]] = 0;
+    }
+  }
+
+  return static_cast<size_t>(std::count(worker.inliers.begin(), worker.inliers.end(), true));
+}
 
-#  else
-    TL_COMPILER_WARNING("'matchGMS' not supported in OpenCV versions < 3.3.1")
-    throw TL_ERROR("'matchGMS' not supported in OpenCV versions < 3.3.1");
-#endif
-#else
-    TL_COMPILER_WARNING("OpenCV not built with extra modules. 'matchGMS' not supported")
-    throw TL_ERROR("OpenCV not built with extra modules. 'matchGMS' not supported");
-#endif // HAVE_OPENCV_XFEATURES2D
+inline cv::Size2f gmsImageSize(const std::vector<cv::KeyPoint> &keypoints,
+                               const cv::Size &imageSize)
+{
+  if (imageSize.width > 0 && imageSize.height > 0)
+    return cv::Size2f(static_cast<float>(imageSize.width), static_cast<float>(imageSize.height));
+
+  float width = 0.f;
+  float height = 0.f;
+  for (const auto &keypoint : keypoints) {
+    width = std::max(width, keypoint.pt.x);
+    height = std::max(height, keypoint.pt.y);
+  }
+
+  return cv::Size2f(width + 1.f, height + 1.f);
+}
+
+} // namespace internal
+
+
+std::vector<bool> gmsInliers(const std::vector<cv::KeyPoint> &keypoints1,
+                             const cv::Size &imageSize1,
+                             const std::vector<cv::KeyPoint> &keypoints2,
+                             const cv::Size &imageSize2,
+                             const std::vector<cv::DMatch> &matches,
+                             bool rotation,
+                             bool scale,
+                             double threshold)
+{
+  std::vector<bool> inliers(matches.size(), false);
+
+  try {
+
+    if (matches.empty()) return inliers;
+
+    /// Coordenadas normalizadas de los puntos emparejados
+    cv::Size2f size1 = internal::gmsImageSize(keypoints1, imageSize1);
+    cv::Size2f size2 = internal::gmsImageSize(keypoints2, imageSize2);
+
+    std::vector<cv::Point2f> points1(matches.size());
+    std::vector<cv::Point2f> points2(matches.size());
+    for (size_t i = 0; i < matches.size(); i++) {
+      const cv::Point2f &pt1 = keypoints1.at(static_cast<size_t>(matches[i].queryIdx)).pt;
+      const cv::Point2f &pt2 = keypoints2.at(static_cast<size_t>(matches[i].trainIdx)).pt;
+      points1[i] = cv::Point2f(std::max(0.f, pt1.x / size1.width), std::max(0.f, pt1.y / size1.height));
+      points2[i] = cv::Point2f(std::max(0.f, pt2.x / size2.width), std::max(0.f, pt2.y / size2.height));
+    }
+
+    size_t scales = scale ? 5 : 1;
+    size_t rotations = rotation ? 8 : 1;
+
+    size_t best_inliers = 0;
+    size_t best_hypothesis = scales * rotations;
+    std::mutex mutex;
+
+    parallel_for_worker<internal::GmsWorker>(0, scales * rotations, [&](internal::GmsWorker &worker, size_t hypothesis) {
+
+      size_t n = internal::gmsRun(worker, points1, points2,
+                                  static_cast<int>(hypothesis / rotations),
+                                  static_cast<int>(hypothesis % rotations),
+                                  threshold);
+
+      std::lock_guard<std::mutex> lck(mutex);
+      if (n > best_inliers || (n == best_inliers && hypothesis < best_hypothesis)) {
+        best_inliers = n;
+        best_hypothesis = hypothesis;
+        inliers = worker.inliers;
+      }
+    });
 
   } catch (...) {
     TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
   }
 
-  return false;
+  return inliers;
 }
 
 } // namespace tl
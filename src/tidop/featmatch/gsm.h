@@ -107,6 +107,42 @@ private:
 
 };
 
+
+/*----------------------------------------------------------------*/
+
+
+/*!
+ * \brief Grid-based Motion Statistics (GMS)
+ *
+ * Bian J., Lin W., Matsushita Y., Yeung S., Nguyen T., Cheng M. (2017)
+ * GMS: Grid-based Motion Statistics for Fast, Ultra-robust Feature
+ * Correspondence. IEEE Conference on Computer Vision and Pattern Recognition
+ *
+ * Native implementation, independent of the OpenCV extra modules. The motion
+ * statistics of every cell are accumulated in a single pass over the matches,
+ * so each grid evaluation is linear in the number of matches. The scale and
+ * rotation hypotheses (5 scales x 8 rotations) are evaluated in parallel and
+ * the one with the largest number of inliers is retained.
+ *
+ * \param[in] keypoints1 Query keypoints
+ * \param[in] imageSize1 Query image size. If empty, the extent of the keypoints is used
+ * \param[in] keypoints2 Train keypoints
+ * \param[in] imageSize2 Train image size. If empty, the extent of the keypoints is used
+ * \param[in] matches Matches
+ * \param[in] rotation Evaluate rotation hypotheses
+ * \param[in] scale Evaluate scale hypotheses
+ * \param[in] threshold Threshold factor
+ * \return Inlier flag for each match
+ */
+TL_EXPORT std::vector<bool> gmsInliers(const std::vector<cv::KeyPoint> &keypoints1,
+                                       const cv::Size &imageSize1,
+                                       const std::vector<cv::KeyPoint> &keypoints2,
+                                       const cv::Size &imageSize2,
+                                       const std::vector<cv::DMatch> &matches,
+                                       bool rotation = gms_default_value_rotation,
+                                       bool scale = gms_default_value_scale,
+                                       double threshold = gms_default_value_threshold);
+
 } // namespace tl
 
 #endif // TL_FEATMATCH_GSM_H
@@ -24,6 +24,12 @@
 
 #include "keypointsfilter.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
+
 #include <tidop/core/messages.h>
 #include <tidop/core/exception.h>
 
@@ -260,6 +266,395 @@ void KeyPointsFilterRemoveDuplicated::reset()
 
 
 
+/*----------------------------------------------------------------*/
+
+
+namespace internal
+{
+
+/*!
+ * \brief Extensión de los keypoints
+ */
+inline cv::Rect2f keyPointsBounds(const std::vector<cv::KeyPoint> &keypoints)
+{
+  float min_x = std::numeric_limits<float>::max();
+  float min_y = std::numeric_limits<float>::max();
+  float max_x = std::numeric_limits<float>::lowest();
+  float max_y = std::numeric_limits<float>::lowest();
+
+  for (const auto &keypoint : keypoints) {
+    min_x = std::min(min_x, keypoint.pt.x);
+    min_y = std::min(min_y, keypoint.pt.y);
+    max_x = std::max(max_x, keypoint.pt.x);
+    max_y = std::max(max_y, keypoint.pt.y);
+  }
+
+  return cv::Rect2f(min_x, min_y, max_x - min_x + 1.f, max_y - min_y + 1.f);
+}
+
+} // namespace internal
+
+
+
+KeyPointsFilterAnmsProperties::KeyPointsFilterAnmsProperties()
+  : KeyPointsFilterBase(KeyPointsFilter::Type::anms),
+    mPointsNumber(5000),
+    mTolerance(0.1)
+{
+}
+
+int KeyPointsFilterAnmsProperties::nPoints() const
+{
+  return mPointsNumber;
+}
+
+void KeyPointsFilterAnmsProperties::setNPoints(int nPoints)
+{
+  mPointsNumber = nPoints;
+}
+
+double KeyPointsFilterAnmsProperties::tolerance() const
+{
+  return mTolerance;
+}
+
+void KeyPointsFilterAnmsProperties::setTolerance(double tolerance)
+{
+  mTolerance = tolerance;
+}
+
+void KeyPointsFilterAnmsProperties::reset()
+{
+  mPointsNumber = 5000;
+  mTolerance = 0.1;
+}
+
+std::string KeyPointsFilterAnmsProperties::name() const
+{
+  return std::string("ANMS");
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+KeyPointsFilterAnms::KeyPointsFilterAnms()
+{
+}
+
+KeyPointsFilterAnms::KeyPointsFilterAnms(int nPoints)
+{
+  this->setNPoints(nPoints);
+}
+
+void KeyPointsFilterAnms::setNPoints(int nPoints)
+{
+  KeyPointsFilterAnmsProperties::setNPoints(nPoints);
+}
+
+void KeyPointsFilterAnms::setTolerance(double tolerance)
+{
+  KeyPointsFilterAnmsProperties::setTolerance(tolerance);
+}
+
+void KeyPointsFilterAnms::reset()
+{
+  KeyPointsFilterAnmsProperties::reset();
+}
+
+std::vector<cv::KeyPoint> KeyPointsFilterAnms::filter(const std::vector<cv::KeyPoint> &keypoints)
+{
+  std::vector<cv::KeyPoint> filteredKeypoints;
+
+  try {
+
+    size_t n_points = static_cast<size_t>(std::max(0, KeyPointsFilterAnmsProperties::nPoints()));
+
+    if (keypoints.size() <= n_points) {
+      filteredKeypoints = keypoints;
+      return filteredKeypoints;
+    }
+
+    if (n_points == 0) return filteredKeypoints;
+
+    std::vector<size_t> order(keypoints.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&keypoints](size_t i, size_t j) {
+      return keypoints[i].response > keypoints[j].response;
+    });
+
+    cv::Rect2f bounds = internal::keyPointsBounds(keypoints);
+    double cols = bounds.width;
+    double rows = bounds.height;
+    double k = static_cast<double>(n_points);
+    double n = static_cast<double>(keypoints.size());
+    double tolerance = KeyPointsFilterAnmsProperties::tolerance();
+
+    /// Cotas iniciales del radio de supresión (Bailo et al., 2018)
+    double exp1 = rows + cols + 2. * k;
+    double exp2 = 4. * cols + 4. * k + 4. * rows * k + rows * rows + cols * cols - 2. * rows * cols + 4. * rows * cols * k;
+    double exp3 = std::sqrt(exp2);
+    double exp4 = k - 1.;
+    double sol1 = exp4 > 0. ? -std::round((exp1 + exp3) / exp4) : std::max(cols, rows);
+    double sol2 = exp4 > 0. ? -std::round((exp1 - exp3) / exp4) : std::max(cols, rows);
+
+    int high = static_cast<int>(std::max(sol1, sol2));
+    int low = std::max(1, static_cast<int>(std::floor(std::sqrt(n / k))));
+    high = std::max(high, low);
+
+    size_t k_min = static_cast<size_t>(std::round(k - k * tolerance));
+    size_t k_max = static_cast<size_t>(std::round(k + k * tolerance));
+
+    std::vector<size_t> result;
+    std::vector<size_t> selected;
+    std::vector<unsigned char> covered;
+    std::unordered_set<long long> covered_sparse;
+    int prev_width = -1;
+
+    while (low <= high) {
+
+      int width = low + (high - low) / 2;
+      if (width == prev_width) break;
+
+      double cell = width / 2.;
+      long long cell_cols = static_cast<long long>(std::floor(cols / cell)) + 1;
+      long long cell_rows = static_cast<long long>(std::floor(rows / cell)) + 1;
+      int cover = static_cast<int>(std::floor(width / cell));
+
+      /// Con radios muy pequeños la rejilla densa no compensa
+      bool dense = cell_cols * cell_rows <= std::max<long long>(1 << 24, 4 * static_cast<long long>(keypoints.size()));
+      if (dense) covered.assign(static_cast<size_t>(cell_cols * cell_rows), 0);
+      else covered_sparse.clear();
+
+      selected.clear();
+
+      for (size_t idx : order) {
+
+        long long row = static_cast<long long>(std::floor((keypoints[idx].pt.y - bounds.y) / cell));
+        long long col = static_cast<long long>(std::floor((keypoints[idx].pt.x - bounds.x) / cell));
+        long long key = row * cell_cols + col;
+
+        bool is_covered = dense ? covered[static_cast<size_t>(key)] != 0 : covered_sparse.count(key) != 0;
+        if (is_covered) continue;
+
+        selected.push_back(idx);
+
+        long long row_min = std::max<long long>(0, row - cover);
+        long long row_max = std::min<long long>(cell_rows - 1, row + cover);
+        long long col_min = std::max<long long>(0, col - cover);
+        long long col_max = std::min<long long>(cell_cols - 1, col + cover);
+
+        for (long long r = row_min; r <= row_max; r++) {
+          for (long long c = col_min; c <= col_max; c++) {
+            if (dense) covered[static_cast<size_t>(r * cell_cols + c)] = 1;
+            else covered_sparse.insert(r * cell_cols + c);
+          }
+        }
+      }
+
+      result.swap(selected);
+
+      if (result.size() >= k_min && result.size() <= k_max) break;
+
+      if (result.size() < k_min) high = width - 1;
+      else low = width + 1;
+
+      prev_width = width;
+    }
+
+    if (result.size() > n_points) result.resize(n_points);
+
+    filteredKeypoints.reserve(result.size());
+    for (size_t idx : result) {
+      filteredKeypoints.push_back(keypoints[idx]);
+    }
+
+    msgInfo("ANMS retaining %i keypoints", static_cast<int>(filteredKeypoints.size()));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return filteredKeypoints;
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+KeyPointsFilterGridProperties::KeyPointsFilterGridProperties()
+  : KeyPointsFilterBase(KeyPointsFilter::Type::grid),
+    mPointsNumber(5000),
+    mRows(8),
+    mCols(8)
+{
+}
+
+int KeyPointsFilterGridProperties::nPoints() const
+{
+  return mPointsNumber;
+}
+
+void KeyPointsFilterGridProperties::setNPoints(int nPoints)
+{
+  mPointsNumber = nPoints;
+}
+
+int KeyPointsFilterGridProperties::rows() const
+{
+  return mRows;
+}
+
+void KeyPointsFilterGridProperties::setRows(int rows)
+{
+  mRows = rows;
+}
+
+int KeyPointsFilterGridProperties::cols() const
+{
+  return mCols;
+}
+
+void KeyPointsFilterGridProperties::setCols(int cols)
+{
+  mCols = cols;
+}
+
+void KeyPointsFilterGridProperties::reset()
+{
+  mPointsNumber = 5000;
+  mRows = 8;
+  mCols = 8;
+}
+
+std::string KeyPointsFilterGridProperties::name() const
+{
+  return std::string("Grid");
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+KeyPointsFilterGrid::KeyPointsFilterGrid()
+{
+}
+
+KeyPointsFilterGrid::KeyPointsFilterGrid(int nPoints, int rows, int cols)
+{
+  this->setNPoints(nPoints);
+  this->setRows(rows);
+  this->setCols(cols);
+}
+
+void KeyPointsFilterGrid::setNPoints(int nPoints)
+{
+  KeyPointsFilterGridProperties::setNPoints(nPoints);
+}
+
+void KeyPointsFilterGrid::setRows(int rows)
+{
+  KeyPointsFilterGridProperties::setRows(rows);
+}
+
+void KeyPointsFilterGrid::setCols(int cols)
+{
+  KeyPointsFilterGridProperties::setCols(cols);
+}
+
+void KeyPointsFilterGrid::reset()
+{
+  KeyPointsFilterGridProperties::reset();
+}
+
+std::vector<cv::KeyPoint> KeyPointsFilterGrid::filter(const std::vector<cv::KeyPoint> &keypoints)
+{
+  std::vector<cv::KeyPoint> filteredKeypoints;
+
+  try {
+
+    size_t n_points = static_cast<size_t>(std::max(0, KeyPointsFilterGridProperties::nPoints()));
+    int grid_rows = std::max(1, KeyPointsFilterGridProperties::rows());
+    int grid_cols = std::max(1, KeyPointsFilterGridProperties::cols());
+
+    if (keypoints.size() <= n_points) {
+      filteredKeypoints = keypoints;
+      return filteredKeypoints;
+    }
+
+    cv::Rect2f bounds = internal::keyPointsBounds(keypoints);
+    double cell_width = bounds.width / grid_cols;
+    double cell_height = bounds.height / grid_rows;
+    size_t cells = static_cast<size_t>(grid_rows) * static_cast<size_t>(grid_cols);
+
+    /// Ordenación por celdas (counting sort)
+    std::vector<size_t> cell_index(keypoints.size());
+    std::vector<size_t> offsets(cells + 1, 0);
+    for (size_t i = 0; i < keypoints.size(); i++) {
+      int col = std::min(grid_cols - 1, static_cast<int>((keypoints[i].pt.x - bounds.x) / cell_width));
+      int row = std::min(grid_rows - 1, static_cast<int>((keypoints[i].pt.y - bounds.y) / cell_height));
+      cell_index[i] = static_cast<size_t>(row) * grid_cols + col;
+      offsets[cell_index[i] + 1]++;
+    }
+
+    for (size_t c = 0; c < cells; c++) offsets[c + 1] += offsets[c];
+
+    std::vector<size_t> order(keypoints.size());
+    std::vector<size_t> position(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < keypoints.size(); i++) {
+      order[position[cell_index[i]]++] = i;
+    }
+
+    /// Reparto del cupo: lo que no cubren las celdas con pocos puntos pasa al resto
+    std::vector<size_t> cell_order(cells);
+    std::iota(cell_order.begin(), cell_order.end(), 0);
+    std::sort(cell_order.begin(), cell_order.end(), [&offsets](size_t c1, size_t c2) {
+      return offsets[c1 + 1] - offsets[c1] < offsets[c2 + 1] - offsets[c2];
+    });
+
+    std::vector<size_t> quota(cells, 0);
+    size_t remaining = n_points;
+    for (size_t i = 0; i < cells; i++) {
+      size_t c = cell_order[i];
+      size_t count = offsets[c + 1] - offsets[c];
+      size_t share = (remaining + (cells - i) - 1) / (cells - i);
+      quota[c] = std::min(count, share);
+      remaining -= quota[c];
+    }
+
+    filteredKeypoints.reserve(n_points);
+
+    auto by_response = [&keypoints](size_t i, size_t j) {
+      return keypoints[i].response > keypoints[j].response;
+    };
+
+    for (size_t c = 0; c < cells; c++) {
+      auto begin = order.begin() + static_cast<std::ptrdiff_t>(offsets[c]);
+      auto end = order.begin() + static_cast<std::ptrdiff_t>(offsets[c + 1]);
+      auto nth = begin + static_cast<std::ptrdiff_t>(quota[c]);
+      if (nth < end) std::nth_element(begin, nth, end, by_response);
+      for (auto it = begin; it != nth; it++) {
+        filteredKeypoints.push_back(keypoints[*it]);
+      }
+    }
+
+    msgInfo("Grid filter retaining %i keypoints", static_cast<int>(filteredKeypoints.size()));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return filteredKeypoints;
+}
+
+
+
 } // namespace tl
 
 
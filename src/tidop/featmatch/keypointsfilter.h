@@ -45,7 +45,9 @@ public:
     n_best,
     size,
     remove_duplicated,
-    mask
+    mask,
+    anms,
+    grid
   };
 
 public:
@@ -324,6 +326,218 @@ public:
 };
 
 
+/*----------------------------------------------------------------*/
+
+
+class TL_EXPORT KeyPointsFilterAnmsProperties
+  : public KeyPointsFilterBase
+{
+
+public:
+
+  KeyPointsFilterAnmsProperties();
+  ~KeyPointsFilterAnmsProperties() override = default;
+
+  /*!
+   * \brief Number of points to retain
+   * \return Number of points
+   */
+  virtual int nPoints() const;
+
+  /*!
+   * \brief Set the number of points to retain
+   * \param[in] nPoints number of points to retain
+   */
+  virtual void setNPoints(int nPoints);
+
+  /*!
+   * \brief Tolerance on the number of points retained
+   * The search of the suppression radius stops when the number of points
+   * is within nPoints*(1 +/- tolerance)
+   * \return Tolerance
+   */
+  virtual double tolerance() const;
+
+  /*!
+   * \brief Set the tolerance on the number of points retained
+   * \param[in] tolerance Tolerance (default 0.1)
+   */
+  virtual void setTolerance(double tolerance);
+
+// KeyPointsFilter interface
+
+public:
+
+  void reset() override;
+  std::string name() const final;
+
+private:
+
+  int mPointsNumber;
+  double mTolerance;
+};
+
+
+/*----------------------------------------------------------------*/
+
+
+/*!
+ * \brief Adaptive non-maximal suppression
+ *
+ * Retains the strongest keypoints while keeping them evenly distributed over
+ * the image, using Suppression via Square Covering (SSC):
+ *
+ * Bailo O., Rameau F., Joo K., Park J., Bogdan O., Kweon I.S. (2018)
+ * Efficient adaptive non-maximal supression algorithms for homogeneous
+ * spatial keypoint distribution. Pattern Recognition Letters 106, 53-60
+ *
+ * The keypoints are sorted once by response and a binary search looks for
+ * the suppression radius. Each iteration covers a grid of cells of half the
+ * radius, so the cost is O(n log n) and doesn't depend on the density of
+ * the keypoints.
+ */
+class TL_EXPORT KeyPointsFilterAnms
+  : public KeyPointsFilterAnmsProperties,
+    public KeyPointsFilterProcess
+{
+
+public:
+
+  KeyPointsFilterAnms();
+  explicit KeyPointsFilterAnms(int nPoints);
+  ~KeyPointsFilterAnms() override = default;
+
+// KeyPointsFilterAnmsProperties interface
+
+public:
+
+  void setNPoints(int nPoints) override;
+  void setTolerance(double tolerance) override;
+
+// KeyPointsFilter interface
+
+public:
+
+  void reset() override;
+
+// KeyPointsFilterProcess interface
+
+public:
+
+  std::vector<cv::KeyPoint> filter(const std::vector<cv::KeyPoint> &keypoints) override;
+
+};
+
+
+/*----------------------------------------------------------------*/
+
+
+class TL_EXPORT KeyPointsFilterGridProperties
+  : public KeyPointsFilterBase
+{
+
+public:
+
+  KeyPointsFilterGridProperties();
+  ~KeyPointsFilterGridProperties() override = default;
+
+  /*!
+   * \brief Number of points to retain
+   * \return Number of points
+   */
+  virtual int nPoints() const;
+
+  /*!
+   * \brief Set the number of points to retain
+   * \param[in] nPoints number of points to retain
+   */
+  virtual void setNPoints(int nPoints);
+
+  /*!
+   * \brief Grid rows
+   * \return Number of rows of the grid
+   */
+  virtual int rows() const;
+
+  /*!
+   * \brief Set the grid rows
+   * \param[in] rows Number of rows of the grid (default 8)
+   */
+  virtual void setRows(int rows);
+
+  /*!
+   * \brief Grid columns
+   * \return Number of columns of the grid
+   */
+  virtual int cols() const;
+
+  /*!
+   * \brief Set the grid columns
+   * \param[in] cols Number of columns of the grid (default 8)
+   */
+  virtual void setCols(int cols);
+
+// KeyPointsFilter interface
+
+public:
+
+  void reset() override;
+  std::string name() const final;
+
+private:
+
+  int mPointsNumber;
+  int mRows;
+  int mCols;
+};
+
+
+/*----------------------------------------------------------------*/
+
+
+/*!
+ * \brief Grid bucketing
+ *
+ * Divides the extent of the keypoints in a regular grid and retains the
+ * strongest keypoints of each cell. The points are shared evenly between
+ * the cells and the quota that a sparse cell can't fill is passed on to the
+ * rest. Each cell is reduced with a partial selection (nth_element), so the
+ * cost is linear in the number of keypoints.
+ */
+class TL_EXPORT KeyPointsFilterGrid
+  : public KeyPointsFilterGridProperties,
+    public KeyPointsFilterProcess
+{
+
+public:
+
+  KeyPointsFilterGrid();
+  KeyPointsFilterGrid(int nPoints, int rows, int cols);
+  ~KeyPointsFilterGrid() override = default;
+
+// KeyPointsFilterGridProperties interface
+
+public:
+
+  void setNPoints(int nPoints) override;
+  void setRows(int rows) override;
+  void setCols(int cols) override;
+
+// KeyPointsFilter interface
+
+public:
+
+  void reset() override;
+
+// KeyPointsFilterProcess interface
+
+public:
+
+  std::vector<cv::KeyPoint> filter(const std::vector<cv::KeyPoint> &keypoints) override;
+
+};
+
+
 } // namespace tl
 
 #endif // TL_FEATMATCH_KEYPOINTSFILTER_H
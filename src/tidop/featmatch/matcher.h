@@ -61,7 +61,8 @@ public:
   enum class Type
   {
     flann,
-    brute_force
+    brute_force,
+    cascade_hashing
   };
 
 public:
@@ -75,7 +76,7 @@ public:
   virtual void reset() = 0;
 
   /*!
-   * \brief Type of match method (flann or brute force)
+   * \brief Type of match method (flann, brute force or cascade hashing)
    * \return
    */
   virtual Type type() const = 0;
@@ -186,6 +187,12 @@ public:
   virtual Index index() const = 0;
   virtual void setIndex(Index index) = 0;
 
+  /*!
+   * \brief Number of image indexes kept for reuse between pairs
+   */
+  virtual int cacheSize() const = 0;
+  virtual void setCacheSize(int cacheSize) = 0;
+
 };
 
 
@@ -219,6 +226,34 @@ public:
 
 
 
+/*----------------------------------------------------------------*/
+
+
+class TL_EXPORT CascadeHashingMatcher
+  : public MatchingMethodBase
+{
+
+public:
+
+  CascadeHashingMatcher() : MatchingMethodBase(MatchingMethod::Type::cascade_hashing) {}
+  ~CascadeHashingMatcher() override = default;
+
+  /*!
+   * \brief Number of candidates of each descriptor re-ranked with the exact distance
+   */
+  virtual int candidates() const = 0;
+  virtual void setCandidates(int candidates) = 0;
+
+  /*!
+   * \brief Number of image indexes kept for reuse between pairs
+   */
+  virtual int cacheSize() const = 0;
+  virtual void setCacheSize(int cacheSize) = 0;
+
+};
+
+
+
 /*----------------------------------------------------------------*/
 
 
@@ -378,6 +413,19 @@ public:
   virtual int maxIter() const = 0;
   virtual void setMaxIters(int maxIter) = 0;
 
+  /*!
+   * \brief Guided second matching pass with the geometric model
+   */
+  virtual bool guidedMatching() const = 0;
+  virtual void setGuidedMatching(bool guidedMatching) = 0;
+
+  /*!
+   * \brief Search radius of the guided matching in pixels
+   * Distance to the epipolar line or to the projected point
+   */
+  virtual double guidedSearchRadius() const = 0;
+  virtual void setGuidedSearchRadius(double guidedSearchRadius) = 0;
+
   /*!
    * \brief Recover the default values
    */
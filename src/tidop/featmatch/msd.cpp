@@ -25,9 +25,17 @@
 #include "msd.h"
 
 #include <tidop/core/messages.h>
+#include <tidop/core/concurrency.h>
 
 #include <opencv2/imgproc.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+
 #if CV_VERSION_MAJOR < 3 || (CV_VERSION_MAJOR == 3 && CV_VERSION_MINOR < 1) || !defined HAVE_OPENCV_XFEATURES2D
 #include "msd/MSD.h"
 
@@ -318,48 +326,91 @@ std::vector<cv::KeyPoint> MsdDetector::detect(const cv::Mat &img,
 #else
 
     if (MsdProperties::affineMSD()) {
-    
-      float maxX = 0;
-      float maxY = 0;
-    
+
+      /// Vistas simuladas (inclinación, rotación)
+      std::vector<std::pair<double, double>> views;
       int affineTilts = MsdProperties::affineTilts();
       for (int tl = 1; tl <= affineTilts; tl++) {
         double t = pow(2, 0.5 * tl);
         for (double phi = 0.; phi < 180.; phi += 72.0 / t) {
-          std::vector<cv::KeyPoint> kps;
-          cv::Mat timg, mask, Ai;
-    
-          img.copyTo(timg);
-          affineSkew(t, phi, timg, mask, Ai);
-    
-          kps = mMSD->detect(timg);
-    
-    
-          for (unsigned int i = 0; i < kps.size(); i++) {
-            cv::Point3f kpt(kps[i].pt.x, kps[i].pt.y, 1);
-            cv::Mat kpt_t = Ai * cv::Mat(kpt);
-    
-            kps[i].pt.x = kpt_t.at<float>(0, 0);
-            kps[i].pt.y = kpt_t.at<float>(1, 0);
-            if (phi == 0. || pointIsAcceptable(kps[i], img.cols, img.rows)) {
-              if (kps[i].pt.x > maxX) {
-                maxX = kps[i].pt.x;
-              }
-              if (kps[i].pt.y > maxY) {
-                maxY = kps[i].pt.y;
+          views.emplace_back(t, phi);
+        }
+      }
+
+      std::vector<std::vector<cv::KeyPoint>> view_key_points(views.size());
+      std::atomic<size_t> next_view(0);
+      std::atomic<bool> failed(false);
+      std::exception_ptr error;
+      std::mutex mutex;
+
+      /// El detector MSD guarda el espacio de escalas, cada hilo usa el suyo
+      auto worker = [&](size_t /*thread*/) {
+
+        try {
+
+          ::MsdDetector msd;
+          msd.setThSaliency(static_cast<float>(MsdProperties::thresholdSaliency()));
+          msd.setPatchRadius(MsdProperties::patchRadius());
+          msd.setKNN(MsdProperties::knn());
+          msd.setSearchAreaRadius(MsdProperties::searchAreaRadius());
+          msd.setScaleFactor(static_cast<float>(MsdProperties::scaleFactor()));
+          msd.setNMSRadius(MsdProperties::NMSRadius());
+          msd.setNScales(MsdProperties::nScales());
+          msd.setNMSScaleRadius(MsdProperties::NMSScaleRadius());
+          msd.setComputeOrientation(MsdProperties::computeOrientation());
+
+          cv::Mat timg, view_mask, Ai;
+          std::vector<cv::Point2f> points;
+
+          for (size_t v = next_view++; v < views.size() && !failed; v = next_view++) {
+
+            double t = views[v].first;
+            double phi = views[v].second;
+
+            img.copyTo(timg);
+            affineSkew(t, phi, timg, view_mask, Ai);
+
+            std::vector<cv::KeyPoint> kps = msd.detect(timg);
+            if (kps.empty()) continue;
+
+            /// Vuelta a la geometría de la imagen original en una sola transformación
+            points.resize(kps.size());
+            for (size_t i = 0; i < kps.size(); i++) {
+              points[i] = kps[i].pt;
+            }
+            cv::transform(points, points, Ai);
+
+            std::vector<cv::KeyPoint> &accepted = view_key_points[v];
+            accepted.reserve(kps.size());
+            for (size_t i = 0; i < kps.size(); i++) {
+              kps[i].pt = points[i];
+              if (phi == 0. || pointIsAcceptable(kps[i], img.cols, img.rows)) {
+                accepted.push_back(kps[i]);
               }
-              keyPoints.push_back(kps[i]);
             }
-            kpt_t.release();
           }
-    
-    
-          timg.release();
-          mask.release();
-          Ai.release();
+
+        } catch (...) {
+          std::lock_guard<std::mutex> lck(mutex);
+          if (!failed) error = std::current_exception();
+          failed = true;
         }
+      };
+
+      size_t num_threads = std::max<size_t>(1, std::min<size_t>(optimalNumberOfThreads(), views.size()));
+      parallel_for(0, num_threads, worker);
+
+      if (error) std::rethrow_exception(error);
+
+      size_t size = 0;
+      for (const auto &kps : view_key_points) size += kps.size();
+      keyPoints.reserve(size);
+      for (auto &kps : view_key_points) {
+        keyPoints.insert(keyPoints.end(), kps.begin(), kps.end());
       }
-    
+
+      removeDuplicatedViews(keyPoints);
+
     } else {
     
       cv::Mat img2;
@@ -467,6 +518,57 @@ bool MsdDetector::pointIsAcceptable(const cv::KeyPoint &vl_keypoint, int width,
   return retVal;
 }
 
+void MsdDetector::removeDuplicatedViews(std::vector<cv::KeyPoint> &keyPoints)
+{
+  /// Los keypoints más fuertes se conservan
+  std::stable_sort(keyPoints.begin(), keyPoints.end(),
+                   [](const cv::KeyPoint &kp1, const cv::KeyPoint &kp2) {
+                     return kp1.response > kp2.response;
+                   });
+
+  /// Rejilla de un pixel: los duplicados están en la celda o en las vecinas
+  auto cell = [](float x, float y) {
+    return static_cast<long long>(std::floor(y)) * 4294967296LL +
+           static_cast<long long>(std::floor(x));
+  };
+
+  float max_scale_ratio = static_cast<float>(std::max(1.25, MsdProperties::scaleFactor()));
+  std::unordered_map<long long, std::vector<size_t>> grid;
+  grid.reserve(keyPoints.size());
+  std::vector<cv::KeyPoint> unique_key_points;
+  unique_key_points.reserve(keyPoints.size());
+
+  for (const auto &key_point : keyPoints) {
+
+    bool duplicated = false;
+
+    for (int dy = -1; dy <= 1 && !duplicated; dy++) {
+      for (int dx = -1; dx <= 1 && !duplicated; dx++) {
+        auto it = grid.find(cell(key_point.pt.x + dx, key_point.pt.y + dy));
+        if (it == grid.end()) continue;
+        for (size_t idx : it->second) {
+          const cv::KeyPoint &other = unique_key_points[idx];
+          float dist_x = other.pt.x - key_point.pt.x;
+          float dist_y = other.pt.y - key_point.pt.y;
+          float size_ratio = std::max(other.size, key_point.size) /
+                             std::max(std::min(other.size, key_point.size), 1e-6f);
+          if (dist_x * dist_x + dist_y * dist_y < 1.f && size_ratio < max_scale_ratio) {
+            duplicated = true;
+            break;
+          }
+        }
+      }
+    }
+
+    if (!duplicated) {
+      grid[cell(key_point.pt.x, key_point.pt.y)].push_back(unique_key_points.size());
+      unique_key_points.push_back(key_point);
+    }
+  }
+
+  keyPoints.swap(unique_key_points);
+}
+
 void MsdDetector::affineSkew(double tilt, double phi, cv::Mat &img, cv::Mat &mask, cv::Mat &Ai)
 {
   int h = img.rows;
@@ -138,6 +138,7 @@ private:
   bool pointIsAcceptable(const cv::KeyPoint &vl_keypoint, int width, int height);
   void compensate_affine_coor1(float *x0, float *y0, int w1, int h1, float t1, float t2, float Rtheta);
   void affineSkew(double tilt, double phi, cv::Mat &img, cv::Mat &mask, cv::Mat &Ai);
+  void removeDuplicatedViews(std::vector<cv::KeyPoint> &keyPoints);
 
 #endif
 
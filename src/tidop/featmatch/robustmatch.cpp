@@ -24,6 +24,10 @@
 
 #include "robustmatch.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "tidop/core/messages.h"
 #include "tidop/core/exception.h"
 
@@ -31,6 +35,7 @@
 #include <opencv2/xfeatures2d.hpp>
 #endif // HAVE_OPENCV_XFEATURES2D
 #include <opencv2/calib3d.hpp>
+#include <opencv2/core/hal/hal.hpp>
 
 namespace tl
 {
@@ -44,7 +49,9 @@ RobustMatchingProperties::RobustMatchingProperties()
     mEssentialComputeMethod(EssentialComputeMethod::ransac),
     mDistance(0.7),
     mConfidence(0.999),
-    mMaxIters(2000)
+    mMaxIters(2000),
+    mGuidedMatching(false),
+    mGuidedSearchRadius(4.)
 {
 }
 
@@ -138,6 +145,26 @@ void RobustMatchingProperties::setMaxIters(int maxIter)
   mMaxIters = maxIter;
 }
 
+bool RobustMatchingProperties::guidedMatching() const
+{
+  return mGuidedMatching;
+}
+
+void RobustMatchingProperties::setGuidedMatching(bool guidedMatching)
+{
+  mGuidedMatching = guidedMatching;
+}
+
+double RobustMatchingProperties::guidedSearchRadius() const
+{
+  return mGuidedSearchRadius;
+}
+
+void RobustMatchingProperties::setGuidedSearchRadius(double guidedSearchRadius)
+{
+  mGuidedSearchRadius = guidedSearchRadius;
+}
+
 void RobustMatchingProperties::reset()
 {
   mRatio = 0.8;
@@ -149,6 +176,8 @@ void RobustMatchingProperties::reset()
   mDistance = 0.7;
   mConfidence = 0.999;
   mMaxIters = 2000;
+  mGuidedMatching = false;
+  mGuidedSearchRadius = 4.;
 }
 
 std::string RobustMatchingProperties::name() const
@@ -196,7 +225,7 @@ void RobustMatchingImp::setDescriptorMatcher(const std::shared_ptr<DescriptorMat
   mDescriptorMatcher = descriptorMatcher;
 }
 
-std::vector<cv::DMatch> RobustMatchingImp::geometricFilter(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints1, const std::vector<cv::KeyPoint> &keypoints2, std::vector<cv::DMatch> *wrongMatches)
+std::vector<cv::DMatch> RobustMatchingImp::geometricFilter(const std::vector<cv::DMatch> &matches, const std::vector<cv::KeyPoint> &keypoints1, const std::vector<cv::KeyPoint> &keypoints2, std::vector<cv::DMatch> *wrongMatches, cv::Mat *model)
 {
   std::vector<cv::DMatch> filter_matches;
 
@@ -216,18 +245,18 @@ std::vector<cv::DMatch> RobustMatchingImp::geometricFilter(const std::vector<cv:
 
   } else if (geometric_test == RobustMatcher::GeometricTest::homography){
 
-    filter_matches = filterByHomographyMatrix(matches, pts1, pts2, wrongMatches);
+    filter_matches = filterByHomographyMatrix(matches, pts1, pts2, wrongMatches, model);
 
   } else if (geometric_test == RobustMatcher::GeometricTest::fundamental){
 
-    filter_matches = filterByFundamentalMatrix(matches, pts1, pts2, wrongMatches);
+    filter_matches = filterByFundamentalMatrix(matches, pts1, pts2, wrongMatches, model);
 
   }
 
   return filter_matches;
 }
 
-std::vector<cv::DMatch> RobustMatchingImp::filterByHomographyMatrix(const std::vector<cv::DMatch> &matches, const std::vector<cv::Point2f> &points1, const std::vector<cv::Point2f> &points2, std::vector<cv::DMatch> *wrongMatches)
+std::vector<cv::DMatch> RobustMatchingImp::filterByHomographyMatrix(const std::vector<cv::DMatch> &matches, const std::vector<cv::Point2f> &points1, const std::vector<cv::Point2f> &points2, std::vector<cv::DMatch> *wrongMatches, cv::Mat *model)
 {
   std::vector<cv::DMatch> filter_matches;
 
@@ -246,6 +275,7 @@ std::vector<cv::DMatch> RobustMatchingImp::filterByHomographyMatrix(const std::v
   size_t nPoints = matches.size();
   std::vector<uchar> inliers(nPoints, 0);
   cv::Mat H = cv::findHomography(cv::Mat(points1), cv::Mat(points2), hcm, this->distance(), inliers, this->maxIter(), this->confidence());
+  if (model) *model = H;
 
   // extract the surviving (inliers) matches
   std::vector<uchar>::const_iterator itIn = inliers.begin();
@@ -294,7 +324,7 @@ std::vector<cv::DMatch> RobustMatchingImp::filterByEssentialMatrix(const std::ve
       return filter_matches;
 }
 
-std::vector<cv::DMatch> RobustMatchingImp::filterByFundamentalMatrix(const std::vector<cv::DMatch> &matches, const std::vector<cv::Point2f> &points1, const std::vector<cv::Point2f> &points2, std::vector<cv::DMatch> *wrongMatches)
+std::vector<cv::DMatch> RobustMatchingImp::filterByFundamentalMatrix(const std::vector<cv::DMatch> &matches, const std::vector<cv::Point2f> &points1, const std::vector<cv::Point2f> &points2, std::vector<cv::DMatch> *wrongMatches, cv::Mat *model)
 {
   int fm_method = cv::FM_RANSAC;
   RobustMatcher::FundamentalComputeMethod fundamentalComputeMethod = this->fundamentalComputeMethod();
@@ -313,6 +343,8 @@ std::vector<cv::DMatch> RobustMatchingImp::filterByFundamentalMatrix(const std::
   std::vector<uchar> inliers(nPoints, 0);
   cv::Mat fundamental = cv::findFundamentalMat(cv::Mat(points1), cv::Mat(points2), inliers,
                                                fm_method, this->distance(), this->confidence());
+  /// El algoritmo de 7 puntos puede devolver hasta tres soluciones
+  if (model) *model = fundamental.rows > 3 ? fundamental.rowRange(0, 3).clone() : fundamental;
 
   std::vector<cv::DMatch> filter_matches;
   // extract the surviving (inliers) matches
@@ -406,6 +438,290 @@ std::vector<cv::DMatch> RobustMatchingImp::fastRobustMatch(const cv::Mat &queryD
   return goodMatches;
 }
 
+namespace internal
+{
+
+/*!
+ * \brief Rejilla de keypoints para la búsqueda guiada
+ * Los índices de los keypoints se ordenan por celda (ordenación por conteo)
+ */
+class KeyPointGrid
+{
+
+public:
+
+  KeyPointGrid(const std::vector<cv::KeyPoint> &keyPoints, double cellSize)
+    : mX0(0.),
+      mY0(0.),
+      mCellSize(cellSize),
+      mCols(1),
+      mRows(1)
+  {
+    if (keyPoints.empty()) return;
+
+    double x1 = std::numeric_limits<double>::max();
+    double y1 = std::numeric_limits<double>::max();
+    double x2 = std::numeric_limits<double>::lowest();
+    double y2 = std::numeric_limits<double>::lowest();
+    for (const auto &key_point : keyPoints) {
+      x1 = std::min(x1, static_cast<double>(key_point.pt.x));
+      y1 = std::min(y1, static_cast<double>(key_point.pt.y));
+      x2 = std::max(x2, static_cast<double>(key_point.pt.x));
+      y2 = std::max(y2, static_cast<double>(key_point.pt.y));
+    }
+
+    /// Se limita el número de celdas para imágenes muy grandes
+    mCellSize = std::max({mCellSize, (x2 - x1) / 256., (y2 - y1) / 256., 1.});
+    mX0 = x1;
+    mY0 = y1;
+    mCols = static_cast<int>((x2 - x1) / mCellSize) + 1;
+    mRows = static_cast<int>((y2 - y1) / mCellSize) + 1;
+
+    std::vector<int> cells(keyPoints.size());
+    mStart.assign(static_cast<size_t>(mCols) * mRows + 1, 0);
+    for (size_t i = 0; i < keyPoints.size(); i++) {
+      int col = std::min(mCols - 1, static_cast<int>((keyPoints[i].pt.x - mX0) / mCellSize));
+      int row = std::min(mRows - 1, static_cast<int>((keyPoints[i].pt.y - mY0) / mCellSize));
+      cells[i] = row * mCols + col;
+      mStart[static_cast<size_t>(cells[i]) + 1]++;
+    }
+
+    for (size_t c = 1; c < mStart.size(); c++) mStart[c] += mStart[c - 1];
+
+    std::vector<int> position(mStart.begin(), mStart.end() - 1);
+    mIndices.resize(keyPoints.size());
+    for (size_t i = 0; i < keyPoints.size(); i++) {
+      mIndices[static_cast<size_t>(position[static_cast<size_t>(cells[i])]++)] = static_cast<int>(i);
+    }
+  }
+
+  /*!
+   * \brief Keypoints de las celdas que intersectan la ventana
+   */
+  template<typename Func>
+  void window(double x, double y, double radius, Func f) const
+  {
+    cells(col(x - radius), col(x + radius), row(y - radius), row(y + radius), f);
+  }
+
+  /*!
+   * \brief Keypoints de las celdas que atraviesa la banda de semiancho halfWidth
+   * alrededor de la recta a·x + b·y + c = 0 (con a² + b² = 1)
+   */
+  template<typename Func>
+  void band(double a, double b, double c, double halfWidth, Func f) const
+  {
+    if (std::abs(b) >= std::abs(a)) {
+      /// Recta próxima a la horizontal: se recorren las columnas
+      double half_width = halfWidth / std::abs(b);
+      for (int i = 0; i < mCols; i++) {
+        double x1 = mX0 + i * mCellSize;
+        double x2 = x1 + mCellSize;
+        double y1 = -(a * x1 + c) / b;
+        double y2 = -(a * x2 + c) / b;
+        cells(i, i,
+              row(std::min(y1, y2) - half_width),
+              row(std::max(y1, y2) + half_width), f);
+      }
+    } else {
+      double half_width = halfWidth / std::abs(a);
+      for (int i = 0; i < mRows; i++) {
+        double y1 = mY0 + i * mCellSize;
+        double y2 = y1 + mCellSize;
+        double x1 = -(b * y1 + c) / a;
+        double x2 = -(b * y2 + c) / a;
+        cells(col(std::min(x1, x2) - half_width),
+              col(std::max(x1, x2) + half_width),
+              i, i, f);
+      }
+    }
+  }
+
+private:
+
+  /// Columna y fila sin acotar (pueden quedar fuera de la rejilla)
+  int col(double x) const
+  {
+    return static_cast<int>(std::max(-1., std::min(static_cast<double>(mCols), std::floor((x - mX0) / mCellSize))));
+  }
+
+  int row(double y) const
+  {
+    return static_cast<int>(std::max(-1., std::min(static_cast<double>(mRows), std::floor((y - mY0) / mCellSize))));
+  }
+
+  template<typename Func>
+  void cells(int col1, int col2, int row1, int row2, Func f) const
+  {
+    if (mIndices.empty()) return;
+
+    col1 = std::max(col1, 0);
+    row1 = std::max(row1, 0);
+    col2 = std::min(col2, mCols - 1);
+    row2 = std::min(row2, mRows - 1);
+
+    for (int r = row1; r <= row2; r++) {
+      for (int c = col1; c <= col2; c++) {
+        size_t cell = static_cast<size_t>(r) * mCols + c;
+        for (int i = mStart[cell]; i < mStart[cell + 1]; i++) {
+          f(mIndices[static_cast<size_t>(i)]);
+        }
+      }
+    }
+  }
+
+private:
+
+  double mX0;
+  double mY0;
+  double mCellSize;
+  int mCols;
+  int mRows;
+  std::vector<int> mStart;
+  std::vector<int> mIndices;
+
+};
+
+} // namespace internal
+
+std::vector<cv::DMatch> RobustMatchingImp::guidedMatch(const cv::Mat &queryDescriptor,
+                                                       const cv::Mat &trainDescriptor,
+                                                       const std::vector<cv::KeyPoint> &keypoints1,
+                                                       const std::vector<cv::KeyPoint> &keypoints2,
+                                                       const cv::Mat &model,
+                                                       GeometricTest geometricTest,
+                                                       std::vector<cv::DMatch> *wrongMatches)
+{
+  std::vector<cv::DMatch> goodMatches;
+
+  try {
+
+    TL_ASSERT(model.rows == 3 && model.cols == 3, "Invalid geometric model");
+    TL_ASSERT(geometricTest == GeometricTest::homography ||
+              geometricTest == GeometricTest::fundamental, "Guided matching requires a homography or a fundamental matrix");
+    TL_ASSERT(queryDescriptor.rows == static_cast<int>(keypoints1.size()) &&
+              trainDescriptor.rows == static_cast<int>(keypoints2.size()), "Descriptors don't match the keypoints");
+    TL_ASSERT(queryDescriptor.type() == trainDescriptor.type() &&
+              queryDescriptor.cols == trainDescriptor.cols, "Incompatible descriptors");
+
+    cv::Mat m;
+    model.convertTo(m, CV_64F);
+    const double *M = m.ptr<double>(0);
+
+    /// Descriptores binarios: Hamming. El resto se compara con la distancia L2
+    bool binary = queryDescriptor.depth() == CV_8U;
+    cv::Mat query_descriptor = queryDescriptor;
+    cv::Mat train_descriptor = trainDescriptor;
+    if (!binary && queryDescriptor.depth() != CV_32F) {
+      queryDescriptor.convertTo(query_descriptor, CV_32F);
+      trainDescriptor.convertTo(train_descriptor, CV_32F);
+    }
+    int length = binary ? static_cast<int>(query_descriptor.cols * query_descriptor.elemSize())
+                        : query_descriptor.cols * query_descriptor.channels();
+
+    double radius = this->guidedSearchRadius();
+    internal::KeyPointGrid grid(keypoints2, 2. * radius);
+
+    std::vector<cv::DMatch> matches;
+    matches.reserve(keypoints1.size());
+
+    for (size_t i = 0; i < keypoints1.size(); i++) {
+
+      const uchar *query = query_descriptor.ptr(static_cast<int>(i));
+      float best_distance = std::numeric_limits<float>::max();
+      float second_distance = std::numeric_limits<float>::max();
+      int best = -1;
+
+      auto candidate = [&](int j) {
+        const uchar *train = train_descriptor.ptr(j);
+        float distance = binary ?
+          static_cast<float>(cv::hal::normHamming(query, train, length)) :
+          std::sqrt(cv::hal::normL2Sqr_(reinterpret_cast<const float *>(query),
+                                        reinterpret_cast<const float *>(train),
+                                        length));
+        if (distance < best_distance) {
+          second_distance = best_distance;
+          best_distance = distance;
+          best = j;
+        } else if (distance < second_distance) {
+          second_distance = distance;
+        }
+      };
+
+      double x = keypoints1[i].pt.x;
+      double y = keypoints1[i].pt.y;
+      double u = M[0] * x + M[1] * y + M[2];
+      double v = M[3] * x + M[4] * y + M[5];
+      double w = M[6] * x + M[7] * y + M[8];
+
+      if (geometricTest == GeometricTest::homography) {
+
+        if (std::abs(w) < std::numeric_limits<double>::epsilon()) continue;
+        double x2 = u / w;
+        double y2 = v / w;
+        grid.window(x2, y2, radius, [&](int j) {
+          double dx = keypoints2[static_cast<size_t>(j)].pt.x - x2;
+          double dy = keypoints2[static_cast<size_t>(j)].pt.y - y2;
+          if (dx * dx + dy * dy <= radius * radius) candidate(j);
+        });
+
+      } else {
+
+        /// Recta epipolar l = F·x1 normalizada
+        double norm = std::sqrt(u * u + v * v);
+        if (norm < std::numeric_limits<double>::epsilon()) continue;
+        double a = u / norm;
+        double b = v / norm;
+        double c = w / norm;
+        grid.band(a, b, c, radius, [&](int j) {
+          const cv::Point2f &pt = keypoints2[static_cast<size_t>(j)].pt;
+          if (std::abs(a * pt.x + b * pt.y + c) <= radius) candidate(j);
+        });
+
+      }
+
+      if (best < 0) continue;
+
+      cv::DMatch guided_match(static_cast<int>(i), best, best_distance);
+
+      /// Con un único candidato no se puede aplicar el test de ratio
+      if (second_distance < std::numeric_limits<float>::max() &&
+          best_distance > static_cast<float>(this->ratio()) * second_distance) {
+        if (wrongMatches) wrongMatches->push_back(guided_match);
+      } else {
+        matches.push_back(guided_match);
+      }
+    }
+
+    if (this->crossCheck()) {
+
+      /// Cada keypoint de la imagen train se queda con su mejor match
+      std::vector<int> best_query(keypoints2.size(), -1);
+      for (size_t i = 0; i < matches.size(); i++) {
+        int &best = best_query[static_cast<size_t>(matches[i].trainIdx)];
+        if (best < 0 || matches[i].distance < matches[static_cast<size_t>(best)].distance)
+          best = static_cast<int>(i);
+      }
+
+      for (size_t i = 0; i < matches.size(); i++) {
+        if (best_query[static_cast<size_t>(matches[i].trainIdx)] == static_cast<int>(i)) {
+          goodMatches.push_back(matches[i]);
+        } else if (wrongMatches) {
+          wrongMatches->push_back(matches[i]);
+        }
+      }
+
+    } else {
+      goodMatches = std::move(matches);
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return goodMatches;
+}
+
 bool RobustMatchingImp::compute(const cv::Mat &queryDescriptor,
                                 const cv::Mat &trainDescriptor,
                                 const std::vector<cv::KeyPoint> &keypoints1,
@@ -416,8 +732,19 @@ bool RobustMatchingImp::compute(const cv::Mat &queryDescriptor,
                                 const cv::Size &trainImageSize)
 {
   try {
+    cv::Mat model;
     *goodMatches = this->match(queryDescriptor, trainDescriptor, wrongMatches);
-    *goodMatches = this->geometricFilter(*goodMatches, keypoints1, keypoints2, wrongMatches);
+    *goodMatches = this->geometricFilter(*goodMatches, keypoints1, keypoints2, wrongMatches, &model);
+
+    /// Segunda pasada guiada por el modelo estimado con los matches de la primera
+    if (this->guidedMatching() && !model.empty()) {
+      if (wrongMatches) wrongMatches->clear();
+      *goodMatches = this->guidedMatch(queryDescriptor, trainDescriptor,
+                                       keypoints1, keypoints2,
+                                       model, this->geometricTest(),
+                                       wrongMatches);
+    }
+
     return false;
   } catch(std::exception &e){
     msgError(e.what());
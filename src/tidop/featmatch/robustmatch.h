@@ -61,6 +61,10 @@ public:
   void setConfidence(double confidence) override;
   int maxIter() const override;
   void setMaxIters(int maxIter) override;
+  bool guidedMatching() const override;
+  void setGuidedMatching(bool guidedMatching) override;
+  double guidedSearchRadius() const override;
+  void setGuidedSearchRadius(double guidedSearchRadius) override;
 
 // MatchingStrategy interface
 
@@ -80,6 +84,8 @@ private:
   double mDistance;
   double mConfidence;
   int mMaxIters;
+  bool mGuidedMatching;
+  double mGuidedSearchRadius;
 
 };
 
@@ -189,12 +195,14 @@ public:
   std::vector<cv::DMatch> geometricFilter(const std::vector<cv::DMatch> &matches,
                                           const std::vector<cv::KeyPoint>& keypoints1,
                                           const std::vector<cv::KeyPoint>& keypoints2,
-                                          std::vector<cv::DMatch> *wrongMatches = nullptr);
+                                          std::vector<cv::DMatch> *wrongMatches = nullptr,
+                                          cv::Mat *model = nullptr);
 
   std::vector<cv::DMatch> filterByHomographyMatrix(const std::vector<cv::DMatch> &matches,
                                                    const std::vector<cv::Point2f>& points1,
                                                    const std::vector<cv::Point2f>& points2,
-                                                   std::vector<cv::DMatch> *wrongMatches = nullptr);
+                                                   std::vector<cv::DMatch> *wrongMatches = nullptr,
+                                                   cv::Mat *model = nullptr);
   std::vector<cv::DMatch> filterByEssentialMatrix(const std::vector<cv::DMatch> &matches,
                                                   const std::vector<cv::Point2f>& points1,
                                                   const std::vector<cv::Point2f>& points2,
@@ -202,7 +210,36 @@ public:
   std::vector<cv::DMatch> filterByFundamentalMatrix(const std::vector<cv::DMatch> &matches,
                                                     const std::vector<cv::Point2f>& points1,
                                                     const std::vector<cv::Point2f>& points2,
-                                                    std::vector<cv::DMatch> *wrongMatches = nullptr);
+                                                    std::vector<cv::DMatch> *wrongMatches = nullptr,
+                                                    cv::Mat *model = nullptr);
+
+  /*!
+   * \brief Guided matching
+   * Each query keypoint is only compared with the train keypoints close to its
+   * epipolar line (fundamental matrix) or to its projection (homography). The
+   * train keypoints are bucketed in a grid, so only the cells crossed by the
+   * epipolar band or the search window are visited. The ratio test is applied
+   * to the candidates of each keypoint, and the cross check keeps the best
+   * query of each train keypoint.
+   * The model can be estimated by the geometric filter or derived from the
+   * approximate orientation of the images.
+   * \param[in] queryDescriptor Query descriptor
+   * \param[in] trainDescriptor Train descriptor
+   * \param[in] keypoints1 Query keypoints
+   * \param[in] keypoints2 Train keypoints
+   * \param[in] model Fundamental matrix (x2' F x1 = 0) or homography (x2 = H x1)
+   * \param[in] geometricTest Type of model: homography or fundamental
+   * \param[out] wrongMatches Wrong matches
+   * \return Good matches
+   * \see guidedSearchRadius
+   */
+  std::vector<cv::DMatch> guidedMatch(const cv::Mat &queryDescriptor,
+                                      const cv::Mat &trainDescriptor,
+                                      const std::vector<cv::KeyPoint> &keypoints1,
+                                      const std::vector<cv::KeyPoint> &keypoints2,
+                                      const cv::Mat &model,
+                                      GeometricTest geometricTest,
+                                      std::vector<cv::DMatch> *wrongMatches = nullptr);
 
   /*!
    * \brief Matching
@@ -0,0 +1,305 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "tileddetector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "tidop/core/concurrency.h"
+#include "tidop/core/exception.h"
+#include "tidop/core/messages.h"
+#include "tidop/featmatch/keypointsfilter.h"
+#ifdef TL_HAVE_IMG
+#include "tidop/img/imgreader.h"
+#endif
+
+namespace tl
+{
+
+
+TiledKeypointDetector::TiledKeypointDetector(DetectorFactory detectorFactory)
+  : mDetectorFactory(std::move(detectorFactory)),
+    mTileSize(2048),
+    mOverlap(64),
+    mThreads(0),
+    mMaxKeypoints(0),
+    mBudget(Budget::global),
+    mSelection(Selection::n_best)
+{
+}
+
+int TiledKeypointDetector::tileSize() const
+{
+  return mTileSize;
+}
+
+void TiledKeypointDetector::setTileSize(int tileSize)
+{
+  mTileSize = tileSize;
+}
+
+int TiledKeypointDetector::overlap() const
+{
+  return mOverlap;
+}
+
+void TiledKeypointDetector::setOverlap(int overlap)
+{
+  mOverlap = overlap;
+}
+
+size_t TiledKeypointDetector::threads() const
+{
+  return mThreads;
+}
+
+void TiledKeypointDetector::setThreads(size_t threads)
+{
+  mThreads = threads;
+}
+
+int TiledKeypointDetector::maxKeypoints() const
+{
+  return mMaxKeypoints;
+}
+
+void TiledKeypointDetector::setMaxKeypoints(int maxKeypoints)
+{
+  mMaxKeypoints = maxKeypoints;
+}
+
+TiledKeypointDetector::Budget TiledKeypointDetector::budget() const
+{
+  return mBudget;
+}
+
+void TiledKeypointDetector::setBudget(Budget budget)
+{
+  mBudget = budget;
+}
+
+TiledKeypointDetector::Selection TiledKeypointDetector::selection() const
+{
+  return mSelection;
+}
+
+void TiledKeypointDetector::setSelection(Selection selection)
+{
+  mSelection = selection;
+}
+
+std::vector<cv::KeyPoint> TiledKeypointDetector::detect(const Path &image)
+{
+  std::vector<cv::KeyPoint> key_points;
+
+  try {
+
+#ifdef TL_HAVE_IMG
+
+    std::unique_ptr<ImageReader> image_reader = ImageReaderFactory::create(image);
+    image_reader->open();
+    TL_ASSERT(image_reader->isOpen(), "Can't open the image");
+
+    /// El lector no admite lecturas concurrentes
+    std::mutex mutex;
+    auto loader = [&](const cv::Rect &tile, cv::Mat &tile_image, cv::Mat &) {
+      {
+        std::lock_guard<std::mutex> lck(mutex);
+        tile_image = image_reader->read(RectI(tile.x, tile.y, tile.width, tile.height));
+      }
+      if (tile_image.channels() == 3)
+        cv::cvtColor(tile_image, tile_image, cv::COLOR_BGR2GRAY);
+      else if (tile_image.channels() == 4)
+        cv::cvtColor(tile_image, tile_image, cv::COLOR_BGRA2GRAY);
+    };
+
+    key_points = detectTiles(image_reader->rows(), image_reader->cols(), loader);
+
+    image_reader->close();
+
+#else
+
+    cv::Mat img = cv::imread(image.toString(), cv::IMREAD_IGNORE_ORIENTATION | cv::IMREAD_GRAYSCALE);
+    TL_ASSERT(!img.empty(), "Can't open the image");
+    key_points = detect(img);
+
+#endif
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return key_points;
+}
+
+std::vector<cv::KeyPoint> TiledKeypointDetector::detect(const cv::Mat &img,
+                                                        cv::InputArray &mask)
+{
+  std::vector<cv::KeyPoint> key_points;
+
+  try {
+
+    cv::Mat image_mask = mask.getMat();
+
+    /// Las teselas son vistas de la imagen, no se copian
+    auto loader = [&](const cv::Rect &tile, cv::Mat &tile_image, cv::Mat &tile_mask) {
+      tile_image = img(tile);
+      if (!image_mask.empty()) tile_mask = image_mask(tile);
+    };
+
+    key_points = detectTiles(img.rows, img.cols, loader);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return key_points;
+}
+
+std::vector<cv::KeyPoint> TiledKeypointDetector::detectTiles(int rows, int cols,
+                                                             const TileLoader &loader)
+{
+  TL_ASSERT(mDetectorFactory, "Detector factory not defined");
+  TL_ASSERT(mTileSize > 0 && mOverlap >= 0 && mOverlap < mTileSize, "Invalid tile size or overlap");
+
+  if (rows <= 0 || cols <= 0) return std::vector<cv::KeyPoint>();
+
+  int step = mTileSize - mOverlap;
+  int half_overlap = mOverlap / 2;
+  int tiles_x = std::max(1, static_cast<int>(std::ceil(static_cast<double>(cols - mOverlap) / step)));
+  int tiles_y = std::max(1, static_cast<int>(std::ceil(static_cast<double>(rows - mOverlap) / step)));
+  size_t tiles = static_cast<size_t>(tiles_x) * static_cast<size_t>(tiles_y);
+
+  size_t num_threads = mThreads == 0 ? optimalNumberOfThreads() : mThreads;
+  num_threads = std::max<size_t>(1, std::min(num_threads, tiles));
+
+  std::vector<std::vector<cv::KeyPoint>> tile_key_points(tiles);
+  std::atomic<size_t> next_tile(0);
+  std::atomic<bool> failed(false);
+  std::exception_ptr error;
+  std::mutex mutex;
+
+  auto worker = [&](size_t /*thread*/) {
+
+    try {
+
+      std::shared_ptr<KeypointDetector> detector = mDetectorFactory();
+      TL_ASSERT(detector, "Invalid detector");
+
+      for (size_t i = next_tile++; i < tiles && !failed; i = next_tile++) {
+
+        int col = static_cast<int>(i % tiles_x);
+        int row = static_cast<int>(i / tiles_x);
+
+        cv::Rect tile(col * step, row * step, mTileSize, mTileSize);
+        tile &= cv::Rect(0, 0, cols, rows);
+
+        /// Región propia de la tesela: la mitad del solape con cada vecina
+        int core_x1 = col == 0 ? 0 : tile.x + half_overlap;
+        int core_y1 = row == 0 ? 0 : tile.y + half_overlap;
+        int core_x2 = col == tiles_x - 1 ? cols : (col + 1) * step + half_overlap;
+        int core_y2 = row == tiles_y - 1 ? rows : (row + 1) * step + half_overlap;
+
+        cv::Mat tile_image;
+        cv::Mat tile_mask;
+        loader(tile, tile_image, tile_mask);
+        if (tile_image.empty()) continue;
+
+        std::vector<cv::KeyPoint> key_points = tile_mask.empty() ?
+                                                 detector->detect(tile_image) :
+                                                 detector->detect(tile_image, tile_mask);
+
+        std::vector<cv::KeyPoint> &core_key_points = tile_key_points[i];
+        core_key_points.reserve(key_points.size());
+        for (auto &key_point : key_points) {
+          key_point.pt.x += static_cast<float>(tile.x);
+          key_point.pt.y += static_cast<float>(tile.y);
+          if (key_point.pt.x >= core_x1 && key_point.pt.x < core_x2 &&
+              key_point.pt.y >= core_y1 && key_point.pt.y < core_y2) {
+            core_key_points.push_back(key_point);
+          }
+        }
+
+        if (mMaxKeypoints > 0 && mBudget == Budget::per_tile) {
+          double core_area = static_cast<double>(core_x2 - core_x1) * (core_y2 - core_y1);
+          double image_area = static_cast<double>(cols) * rows;
+          size_t quota = static_cast<size_t>(std::ceil(mMaxKeypoints * core_area / image_area));
+          retainBest(core_key_points, quota);
+        }
+      }
+
+    } catch (...) {
+      std::lock_guard<std::mutex> lck(mutex);
+      if (!failed) error = std::current_exception();
+      failed = true;
+    }
+  };
+
+  parallel_for(0, num_threads, worker);
+
+  if (error) std::rethrow_exception(error);
+
+  size_t size = 0;
+  for (const auto &key_points : tile_key_points) size += key_points.size();
+
+  std::vector<cv::KeyPoint> key_points;
+  key_points.reserve(size);
+  for (auto &tile : tile_key_points) {
+    key_points.insert(key_points.end(), tile.begin(), tile.end());
+    std::vector<cv::KeyPoint>().swap(tile);
+  }
+
+  if (mMaxKeypoints > 0 && mBudget == Budget::global) {
+    retainBest(key_points, static_cast<size_t>(mMaxKeypoints));
+  }
+
+  msgInfo("%i keypoints detected in %i tiles", static_cast<int>(key_points.size()), static_cast<int>(tiles));
+
+  return key_points;
+}
+
+void TiledKeypointDetector::retainBest(std::vector<cv::KeyPoint> &keyPoints, size_t size) const
+{
+  if (keyPoints.size() <= size) return;
+
+  if (mSelection == Selection::anms) {
+    KeyPointsFilterAnms anms(static_cast<int>(size));
+    keyPoints = anms.filter(keyPoints);
+    return;
+  }
+
+  cv::KeyPointsFilter::retainBest(keyPoints, static_cast<int>(size));
+
+  /// retainBest conserva los empates con el último keypoint
+  if (keyPoints.size() > size) keyPoints.resize(size);
+}
+
+} // namespace tl
@@ -0,0 +1,187 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_FEATMATCH_TILED_DETECTOR_H
+#define TL_FEATMATCH_TILED_DETECTOR_H
+
+#include "config_tl.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/path.h"
+#include "tidop/featmatch/features.h"
+
+namespace tl
+{
+
+/*! \addtogroup Features
+ *
+ *  \{
+ */
+
+/*!
+ * \brief Tiled keypoint detection for very large images
+ *
+ * The image is split into overlapping tiles that are processed in parallel by
+ * the wrapped detector. Each worker thread owns its own detector instance,
+ * created with the factory, so any detector of the library can be used.
+ *
+ * Every tile owns the central part of the overlap it shares with its
+ * neighbours (half the overlap on each side), and only the keypoints that fall
+ * in that core region are kept. This removes the duplicated keypoints at the
+ * seams without searching for them, while the other half of the overlap gives
+ * the detector the context it needs near the tile border. The overlap must be
+ * larger than twice the border discarded by the detector (ORB edge threshold,
+ * SIFT border, ...).
+ *
+ * The number of keypoints can be limited for the whole image or distributed
+ * between tiles proportionally to their area, which gives a more even
+ * distribution of the keypoints. The keypoints retained are the strongest ones
+ * or those selected by adaptive non-maximal suppression.
+ *
+ * \code
+ * TiledKeypointDetector detector([]() {
+ *                                  return std::make_shared<OrbDetectorDescriptor>();
+ *                                });
+ * detector.setMaxKeypoints(20000);
+ * detector.setBudget(TiledKeypointDetector::Budget::per_tile);
+ * std::vector<cv::KeyPoint> key_points = detector.detect(Path("image.tif"));
+ * \endcode
+ */
+class TL_EXPORT TiledKeypointDetector
+  : public KeypointDetector
+{
+
+public:
+
+  using DetectorFactory = std::function<std::shared_ptr<KeypointDetector>()>;
+
+  /*!
+   * \brief Distribution of the maximum number of keypoints
+   */
+  enum class Budget
+  {
+    global,   /*!< budget for the whole image */
+    per_tile  /*!< budget for each tile, proportional to its area */
+  };
+
+  /*!
+   * \brief Selection of the keypoints retained
+   */
+  enum class Selection
+  {
+    n_best, /*!< strongest keypoints */
+    anms    /*!< adaptive non-maximal suppression (KeyPointsFilterAnms) */
+  };
+
+public:
+
+  /*!
+   * \brief Constructor
+   * \param[in] detectorFactory Creates a detector for each worker
+   */
+  explicit TiledKeypointDetector(DetectorFactory detectorFactory);
+  ~TiledKeypointDetector() override = default;
+
+  TL_DISABLE_COPY(TiledKeypointDetector)
+  TL_DISABLE_MOVE(TiledKeypointDetector)
+
+  /*!
+   * \brief Tile size in pixels (default 2048)
+   */
+  int tileSize() const;
+  void setTileSize(int tileSize);
+
+  /*!
+   * \brief Overlap between neighbouring tiles in pixels (default 64)
+   */
+  int overlap() const;
+  void setOverlap(int overlap);
+
+  /*!
+   * \brief Number of detection threads. 0 (default) uses all the cores
+   */
+  size_t threads() const;
+  void setThreads(size_t threads);
+
+  /*!
+   * \brief Maximum number of keypoints. 0 (default) keeps all the keypoints
+   */
+  int maxKeypoints() const;
+  void setMaxKeypoints(int maxKeypoints);
+
+  /*!
+   * \brief Distribution of the maximum number of keypoints (default Budget::global)
+   */
+  Budget budget() const;
+  void setBudget(Budget budget);
+
+  /*!
+   * \brief Selection of the keypoints retained (default Selection::n_best)
+   */
+  Selection selection() const;
+  void setSelection(Selection selection);
+
+  /*!
+   * \brief Detects keypoints in an image file reading it by tiles
+   * Only the tiles being processed are loaded in memory.
+   * \param[in] image Image file
+   * \return key points detected
+   */
+  std::vector<cv::KeyPoint> detect(const Path &image);
+
+// KeypointDetector interface
+
+public:
+
+  std::vector<cv::KeyPoint> detect(const cv::Mat &img,
+                                   cv::InputArray &mask = cv::noArray()) override;
+
+private:
+
+  using TileLoader = std::function<void(const cv::Rect &, cv::Mat &, cv::Mat &)>;
+
+  std::vector<cv::KeyPoint> detectTiles(int rows, int cols, const TileLoader &loader);
+  void retainBest(std::vector<cv::KeyPoint> &keyPoints, size_t size) const;
+
+private:
+
+  DetectorFactory mDetectorFactory;
+  int mTileSize;
+  int mOverlap;
+  size_t mThreads;
+  int mMaxKeypoints;
+  Budget mBudget;
+  Selection mSelection;
+
+};
+
+/*! \} */ // end of Features
+
+} // namespace tl
+
+#endif // TL_FEATMATCH_TILED_DETECTOR_H
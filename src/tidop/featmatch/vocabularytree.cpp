@@ -0,0 +1,709 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "vocabularytree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <string>
+
+#include <opencv2/core/hal/hal.hpp>
+
+#include "tidop/core/concurrency.h"
+#include "tidop/core/exception.h"
+#include "tidop/core/messages.h"
+#include "tidop/featmatch/featio.h"
+
+namespace tl
+{
+
+namespace internal
+{
+
+/*!
+ * \brief Distancia entre descriptores: Hamming para binarios y L2 al cuadrado para reales
+ */
+inline double descriptorDistance(const uchar *descriptor1,
+                                 const uchar *descriptor2,
+                                 int cols,
+                                 int type)
+{
+  if (type == CV_8U)
+    return static_cast<double>(cv::hal::normHamming(descriptor1, descriptor2, cols));
+
+  return static_cast<double>(cv::hal::normL2Sqr_(reinterpret_cast<const float *>(descriptor1),
+                                                 reinterpret_cast<const float *>(descriptor2),
+                                                 cols));
+}
+
+/*!
+ * \brief Centro más cercano de las filas [first, first + count) de centers
+ * \return Posición del centro respecto a first
+ */
+inline int nearestCenter(const cv::Mat &centers,
+                         int first,
+                         int count,
+                         const uchar *descriptor)
+{
+  int best = 0;
+  double best_distance = std::numeric_limits<double>::max();
+
+  for (int i = 0; i < count; i++) {
+    double distance = descriptorDistance(centers.ptr(first + i), descriptor, centers.cols, centers.type());
+    if (distance < best_distance) {
+      best_distance = distance;
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+/*!
+ * \brief k-means de un subconjunto de descriptores
+ *
+ * Inicialización k-means++ con semilla fija para que el entrenamiento sea
+ * reproducible. Los centros de los descriptores binarios son el voto
+ * mayoritario de cada bit.
+ *
+ * \param[in] descriptors Descriptores
+ * \param[in] indices Filas de descriptors que se agrupan
+ * \param[in] k Número de grupos
+ * \param[in] iterations Número máximo de iteraciones
+ * \param[in] parallel Asignación de los descriptores en paralelo
+ * \param[out] centers Centros. Vacío si los descriptores no se pueden separar
+ * \param[out] labels Grupo de cada descriptor
+ */
+inline void kmeans(const cv::Mat &descriptors,
+                   const std::vector<int> &indices,
+                   int k,
+                   int iterations,
+                   bool parallel,
+                   cv::Mat &centers,
+                   std::vector<int> &labels)
+{
+  size_t size = indices.size();
+  int cols = descriptors.cols;
+  int type = descriptors.type();
+
+  auto for_each = [parallel, size](const std::function<void(size_t)> &f) {
+    if (parallel) {
+      parallel_for(0, size, f);
+    } else {
+      for (size_t i = 0; i < size; i++) f(i);
+    }
+  };
+
+  /// Inicialización k-means++
+
+  std::mt19937 random(static_cast<unsigned int>(size));
+  std::vector<int> seeds;
+  seeds.reserve(static_cast<size_t>(k));
+  seeds.push_back(indices[random() % size]);
+
+  std::vector<double> min_distance(size, std::numeric_limits<double>::max());
+
+  while (seeds.size() < static_cast<size_t>(k)) {
+
+    const uchar *seed = descriptors.ptr(seeds.back());
+    for_each([&](size_t i) {
+      double distance = descriptorDistance(descriptors.ptr(indices[i]), seed, cols, type);
+      if (distance < min_distance[i]) min_distance[i] = distance;
+    });
+
+    double sum = std::accumulate(min_distance.begin(), min_distance.end(), 0.);
+    if (sum <= 0.) break;
+
+    double r = std::uniform_real_distribution<double>(0., sum)(random);
+    size_t i = 0;
+    for (; i < size - 1; i++) {
+      r -= min_distance[i];
+      if (r <= 0.) break;
+    }
+    seeds.push_back(indices[i]);
+  }
+
+  if (seeds.size() < 2) {
+    centers.release();
+    return;
+  }
+
+  int clusters = static_cast<int>(seeds.size());
+  centers.create(clusters, cols, type);
+  for (int c = 0; c < clusters; c++) {
+    descriptors.row(seeds[static_cast<size_t>(c)]).copyTo(centers.row(c));
+  }
+
+  labels.assign(size, -1);
+
+  for (int iteration = 0; iteration < iterations; iteration++) {
+
+    /// Asignación
+
+    std::atomic<bool> changed(false);
+    for_each([&](size_t i) {
+      int label = nearestCenter(centers, 0, clusters, descriptors.ptr(indices[i]));
+      if (label != labels[i]) {
+        labels[i] = label;
+        changed = true;
+      }
+    });
+
+    if (!changed || iteration == iterations - 1) break;
+
+    /// Actualización de los centros. Los grupos vacíos conservan su centro
+
+    std::vector<int> count(static_cast<size_t>(clusters), 0);
+
+    if (type == CV_32F) {
+
+      std::vector<double> sum(static_cast<size_t>(clusters) * cols, 0.);
+      for (size_t i = 0; i < size; i++) {
+        const float *descriptor = descriptors.ptr<float>(indices[i]);
+        double *cluster_sum = &sum[static_cast<size_t>(labels[i]) * cols];
+        for (int j = 0; j < cols; j++) cluster_sum[j] += descriptor[j];
+        count[labels[i]]++;
+      }
+
+      for (int c = 0; c < clusters; c++) {
+        if (count[c] == 0) continue;
+        float *center = centers.ptr<float>(c);
+        const double *cluster_sum = &sum[static_cast<size_t>(c) * cols];
+        for (int j = 0; j < cols; j++)
+          center[j] = static_cast<float>(cluster_sum[j] / count[c]);
+      }
+
+    } else {
+
+      size_t bits = static_cast<size_t>(cols) * 8;
+      std::vector<int> ones(static_cast<size_t>(clusters) * bits, 0);
+      for (size_t i = 0; i < size; i++) {
+        const uchar *descriptor = descriptors.ptr(indices[i]);
+        int *cluster_ones = &ones[static_cast<size_t>(labels[i]) * bits];
+        for (int j = 0; j < cols; j++) {
+          for (int b = 0; b < 8; b++) {
+            cluster_ones[j * 8 + b] += (descriptor[j] >> (7 - b)) & 1;
+          }
+        }
+        count[labels[i]]++;
+      }
+
+      for (int c = 0; c < clusters; c++) {
+        if (count[c] == 0) continue;
+        uchar *center = centers.ptr(c);
+        const int *cluster_ones = &ones[static_cast<size_t>(c) * bits];
+        for (int j = 0; j < cols; j++) {
+          uchar byte = 0;
+          for (int b = 0; b < 8; b++) {
+            if (2 * cluster_ones[j * 8 + b] > count[c])
+              byte |= static_cast<uchar>(1 << (7 - b));
+          }
+          center[j] = byte;
+        }
+      }
+
+    }
+  }
+}
+
+} // namespace internal
+
+
+
+VocabularyTree::VocabularyTree()
+  : mWords(0)
+{
+}
+
+void VocabularyTree::train(const cv::Mat &descriptors,
+                           int branching,
+                           int levels,
+                           int iterations)
+{
+  try {
+
+    TL_ASSERT(!descriptors.empty(), "Empty descriptors");
+    TL_ASSERT(descriptors.type() == CV_32F || descriptors.type() == CV_8U, "Descriptor type not supported");
+    TL_ASSERT(branching > 1 && levels > 0 && iterations > 0, "Invalid vocabulary tree parameters");
+
+    std::vector<Node> nodes(1, Node{-1, 0, -1});
+    std::vector<cv::Mat> centers(1, cv::Mat::zeros(1, descriptors.cols, descriptors.type()));
+
+    /// Nodos pendientes del nivel actual y descriptores de cada uno
+    std::vector<std::pair<int, std::vector<int>>> current(1);
+    current[0].first = 0;
+    current[0].second.resize(static_cast<size_t>(descriptors.rows));
+    std::iota(current[0].second.begin(), current[0].second.end(), 0);
+
+    size_t num_threads = optimalNumberOfThreads();
+
+    for (int level = 0; level < levels && !current.empty(); level++) {
+
+      std::vector<cv::Mat> level_centers(current.size());
+      std::vector<std::vector<int>> level_labels(current.size());
+
+      auto cluster = [&](size_t i, bool parallel) {
+        if (current[i].second.size() > static_cast<size_t>(branching)) {
+          internal::kmeans(descriptors, current[i].second, branching, iterations,
+                           parallel, level_centers[i], level_labels[i]);
+        }
+      };
+
+      /// En los primeros niveles hay pocos nodos pero con muchos descriptores
+      if (current.size() < num_threads) {
+        for (size_t i = 0; i < current.size(); i++) cluster(i, true);
+      } else {
+        parallel_for(0, current.size(), [&](size_t i) {
+          cluster(i, false);
+        });
+      }
+
+      std::vector<std::pair<int, std::vector<int>>> next;
+
+      for (size_t i = 0; i < current.size(); i++) {
+
+        if (level_centers[i].empty()) continue;
+
+        std::vector<std::vector<int>> clusters(static_cast<size_t>(level_centers[i].rows));
+        for (size_t j = 0; j < current[i].second.size(); j++) {
+          clusters[static_cast<size_t>(level_labels[i][j])].push_back(current[i].second[j]);
+        }
+
+        int first_child = static_cast<int>(nodes.size());
+        int children = 0;
+        for (int c = 0; c < level_centers[i].rows; c++) {
+          if (clusters[c].empty()) continue;
+          nodes.push_back(Node{-1, 0, -1});
+          centers.push_back(level_centers[i].row(c));
+          next.emplace_back(static_cast<int>(nodes.size()) - 1, std::move(clusters[c]));
+          children++;
+        }
+
+        nodes[current[i].first].firstChild = first_child;
+        nodes[current[i].first].children = children;
+      }
+
+      current = std::move(next);
+    }
+
+    mWords = 0;
+    for (auto &node : nodes) {
+      if (node.children == 0) node.word = static_cast<int>(mWords++);
+    }
+
+    mNodes = std::move(nodes);
+    cv::vconcat(centers, mCenters);
+
+    msgInfo("Vocabulary tree trained: %i words", static_cast<int>(mWords));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+size_t VocabularyTree::words() const
+{
+  return mWords;
+}
+
+bool VocabularyTree::empty() const
+{
+  return mWords == 0;
+}
+
+int VocabularyTree::descriptorType() const
+{
+  return mCenters.empty() ? -1 : mCenters.type();
+}
+
+std::vector<int> VocabularyTree::quantize(const cv::Mat &descriptors) const
+{
+  std::vector<int> words;
+
+  try {
+
+    TL_ASSERT(!empty(), "Vocabulary not trained");
+
+    if (descriptors.empty()) return words;
+
+    TL_ASSERT(descriptors.type() == mCenters.type() && descriptors.cols == mCenters.cols,
+              "Descriptors don't match the vocabulary");
+
+    words.resize(static_cast<size_t>(descriptors.rows));
+    for (int i = 0; i < descriptors.rows; i++) {
+      words[static_cast<size_t>(i)] = word(descriptors, i);
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return words;
+}
+
+int VocabularyTree::word(const cv::Mat &descriptors, int row) const
+{
+  const uchar *descriptor = descriptors.ptr(row);
+
+  size_t node = 0;
+  while (mNodes[node].children > 0) {
+    int first_child = mNodes[node].firstChild;
+    node = static_cast<size_t>(first_child + internal::nearestCenter(mCenters, first_child,
+                                                                     mNodes[node].children,
+                                                                     descriptor));
+  }
+
+  return mNodes[node].word;
+}
+
+void VocabularyTree::save(const Path &file) const
+{
+  try {
+
+    TL_ASSERT(!empty(), "Vocabulary not trained");
+
+    std::ofstream stream(file.toString(), std::ios::binary | std::ios::trunc);
+    TL_ASSERT(stream.is_open(), "Can't open the vocabulary file");
+
+    int32_t nodes = static_cast<int32_t>(mNodes.size());
+    int32_t cols = mCenters.cols;
+    int32_t type = mCenters.type();
+    int32_t words = static_cast<int32_t>(mWords);
+    stream.write("TIDOPLIB-VocabularyTree-#01", sizeof("TIDOPLIB-VocabularyTree-#01"));
+    stream.write(reinterpret_cast<const char *>(&nodes), sizeof(int32_t));
+    stream.write(reinterpret_cast<const char *>(&cols), sizeof(int32_t));
+    stream.write(reinterpret_cast<const char *>(&type), sizeof(int32_t));
+    stream.write(reinterpret_cast<const char *>(&words), sizeof(int32_t));
+
+    for (const auto &node : mNodes) {
+      int32_t data[3] = {node.firstChild, node.children, node.word};
+      stream.write(reinterpret_cast<const char *>(data), sizeof(data));
+    }
+
+    size_t row_size = mCenters.cols * mCenters.elemSize();
+    for (int r = 0; r < mCenters.rows; r++) {
+      stream.write(reinterpret_cast<const char *>(mCenters.ptr(r)), static_cast<std::streamsize>(row_size));
+    }
+
+    TL_ASSERT(stream.good(), "Error writing the vocabulary file");
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VocabularyTree::load(const Path &file)
+{
+  try {
+
+    std::ifstream stream(file.toString(), std::ios::binary);
+    TL_ASSERT(stream.is_open(), "Can't open the vocabulary file");
+
+    char header[sizeof("TIDOPLIB-VocabularyTree-#01")];
+    stream.read(header, sizeof(header));
+    TL_ASSERT(stream.good() && std::string(header) == "TIDOPLIB-VocabularyTree-#01",
+              "Invalid vocabulary file");
+
+    int32_t nodes = 0;
+    int32_t cols = 0;
+    int32_t type = 0;
+    int32_t words = 0;
+    stream.read(reinterpret_cast<char *>(&nodes), sizeof(int32_t));
+    stream.read(reinterpret_cast<char *>(&cols), sizeof(int32_t));
+    stream.read(reinterpret_cast<char *>(&type), sizeof(int32_t));
+    stream.read(reinterpret_cast<char *>(&words), sizeof(int32_t));
+    TL_ASSERT(stream.good() && nodes > 0 && cols > 0 && (type == CV_32F || type == CV_8U),
+              "Invalid vocabulary file");
+
+    std::vector<Node> tree(static_cast<size_t>(nodes));
+    for (auto &node : tree) {
+      int32_t data[3];
+      stream.read(reinterpret_cast<char *>(data), sizeof(data));
+      node = Node{data[0], data[1], data[2]};
+    }
+
+    cv::Mat centers(nodes, cols, type);
+    size_t row_size = centers.cols * centers.elemSize();
+    for (int r = 0; r < centers.rows; r++) {
+      stream.read(reinterpret_cast<char *>(centers.ptr(r)), static_cast<std::streamsize>(row_size));
+    }
+
+    TL_ASSERT(stream.good(), "Error reading the vocabulary file");
+
+    mNodes = std::move(tree);
+    mCenters = centers;
+    mWords = static_cast<size_t>(words);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+
+
+/*----------------------------------------------------------------*/
+
+
+
+VocabularyIndex::VocabularyIndex(std::shared_ptr<const VocabularyTree> vocabulary)
+  : mVocabulary(std::move(vocabulary))
+{
+}
+
+size_t VocabularyIndex::add(const cv::Mat &descriptors)
+{
+  try {
+
+    mHistograms.push_back(histogram(descriptors));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return mHistograms.size() - 1;
+}
+
+void VocabularyIndex::add(const std::vector<Path> &features)
+{
+  try {
+
+    size_t offset = mHistograms.size();
+    mHistograms.resize(offset + features.size());
+
+    size_t num_threads = std::max<size_t>(1, std::min<size_t>(optimalNumberOfThreads(), features.size()));
+    std::atomic<size_t> next_image(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex mutex;
+
+    auto worker = [&](size_t /*thread*/) {
+
+      try {
+
+        for (size_t i = next_image++; i < features.size() && !failed; i = next_image++) {
+          std::unique_ptr<FeaturesReader> reader = FeaturesReaderFactory::create(features[i]);
+          reader->read();
+          mHistograms[offset + i] = histogram(reader->descriptors());
+        }
+
+      } catch (...) {
+        std::lock_guard<std::mutex> lck(mutex);
+        if (!failed) error = std::current_exception();
+        failed = true;
+      }
+    };
+
+    parallel_for(0, num_threads, worker);
+
+    if (error) {
+      mHistograms.resize(offset);
+      std::rethrow_exception(error);
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VocabularyIndex::build()
+{
+  try {
+
+    TL_ASSERT(mVocabulary && !mVocabulary->empty(), "Vocabulary not trained");
+
+    size_t words = mVocabulary->words();
+    size_t images = mHistograms.size();
+
+    /// IDF: log(N / n_i), siendo n_i el número de imágenes que contienen la palabra
+    std::vector<size_t> document_frequency(words, 0);
+    for (const auto &histogram : mHistograms) {
+      for (const auto &word : histogram) document_frequency[static_cast<size_t>(word.first)]++;
+    }
+
+    mIdf.assign(words, 0.);
+    for (size_t w = 0; w < words; w++) {
+      if (document_frequency[w] > 0)
+        mIdf[w] = std::log(static_cast<double>(images) / static_cast<double>(document_frequency[w]));
+    }
+
+    mImages.resize(images);
+    std::vector<size_t> list_size(words, 0);
+    for (size_t i = 0; i < images; i++) {
+      mImages[i] = weight(mHistograms[i]);
+      for (const auto &word : mImages[i]) list_size[static_cast<size_t>(word.first)]++;
+    }
+
+    mInvertedFile.assign(words, std::vector<std::pair<size_t, double>>());
+    for (size_t w = 0; w < words; w++) mInvertedFile[w].reserve(list_size[w]);
+    for (size_t i = 0; i < images; i++) {
+      for (const auto &word : mImages[i]) {
+        mInvertedFile[static_cast<size_t>(word.first)].emplace_back(i, word.second);
+      }
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+size_t VocabularyIndex::size() const
+{
+  return mHistograms.size();
+}
+
+std::vector<std::pair<size_t, double>> VocabularyIndex::query(const cv::Mat &descriptors,
+                                                              size_t k) const
+{
+  std::vector<std::pair<size_t, double>> images;
+
+  try {
+
+    TL_ASSERT(!mInvertedFile.empty() && mImages.size() == mHistograms.size(), "Index not built");
+
+    images = query(weight(histogram(descriptors)), k, std::numeric_limits<size_t>::max());
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return images;
+}
+
+std::vector<ImagePair> VocabularyIndex::candidatePairs(size_t k) const
+{
+  std::vector<ImagePair> pairs;
+
+  try {
+
+    TL_ASSERT(!mInvertedFile.empty() && mImages.size() == mHistograms.size(), "Index not built");
+
+    std::vector<std::vector<std::pair<size_t, double>>> neighbours(mImages.size());
+    parallel_for(0, mImages.size(), [&](size_t i) {
+      neighbours[i] = query(mImages[i], k, i);
+    });
+
+    for (size_t i = 0; i < neighbours.size(); i++) {
+      for (const auto &neighbour : neighbours[i]) {
+        pairs.emplace_back(std::min(i, neighbour.first), std::max(i, neighbour.first));
+      }
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    msgInfo("%i candidate pairs of %i images", static_cast<int>(pairs.size()), static_cast<int>(mImages.size()));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return pairs;
+}
+
+VocabularyIndex::BowVector VocabularyIndex::histogram(const cv::Mat &descriptors) const
+{
+  TL_ASSERT(mVocabulary && !mVocabulary->empty(), "Vocabulary not trained");
+
+  std::vector<int> words = mVocabulary->quantize(descriptors);
+  std::sort(words.begin(), words.end());
+
+  BowVector histogram;
+  for (size_t i = 0; i < words.size();) {
+    size_t j = i;
+    while (j < words.size() && words[j] == words[i]) j++;
+    histogram.emplace_back(words[i], static_cast<double>(j - i));
+    i = j;
+  }
+
+  return histogram;
+}
+
+VocabularyIndex::BowVector VocabularyIndex::weight(const BowVector &histogram) const
+{
+  BowVector bow;
+  bow.reserve(histogram.size());
+
+  double sum = 0.;
+  for (const auto &word : histogram) {
+    double value = word.second * mIdf[static_cast<size_t>(word.first)];
+    /// Las palabras presentes en todas las imágenes no aportan nada
+    if (value <= 0.) continue;
+    bow.emplace_back(word.first, value);
+    sum += value;
+  }
+
+  if (sum > 0.) {
+    for (auto &word : bow) word.second /= sum;
+  }
+
+  return bow;
+}
+
+std::vector<std::pair<size_t, double>> VocabularyIndex::query(const BowVector &bow,
+                                                              size_t k,
+                                                              size_t exclude) const
+{
+  /// Con vectores normalizados (L1): |q - d| = 2 + suma(|q_i - d_i| - |q_i| - |d_i|)
+  /// extendida sólo a las palabras comunes
+  std::vector<double> scores(mImages.size(), 0.);
+  for (const auto &word : bow) {
+    double q = word.second;
+    for (const auto &entry : mInvertedFile[static_cast<size_t>(word.first)]) {
+      double d = entry.second;
+      scores[entry.first] += std::abs(q - d) - q - d;
+    }
+  }
+
+  std::vector<std::pair<size_t, double>> images;
+  for (size_t i = 0; i < scores.size(); i++) {
+    if (i == exclude || scores[i] >= 0.) continue;
+    images.emplace_back(i, -0.5 * scores[i]);
+  }
+
+  auto better = [](const std::pair<size_t, double> &image1,
+                   const std::pair<size_t, double> &image2) {
+    return image1.second > image2.second ||
+           (image1.second == image2.second && image1.first < image2.first);
+  };
+
+  if (images.size() > k) {
+    std::partial_sort(images.begin(), images.begin() + static_cast<std::ptrdiff_t>(k), images.end(), better);
+    images.resize(k);
+  } else {
+    std::sort(images.begin(), images.end(), better);
+  }
+
+  return images;
+}
+
+} // namespace tl
@@ -0,0 +1,228 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_FEATMATCH_VOCABULARY_TREE_H
+#define TL_FEATMATCH_VOCABULARY_TREE_H
+
+#include "config_tl.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/path.h"
+#include "tidop/featmatch/blockmatching.h"
+
+namespace tl
+{
+
+/*! \addtogroup Features
+ *
+ *  \{
+ */
+
+/*! \addtogroup FeatureMatching
+ *
+ *  \{
+ */
+
+/*!
+ * \brief Vocabulary tree
+ *
+ * Hierarchical k-means quantization of descriptors into visual words:
+ *
+ * Nister D., Stewenius H. (2006) Scalable Recognition with a Vocabulary
+ * Tree. IEEE Conference on Computer Vision and Pattern Recognition
+ *
+ * Float descriptors (CV_32F: SIFT, SURF, KAZE, ...) are clustered with the L2
+ * distance and binary descriptors (CV_8U: ORB, BRISK, AKAZE, ...) with the
+ * Hamming distance and bitwise majority centers. The tree is trained level by
+ * level: the clusters of a level are computed in parallel, or the assignment
+ * step of each clustering when the level has few clusters.
+ */
+class TL_EXPORT VocabularyTree
+{
+
+public:
+
+  VocabularyTree();
+  ~VocabularyTree() = default;
+
+  /*!
+   * \brief Trains the vocabulary
+   * \param[in] descriptors Training descriptors (one per row)
+   * \param[in] branching Number of children of each node
+   * \param[in] levels Depth of the tree. The vocabulary has up to branching^levels words
+   * \param[in] iterations Maximum number of k-means iterations
+   */
+  void train(const cv::Mat &descriptors,
+             int branching = 10,
+             int levels = 6,
+             int iterations = 10);
+
+  /*!
+   * \brief Number of visual words
+   */
+  size_t words() const;
+
+  bool empty() const;
+
+  /*!
+   * \brief Type of the descriptors (CV_32F or CV_8U)
+   */
+  int descriptorType() const;
+
+  /*!
+   * \brief Visual word of each descriptor
+   * \param[in] descriptors Descriptors (one per row)
+   * \return Word of each descriptor
+   */
+  std::vector<int> quantize(const cv::Mat &descriptors) const;
+
+  void save(const Path &file) const;
+  void load(const Path &file);
+
+private:
+
+  int word(const cv::Mat &descriptors, int row) const;
+
+private:
+
+  struct Node
+  {
+    int firstChild;
+    int children;
+    int word;
+  };
+
+  std::vector<Node> mNodes;
+  cv::Mat mCenters;
+  size_t mWords;
+
+};
+
+
+/*----------------------------------------------------------------*/
+
+
+/*!
+ * \brief Inverted file index of images
+ *
+ * Images are described by their TF-IDF weighted, L1 normalized histogram of
+ * visual words and scored with the L1 distance, which only needs the words
+ * that a query shares with each image (the inverted lists of the query words).
+ *
+ * \code
+ * auto vocabulary = std::make_shared<VocabularyTree>();
+ * vocabulary->load("vocabulary.bin");
+ * VocabularyIndex index(vocabulary);
+ * index.add(features);
+ * index.build();
+ * BlockMatching block_matching(factory);
+ * block_matching.run(features, index.candidatePairs(20), "matches");
+ * \endcode
+ */
+class TL_EXPORT VocabularyIndex
+{
+
+public:
+
+  explicit VocabularyIndex(std::shared_ptr<const VocabularyTree> vocabulary);
+  ~VocabularyIndex() = default;
+
+  TL_DISABLE_COPY(VocabularyIndex)
+  TL_DISABLE_MOVE(VocabularyIndex)
+
+  /*!
+   * \brief Adds an image
+   * \param[in] descriptors Descriptors of the image
+   * \return Image identifier
+   */
+  size_t add(const cv::Mat &descriptors);
+
+  /*!
+   * \brief Adds the images of a list of features files in parallel
+   * The identifiers are the positions in the list, following the images already added
+   * \param[in] features Features files
+   */
+  void add(const std::vector<Path> &features);
+
+  /*!
+   * \brief Computes the IDF weights and the inverted lists
+   * Must be called after adding the images and before querying
+   */
+  void build();
+
+  /*!
+   * \brief Number of images
+   */
+  size_t size() const;
+
+  /*!
+   * \brief Most similar images
+   * \param[in] descriptors Descriptors of the query image
+   * \param[in] k Number of images
+   * \return Images and scores in [0, 1] from best to worst
+   */
+  std::vector<std::pair<size_t, double>> query(const cv::Mat &descriptors,
+                                               size_t k) const;
+
+  /*!
+   * \brief Candidate pairs: each image with its k most similar images
+   * The images are queried in parallel
+   * \param[in] k Number of images retrieved for each image
+   * \return Image pairs
+   */
+  std::vector<ImagePair> candidatePairs(size_t k) const;
+
+private:
+
+  using BowVector = std::vector<std::pair<int, double>>;
+
+  BowVector histogram(const cv::Mat &descriptors) const;
+  BowVector weight(const BowVector &histogram) const;
+  std::vector<std::pair<size_t, double>> query(const BowVector &bow,
+                                               size_t k,
+                                               size_t exclude) const;
+
+private:
+
+  std::shared_ptr<const VocabularyTree> mVocabulary;
+  std::vector<BowVector> mHistograms;
+  std::vector<double> mIdf;
+  std::vector<BowVector> mImages;
+  std::vector<std::vector<std::pair<size_t, double>>> mInvertedFile;
+
+};
+
+/*! \} */ // end of FeatureMatching
+
+/*! \} */ // end of Features
+
+} // namespace tl
+
+#endif // TL_FEATMATCH_VOCABULARY_TREE_H
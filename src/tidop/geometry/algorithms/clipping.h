@@ -0,0 +1,906 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOMETRY_ALGORITHMS_CLIPPING_H
+#define TL_GEOMETRY_ALGORITHMS_CLIPPING_H
+
+#include "config_tl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/concurrency.h"
+#include "tidop/geometry/entities/point.h"
+#include "tidop/geometry/entities/polygon.h"
+#include "tidop/geometry/entities/window.h"
+#include "tidop/geometry/preparedpolygon.h"
+#include "tidop/math/math.h"
+
+namespace tl
+{
+
+/*! \addtogroup geometry
+ *  \{
+ */
+
+/*! \addtogroup geometry_algorithms
+ *  \{
+ */
+
+namespace internal
+{
+
+using ClipPoint = std::pair<double, double>;
+
+struct ClipPointHash
+{
+  size_t operator()(const ClipPoint &point) const
+  {
+    size_t h1 = std::hash<double>()(point.first);
+    size_t h2 = std::hash<double>()(point.second);
+    return h1 ^ (h2 + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
+  }
+};
+
+template<typename Point_t> inline
+Point_t makeClipPoint(double x, double y)
+{
+  using value_type = typename Point_t::value_type;
+  if (std::is_integral<value_type>::value)
+    return Point_t(static_cast<value_type>(std::lround(x)), static_cast<value_type>(std::lround(y)));
+  return Point_t(static_cast<value_type>(x), static_cast<value_type>(y));
+}
+
+inline double signedRingArea(const std::vector<ClipPoint> &ring)
+{
+  double area = 0.;
+  for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+    area += ring[j].first * ring[i].second - ring[i].first * ring[j].second;
+  }
+  return area / 2.;
+}
+
+} // namespace internal
+
+
+/*!
+ * \brief Recorte de polígonos con una ventana (Sutherland-Hodgman)
+ *
+ * Camino rápido para recortar huellas con las celdas de una malla. Cada
+ * anillo se recorta con los cuatro semiplanos de la ventana. El resultado es
+ * exacto para polígonos convexos; en polígonos cóncavos que se parten en
+ * varias piezas las piezas quedan unidas por aristas de área nula sobre el
+ * borde de la ventana (el área es correcta). Para obtener la topología exacta
+ * usar PolygonClipper.
+ *
+ * Los buffers de trabajo se reutilizan entre llamadas.
+ */
+template<typename Point_t>
+class WindowClipper
+{
+
+public:
+
+  WindowClipper() = default;
+  ~WindowClipper() = default;
+
+  /*!
+   * \brief Recorta un polígono con una ventana
+   * \param[in] polygon Polígono
+   * \param[in] window Ventana de recorte
+   * \return Polígono recortado. Vacío si no hay intersección
+   */
+  Polygon<Point_t> clip(const Polygon<Point_t> &polygon,
+                        const Window<Point_t> &window);
+
+private:
+
+  template<typename Ring_t>
+  bool clipRing(const Ring_t &ring,
+                const Window<Point_t> &window);
+
+  template<typename Inside, typename Cut>
+  void clipHalfPlane(Inside inside, Cut cut);
+
+private:
+
+  std::vector<internal::ClipPoint> mInput;
+  std::vector<internal::ClipPoint> mOutput;
+
+};
+
+template<typename Point_t> inline
+Polygon<Point_t> WindowClipper<Point_t>::clip(const Polygon<Point_t> &polygon,
+                                              const Window<Point_t> &window)
+{
+  Polygon<Point_t> result;
+
+  if (!intersectWindows(polygon.window(), window)) return result;
+
+  if (!clipRing(polygon, window)) return result;
+
+  result.reserve(mInput.size());
+  for (const auto &point : mInput) {
+    result.push_back(internal::makeClipPoint<Point_t>(point.first, point.second));
+  }
+
+  for (size_t i = 0; i < polygon.holes(); i++) {
+    if (!clipRing(polygon.hole(i), window)) continue;
+
+    PolygonHole<Point_t> hole;
+    for (const auto &point : mInput) {
+      hole.push_back(internal::makeClipPoint<Point_t>(point.first, point.second));
+    }
+    result.addHole(hole);
+  }
+
+  return result;
+}
+
+template<typename Point_t> template<typename Ring_t> inline
+bool WindowClipper<Point_t>::clipRing(const Ring_t &ring,
+                                      const Window<Point_t> &window)
+{
+  mInput.clear();
+  for (size_t i = 0; i < ring.size(); i++) {
+    mInput.emplace_back(static_cast<double>(ring[i].x), static_cast<double>(ring[i].y));
+  }
+
+  double x_min = static_cast<double>(window.pt1.x);
+  double y_min = static_cast<double>(window.pt1.y);
+  double x_max = static_cast<double>(window.pt2.x);
+  double y_max = static_cast<double>(window.pt2.y);
+
+  using internal::ClipPoint;
+
+  clipHalfPlane([x_min](const ClipPoint &p) { return p.first >= x_min; },
+                [x_min](const ClipPoint &p, const ClipPoint &q) {
+                  return ClipPoint(x_min, p.second + (x_min - p.first) * (q.second - p.second) / (q.first - p.first));
+                });
+  clipHalfPlane([x_max](const ClipPoint &p) { return p.first <= x_max; },
+                [x_max](const ClipPoint &p, const ClipPoint &q) {
+                  return ClipPoint(x_max, p.second + (x_max - p.first) * (q.second - p.second) / (q.first - p.first));
+                });
+  clipHalfPlane([y_min](const ClipPoint &p) { return p.second >= y_min; },
+                [y_min](const ClipPoint &p, const ClipPoint &q) {
+                  return ClipPoint(p.first + (y_min - p.second) * (q.first - p.first) / (q.second - p.second), y_min);
+                });
+  clipHalfPlane([y_max](const ClipPoint &p) { return p.second <= y_max; },
+                [y_max](const ClipPoint &p, const ClipPoint &q) {
+                  return ClipPoint(p.first + (y_max - p.second) * (q.first - p.first) / (q.second - p.second), y_max);
+                });
+
+  // Vértices repetidos consecutivos
+  mInput.erase(std::unique(mInput.begin(), mInput.end()), mInput.end());
+  while (mInput.size() > 1 && mInput.front() == mInput.back()) mInput.pop_back();
+
+  return mInput.size() >= 3 && internal::signedRingArea(mInput) != 0.;
+}
+
+template<typename Point_t> template<typename Inside, typename Cut> inline
+void WindowClipper<Point_t>::clipHalfPlane(Inside inside, Cut cut)
+{
+  mOutput.clear();
+
+  if (!mInput.empty()) {
+    internal::ClipPoint previous = mInput.back();
+    bool previous_inside = inside(previous);
+
+    for (const auto &current : mInput) {
+      bool current_inside = inside(current);
+      if (current_inside) {
+        if (!previous_inside) mOutput.push_back(cut(previous, current));
+        mOutput.push_back(current);
+      } else if (previous_inside) {
+        mOutput.push_back(cut(previous, current));
+      }
+      previous = current;
+      previous_inside = current_inside;
+    }
+  }
+
+  std::swap(mInput, mOutput);
+}
+
+
+/*!
+ * \brief Operaciones booleanas entre polígonos y multipolígonos
+ *
+ * Las aristas de ambos operandos se parten en todos sus puntos de corte
+ * (incluidos los solapes colineales) mediante un barrido en x. Cada arista
+ * resultante se clasifica como interior o exterior al otro operando y se
+ * seleccionan las que forman el contorno del resultado según la operación,
+ * como en el algoritmo de Martínez-Rueda. Las aristas seleccionadas se
+ * enlazan en anillos y los anillos horarios se asignan como huecos.
+ *
+ * Los anillos exteriores se orientan en sentido antihorario y los huecos en
+ * sentido horario antes de operar. Los polígonos de un multipolígono no
+ * deben solaparse entre sí.
+ *
+ * Todos los contenedores de trabajo se conservan entre llamadas, por lo que
+ * reutilizar un mismo objeto para muchas operaciones evita reservas de
+ * memoria. Un objeto no debe usarse desde varios hilos a la vez.
+ *
+ * \code
+ * PolygonClipper<PointD> clipper;
+ * MultiPolygonD result = clipper.execute(footprint, cell, PolygonClipper<PointD>::Operation::intersection);
+ * \endcode
+ */
+template<typename Point_t>
+class PolygonClipper
+{
+
+public:
+
+  enum class Operation
+  {
+    intersection,
+    join,
+    difference
+  };
+
+public:
+
+  PolygonClipper() = default;
+  ~PolygonClipper() = default;
+
+  /*!
+   * \brief Ejecuta una operación booleana
+   * \param[in] subject Multipolígono sujeto
+   * \param[in] clip Multipolígono de recorte
+   * \param[in] operation Operación
+   * \return Resultado
+   */
+  MultiPolygon<Point_t> execute(const MultiPolygon<Point_t> &subject,
+                                const MultiPolygon<Point_t> &clip,
+                                Operation operation);
+
+  /*!
+   * \brief Ejecuta una operación booleana
+   * \param[in] subject Polígono sujeto
+   * \param[in] clip Polígono de recorte
+   * \param[in] operation Operación
+   * \return Resultado
+   */
+  MultiPolygon<Point_t> execute(const Polygon<Point_t> &subject,
+                                const Polygon<Point_t> &clip,
+                                Operation operation);
+
+private:
+
+  struct Edge
+  {
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+    int source;
+  };
+
+  struct Split
+  {
+    size_t edge;
+    double t;
+    internal::ClipPoint point;
+  };
+
+  struct SubEdge
+  {
+    size_t v1;
+    size_t v2;
+    int source;
+  };
+
+  void clear();
+  void addPolygon(const Polygon<Point_t> &polygon, int source);
+  template<typename Ring_t>
+  void addRing(const Ring_t &ring, bool outer, int source);
+  void intersectEdges();
+  void intersect(size_t edge1, size_t edge2);
+  void addSplit(size_t edge, const internal::ClipPoint &point);
+  void splitEdges();
+  size_t vertex(const internal::ClipPoint &point);
+  void selectEdges(Operation operation,
+                   const PreparedPolygon<Point<double>> &subject,
+                   const PreparedPolygon<Point<double>> &clip);
+  MultiPolygon<Point_t> buildResult();
+
+private:
+
+  std::vector<Edge> mEdges;
+  std::vector<Split> mSplits;
+  std::vector<size_t> mOrder;
+  std::vector<size_t> mActive;
+  std::vector<internal::ClipPoint> mVertices;
+  std::unordered_map<internal::ClipPoint, size_t, internal::ClipPointHash> mVertexIndex;
+  std::vector<SubEdge> mSubEdges;
+  std::vector<size_t> mPartner;
+  std::vector<std::pair<size_t, size_t>> mSelected;
+  std::vector<size_t> mOutOffsets;
+  std::vector<size_t> mOut;
+  std::vector<char> mUsed;
+  std::vector<internal::ClipPoint> mRing;
+  MultiPolygon<Point<double>> mOperands[2];
+
+};
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> PolygonClipper<Point_t>::execute(const Polygon<Point_t> &subject,
+                                                       const Polygon<Point_t> &clip,
+                                                       Operation operation)
+{
+  MultiPolygon<Point_t> multi_subject;
+  multi_subject.push_back(subject);
+  MultiPolygon<Point_t> multi_clip;
+  multi_clip.push_back(clip);
+  return execute(multi_subject, multi_clip, operation);
+}
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> PolygonClipper<Point_t>::execute(const MultiPolygon<Point_t> &subject,
+                                                       const MultiPolygon<Point_t> &clip,
+                                                       Operation operation)
+{
+  // Operandos disjuntos
+  if (subject.size() == 0 || clip.size() == 0 ||
+      !intersectWindows(subject.window(), clip.window())) {
+    MultiPolygon<Point_t> result;
+    if (operation == Operation::join || operation == Operation::difference) {
+      for (size_t i = 0; i < subject.size(); i++) result.push_back(subject[i]);
+    }
+    if (operation == Operation::join) {
+      for (size_t i = 0; i < clip.size(); i++) result.push_back(clip[i]);
+    }
+    return result;
+  }
+
+  clear();
+
+  for (size_t i = 0; i < subject.size(); i++) addPolygon(subject[i], 0);
+  for (size_t i = 0; i < clip.size(); i++) addPolygon(clip[i], 1);
+
+  intersectEdges();
+  splitEdges();
+
+  PreparedPolygon<Point<double>> prepared_subject(mOperands[0]);
+  PreparedPolygon<Point<double>> prepared_clip(mOperands[1]);
+  selectEdges(operation, prepared_subject, prepared_clip);
+
+  return buildResult();
+}
+
+template<typename Point_t> inline
+void PolygonClipper<Point_t>::clear()
+{
+  mEdges.clear();
+  mSplits.clear();
+  mVertices.clear();
+  mVertexIndex.clear();
+  mSubEdges.clear();
+  mSelected.clear();
+  mOperands[0].clear();
+  mOperands[1].clear();
+}
+
+template<typename Point_t> inline
+void PolygonClipper<Point_t>::addPolygon(const Polygon<Point_t> &polygon, int source)
+{
+  mOperands[source].push_back(Polygon<Point<double>>());
+  addRing(polygon, true, source);
+  for (size_t i = 0; i < polygon.holes(); i++) {
+    addRing(polygon.hole(i), false, source);
+  }
+}
+
+template<typename Point_t> template<typename Ring_t> inline
+void PolygonClipper<Point_t>::addRing(const Ring_t &ring, bool outer, int source)
+{
+  mRing.clear();
+  for (size_t i = 0; i < ring.size(); i++) {
+    internal::ClipPoint point(static_cast<double>(ring[i].x), static_cast<double>(ring[i].y));
+    if (mRing.empty() || mRing.back() != point) mRing.push_back(point);
+  }
+  while (mRing.size() > 1 && mRing.front() == mRing.back()) mRing.pop_back();
+  if (mRing.size() < 3) return;
+
+  double area = internal::signedRingArea(mRing);
+  if (area == 0.) return;
+  if ((area > 0.) != outer) std::reverse(mRing.begin(), mRing.end());
+
+  Polygon<Point<double>> &polygon = mOperands[source][mOperands[source].size() - 1];
+  if (outer) {
+    for (const auto &point : mRing) polygon.push_back(Point<double>(point.first, point.second));
+  } else {
+    PolygonHole<Point<double>> hole;
+    for (const auto &point : mRing) hole.push_back(Point<double>(point.first, point.second));
+    polygon.addHole(hole);
+  }
+
+  for (size_t i = 0, j = mRing.size() - 1; i < mRing.size(); j = i++) {
+    mEdges.push_back({mRing[j].first, mRing[j].second, mRing[i].first, mRing[i].second, source});
+  }
+}
+
+template<typename Point_t> inline
+void PolygonClipper<Point_t>::intersectEdges()
+{
+  // Barrido en x: sólo se comparan aristas de distinto operando cuyos
+  // intervalos en x se solapan
+  mOrder.resize(mEdges.size());
+  std::iota(mOrder.begin(), mOrder.end(), 0);
+  std::sort(mOrder.begin(), mOrder.end(), [this](size_t e1, size_t e2) {
+    return std::min(mEdges[e1].x1, mEdges[e1].x2) < std::min(mEdges[e2].x1, mEdges[e2].x2);
+  });
+
+  mActive.clear();
+
+  for (size_t id : mOrder) {
+    const Edge &edge = mEdges[id];
+    double x_min = std::min(edge.x1, edge.x2);
+    double y_min = std::min(edge.y1, edge.y2);
+    double y_max = std::max(edge.y1, edge.y2);
+
+    mActive.erase(std::remove_if(mActive.begin(), mActive.end(), [this, x_min](size_t active) {
+      return std::max(mEdges[active].x1, mEdges[active].x2) < x_min;
+    }), mActive.end());
+
+    for (size_t active : mActive) {
+      const Edge &other = mEdges[active];
+      if (other.source == edge.source) continue;
+      if (std::max(other.y1, other.y2) < y_min || std::min(other.y1, other.y2) > y_max) continue;
+      intersect(active, id);
+    }
+
+    mActive.push_back(id);
+  }
+}
+
+template<typename Point_t> inline
+void PolygonClipper<Point_t>::intersect(size_t edge1, size_t edge2)
+{
+  const Edge &e = mEdges[edge1];
+  const Edge &f = mEdges[edge2];
+
+  const double tolerance = 1e-10;
+
+  double rx = e.x2 - e.x1;
+  double ry = e.y2 - e.y1;
+  double sx = f.x2 - f.x1;
+  double sy = f.y2 - f.y1;
+  double qx = f.x1 - e.x1;
+  double qy = f.y1 - e.y1;
+  double rr = rx * rx + ry * ry;
+  double ss = sx * sx + sy * sy;
+  double denom = rx * sy - ry * sx;
+
+  if (std::abs(denom) > tolerance * std::sqrt(rr * ss)) {
+
+    double t = (qx * sy - qy * sx) / denom;
+    double u = (qx * ry - qy * rx) / denom;
+    if (t < -tolerance || t > 1. + tolerance || u < -tolerance || u > 1. + tolerance) return;
+
+    // Si el corte coincide con un vértice se usa el vértice para que ambas
+    // aristas compartan exactamente el mismo punto
+    internal::ClipPoint point;
+    if (std::abs(u) <= tolerance) point = internal::ClipPoint(f.x1, f.y1);
+    else if (std::abs(u - 1.) <= tolerance) point = internal::ClipPoint(f.x2, f.y2);
+    else if (std::abs(t) <= tolerance) point = internal::ClipPoint(e.x1, e.y1);
+    else if (std::abs(t - 1.) <= tolerance) point = internal::ClipPoint(e.x2, e.y2);
+    else point = internal::ClipPoint(e.x1 + t * rx, e.y1 + t * ry);
+
+    addSplit(edge1, point);
+    addSplit(edge2, point);
+
+  } else if (std::abs(qx * ry - qy * rx) <= tolerance * rr) {
+
+    // Aristas colineales. Cada una se parte en los extremos de la otra
+    addSplit(edge1, internal::ClipPoint(f.x1, f.y1));
+    addSplit(edge1, internal::ClipPoint(f.x2, f.y2));
+    addSplit(edge2, internal::ClipPoint(e.x1, e.y1));
+    addSplit(edge2, internal::ClipPoint(e.x2, e.y2));
+
+  }
+}
+
+template<typename Point_t> inline
+void PolygonClipper<Point_t>::addSplit(size_t edge, const internal::ClipPoint &point)
+{
+  const Edge &e = mEdges[edge];
+  double dx = e.x2 - e.x1;
+  double dy = e.y2 - e.y1;
+  double t = ((point.first - e.x1) * dx + (point.second - e.y1) * dy) / (dx * dx + dy * dy);
+  if (t <= 0. || t >= 1.) return;
+  mSplits.push_back({edge, t, point});
+}
+
+template<typename Point_t> inline
+size_t PolygonClipper<Point_t>::vertex(const internal::ClipPoint &point)
+{
+  // -0. y 0. son el mismo vértice
+  internal::ClipPoint key(point.first == 0. ? 0. : point.first,
+                          point.second == 0. ? 0. : point.second);
+  auto it = mVertexIndex.find(key);
+  if (it != mVertexIndex.end()) return it->second;
+  size_t id = mVertices.size();
+  mVertices.push_back(key);
+  mVertexIndex.emplace(key, id);
+  return id;
+}
+
+template<typename Point_t> inline
+void PolygonClipper<Point_t>::splitEdges()
+{
+  std::sort(mSplits.begin(), mSplits.end(), [](const Split &s1, const Split &s2) {
+    return s1.edge < s2.edge || (s1.edge == s2.edge && s1.t < s2.t);
+  });
+
+  size_t split = 0;
+  for (size_t id = 0; id < mEdges.size(); id++) {
+    const Edge &edge = mEdges[id];
+    size_t previous = vertex(internal::ClipPoint(edge.x1, edge.y1));
+
+    for (; split < mSplits.size() && mSplits[split].edge == id; split++) {
+      size_t current = vertex(mSplits[split].point);
+      if (current != previous) {
+        mSubEdges.push_back({previous, current, edge.source});
+        previous = current;
+      }
+    }
+
+    size_t last = vertex(internal::ClipPoint(edge.x2, edge.y2));
+    if (last != previous) mSubEdges.push_back({previous, last, edge.source});
+  }
+}
+
+template<typename Point_t> inline
+void PolygonClipper<Point_t>::selectEdges(Operation operation,
+                                          const PreparedPolygon<Point<double>> &subject,
+                                          const PreparedPolygon<Point<double>> &clip)
+{
+  // Aristas coincidentes de ambos operandos: se agrupan por sus vértices
+  mOrder.resize(mSubEdges.size());
+  std::iota(mOrder.begin(), mOrder.end(), 0);
+  auto key = [this](size_t id) {
+    const SubEdge &edge = mSubEdges[id];
+    return std::make_pair(std::min(edge.v1, edge.v2), std::max(edge.v1, edge.v2));
+  };
+  std::sort(mOrder.begin(), mOrder.end(), [&key](size_t e1, size_t e2) {
+    return key(e1) < key(e2);
+  });
+
+  // Para cada arista, la arista coincidente del otro operando si existe
+  std::vector<size_t> &partner = mPartner;
+  partner.assign(mSubEdges.size(), mSubEdges.size());
+  for (size_t i = 0; i < mOrder.size();) {
+    size_t j = i + 1;
+    while (j < mOrder.size() && key(mOrder[j]) == key(mOrder[i])) j++;
+    size_t first[2] = {mSubEdges.size(), mSubEdges.size()};
+    for (size_t k = i; k < j; k++) {
+      int source = mSubEdges[mOrder[k]].source;
+      if (first[source] == mSubEdges.size()) first[source] = mOrder[k];
+    }
+    if (first[0] != mSubEdges.size() && first[1] != mSubEdges.size()) {
+      partner[first[0]] = first[1];
+      partner[first[1]] = first[0];
+    }
+    i = j;
+  }
+
+  for (size_t id = 0; id < mSubEdges.size(); id++) {
+    const SubEdge &edge = mSubEdges[id];
+
+    if (partner[id] != mSubEdges.size()) {
+      // Sólo se evalúa desde el sujeto
+      if (edge.source == 1) continue;
+      bool same_direction = mSubEdges[partner[id]].v1 == edge.v1;
+      bool keep = operation == Operation::difference ? !same_direction : same_direction;
+      if (keep) mSelected.emplace_back(edge.v1, edge.v2);
+      continue;
+    }
+
+    const internal::ClipPoint &p1 = mVertices[edge.v1];
+    const internal::ClipPoint &p2 = mVertices[edge.v2];
+    Point<double> middle((p1.first + p2.first) / 2., (p1.second + p2.second) / 2.);
+    bool inside = edge.source == 0 ? clip.contains(middle) : subject.contains(middle);
+
+    switch (operation) {
+    case Operation::intersection:
+      if (inside) mSelected.emplace_back(edge.v1, edge.v2);
+      break;
+    case Operation::join:
+      if (!inside) mSelected.emplace_back(edge.v1, edge.v2);
+      break;
+    case Operation::difference:
+      if (edge.source == 0 && !inside) mSelected.emplace_back(edge.v1, edge.v2);
+      else if (edge.source == 1 && inside) mSelected.emplace_back(edge.v2, edge.v1);
+      break;
+    }
+  }
+}
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> PolygonClipper<Point_t>::buildResult()
+{
+  MultiPolygon<Point_t> result;
+
+  // Aristas salientes de cada vértice
+  mOutOffsets.assign(mVertices.size() + 1, 0);
+  for (const auto &edge : mSelected) mOutOffsets[edge.first + 1]++;
+  for (size_t i = 0; i < mVertices.size(); i++) mOutOffsets[i + 1] += mOutOffsets[i];
+  mOut.resize(mSelected.size());
+  {
+    std::vector<size_t> position(mOutOffsets.begin(), mOutOffsets.end() - 1);
+    for (size_t i = 0; i < mSelected.size(); i++) {
+      mOut[position[mSelected[i].first]++] = i;
+    }
+  }
+
+  mUsed.assign(mSelected.size(), 0);
+
+  std::vector<std::vector<internal::ClipPoint>> outers;
+  std::vector<double> outer_areas;
+  std::vector<std::vector<internal::ClipPoint>> holes;
+
+  auto collinear = [](const internal::ClipPoint &a, const internal::ClipPoint &b, const internal::ClipPoint &c) {
+    double ux = b.first - a.first;
+    double uy = b.second - a.second;
+    double vx = c.first - b.first;
+    double vy = c.second - b.second;
+    double cross = ux * vy - uy * vx;
+    return std::abs(cross) <= 1e-12 * std::sqrt((ux * ux + uy * uy) * (vx * vx + vy * vy)) &&
+           ux * vx + uy * vy > 0.;
+  };
+
+  for (size_t start_edge = 0; start_edge < mSelected.size(); start_edge++) {
+    if (mUsed[start_edge]) continue;
+
+    size_t start = mSelected[start_edge].first;
+    size_t current = start_edge;
+    mUsed[current] = 1;
+    mRing.clear();
+    mRing.push_back(mVertices[start]);
+    bool closed = true;
+
+    while (mSelected[current].second != start) {
+      size_t from = mSelected[current].first;
+      size_t to = mSelected[current].second;
+      mRing.push_back(mVertices[to]);
+
+      // Se continúa por la arista con el menor giro horario respecto a la
+      // arista de llegada invertida. Así los anillos que se tocan en un
+      // vértice se recorren por separado.
+      double bx = mVertices[from].first - mVertices[to].first;
+      double by = mVertices[from].second - mVertices[to].second;
+      size_t next = mSelected.size();
+      double best = 0.;
+      for (size_t k = mOutOffsets[to]; k < mOutOffsets[to + 1]; k++) {
+        size_t candidate = mOut[k];
+        if (mUsed[candidate]) continue;
+        const internal::ClipPoint &target = mVertices[mSelected[candidate].second];
+        double ox = target.first - mVertices[to].first;
+        double oy = target.second - mVertices[to].second;
+        double angle = std::atan2(bx * oy - by * ox, bx * ox + by * oy);
+        double clockwise = angle < 0. ? -angle : math::consts::two_pi<double> - angle;
+        if (next == mSelected.size() || clockwise < best) {
+          next = candidate;
+          best = clockwise;
+        }
+      }
+
+      if (next == mSelected.size()) {
+        closed = false;
+        break;
+      }
+
+      mUsed[next] = 1;
+      current = next;
+    }
+
+    if (!closed) continue;
+
+    // Eliminación de vértices intermedios colineales
+    std::vector<internal::ClipPoint> ring;
+    ring.reserve(mRing.size());
+    for (const auto &point : mRing) {
+      while (ring.size() >= 2 && collinear(ring[ring.size() - 2], ring.back(), point)) ring.pop_back();
+      ring.push_back(point);
+    }
+    while (ring.size() >= 3 && collinear(ring[ring.size() - 2], ring.back(), ring.front())) ring.pop_back();
+    while (ring.size() >= 3 && collinear(ring.back(), ring[0], ring[1])) ring.erase(ring.begin());
+
+    if (ring.size() < 3) continue;
+
+    double area = internal::signedRingArea(ring);
+    if (area > 0.) {
+      outers.push_back(std::move(ring));
+      outer_areas.push_back(area);
+    } else if (area < 0.) {
+      holes.push_back(std::move(ring));
+    }
+  }
+
+  std::vector<Polygon<Point_t>> polygons(outers.size());
+  std::vector<PreparedPolygon<Point<double>>> prepared(outers.size());
+  for (size_t i = 0; i < outers.size(); i++) {
+    Polygon<Point<double>> outer;
+    for (const auto &point : outers[i]) {
+      polygons[i].push_back(internal::makeClipPoint<Point_t>(point.first, point.second));
+      outer.push_back(Point<double>(point.first, point.second));
+    }
+    prepared[i].prepare(outer);
+  }
+
+  // Cada hueco se asigna al menor anillo exterior que lo contiene
+  for (const auto &hole : holes) {
+    Point<double> point((hole[0].first + hole[1].first) / 2., (hole[0].second + hole[1].second) / 2.);
+    size_t owner = outers.size();
+    for (size_t i = 0; i < outers.size(); i++) {
+      if (prepared[i].contains(point) && (owner == outers.size() || outer_areas[i] < outer_areas[owner]))
+        owner = i;
+    }
+    if (owner == outers.size()) continue;
+
+    PolygonHole<Point_t> polygon_hole;
+    for (const auto &hole_point : hole) {
+      polygon_hole.push_back(internal::makeClipPoint<Point_t>(hole_point.first, hole_point.second));
+    }
+    polygons[owner].addHole(polygon_hole);
+  }
+
+  for (auto &polygon : polygons) {
+    result.push_back(std::move(polygon));
+  }
+
+  return result;
+}
+
+
+/*!
+ * \brief Recorta un polígono con una ventana
+ * \see WindowClipper
+ */
+template<typename Point_t> inline
+Polygon<Point_t> clip(const Polygon<Point_t> &polygon,
+                      const Window<Point_t> &window)
+{
+  WindowClipper<Point_t> clipper;
+  return clipper.clip(polygon, window);
+}
+
+/*!
+ * \brief Recorta un conjunto de polígonos con una ventana en paralelo
+ * \param[in] polygons Polígonos
+ * \param[in] window Ventana de recorte
+ * \return Polígonos recortados. Los que quedan fuera de la ventana se devuelven vacíos
+ */
+template<typename Point_t> inline
+std::vector<Polygon<Point_t>> clip(const std::vector<Polygon<Point_t>> &polygons,
+                                   const Window<Point_t> &window)
+{
+  std::vector<Polygon<Point_t>> result(polygons.size());
+  parallel_for_worker<WindowClipper<Point_t>>(0, polygons.size(), [&](WindowClipper<Point_t> &clipper, size_t i) {
+    result[i] = clipper.clip(polygons[i], window);
+  });
+  return result;
+}
+
+/*!
+ * \brief Recorta un polígono con un conjunto de ventanas en paralelo
+ * \param[in] polygon Polígono
+ * \param[in] windows Ventanas de recorte (por ejemplo las celdas de una malla)
+ * \return Polígono recortado con cada ventana
+ */
+template<typename Point_t> inline
+std::vector<Polygon<Point_t>> clip(const Polygon<Point_t> &polygon,
+                                   const std::vector<Window<Point_t>> &windows)
+{
+  std::vector<Polygon<Point_t>> result(windows.size());
+  parallel_for_worker<WindowClipper<Point_t>>(0, windows.size(), [&](WindowClipper<Point_t> &clipper, size_t i) {
+    result[i] = clipper.clip(polygon, windows[i]);
+  });
+  return result;
+}
+
+/*!
+ * \brief Operación booleana de un conjunto de polígonos con otro polígono en paralelo
+ * Cada hilo reutiliza su propio PolygonClipper.
+ * \param[in] polygons Polígonos sujeto
+ * \param[in] clip Polígono de recorte
+ * \param[in] operation Operación
+ * \return Resultado para cada polígono
+ */
+template<typename Point_t> inline
+std::vector<MultiPolygon<Point_t>> booleanOperation(const std::vector<Polygon<Point_t>> &polygons,
+                                                    const Polygon<Point_t> &clip,
+                                                    typename PolygonClipper<Point_t>::Operation operation)
+{
+  std::vector<MultiPolygon<Point_t>> result(polygons.size());
+  parallel_for_worker<PolygonClipper<Point_t>>(0, polygons.size(), [&](PolygonClipper<Point_t> &clipper, size_t i) {
+    result[i] = clipper.execute(polygons[i], clip, operation);
+  });
+  return result;
+}
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> polygonIntersection(const Polygon<Point_t> &polygon1,
+                                          const Polygon<Point_t> &polygon2)
+{
+  PolygonClipper<Point_t> clipper;
+  return clipper.execute(polygon1, polygon2, PolygonClipper<Point_t>::Operation::intersection);
+}
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> polygonIntersection(const MultiPolygon<Point_t> &multiPolygon1,
+                                          const MultiPolygon<Point_t> &multiPolygon2)
+{
+  PolygonClipper<Point_t> clipper;
+  return clipper.execute(multiPolygon1, multiPolygon2, PolygonClipper<Point_t>::Operation::intersection);
+}
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> polygonUnion(const Polygon<Point_t> &polygon1,
+                                   const Polygon<Point_t> &polygon2)
+{
+  PolygonClipper<Point_t> clipper;
+  return clipper.execute(polygon1, polygon2, PolygonClipper<Point_t>::Operation::join);
+}
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> polygonUnion(const MultiPolygon<Point_t> &multiPolygon1,
+                                   const MultiPolygon<Point_t> &multiPolygon2)
+{
+  PolygonClipper<Point_t> clipper;
+  return clipper.execute(multiPolygon1, multiPolygon2, PolygonClipper<Point_t>::Operation::join);
+}
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> polygonDifference(const Polygon<Point_t> &polygon1,
+                                        const Polygon<Point_t> &polygon2)
+{
+  PolygonClipper<Point_t> clipper;
+  return clipper.execute(polygon1, polygon2, PolygonClipper<Point_t>::Operation::difference);
+}
+
+template<typename Point_t> inline
+MultiPolygon<Point_t> polygonDifference(const MultiPolygon<Point_t> &multiPolygon1,
+                                        const MultiPolygon<Point_t> &multiPolygon2)
+{
+  PolygonClipper<Point_t> clipper;
+  return clipper.execute(multiPolygon1, multiPolygon2, PolygonClipper<Point_t>::Operation::difference);
+}
+
+/*! \} */ // end of geometry_algorithms
+
+/*! \} */ // end of geometry
+
+} // End namespace tl
+
+#endif // TL_GEOMETRY_ALGORITHMS_CLIPPING_H
@@ -0,0 +1,397 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOMETRY_ALGORITHMS_HULL_H
+#define TL_GEOMETRY_ALGORITHMS_HULL_H
+
+#include "config_tl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/concurrency.h"
+#include "tidop/geometry/entities/point.h"
+#include "tidop/geometry/entities/polygon.h"
+#include "tidop/geometry/entities/shapes.h"
+
+namespace tl
+{
+
+/*! \addtogroup geometry
+ *  \{
+ */
+
+/*! \addtogroup geometry_algorithms
+ *  \{
+ */
+
+namespace internal
+{
+
+inline double hullCross(const Point<double> &o,
+                        const Point<double> &a,
+                        const Point<double> &b)
+{
+  return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+/*!
+ * \brief Envolvente convexa por cadena monótona (Andrew)
+ * Los puntos se ordenan en el propio vector. El resultado está en sentido
+ * antihorario, sin puntos colineales y sin repetir el primer vértice.
+ */
+inline void monotoneChain(std::vector<Point<double>> &points,
+                          std::vector<Point<double>> *hull)
+{
+  std::sort(points.begin(), points.end(), [](const Point<double> &p1, const Point<double> &p2) {
+    return p1.x < p2.x || (p1.x == p2.x && p1.y < p2.y);
+  });
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+
+  size_t n = points.size();
+  if (n < 3) {
+    *hull = points;
+    return;
+  }
+
+  hull->resize(2 * n);
+  size_t k = 0;
+
+  // Cadena inferior
+  for (size_t i = 0; i < n; i++) {
+    while (k >= 2 && hullCross((*hull)[k - 2], (*hull)[k - 1], points[i]) <= 0.) k--;
+    (*hull)[k++] = points[i];
+  }
+
+  // Cadena superior
+  for (size_t i = n - 1, t = k + 1; i > 0; i--) {
+    while (k >= t && hullCross((*hull)[k - 2], (*hull)[k - 1], points[i - 1]) <= 0.) k--;
+    (*hull)[k++] = points[i - 1];
+  }
+
+  hull->resize(k - 1);
+}
+
+template<typename Container_t> inline
+void hullRange(const Container_t &points,
+               size_t first,
+               size_t last,
+               std::vector<Point<double>> *hull)
+{
+  std::vector<Point<double>> buffer;
+  buffer.reserve(last - first);
+  for (size_t i = first; i < last; i++) {
+    buffer.emplace_back(static_cast<double>(points[i].x), static_cast<double>(points[i].y));
+  }
+  monotoneChain(buffer, hull);
+}
+
+/*!
+ * \brief Vértices de la envolvente convexa en coordenadas double
+ *
+ * Por encima de un umbral de puntos se divide el conjunto en bloques, se
+ * calcula en paralelo la envolvente de cada bloque y se fusionan las
+ * envolventes parciales (la envolvente de la unión de las envolventes es la
+ * envolvente del conjunto).
+ */
+template<typename Container_t> inline
+std::vector<Point<double>> hullVertices(const Container_t &points)
+{
+  size_t size = points.size();
+  std::vector<Point<double>> hull;
+
+  size_t chunks = std::min<size_t>(optimalNumberOfThreads(), size / 50000);
+  if (chunks < 2) {
+    hullRange(points, 0, size, &hull);
+    return hull;
+  }
+
+  std::vector<std::vector<Point<double>>> partial(chunks);
+  parallel_for(0, chunks, [&](size_t chunk) {
+    hullRange(points, size * chunk / chunks, size * (chunk + 1) / chunks, &partial[chunk]);
+  });
+
+  std::vector<Point<double>> merged;
+  for (const auto &part : partial) {
+    merged.insert(merged.end(), part.begin(), part.end());
+  }
+  monotoneChain(merged, &hull);
+
+  return hull;
+}
+
+inline bool circleContains(const Circle<double> &circle,
+                           const Point<double> &point)
+{
+  double dx = point.x - circle.center.x;
+  double dy = point.y - circle.center.y;
+  return std::sqrt(dx * dx + dy * dy) <= circle.radius * (1. + 1e-12) + 1e-12;
+}
+
+inline Circle<double> circleFrom(const Point<double> &p1,
+                                 const Point<double> &p2)
+{
+  Point<double> center((p1.x + p2.x) / 2., (p1.y + p2.y) / 2.);
+  double dx = p1.x - center.x;
+  double dy = p1.y - center.y;
+  return Circle<double>(center, std::sqrt(dx * dx + dy * dy));
+}
+
+inline Circle<double> circleFrom(const Point<double> &p1,
+                                 const Point<double> &p2,
+                                 const Point<double> &p3)
+{
+  double bx = p2.x - p1.x;
+  double by = p2.y - p1.y;
+  double cx = p3.x - p1.x;
+  double cy = p3.y - p1.y;
+  double d = 2. * (bx * cy - by * cx);
+
+  if (d == 0.) {
+    // Colineales: círculo del par más alejado
+    Circle<double> c1 = circleFrom(p1, p2);
+    Circle<double> c2 = circleFrom(p1, p3);
+    Circle<double> c3 = circleFrom(p2, p3);
+    if (c1.radius >= c2.radius && c1.radius >= c3.radius) return c1;
+    return c2.radius >= c3.radius ? c2 : c3;
+  }
+
+  double b2 = bx * bx + by * by;
+  double c2 = cx * cx + cy * cy;
+  double ux = (cy * b2 - by * c2) / d;
+  double uy = (bx * c2 - cx * b2) / d;
+  return Circle<double>(Point<double>(p1.x + ux, p1.y + uy), std::sqrt(ux * ux + uy * uy));
+}
+
+} // namespace internal
+
+
+/*!
+ * \brief Rectángulo orientado
+ */
+struct OrientedRectangle
+{
+  /*!
+   * \brief Centro
+   */
+  Point<double> center;
+
+  /*!
+   * \brief Lado en la dirección del ángulo
+   */
+  double width;
+
+  /*!
+   * \brief Lado perpendicular
+   */
+  double height;
+
+  /*!
+   * \brief Ángulo del lado width respecto al eje x en radianes
+   */
+  double angle;
+
+  OrientedRectangle()
+    : center(),
+      width(0.),
+      height(0.),
+      angle(0.)
+  {
+  }
+
+  double area() const
+  {
+    return width * height;
+  }
+
+  /*!
+   * \brief Esquinas del rectángulo en sentido antihorario
+   */
+  Polygon<Point<double>> polygon() const
+  {
+    double ux = std::cos(angle) * width / 2.;
+    double uy = std::sin(angle) * width / 2.;
+    double nx = -std::sin(angle) * height / 2.;
+    double ny = std::cos(angle) * height / 2.;
+    return Polygon<Point<double>>{Point<double>(center.x - ux - nx, center.y - uy - ny),
+                                  Point<double>(center.x + ux - nx, center.y + uy - ny),
+                                  Point<double>(center.x + ux + nx, center.y + uy + ny),
+                                  Point<double>(center.x - ux + nx, center.y - uy + ny)};
+  }
+};
+
+
+/*!
+ * \brief Envolvente convexa (cadena monótona de Andrew)
+ *
+ * Admite cualquier contenedor de Point o Point3 (std::vector, MultiPoint,
+ * MultiPoint3D, ...). Con puntos 3D se calcula la envolvente de la
+ * proyección en el plano XY. Los conjuntos grandes se procesan en paralelo.
+ * \param[in] points Puntos
+ * \return Envolvente en sentido antihorario
+ */
+template<typename Container_t> inline
+auto convexHull(const Container_t &points) -> Polygon<Point<typename std::decay<decltype(points[0].x)>::type>>
+{
+  using value_type = typename std::decay<decltype(points[0].x)>::type;
+
+  Polygon<Point<value_type>> hull;
+  for (const auto &vertex : internal::hullVertices(points)) {
+    hull.push_back(Point<value_type>(static_cast<value_type>(vertex.x),
+                                     static_cast<value_type>(vertex.y)));
+  }
+  return hull;
+}
+
+/*!
+ * \brief Rectángulo de área mínima que contiene un conjunto de puntos
+ * Se recorre la envolvente convexa con calibres rotatorios: uno de los lados
+ * del rectángulo óptimo contiene una arista de la envolvente.
+ * \param[in] points Puntos (Point o Point3, se usa la proyección XY)
+ * \return Rectángulo orientado
+ */
+template<typename Container_t> inline
+OrientedRectangle minAreaRectangle(const Container_t &points)
+{
+  OrientedRectangle rectangle;
+
+  std::vector<Point<double>> hull = internal::hullVertices(points);
+  size_t n = hull.size();
+
+  if (n == 0) return rectangle;
+
+  if (n == 1) {
+    rectangle.center = hull[0];
+    return rectangle;
+  }
+
+  if (n == 2) {
+    double dx = hull[1].x - hull[0].x;
+    double dy = hull[1].y - hull[0].y;
+    rectangle.center = Point<double>((hull[0].x + hull[1].x) / 2., (hull[0].y + hull[1].y) / 2.);
+    rectangle.width = std::sqrt(dx * dx + dy * dy);
+    rectangle.angle = std::atan2(dy, dx);
+    return rectangle;
+  }
+
+  auto dot = [&hull](size_t i, double x, double y) {
+    return hull[i % hull.size()].x * x + hull[i % hull.size()].y * y;
+  };
+
+  size_t right = 0;
+  size_t top = 0;
+  size_t left = 0;
+  double best_area = std::numeric_limits<double>::max();
+
+  for (size_t i = 0; i < n; i++) {
+    double ex = hull[(i + 1) % n].x - hull[i].x;
+    double ey = hull[(i + 1) % n].y - hull[i].y;
+    double length = std::sqrt(ex * ex + ey * ey);
+    double ux = ex / length;
+    double uy = ey / length;
+    double nx = -uy;
+    double ny = ux;
+
+    if (i == 0) {
+      for (size_t j = 1; j < n; j++) {
+        if (dot(j, ux, uy) > dot(right, ux, uy)) right = j;
+        if (dot(j, nx, ny) > dot(top, nx, ny)) top = j;
+        if (dot(j, ux, uy) < dot(left, ux, uy)) left = j;
+      }
+    } else {
+      // Los calibres sólo avanzan en el sentido de la envolvente
+      for (size_t k = 0; k < n && dot(right + 1, ux, uy) >= dot(right, ux, uy); k++) right = (right + 1) % n;
+      for (size_t k = 0; k < n && dot(top + 1, nx, ny) >= dot(top, nx, ny); k++) top = (top + 1) % n;
+      for (size_t k = 0; k < n && dot(left + 1, ux, uy) <= dot(left, ux, uy); k++) left = (left + 1) % n;
+    }
+
+    double min_u = dot(left, ux, uy);
+    double max_u = dot(right, ux, uy);
+    double min_n = dot(i, nx, ny);
+    double max_n = dot(top, nx, ny);
+    double area = (max_u - min_u) * (max_n - min_n);
+
+    if (area < best_area) {
+      best_area = area;
+      double cu = (min_u + max_u) / 2.;
+      double cn = (min_n + max_n) / 2.;
+      rectangle.center = Point<double>(cu * ux + cn * nx, cu * uy + cn * ny);
+      rectangle.width = max_u - min_u;
+      rectangle.height = max_n - min_n;
+      rectangle.angle = std::atan2(uy, ux);
+    }
+  }
+
+  return rectangle;
+}
+
+/*!
+ * \brief Círculo mínimo que contiene un conjunto de puntos (Welzl)
+ * Se usa la versión iterativa del algoritmo aleatorizado de Welzl sobre los
+ * vértices de la envolvente convexa, que determinan el mismo círculo. La
+ * permutación aleatoria usa una semilla fija para que el resultado sea
+ * reproducible.
+ * \param[in] points Puntos (Point o Point3, se usa la proyección XY)
+ * \return Círculo mínimo
+ */
+template<typename Container_t> inline
+Circle<double> minEnclosingCircle(const Container_t &points)
+{
+  std::vector<Point<double>> hull = internal::hullVertices(points);
+
+  if (hull.empty()) return Circle<double>(Point<double>(), 0.);
+
+  std::mt19937 generator(5489u);
+  std::shuffle(hull.begin(), hull.end(), generator);
+
+  Circle<double> circle(hull[0], 0.);
+
+  for (size_t i = 1; i < hull.size(); i++) {
+    if (internal::circleContains(circle, hull[i])) continue;
+    circle = Circle<double>(hull[i], 0.);
+    for (size_t j = 0; j < i; j++) {
+      if (internal::circleContains(circle, hull[j])) continue;
+      circle = internal::circleFrom(hull[i], hull[j]);
+      for (size_t k = 0; k < j; k++) {
+        if (internal::circleContains(circle, hull[k])) continue;
+        circle = internal::circleFrom(hull[i], hull[j], hull[k]);
+      }
+    }
+  }
+
+  return circle;
+}
+
+/*! \} */ // end of geometry_algorithms
+
+/*! \} */ // end of geometry
+
+} // End namespace tl
+
+#endif // TL_GEOMETRY_ALGORITHMS_HULL_H
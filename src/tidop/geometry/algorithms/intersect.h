@@ -27,6 +27,12 @@
 
 #include "config_tl.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <vector>
+
 #include "tidop/core/defs.h"
 #include "tidop/geometry/entities/point.h"
 #include "tidop/geometry/entities/segment.h"
@@ -115,6 +121,318 @@ inline int intersectLines(const Segment<Point_t> &ln1, const Segment<Point_t> &l
 }
 
 
+/*!
+ * \brief Intersección entre dos segmentos de un conjunto
+ */
+struct SegmentIntersection
+{
+  /*!
+   * \brief Punto de intersección
+   */
+  Point<double> point;
+
+  /*!
+   * \brief Índice del primer segmento (el menor)
+   */
+  size_t segment1;
+
+  /*!
+   * \brief Índice del segundo segmento
+   */
+  size_t segment2;
+};
+
+
+namespace internal
+{
+
+/*!
+ * \brief Segmento orientado para el barrido con pt1 lexicográficamente menor que pt2
+ */
+struct SweepSegment
+{
+  Point<double> pt1;
+  Point<double> pt2;
+  size_t id;
+};
+
+/*!
+ * \brief Orden lexicográfico (x, y) de los eventos del barrido
+ */
+struct SweepPointLess
+{
+  bool operator()(const Point<double> &pt1, const Point<double> &pt2) const
+  {
+    return pt1.x < pt2.x || (pt1.x == pt2.x && pt1.y < pt2.y);
+  }
+};
+
+} // namespace internal
+
+
+/*!
+ * \brief Intersección de todos los pares de un conjunto de segmentos (Bentley-Ottmann)
+ *
+ * Barrido de izquierda a derecha con una cola de eventos ordenada
+ * (extremos e intersecciones) y una estructura de estado con los segmentos
+ * activos ordenados por su ordenada en la posición del barrido. Sólo se
+ * comprueban los segmentos adyacentes en el estado, por lo que el coste es
+ * O((n + k) log n) frente al O(n²) de comparar todos los pares.
+ *
+ * Se tratan los casos degenerados habituales en la salida de los detectores
+ * de líneas: segmentos verticales, extremos compartidos, uniones en T y varios
+ * segmentos por un mismo punto. Dos segmentos colineales solapados se
+ * informan en los extremos del tramo común. Los segmentos de longitud nula se
+ * ignoran.
+ *
+ * La clase reutiliza sus buffers entre llamadas.
+ */
+template<typename Point_t>
+class SegmentIntersector
+{
+
+public:
+
+  SegmentIntersector()
+    : mTolerance(0.)
+  {
+  }
+
+  /*!
+   * \brief Calcula todas las intersecciones
+   * \param[in] segments Segmentos
+   * \return Intersecciones ordenadas por pares de segmentos
+   */
+  std::vector<SegmentIntersection> execute(const std::vector<Segment<Point_t>> &segments);
+
+private:
+
+  bool near(const Point<double> &pt1, const Point<double> &pt2) const;
+  double yAt(size_t segment, const Point<double> &event) const;
+  bool contains(size_t segment, const Point<double> &event) const;
+  double slope(size_t segment) const;
+  void findEvent(size_t segment1, size_t segment2, const Point<double> &event);
+
+private:
+
+  std::vector<internal::SweepSegment> mSegments;
+  std::map<Point<double>, std::vector<size_t>, internal::SweepPointLess> mEvents;
+  std::vector<size_t> mStatus;
+  std::vector<size_t> mGroup;
+  std::vector<size_t> mInvolved;
+  double mTolerance;
+};
+
+template<typename Point_t> inline
+std::vector<SegmentIntersection> SegmentIntersector<Point_t>::execute(const std::vector<Segment<Point_t>> &segments)
+{
+  std::vector<SegmentIntersection> intersections;
+
+  mSegments.clear();
+  mEvents.clear();
+  mStatus.clear();
+
+  internal::SweepPointLess less;
+  double scale = 1.;
+  for (size_t i = 0; i < segments.size(); i++) {
+    internal::SweepSegment segment;
+    segment.pt1 = Point<double>(static_cast<double>(segments[i].pt1.x), static_cast<double>(segments[i].pt1.y));
+    segment.pt2 = Point<double>(static_cast<double>(segments[i].pt2.x), static_cast<double>(segments[i].pt2.y));
+    segment.id = i;
+    if (segment.pt1 == segment.pt2) continue;
+    if (less(segment.pt2, segment.pt1)) std::swap(segment.pt1, segment.pt2);
+    scale = std::max({scale, std::abs(segment.pt1.x), std::abs(segment.pt1.y),
+                      std::abs(segment.pt2.x), std::abs(segment.pt2.y)});
+    mSegments.push_back(segment);
+  }
+  mTolerance = scale * 1e-10;
+
+  for (size_t i = 0; i < mSegments.size(); i++) {
+    mEvents[mSegments[i].pt1].push_back(i);
+    mEvents[mSegments[i].pt2];
+  }
+
+  while (!mEvents.empty()) {
+
+    auto it = mEvents.begin();
+    Point<double> event = it->first;
+    mGroup.swap(it->second);
+    mEvents.erase(it);
+
+    // Banda del estado a la altura del evento. Se reordena para que los
+    // segmentos que contienen el evento queden contiguos.
+    auto band_begin = std::lower_bound(mStatus.begin(), mStatus.end(), event.y - mTolerance,
+                                       [&](size_t segment, double y) {
+                                         return yAt(segment, event) < y;
+                                       });
+    auto band_end = band_begin;
+    while (band_end != mStatus.end() && yAt(*band_end, event) <= event.y + mTolerance) ++band_end;
+
+    auto lower = std::stable_partition(band_begin, band_end, [&](size_t segment) {
+      return !contains(segment, event) && yAt(segment, event) < event.y;
+    });
+    auto upper = std::stable_partition(lower, band_end, [&](size_t segment) {
+      return contains(segment, event);
+    });
+
+    size_t first = static_cast<size_t>(lower - mStatus.begin());
+    size_t last = static_cast<size_t>(upper - mStatus.begin());
+
+    mInvolved.assign(mGroup.begin(), mGroup.end());
+    for (size_t i = first; i < last; i++) {
+      size_t segment = mStatus[i];
+      mInvolved.push_back(segment);
+      // Los segmentos que continúan tras el evento se reinsertan
+      if (!near(mSegments[segment].pt2, event)) mGroup.push_back(segment);
+    }
+
+    for (size_t i = 0; i < mInvolved.size(); i++) {
+      for (size_t j = i + 1; j < mInvolved.size(); j++) {
+        SegmentIntersection intersection;
+        intersection.point = event;
+        intersection.segment1 = std::min(mSegments[mInvolved[i]].id, mSegments[mInvolved[j]].id);
+        intersection.segment2 = std::max(mSegments[mInvolved[i]].id, mSegments[mInvolved[j]].id);
+        intersections.push_back(intersection);
+      }
+    }
+
+    mStatus.erase(mStatus.begin() + first, mStatus.begin() + last);
+
+    // A la derecha del evento el orden lo da la pendiente
+    std::sort(mGroup.begin(), mGroup.end(), [&](size_t segment1, size_t segment2) {
+      double slope1 = slope(segment1);
+      double slope2 = slope(segment2);
+      return slope1 < slope2 || (slope1 == slope2 && segment1 < segment2);
+    });
+    mStatus.insert(mStatus.begin() + first, mGroup.begin(), mGroup.end());
+
+    if (mGroup.empty()) {
+      if (first > 0 && first < mStatus.size())
+        findEvent(mStatus[first - 1], mStatus[first], event);
+    } else {
+      if (first > 0)
+        findEvent(mStatus[first - 1], mStatus[first], event);
+      size_t next = first + mGroup.size();
+      if (next < mStatus.size())
+        findEvent(mStatus[next - 1], mStatus[next], event);
+    }
+
+    mGroup.clear();
+  }
+
+  // Un mismo cruce puede llegar por eventos casi coincidentes
+  std::sort(intersections.begin(), intersections.end(), [](const SegmentIntersection &i1, const SegmentIntersection &i2) {
+    if (i1.segment1 != i2.segment1) return i1.segment1 < i2.segment1;
+    if (i1.segment2 != i2.segment2) return i1.segment2 < i2.segment2;
+    return internal::SweepPointLess()(i1.point, i2.point);
+  });
+  intersections.erase(std::unique(intersections.begin(), intersections.end(), [&](const SegmentIntersection &i1, const SegmentIntersection &i2) {
+    return i1.segment1 == i2.segment1 && i1.segment2 == i2.segment2 && near(i1.point, i2.point);
+  }), intersections.end());
+
+  return intersections;
+}
+
+template<typename Point_t> inline
+bool SegmentIntersector<Point_t>::near(const Point<double> &pt1, const Point<double> &pt2) const
+{
+  return std::abs(pt1.x - pt2.x) <= mTolerance && std::abs(pt1.y - pt2.y) <= mTolerance;
+}
+
+template<typename Point_t> inline
+double SegmentIntersector<Point_t>::yAt(size_t segment, const Point<double> &event) const
+{
+  const internal::SweepSegment &s = mSegments[segment];
+
+  // Un segmento vertical se sitúa a la altura del evento
+  if (s.pt1.x == s.pt2.x)
+    return std::min(std::max(event.y, s.pt1.y), s.pt2.y);
+  if (event.x <= s.pt1.x) return s.pt1.y;
+  if (event.x >= s.pt2.x) return s.pt2.y;
+
+  return s.pt1.y + (event.x - s.pt1.x) * (s.pt2.y - s.pt1.y) / (s.pt2.x - s.pt1.x);
+}
+
+template<typename Point_t> inline
+bool SegmentIntersector<Point_t>::contains(size_t segment, const Point<double> &event) const
+{
+  const internal::SweepSegment &s = mSegments[segment];
+
+  if (event.x < s.pt1.x - mTolerance || event.x > s.pt2.x + mTolerance ||
+      event.y < std::min(s.pt1.y, s.pt2.y) - mTolerance ||
+      event.y > std::max(s.pt1.y, s.pt2.y) + mTolerance) return false;
+
+  double dx = s.pt2.x - s.pt1.x;
+  double dy = s.pt2.y - s.pt1.y;
+  double cross = dx * (event.y - s.pt1.y) - dy * (event.x - s.pt1.x);
+
+  return std::abs(cross) <= mTolerance * std::sqrt(dx * dx + dy * dy);
+}
+
+template<typename Point_t> inline
+double SegmentIntersector<Point_t>::slope(size_t segment) const
+{
+  const internal::SweepSegment &s = mSegments[segment];
+  if (s.pt1.x == s.pt2.x) return std::numeric_limits<double>::infinity();
+  return (s.pt2.y - s.pt1.y) / (s.pt2.x - s.pt1.x);
+}
+
+template<typename Point_t> inline
+void SegmentIntersector<Point_t>::findEvent(size_t segment1,
+                                             size_t segment2,
+                                             const Point<double> &event)
+{
+  // Orden fijo para que el mismo par dé siempre el mismo punto
+  if (segment2 < segment1) std::swap(segment1, segment2);
+
+  const internal::SweepSegment &s1 = mSegments[segment1];
+  const internal::SweepSegment &s2 = mSegments[segment2];
+
+  double dx1 = s1.pt2.x - s1.pt1.x;
+  double dy1 = s1.pt2.y - s1.pt1.y;
+  double dx2 = s2.pt2.x - s2.pt1.x;
+  double dy2 = s2.pt2.y - s2.pt1.y;
+  double den = dx1 * dy2 - dy1 * dx2;
+
+  // Paralelos. Los solapes colineales se detectan en los extremos.
+  if (std::abs(den) <= 1e-15 * std::sqrt((dx1 * dx1 + dy1 * dy1) * (dx2 * dx2 + dy2 * dy2))) return;
+
+  double wx = s2.pt1.x - s1.pt1.x;
+  double wy = s2.pt1.y - s1.pt1.y;
+  double t = (wx * dy2 - wy * dx2) / den;
+  double u = (wx * dy1 - wy * dx1) / den;
+  if (t < -1e-12 || t > 1. + 1e-12 || u < -1e-12 || u > 1. + 1e-12) return;
+
+  Point<double> point(s1.pt1.x + t * dx1, s1.pt1.y + t * dy1);
+
+  // Se ajusta a las coordenadas exactas de verticales, horizontales y
+  // extremos para no desordenar el evento respecto a los ya existentes
+  if (dx1 == 0.) point.x = s1.pt1.x;
+  else if (dx2 == 0.) point.x = s2.pt1.x;
+  if (dy1 == 0.) point.y = s1.pt1.y;
+  else if (dy2 == 0.) point.y = s2.pt1.y;
+  for (const Point<double> *end : {&s1.pt1, &s1.pt2, &s2.pt1, &s2.pt2}) {
+    if (near(point, *end)) point = *end;
+  }
+  if (internal::SweepPointLess()(event, point) && !near(event, point)) {
+    mEvents[point];
+  }
+}
+
+/*!
+ * \brief Intersecciones entre todos los pares de un conjunto de segmentos
+ * \param[in] segments Segmentos
+ * \return Intersecciones
+ * \see SegmentIntersector
+ */
+template<typename Point_t> inline
+std::vector<SegmentIntersection> segmentIntersections(const std::vector<Segment<Point_t>> &segments)
+{
+  SegmentIntersector<Point_t> intersector;
+  return intersector.execute(segments);
+}
+
+
 template<typename Point_t>
 bool linePlaneIntersection(const std::array<double, 4> &plane, const Segment<Point_t> &ln, Point_t *intersect)
 {
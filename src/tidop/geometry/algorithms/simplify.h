@@ -0,0 +1,660 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOMETRY_ALGORITHMS_SIMPLIFY_H
+#define TL_GEOMETRY_ALGORITHMS_SIMPLIFY_H
+
+#include "config_tl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/concurrency.h"
+#include "tidop/geometry/entities/point.h"
+#include "tidop/geometry/entities/linestring.h"
+#include "tidop/geometry/entities/polygon.h"
+
+namespace tl
+{
+
+/*! \addtogroup geometry
+ *  \{
+ */
+
+/*! \addtogroup geometry_algorithms
+ *  \{
+ */
+
+
+namespace internal
+{
+
+/*!
+ * \brief Distancia al cuadrado de un punto a un segmento
+ */
+template<typename Point_t> inline
+double distancePointToSegment2(const Point_t &point,
+                               const Point_t &pt1,
+                               const Point_t &pt2)
+{
+  double x = static_cast<double>(point.x);
+  double y = static_cast<double>(point.y);
+  double x1 = static_cast<double>(pt1.x);
+  double y1 = static_cast<double>(pt1.y);
+  double dx = static_cast<double>(pt2.x) - x1;
+  double dy = static_cast<double>(pt2.y) - y1;
+  double length2 = dx * dx + dy * dy;
+
+  double t = length2 > 0. ? ((x - x1) * dx + (y - y1) * dy) / length2 : 0.;
+  t = std::max(0., std::min(1., t));
+
+  double px = x1 + t * dx - x;
+  double py = y1 + t * dy - y;
+  return px * px + py * py;
+}
+
+template<typename Ring_t> inline
+double holeArea(const Ring_t &ring)
+{
+  double area = 0.;
+  for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+    area += static_cast<double>(ring[j].x) * static_cast<double>(ring[i].y) -
+            static_cast<double>(ring[i].x) * static_cast<double>(ring[j].y);
+  }
+  return std::abs(area / 2.);
+}
+
+} // namespace internal
+
+
+/*!
+ * \brief Simplificación y densificación de líneas y polígonos
+ *
+ * - Douglas-Peucker iterativo con pila explícita. La tolerancia es la
+ *   distancia máxima entre la línea original y la simplificada.
+ * - Visvalingam-Whyatt con montículo. La tolerancia es el área efectiva
+ *   mínima (área del triángulo que forma un vértice con sus vecinos).
+ * - Densificación a paso fijo: se insertan vértices equiespaciados en los
+ *   segmentos más largos que el paso.
+ *
+ * En los polígonos se procesan el anillo exterior y los huecos como anillos
+ * cerrados. Un anillo nunca se reduce a menos de tres vértices; los huecos que
+ * quedan por debajo de la tolerancia de Visvalingam-Whyatt se eliminan.
+ *
+ * Los buffers de trabajo (pila, montículo, listas de vecinos, ...) se
+ * conservan entre llamadas. Para procesar muchas geometrías se reutiliza un
+ * mismo objeto o se usan las funciones por lotes, que crean uno por hilo.
+ * Un objeto no debe usarse desde varios hilos a la vez.
+ */
+template<typename Point_t>
+class LineSimplifier
+{
+
+public:
+
+  enum class Method
+  {
+    douglas_peucker,
+    visvalingam_whyatt
+  };
+
+public:
+
+  LineSimplifier() = default;
+  ~LineSimplifier() = default;
+
+  /*!
+   * \brief Simplifica una línea
+   * \param[in] lineString Línea
+   * \param[in] tolerance Distancia (Douglas-Peucker) o área (Visvalingam-Whyatt)
+   * \param[in] method Método de simplificación
+   * \param[out] simplified Línea simplificada. Se reutiliza su memoria
+   */
+  void simplify(const LineString<Point_t> &lineString,
+                double tolerance,
+                Method method,
+                LineString<Point_t> *simplified);
+
+  LineString<Point_t> simplify(const LineString<Point_t> &lineString,
+                               double tolerance,
+                               Method method = Method::douglas_peucker);
+
+  /*!
+   * \brief Simplifica un polígono (anillo exterior y huecos)
+   * \param[in] polygon Polígono
+   * \param[in] tolerance Distancia (Douglas-Peucker) o área (Visvalingam-Whyatt)
+   * \param[in] method Método de simplificación
+   * \return Polígono simplificado
+   */
+  Polygon<Point_t> simplify(const Polygon<Point_t> &polygon,
+                            double tolerance,
+                            Method method = Method::douglas_peucker);
+
+  /*!
+   * \brief Densifica una línea
+   * \param[in] lineString Línea
+   * \param[in] step Longitud máxima de los segmentos
+   * \param[out] densified Línea densificada. Se reutiliza su memoria
+   */
+  void densify(const LineString<Point_t> &lineString,
+               double step,
+               LineString<Point_t> *densified);
+
+  LineString<Point_t> densify(const LineString<Point_t> &lineString,
+                              double step);
+
+  /*!
+   * \brief Densifica un polígono (anillo exterior y huecos)
+   * \param[in] polygon Polígono
+   * \param[in] step Longitud máxima de los segmentos
+   * \return Polígono densificado
+   */
+  Polygon<Point_t> densify(const Polygon<Point_t> &polygon,
+                           double step);
+
+private:
+
+  /*!
+   * \brief Marca en mKeep los vértices que se conservan
+   * \return Número de vértices conservados
+   */
+  template<typename Points_t>
+  size_t select(const Points_t &points,
+                bool closed,
+                double tolerance,
+                Method method);
+
+  template<typename Points_t>
+  void douglasPeucker(const Points_t &points,
+                      size_t first,
+                      size_t last,
+                      double tolerance);
+
+  template<typename Points_t>
+  size_t visvalingamWhyatt(const Points_t &points,
+                           bool closed,
+                           double tolerance);
+
+  template<typename Points_t>
+  double effectiveArea(const Points_t &points,
+                       size_t i) const;
+
+  template<typename Points_t, typename Output_t>
+  void copySelected(const Points_t &points,
+                    Output_t *output) const;
+
+  template<typename Points_t, typename Output_t>
+  void densifyPoints(const Points_t &points,
+                     bool closed,
+                     double step,
+                     Output_t *output) const;
+
+private:
+
+  struct HeapItem
+  {
+    double area;
+    size_t index;
+    size_t version;
+
+    bool operator > (const HeapItem &item) const
+    {
+      return area > item.area || (area == item.area && index > item.index);
+    }
+  };
+
+  std::vector<char> mKeep;
+  std::vector<std::pair<size_t, size_t>> mStack;
+  std::vector<HeapItem> mHeap;
+  std::vector<size_t> mPrevious;
+  std::vector<size_t> mNext;
+  std::vector<size_t> mVersion;
+
+};
+
+template<typename Point_t> inline
+void LineSimplifier<Point_t>::simplify(const LineString<Point_t> &lineString,
+                                       double tolerance,
+                                       Method method,
+                                       LineString<Point_t> *simplified)
+{
+  simplified->clear();
+  select(lineString, false, tolerance, method);
+  copySelected(lineString, simplified);
+}
+
+template<typename Point_t> inline
+LineString<Point_t> LineSimplifier<Point_t>::simplify(const LineString<Point_t> &lineString,
+                                                      double tolerance,
+                                                      Method method)
+{
+  LineString<Point_t> simplified;
+  simplify(lineString, tolerance, method, &simplified);
+  return simplified;
+}
+
+template<typename Point_t> inline
+Polygon<Point_t> LineSimplifier<Point_t>::simplify(const Polygon<Point_t> &polygon,
+                                                   double tolerance,
+                                                   Method method)
+{
+  Polygon<Point_t> simplified;
+
+  select(polygon, true, tolerance, method);
+  copySelected(polygon, &simplified);
+
+  for (size_t i = 0; i < polygon.holes(); i++) {
+    PolygonHole<Point_t> hole = polygon.hole(i);
+    select(hole, true, tolerance, method);
+    PolygonHole<Point_t> simplified_hole;
+    copySelected(hole, &simplified_hole);
+    if (method == Method::visvalingam_whyatt &&
+        internal::holeArea(simplified_hole) < tolerance) continue;
+    simplified.addHole(simplified_hole);
+  }
+
+  return simplified;
+}
+
+template<typename Point_t> inline
+void LineSimplifier<Point_t>::densify(const LineString<Point_t> &lineString,
+                                      double step,
+                                      LineString<Point_t> *densified)
+{
+  densified->clear();
+  densifyPoints(lineString, false, step, densified);
+}
+
+template<typename Point_t> inline
+LineString<Point_t> LineSimplifier<Point_t>::densify(const LineString<Point_t> &lineString,
+                                                     double step)
+{
+  LineString<Point_t> densified;
+  densify(lineString, step, &densified);
+  return densified;
+}
+
+template<typename Point_t> inline
+Polygon<Point_t> LineSimplifier<Point_t>::densify(const Polygon<Point_t> &polygon,
+                                                  double step)
+{
+  Polygon<Point_t> densified;
+  densifyPoints(polygon, true, step, &densified);
+
+  for (size_t i = 0; i < polygon.holes(); i++) {
+    PolygonHole<Point_t> hole;
+    densifyPoints(polygon.hole(i), true, step, &hole);
+    densified.addHole(hole);
+  }
+
+  return densified;
+}
+
+template<typename Point_t> template<typename Points_t> inline
+size_t LineSimplifier<Point_t>::select(const Points_t &points,
+                                       bool closed,
+                                       double tolerance,
+                                       Method method)
+{
+  size_t size = points.size();
+  size_t min_size = closed ? 3 : 2;
+
+  if (size <= min_size || tolerance <= 0.) {
+    mKeep.assign(size, 1);
+    return size;
+  }
+
+  if (method == Method::visvalingam_whyatt)
+    return visvalingamWhyatt(points, closed, tolerance);
+
+  mKeep.assign(size, 0);
+
+  if (closed) {
+    // El anillo se parte en el vértice inicial y el más alejado de él
+    size_t farthest = 0;
+    double max_distance = -1.;
+    for (size_t i = 1; i < size; i++) {
+      double dx = static_cast<double>(points[i].x) - static_cast<double>(points[0].x);
+      double dy = static_cast<double>(points[i].y) - static_cast<double>(points[0].y);
+      double distance = dx * dx + dy * dy;
+      if (distance > max_distance) {
+        max_distance = distance;
+        farthest = i;
+      }
+    }
+    mKeep[0] = 1;
+    mKeep[farthest] = 1;
+    douglasPeucker(points, 0, farthest, tolerance);
+    douglasPeucker(points, farthest, size, tolerance);
+  } else {
+    mKeep[0] = 1;
+    mKeep[size - 1] = 1;
+    douglasPeucker(points, 0, size - 1, tolerance);
+  }
+
+  size_t count = static_cast<size_t>(std::count(mKeep.begin(), mKeep.end(), 1));
+
+  // Un anillo no puede quedar con menos de tres vértices: se añade el
+  // vértice más alejado del segmento que forman los dos conservados
+  if (closed && count < 3) {
+    size_t v1 = 0;
+    size_t v2 = 0;
+    for (size_t i = 1; i < size; i++) if (mKeep[i]) v2 = i;
+    size_t best = 0;
+    double max_distance = -1.;
+    for (size_t i = 0; i < size; i++) {
+      if (mKeep[i]) continue;
+      double distance = internal::distancePointToSegment2(points[i], points[v1], points[v2]);
+      if (distance > max_distance) {
+        max_distance = distance;
+        best = i;
+      }
+    }
+    mKeep[best] = 1;
+    count++;
+  }
+
+  return count;
+}
+
+
+template<typename Point_t> template<typename Points_t> inline
+void LineSimplifier<Point_t>::douglasPeucker(const Points_t &points,
+                                             size_t first,
+                                             size_t last,
+                                             double tolerance)
+{
+  // last puede valer points.size() para cerrar el anillo con el vértice 0
+  size_t size = points.size();
+  double tolerance2 = tolerance * tolerance;
+
+  mStack.clear();
+  mStack.emplace_back(first, last);
+
+  while (!mStack.empty()) {
+    std::pair<size_t, size_t> range = mStack.back();
+    mStack.pop_back();
+
+    if (range.second <= range.first + 1) continue;
+
+    const Point_t &pt1 = points[range.first];
+    const Point_t &pt2 = points[range.second % size];
+
+    size_t farthest = range.first;
+    double max_distance = 0.;
+    for (size_t i = range.first + 1; i < range.second; i++) {
+      double distance = internal::distancePointToSegment2(points[i], pt1, pt2);
+      if (distance > max_distance) {
+        max_distance = distance;
+        farthest = i;
+      }
+    }
+
+    if (max_distance > tolerance2) {
+      mKeep[farthest] = 1;
+      mStack.emplace_back(range.first, farthest);
+      mStack.emplace_back(farthest, range.second);
+    }
+  }
+}
+
+template<typename Point_t> template<typename Points_t> inline
+double LineSimplifier<Point_t>::effectiveArea(const Points_t &points,
+                                              size_t i) const
+{
+  const Point_t &a = points[mPrevious[i]];
+  const Point_t &b = points[i];
+  const Point_t &c = points[mNext[i]];
+  double abx = static_cast<double>(b.x) - static_cast<double>(a.x);
+  double aby = static_cast<double>(b.y) - static_cast<double>(a.y);
+  double acx = static_cast<double>(c.x) - static_cast<double>(a.x);
+  double acy = static_cast<double>(c.y) - static_cast<double>(a.y);
+  return std::abs(abx * acy - aby * acx) / 2.;
+}
+
+template<typename Point_t> template<typename Points_t> inline
+size_t LineSimplifier<Point_t>::visvalingamWhyatt(const Points_t &points,
+                                                  bool closed,
+                                                  double tolerance)
+{
+  size_t size = points.size();
+  size_t min_size = closed ? 3 : 2;
+
+  mKeep.assign(size, 1);
+  mPrevious.resize(size);
+  mNext.resize(size);
+  mVersion.assign(size, 0);
+  mHeap.clear();
+
+  for (size_t i = 0; i < size; i++) {
+    mPrevious[i] = i == 0 ? size - 1 : i - 1;
+    mNext[i] = i == size - 1 ? 0 : i + 1;
+  }
+
+  size_t first = closed ? 0 : 1;
+  size_t last = closed ? size : size - 1;
+  for (size_t i = first; i < last; i++) {
+    mHeap.push_back({effectiveArea(points, i), i, 0});
+  }
+
+  std::greater<HeapItem> compare;
+  std::make_heap(mHeap.begin(), mHeap.end(), compare);
+
+  size_t count = size;
+  double min_area = 0.;
+
+  while (!mHeap.empty() && count > min_size) {
+    std::pop_heap(mHeap.begin(), mHeap.end(), compare);
+    HeapItem item = mHeap.back();
+    mHeap.pop_back();
+
+    if (!mKeep[item.index] || item.version != mVersion[item.index]) continue;
+    if (item.area >= tolerance) break;
+
+    // El área efectiva no decrece al eliminar vértices
+    min_area = std::max(min_area, item.area);
+
+    size_t previous = mPrevious[item.index];
+    size_t next = mNext[item.index];
+    mKeep[item.index] = 0;
+    mNext[previous] = next;
+    mPrevious[next] = previous;
+    count--;
+
+    for (size_t neighbour : {previous, next}) {
+      if (!closed && (neighbour == 0 || neighbour == size - 1)) continue;
+      mVersion[neighbour]++;
+      mHeap.push_back({std::max(min_area, effectiveArea(points, neighbour)), neighbour, mVersion[neighbour]});
+      std::push_heap(mHeap.begin(), mHeap.end(), compare);
+    }
+  }
+
+  return count;
+}
+
+template<typename Point_t> template<typename Points_t, typename Output_t> inline
+void LineSimplifier<Point_t>::copySelected(const Points_t &points,
+                                           Output_t *output) const
+{
+  for (size_t i = 0; i < points.size(); i++) {
+    if (mKeep[i]) output->push_back(points[i]);
+  }
+}
+
+template<typename Point_t> template<typename Points_t, typename Output_t> inline
+void LineSimplifier<Point_t>::densifyPoints(const Points_t &points,
+                                            bool closed,
+                                            double step,
+                                            Output_t *output) const
+{
+  using value_type = typename Point_t::value_type;
+
+  size_t size = points.size();
+  if (size == 0) return;
+
+  size_t segments = closed ? size : size - 1;
+
+  for (size_t i = 0; i < segments; i++) {
+    const Point_t &pt1 = points[i];
+    const Point_t &pt2 = points[(i + 1) % size];
+    output->push_back(pt1);
+
+    if (step <= 0.) continue;
+
+    double x1 = static_cast<double>(pt1.x);
+    double y1 = static_cast<double>(pt1.y);
+    double dx = static_cast<double>(pt2.x) - x1;
+    double dy = static_cast<double>(pt2.y) - y1;
+    double length = std::sqrt(dx * dx + dy * dy);
+    size_t parts = static_cast<size_t>(std::ceil(length / step));
+
+    for (size_t j = 1; j < parts; j++) {
+      double t = static_cast<double>(j) / static_cast<double>(parts);
+      output->push_back(Point_t(static_cast<value_type>(x1 + t * dx),
+                                static_cast<value_type>(y1 + t * dy)));
+    }
+  }
+
+  if (!closed) output->push_back(points[size - 1]);
+}
+
+
+/*!
+ * \brief Simplificación Douglas-Peucker de una línea
+ * \param[in] lineString Línea
+ * \param[in] tolerance Distancia máxima entre la línea original y la simplificada
+ */
+template<typename Point_t> inline
+LineString<Point_t> simplifyDouglasPeucker(const LineString<Point_t> &lineString,
+                                           double tolerance)
+{
+  LineSimplifier<Point_t> simplifier;
+  return simplifier.simplify(lineString, tolerance, LineSimplifier<Point_t>::Method::douglas_peucker);
+}
+
+template<typename Point_t> inline
+Polygon<Point_t> simplifyDouglasPeucker(const Polygon<Point_t> &polygon,
+                                        double tolerance)
+{
+  LineSimplifier<Point_t> simplifier;
+  return simplifier.simplify(polygon, tolerance, LineSimplifier<Point_t>::Method::douglas_peucker);
+}
+
+/*!
+ * \brief Simplificación Visvalingam-Whyatt de una línea
+ * \param[in] lineString Línea
+ * \param[in] area Área efectiva mínima de los vértices conservados
+ */
+template<typename Point_t> inline
+LineString<Point_t> simplifyVisvalingamWhyatt(const LineString<Point_t> &lineString,
+                                              double area)
+{
+  LineSimplifier<Point_t> simplifier;
+  return simplifier.simplify(lineString, area, LineSimplifier<Point_t>::Method::visvalingam_whyatt);
+}
+
+template<typename Point_t> inline
+Polygon<Point_t> simplifyVisvalingamWhyatt(const Polygon<Point_t> &polygon,
+                                           double area)
+{
+  LineSimplifier<Point_t> simplifier;
+  return simplifier.simplify(polygon, area, LineSimplifier<Point_t>::Method::visvalingam_whyatt);
+}
+
+/*!
+ * \brief Densificación a paso fijo de una línea
+ * \param[in] lineString Línea
+ * \param[in] step Longitud máxima de los segmentos
+ */
+template<typename Point_t> inline
+LineString<Point_t> densify(const LineString<Point_t> &lineString,
+                            double step)
+{
+  LineSimplifier<Point_t> simplifier;
+  return simplifier.densify(lineString, step);
+}
+
+/*!
+ * \brief Densificación a paso fijo de un polígono
+ * \param[in] polygon Polígono
+ * \param[in] step Longitud máxima de los segmentos
+ */
+template<typename Point_t> inline
+Polygon<Point_t> densify(const Polygon<Point_t> &polygon,
+                         double step)
+{
+  LineSimplifier<Point_t> simplifier;
+  return simplifier.densify(polygon, step);
+}
+
+/*!
+ * \brief Simplificación en paralelo de un conjunto de líneas o polígonos
+ * Cada hilo reutiliza su propio LineSimplifier.
+ * \param[in] entities Líneas o polígonos
+ * \param[in] tolerance Distancia (Douglas-Peucker) o área (Visvalingam-Whyatt)
+ * \param[in] method Método de simplificación
+ */
+template<typename Entity_t> inline
+std::vector<Entity_t> simplify(const std::vector<Entity_t> &entities,
+                               double tolerance,
+                               typename LineSimplifier<typename Entity_t::value_type>::Method method)
+{
+  using Simplifier = LineSimplifier<typename Entity_t::value_type>;
+
+  std::vector<Entity_t> result(entities.size());
+  parallel_for_worker<Simplifier>(0, entities.size(), [&](Simplifier &simplifier, size_t i) {
+    result[i] = simplifier.simplify(entities[i], tolerance, method);
+  });
+  return result;
+}
+
+/*!
+ * \brief Densificación en paralelo de un conjunto de líneas o polígonos
+ * \param[in] entities Líneas o polígonos
+ * \param[in] step Longitud máxima de los segmentos
+ */
+template<typename Entity_t> inline
+std::vector<Entity_t> densify(const std::vector<Entity_t> &entities,
+                              double step)
+{
+  using Simplifier = LineSimplifier<typename Entity_t::value_type>;
+
+  std::vector<Entity_t> result(entities.size());
+  parallel_for_worker<Simplifier>(0, entities.size(), [&](Simplifier &simplifier, size_t i) {
+    result[i] = simplifier.densify(entities[i], step);
+  });
+  return result;
+}
+
+/*! \} */ // end of geometry_algorithms
+
+/*! \} */ // end of geometry
+
+} // End namespace tl
+
+#endif // TL_GEOMETRY_ALGORITHMS_SIMPLIFY_H
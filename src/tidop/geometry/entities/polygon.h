@@ -763,6 +763,10 @@ Window<Point_t> MultiPolygon<Point_t>::window() const
   return w;
 }
 
+using MultiPolygonI = MultiPolygon<Point<int>>;
+using MultiPolygonD = MultiPolygon<Point<double>>;
+using MultiPolygonF = MultiPolygon<Point<float>>;
+
 /* ---------------------------------------------------------------------------------- */
 
 template <typename Point3_t>
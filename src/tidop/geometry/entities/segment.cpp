@@ -24,6 +24,13 @@
 
 #include "segment.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+#include "tidop/core/exception.h"
+#include "tidop/math/math.h"
 #include "tidop/math/mathutils.h"
 
 //#include "tidop/geometry/operations.h"
@@ -85,4 +92,127 @@ void GroupLines::deleteLine(int id)
   linesgroup.erase(linesgroup.begin() + id);
 }
 
+
+namespace internal
+{
+
+size_t findRoot(std::vector<size_t> &parent, size_t id)
+{
+  while (parent[id] != id) {
+    parent[id] = parent[parent[id]];
+    id = parent[id];
+  }
+  return id;
+}
+
+int64_t lineBucketKey(int angleBucket, int64_t offsetBucket)
+{
+  return (static_cast<int64_t>(angleBucket) << 32) ^ static_cast<int64_t>(static_cast<uint32_t>(offsetBucket));
+}
+
+} // namespace internal
+
+std::vector<GroupLines> groupCollinearLines(const std::vector<Line> &lines,
+                                            double angleTolerance,
+                                            double distanceTolerance)
+{
+  TL_ASSERT(angleTolerance > 0. && angleTolerance < math::consts::half_pi<double>, "Invalid angle tolerance");
+  TL_ASSERT(distanceTolerance > 0., "Invalid distance tolerance");
+
+  std::vector<GroupLines> groups;
+  size_t size = lines.size();
+  if (size == 0) return groups;
+
+  constexpr double pi = math::consts::pi<double>;
+
+  // Centro del conjunto como origen de las distancias
+  double xmin = lines[0].pt1.x;
+  double xmax = xmin;
+  double ymin = lines[0].pt1.y;
+  double ymax = ymin;
+  for (const auto &line : lines) {
+    xmin = std::min({xmin, static_cast<double>(line.pt1.x), static_cast<double>(line.pt2.x)});
+    xmax = std::max({xmax, static_cast<double>(line.pt1.x), static_cast<double>(line.pt2.x)});
+    ymin = std::min({ymin, static_cast<double>(line.pt1.y), static_cast<double>(line.pt2.y)});
+    ymax = std::max({ymax, static_cast<double>(line.pt1.y), static_cast<double>(line.pt2.y)});
+  }
+  double cx = (xmin + xmax) / 2.;
+  double cy = (ymin + ymax) / 2.;
+
+  std::vector<double> angles(size);
+  std::vector<double> offsets(size);
+  for (size_t i = 0; i < size; i++) {
+    const Line &line = lines[i];
+    double angle = std::atan2(static_cast<double>(line.pt2.y - line.pt1.y),
+                              static_cast<double>(line.pt2.x - line.pt1.x));
+    if (angle < 0.) angle += pi;
+    if (angle >= pi) angle -= pi;
+    angles[i] = angle;
+    double mx = (line.pt1.x + line.pt2.x) / 2. - cx;
+    double my = (line.pt1.y + line.pt2.y) / 2. - cy;
+    offsets[i] = -std::sin(angle) * mx + std::cos(angle) * my;
+  }
+
+  // Rejilla ángulo-distancia. El ancho angular de celda nunca es menor que
+  // la tolerancia, por lo que dos líneas compatibles están en celdas vecinas.
+  int angle_buckets = static_cast<int>(pi / angleTolerance);
+  double angle_step = pi / angle_buckets;
+
+  std::unordered_map<int64_t, std::vector<size_t>> grid;
+  std::vector<int> angle_bucket(size);
+  for (size_t i = 0; i < size; i++) {
+    angle_bucket[i] = std::min(static_cast<int>(angles[i] / angle_step), angle_buckets - 1);
+    int64_t offset_bucket = static_cast<int64_t>(std::floor(offsets[i] / distanceTolerance));
+    grid[internal::lineBucketKey(angle_bucket[i], offset_bucket)].push_back(i);
+  }
+
+  auto collinear = [&](size_t i, size_t j) {
+    double angle = std::abs(angles[i] - angles[j]);
+    double offset = offsets[j];
+    // Al cruzar 0/π la normal cambia de sentido
+    if (angle > math::consts::half_pi<double>) {
+      angle = pi - angle;
+      offset = -offset;
+    }
+    return angle <= angleTolerance && std::abs(offsets[i] - offset) <= distanceTolerance;
+  };
+
+  std::vector<size_t> parent(size);
+  for (size_t i = 0; i < size; i++) parent[i] = i;
+
+  for (size_t i = 0; i < size; i++) {
+    for (int da = -1; da <= 1; da++) {
+      int bucket = angle_bucket[i] + da;
+      double offset = offsets[i];
+      if (bucket < 0 || bucket >= angle_buckets) {
+        bucket = (bucket + angle_buckets) % angle_buckets;
+        offset = -offset;
+      }
+      int64_t offset_bucket = static_cast<int64_t>(std::floor(offset / distanceTolerance));
+      for (int64_t db = -1; db <= 1; db++) {
+        auto it = grid.find(internal::lineBucketKey(bucket, offset_bucket + db));
+        if (it == grid.end()) continue;
+        for (size_t j : it->second) {
+          if (j <= i || !collinear(i, j)) continue;
+          size_t root_i = internal::findRoot(parent, i);
+          size_t root_j = internal::findRoot(parent, j);
+          if (root_i != root_j) parent[std::max(root_i, root_j)] = std::min(root_i, root_j);
+        }
+      }
+    }
+  }
+
+  std::vector<size_t> group_id(size, size);
+  for (size_t i = 0; i < size; i++) {
+    size_t root = internal::findRoot(parent, i);
+    if (group_id[root] == size) {
+      group_id[root] = groups.size();
+      groups.emplace_back();
+    }
+    groups[group_id[root]].add(lines[i]);
+  }
+
+  return groups;
+}
+
 } // End namespace tl
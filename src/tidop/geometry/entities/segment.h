@@ -694,6 +694,24 @@ public:
 
 };
 
+/*!
+ * \brief Agrupa líneas colineales
+ *
+ * Cada línea se describe por su dirección (ángulo en [0, π)) y por la
+ * distancia de su recta al centro del conjunto. Las líneas se indexan en una
+ * rejilla ángulo-distancia con celdas del tamaño de las tolerancias, de modo
+ * que sólo se comparan líneas de celdas vecinas en lugar de todos los pares.
+ * Dos líneas quedan en el mismo grupo si están unidas por una cadena de
+ * líneas dentro de las tolerancias.
+ * \param[in] lines Líneas
+ * \param[in] angleTolerance Tolerancia angular en radianes (menor que π/2)
+ * \param[in] distanceTolerance Tolerancia en la distancia entre rectas
+ * \return Grupos en el orden de su primera línea
+ */
+TL_EXPORT std::vector<GroupLines> groupCollinearLines(const std::vector<Line> &lines,
+                                                      double angleTolerance,
+                                                      double distanceTolerance);
+
 
 /*! \} */ // end of geometry
 
@@ -0,0 +1,717 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOMETRY_KDTREE_H
+#define TL_GEOMETRY_KDTREE_H
+
+#include "config_tl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/concurrency.h"
+#include "tidop/geometry/entities/point.h"
+
+namespace tl
+{
+
+/*! \addtogroup geometry
+ *  \{
+ */
+
+namespace internal
+{
+
+/*!
+ * \brief Acceso por dimensión a los puntos indexados por KDTree
+ */
+template<typename Point_t>
+struct KDTreePointTraits;
+
+template<typename T>
+struct KDTreePointTraits<Point<T>>
+{
+  using value_type = T;
+
+  static constexpr size_t dimensions = 2;
+
+  static double coordinate(const Point<T> &point, size_t dim)
+  {
+    return static_cast<double>(dim == 0 ? point.x : point.y);
+  }
+};
+
+template<typename T>
+struct KDTreePointTraits<Point3<T>>
+{
+  using value_type = T;
+
+  static constexpr size_t dimensions = 3;
+
+  static double coordinate(const Point3<T> &point, size_t dim)
+  {
+    return static_cast<double>(dim == 0 ? point.x : dim == 1 ? point.y : point.z);
+  }
+};
+
+/*!
+ * \brief Montículo de máximos con los k mejores candidatos (distancia², posición)
+ */
+class KDTreeNeighbors
+{
+
+public:
+
+  KDTreeNeighbors(size_t k, double maxDistance2)
+    : mK(k),
+      mMaxDistance2(maxDistance2)
+  {
+    mHeap.reserve(k);
+  }
+
+  bool full() const
+  {
+    return mHeap.size() == mK;
+  }
+
+  double worst() const
+  {
+    return full() ? mHeap.front().first : mMaxDistance2;
+  }
+
+  void push(double distance2, size_t position)
+  {
+    if (distance2 > mMaxDistance2) return;
+    if (!full()) {
+      mHeap.emplace_back(distance2, position);
+      std::push_heap(mHeap.begin(), mHeap.end());
+    } else if (distance2 < mHeap.front().first) {
+      std::pop_heap(mHeap.begin(), mHeap.end());
+      mHeap.back() = std::make_pair(distance2, position);
+      std::push_heap(mHeap.begin(), mHeap.end());
+    }
+  }
+
+  std::vector<std::pair<double, size_t>> &sorted()
+  {
+    std::sort_heap(mHeap.begin(), mHeap.end());
+    return mHeap;
+  }
+
+private:
+
+  size_t mK;
+  double mMaxDistance2;
+  std::vector<std::pair<double, size_t>> mHeap;
+};
+
+} // End namespace internal
+
+
+/*!
+ * \brief Árbol KD de sólo lectura para puntos 2D y 3D
+ *
+ * El árbol es implícito: no hay nodos ni punteros. Cada nodo es un rango de
+ * un único vector de posiciones cuyo elemento central es el pivote y las dos
+ * mitades son los hijos, de modo que la estructura completa ocupa la
+ * permutación de índices, las coordenadas copiadas en orden de árbol (en el
+ * tipo del punto, float o double) y la dimensión de corte de cada pivote. La
+ * dimensión de corte es la de mayor extensión del rango. Los rangos de hasta
+ * leafSize puntos son hojas y se recorren de forma lineal.
+ *
+ * La construcción reparte los subárboles entre hilos a partir de cierto
+ * número de puntos. Las consultas son de sólo lectura y pueden hacerse desde
+ * varios hilos; las consultas por lotes ya se reparten entre hilos.
+ *
+ * Por defecto la búsqueda de vecinos es exacta. Con setMaxChecks se pasa a
+ * modo aproximado: se exploran primero las hojas más prometedoras y la
+ * búsqueda se detiene tras comprobar el número de puntos indicado. Las
+ * búsquedas por radio son siempre exactas.
+ *
+ * Las consultas devuelven la posición del punto en el contenedor con el que
+ * se construyó el árbol.
+ *
+ * \code
+ * std::vector<Point3D> points;
+ * ...
+ * KDTree<Point3D> tree(points);
+ * std::vector<size_t> neighbors = tree.nearest(Point3D(x, y, z), 8);
+ * std::vector<size_t> near_points = tree.radiusSearch(Point3D(x, y, z), 2.5);
+ * \endcode
+ */
+template<typename Point_t>
+class KDTree
+{
+
+public:
+
+  using point_type = Point_t;
+  using value_type = typename internal::KDTreePointTraits<Point_t>::value_type;
+
+  static constexpr size_t dimensions = internal::KDTreePointTraits<Point_t>::dimensions;
+
+public:
+
+  /*!
+   * \brief Constructor por defecto. Árbol vacío
+   * \param[in] leafSize Número máximo de puntos por hoja
+   */
+  explicit KDTree(size_t leafSize = 10);
+
+  /*!
+   * \brief Construye el árbol a partir de un conjunto de puntos
+   * \param[in] points Puntos (std::vector, MultiPoint, ...)
+   * \param[in] leafSize Número máximo de puntos por hoja
+   */
+  template<typename Container_t>
+  explicit KDTree(const Container_t &points,
+                  size_t leafSize = 10);
+
+  ~KDTree() = default;
+
+  /*!
+   * \brief Construye (o reconstruye) el árbol
+   * \param[in] points Puntos (std::vector, MultiPoint, ...)
+   */
+  template<typename Container_t>
+  void build(const Container_t &points);
+
+  /*!
+   * \brief Número de puntos indexados
+   */
+  size_t size() const;
+  bool empty() const;
+
+  /*!
+   * \brief Número máximo de puntos comprobados en la búsqueda de vecinos
+   * Cero (valor por defecto) para búsqueda exacta
+   */
+  size_t maxChecks() const;
+  void setMaxChecks(size_t maxChecks);
+
+  /*!
+   * \brief Vecinos más próximos a un punto
+   * \param[in] point Punto
+   * \param[in] k Número de vecinos
+   * \param[in] maxDistance Distancia máxima de búsqueda
+   * \return Índices de los puntos ordenados de menor a mayor distancia
+   */
+  std::vector<size_t> nearest(const Point_t &point,
+                              size_t k = 1,
+                              double maxDistance = std::numeric_limits<double>::max()) const;
+
+  /*!
+   * \brief Vecinos más próximos a un punto
+   * \param[in] point Punto
+   * \param[in] k Número de vecinos
+   * \param[out] indices Índices de los puntos ordenados de menor a mayor distancia
+   * \param[out] distances Distancias (puede ser nulo)
+   * \param[in] maxDistance Distancia máxima de búsqueda
+   */
+  void nearest(const Point_t &point,
+               size_t k,
+               std::vector<size_t> *indices,
+               std::vector<double> *distances,
+               double maxDistance = std::numeric_limits<double>::max()) const;
+
+  /*!
+   * \brief Vecinos más próximos de un conjunto de puntos
+   * Las consultas se reparten entre hilos
+   * \param[in] points Puntos de consulta
+   * \param[in] k Número de vecinos
+   * \param[in] maxDistance Distancia máxima de búsqueda
+   * \return Índices de los vecinos de cada punto de consulta
+   */
+  std::vector<std::vector<size_t>> nearest(const std::vector<Point_t> &points,
+                                           size_t k = 1,
+                                           double maxDistance = std::numeric_limits<double>::max()) const;
+
+  /*!
+   * \brief Puntos a una distancia menor o igual que un radio
+   * \param[in] point Punto
+   * \param[in] radius Radio de búsqueda
+   * \return Índices de los puntos ordenados de menor a mayor distancia
+   */
+  std::vector<size_t> radiusSearch(const Point_t &point,
+                                   double radius) const;
+
+  /*!
+   * \brief Puntos a una distancia menor o igual que un radio
+   * \param[in] point Punto
+   * \param[in] radius Radio de búsqueda
+   * \param[out] indices Índices de los puntos ordenados de menor a mayor distancia
+   * \param[out] distances Distancias (puede ser nulo)
+   */
+  void radiusSearch(const Point_t &point,
+                    double radius,
+                    std::vector<size_t> *indices,
+                    std::vector<double> *distances) const;
+
+  /*!
+   * \brief Búsqueda por radio para un conjunto de puntos
+   * Las consultas se reparten entre hilos
+   * \param[in] points Puntos de consulta
+   * \param[in] radius Radio de búsqueda
+   * \return Índices de los puntos encontrados para cada punto de consulta
+   */
+  std::vector<std::vector<size_t>> radiusSearch(const std::vector<Point_t> &points,
+                                                double radius) const;
+
+private:
+
+  template<typename Container_t>
+  size_t split(const Container_t &points, size_t first, size_t last);
+
+  template<typename Container_t>
+  void buildRange(const Container_t &points, size_t first, size_t last);
+
+  double distance2(const double *query, size_t position) const;
+
+  /*!
+   * \brief Desciende por el lado más próximo hasta una hoja
+   * Los rangos del lado lejano se pasan a pending con su cota inferior de distancia²
+   * \return Número de puntos comprobados
+   */
+  template<typename Func>
+  size_t descend(const double *query,
+                 size_t first,
+                 size_t last,
+                 double bound,
+                 internal::KDTreeNeighbors &neighbors,
+                 Func pending) const;
+
+  void search(const double *query,
+              internal::KDTreeNeighbors &neighbors) const;
+
+  void query(const Point_t &point, double *query) const;
+
+private:
+
+  struct Range
+  {
+    double bound;
+    size_t first;
+    size_t last;
+
+    bool operator > (const Range &range) const
+    {
+      return bound > range.bound;
+    }
+  };
+
+  size_t mLeafSize;
+  size_t mSize;
+  size_t mMaxChecks;
+  /// Posición del punto en el contenedor original, en orden de árbol
+  std::vector<size_t> mIndices;
+  /// Coordenadas en orden de árbol
+  std::vector<value_type> mCoordinates;
+  /// Dimensión de corte de cada pivote
+  std::vector<unsigned char> mSplitDims;
+
+};
+
+
+/* Implementation */
+
+template<typename Point_t> inline
+KDTree<Point_t>::KDTree(size_t leafSize)
+  : mLeafSize(std::max<size_t>(1, leafSize)),
+    mSize(0),
+    mMaxChecks(0)
+{
+}
+
+template<typename Point_t> template<typename Container_t> inline
+KDTree<Point_t>::KDTree(const Container_t &points,
+                        size_t leafSize)
+  : mLeafSize(std::max<size_t>(1, leafSize)),
+    mSize(0),
+    mMaxChecks(0)
+{
+  build(points);
+}
+
+template<typename Point_t> template<typename Container_t> inline
+void KDTree<Point_t>::build(const Container_t &points)
+{
+  mSize = points.size();
+  mIndices.resize(mSize);
+  std::iota(mIndices.begin(), mIndices.end(), 0);
+  mSplitDims.assign(mSize, 0);
+
+  // Los niveles superiores se dividen en secuencial hasta tener suficientes
+  // subárboles independientes para repartir entre hilos
+  std::vector<std::pair<size_t, size_t>> ranges{std::make_pair(size_t{0}, mSize)};
+  size_t num_threads = optimalNumberOfThreads();
+  if (mSize >= 20000 && num_threads > 1) {
+    bool splitted = true;
+    while (splitted && ranges.size() < 4 * num_threads) {
+      splitted = false;
+      std::vector<std::pair<size_t, size_t>> next;
+      for (const auto &range : ranges) {
+        size_t mid = split(points, range.first, range.second);
+        if (mid == range.second) {
+          next.push_back(range);
+        } else {
+          next.emplace_back(range.first, mid);
+          next.emplace_back(mid + 1, range.second);
+          splitted = true;
+        }
+      }
+      ranges.swap(next);
+    }
+  }
+
+  parallel_for(0, ranges.size(), [&](size_t i) {
+    buildRange(points, ranges[i].first, ranges[i].second);
+  });
+
+  mCoordinates.resize(mSize * dimensions);
+  for (size_t i = 0; i < mSize; i++) {
+    for (size_t dim = 0; dim < dimensions; dim++) {
+      mCoordinates[i * dimensions + dim] = static_cast<value_type>(internal::KDTreePointTraits<Point_t>::coordinate(points[mIndices[i]], dim));
+    }
+  }
+}
+
+template<typename Point_t> template<typename Container_t> inline
+size_t KDTree<Point_t>::split(const Container_t &points, size_t first, size_t last)
+{
+  if (last - first <= mLeafSize) return last;
+
+  double min[dimensions];
+  double max[dimensions];
+  for (size_t dim = 0; dim < dimensions; dim++) {
+    min[dim] = std::numeric_limits<double>::max();
+    max[dim] = std::numeric_limits<double>::lowest();
+  }
+
+  for (size_t i = first; i < last; i++) {
+    for (size_t dim = 0; dim < dimensions; dim++) {
+      double coordinate = internal::KDTreePointTraits<Point_t>::coordinate(points[mIndices[i]], dim);
+      min[dim] = std::min(min[dim], coordinate);
+      max[dim] = std::max(max[dim], coordinate);
+    }
+  }
+
+  size_t split_dim = 0;
+  for (size_t dim = 1; dim < dimensions; dim++) {
+    if (max[dim] - min[dim] > max[split_dim] - min[split_dim]) split_dim = dim;
+  }
+
+  size_t mid = first + (last - first) / 2;
+  std::nth_element(mIndices.begin() + first, mIndices.begin() + mid, mIndices.begin() + last,
+                   [&](size_t index1, size_t index2) {
+                     return internal::KDTreePointTraits<Point_t>::coordinate(points[index1], split_dim) <
+                            internal::KDTreePointTraits<Point_t>::coordinate(points[index2], split_dim);
+                   });
+  mSplitDims[mid] = static_cast<unsigned char>(split_dim);
+
+  return mid;
+}
+
+template<typename Point_t> template<typename Container_t> inline
+void KDTree<Point_t>::buildRange(const Container_t &points, size_t first, size_t last)
+{
+  std::vector<std::pair<size_t, size_t>> stack{std::make_pair(first, last)};
+
+  while (!stack.empty()) {
+    std::pair<size_t, size_t> range = stack.back();
+    stack.pop_back();
+    size_t mid = split(points, range.first, range.second);
+    if (mid == range.second) continue;
+    stack.emplace_back(range.first, mid);
+    stack.emplace_back(mid + 1, range.second);
+  }
+}
+
+template<typename Point_t> inline
+size_t KDTree<Point_t>::size() const
+{
+  return mSize;
+}
+
+template<typename Point_t> inline
+bool KDTree<Point_t>::empty() const
+{
+  return mSize == 0;
+}
+
+template<typename Point_t> inline
+size_t KDTree<Point_t>::maxChecks() const
+{
+  return mMaxChecks;
+}
+
+template<typename Point_t> inline
+void KDTree<Point_t>::setMaxChecks(size_t maxChecks)
+{
+  mMaxChecks = maxChecks;
+}
+
+template<typename Point_t> inline
+double KDTree<Point_t>::distance2(const double *query, size_t position) const
+{
+  const value_type *coordinates = &mCoordinates[position * dimensions];
+  double distance2 = 0.;
+  for (size_t dim = 0; dim < dimensions; dim++) {
+    double diff = query[dim] - static_cast<double>(coordinates[dim]);
+    distance2 += diff * diff;
+  }
+  return distance2;
+}
+
+template<typename Point_t> inline
+void KDTree<Point_t>::query(const Point_t &point, double *query) const
+{
+  for (size_t dim = 0; dim < dimensions; dim++) {
+    query[dim] = internal::KDTreePointTraits<Point_t>::coordinate(point, dim);
+  }
+}
+
+template<typename Point_t> template<typename Func> inline
+size_t KDTree<Point_t>::descend(const double *query,
+                                size_t first,
+                                size_t last,
+                                double bound,
+                                internal::KDTreeNeighbors &neighbors,
+                                Func pending) const
+{
+  size_t checks = 0;
+
+  while (last - first > mLeafSize) {
+    size_t mid = first + (last - first) / 2;
+    size_t dim = mSplitDims[mid];
+    double diff = query[dim] - static_cast<double>(mCoordinates[mid * dimensions + dim]);
+
+    neighbors.push(distance2(query, mid), mid);
+    checks++;
+
+    double far_bound = std::max(bound, diff * diff);
+    if (diff < 0.) {
+      if (far_bound <= neighbors.worst()) pending(far_bound, mid + 1, last);
+      last = mid;
+    } else {
+      if (far_bound <= neighbors.worst()) pending(far_bound, first, mid);
+      first = mid + 1;
+    }
+  }
+
+  for (size_t i = first; i < last; i++) {
+    neighbors.push(distance2(query, i), i);
+  }
+
+  return checks + last - first;
+}
+
+template<typename Point_t> inline
+void KDTree<Point_t>::search(const double *query,
+                             internal::KDTreeNeighbors &neighbors) const
+{
+  if (mSize == 0) return;
+
+  if (mMaxChecks == 0) {
+
+    // Búsqueda exacta en profundidad, primero el lado más próximo
+    std::vector<Range> stack;
+    stack.push_back({0., 0, mSize});
+    while (!stack.empty()) {
+      Range range = stack.back();
+      stack.pop_back();
+      if (range.bound > neighbors.worst()) continue;
+      descend(query, range.first, range.last, range.bound, neighbors,
+              [&stack](double bound, size_t first, size_t last) {
+                stack.push_back({bound, first, last});
+              });
+    }
+
+  } else {
+
+    // Best-bin-first limitado en número de puntos comprobados
+    std::priority_queue<Range, std::vector<Range>, std::greater<Range>> queue;
+    queue.push({0., 0, mSize});
+    size_t checks = 0;
+    while (!queue.empty()) {
+      Range range = queue.top();
+      queue.pop();
+      if (range.bound > neighbors.worst()) break;
+      if (checks >= mMaxChecks && neighbors.full()) break;
+      checks += descend(query, range.first, range.last, range.bound, neighbors,
+                        [&queue](double bound, size_t first, size_t last) {
+                          queue.push({bound, first, last});
+                        });
+    }
+
+  }
+}
+
+template<typename Point_t> inline
+std::vector<size_t> KDTree<Point_t>::nearest(const Point_t &point,
+                                             size_t k,
+                                             double maxDistance) const
+{
+  std::vector<size_t> indices;
+  nearest(point, k, &indices, nullptr, maxDistance);
+  return indices;
+}
+
+template<typename Point_t> inline
+void KDTree<Point_t>::nearest(const Point_t &point,
+                              size_t k,
+                              std::vector<size_t> *indices,
+                              std::vector<double> *distances,
+                              double maxDistance) const
+{
+  indices->clear();
+  if (distances) distances->clear();
+
+  if (mSize == 0 || k == 0) return;
+
+  double max_distance2 = maxDistance < std::sqrt(std::numeric_limits<double>::max()) ?
+                         maxDistance * maxDistance : std::numeric_limits<double>::max();
+
+  double query_point[dimensions];
+  query(point, query_point);
+
+  internal::KDTreeNeighbors neighbors(std::min(k, mSize), max_distance2);
+  search(query_point, neighbors);
+
+  for (const auto &neighbor : neighbors.sorted()) {
+    indices->push_back(mIndices[neighbor.second]);
+    if (distances) distances->push_back(std::sqrt(neighbor.first));
+  }
+}
+
+template<typename Point_t> inline
+std::vector<std::vector<size_t>> KDTree<Point_t>::nearest(const std::vector<Point_t> &points,
+                                                          size_t k,
+                                                          double maxDistance) const
+{
+  std::vector<std::vector<size_t>> indices(points.size());
+
+  auto query_point = [&](size_t i) {
+    nearest(points[i], k, &indices[i], nullptr, maxDistance);
+  };
+
+  if (points.size() < 1000) {
+    for (size_t i = 0; i < points.size(); i++) query_point(i);
+  } else {
+    parallel_for(0, points.size(), query_point);
+  }
+
+  return indices;
+}
+
+template<typename Point_t> inline
+std::vector<size_t> KDTree<Point_t>::radiusSearch(const Point_t &point,
+                                                  double radius) const
+{
+  std::vector<size_t> indices;
+  radiusSearch(point, radius, &indices, nullptr);
+  return indices;
+}
+
+template<typename Point_t> inline
+void KDTree<Point_t>::radiusSearch(const Point_t &point,
+                                   double radius,
+                                   std::vector<size_t> *indices,
+                                   std::vector<double> *distances) const
+{
+  indices->clear();
+  if (distances) distances->clear();
+
+  if (mSize == 0 || radius < 0.) return;
+
+  double radius2 = radius * radius;
+  double query_point[dimensions];
+  query(point, query_point);
+
+  std::vector<std::pair<double, size_t>> found;
+  std::vector<std::pair<size_t, size_t>> stack{std::make_pair(size_t{0}, mSize)};
+
+  while (!stack.empty()) {
+    size_t first = stack.back().first;
+    size_t last = stack.back().second;
+    stack.pop_back();
+
+    if (last - first <= mLeafSize) {
+      for (size_t i = first; i < last; i++) {
+        double d2 = distance2(query_point, i);
+        if (d2 <= radius2) found.emplace_back(d2, i);
+      }
+      continue;
+    }
+
+    size_t mid = first + (last - first) / 2;
+    size_t dim = mSplitDims[mid];
+    double diff = query_point[dim] - static_cast<double>(mCoordinates[mid * dimensions + dim]);
+
+    double d2 = distance2(query_point, mid);
+    if (d2 <= radius2) found.emplace_back(d2, mid);
+
+    if (diff <= 0. || diff * diff <= radius2) stack.emplace_back(first, mid);
+    if (diff >= 0. || diff * diff <= radius2) stack.emplace_back(mid + 1, last);
+  }
+
+  std::sort(found.begin(), found.end());
+
+  indices->reserve(found.size());
+  for (const auto &item : found) {
+    indices->push_back(mIndices[item.second]);
+    if (distances) distances->push_back(std::sqrt(item.first));
+  }
+}
+
+template<typename Point_t> inline
+std::vector<std::vector<size_t>> KDTree<Point_t>::radiusSearch(const std::vector<Point_t> &points,
+                                                               double radius) const
+{
+  std::vector<std::vector<size_t>> indices(points.size());
+
+  auto query_point = [&](size_t i) {
+    radiusSearch(points[i], radius, &indices[i], nullptr);
+  };
+
+  if (points.size() < 1000) {
+    for (size_t i = 0; i < points.size(); i++) query_point(i);
+  } else {
+    parallel_for(0, points.size(), query_point);
+  }
+
+  return indices;
+}
+
+/*! \} */ // end of geometry
+
+} // End namespace tl
+
+#endif // TL_GEOMETRY_KDTREE_H
@@ -0,0 +1,869 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOMETRY_PREPARED_POLYGON_H
+#define TL_GEOMETRY_PREPARED_POLYGON_H
+
+#include "config_tl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/concurrency.h"
+#include "tidop/geometry/entities/polygon.h"
+#include "tidop/geometry/entities/window.h"
+#include "tidop/geometry/rtree.h"
+
+namespace tl
+{
+
+/*! \addtogroup geometry
+ *  \{
+ */
+
+namespace internal
+{
+
+/*!
+ * \brief Arista de un anillo de un polígono
+ * Se guarda la pendiente dx/dy para evitar divisiones en los test de
+ * inclusión y en el barrido.
+ */
+struct PolygonEdge
+{
+  double x1;
+  double y1;
+  double x2;
+  double y2;
+  double dxdy;
+
+  PolygonEdge(double _x1, double _y1, double _x2, double _y2)
+    : x1(_x1), y1(_y1), x2(_x2), y2(_y2),
+      dxdy(_y1 != _y2 ? (_x2 - _x1) / (_y2 - _y1) : 0.)
+  {
+  }
+
+  double ymin() const { return std::min(y1, y2); }
+  double ymax() const { return std::max(y1, y2); }
+
+  double x(double y) const
+  {
+    return x1 + (y - y1) * dxdy;
+  }
+};
+
+template<typename Ring_t> inline
+void appendRingEdges(const Ring_t &ring, std::vector<PolygonEdge> *edges)
+{
+  size_t size = ring.size();
+  if (size < 2) return;
+
+  for (size_t i = 0, j = size - 1; i < size; j = i++) {
+    double x1 = static_cast<double>(ring[j].x);
+    double y1 = static_cast<double>(ring[j].y);
+    double x2 = static_cast<double>(ring[i].x);
+    double y2 = static_cast<double>(ring[i].y);
+    // Anillos cerrados con el último punto repetido
+    if (x1 == x2 && y1 == y2) continue;
+    edges->emplace_back(x1, y1, x2, y2);
+  }
+}
+
+template<typename Ring_t> inline
+double ringArea(const Ring_t &ring)
+{
+  double area = 0.;
+  for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+    area += static_cast<double>(ring[j].x) * static_cast<double>(ring[i].y) -
+            static_cast<double>(ring[i].x) * static_cast<double>(ring[j].y);
+  }
+  return std::abs(area / 2.);
+}
+
+template<typename Point_t> inline
+std::vector<PolygonEdge> polygonEdges(const Polygon<Point_t> &polygon)
+{
+  std::vector<PolygonEdge> edges;
+  edges.reserve(polygon.size());
+  appendRingEdges(polygon, &edges);
+  for (size_t i = 0; i < polygon.holes(); i++) {
+    appendRingEdges(polygon.hole(i), &edges);
+  }
+  return edges;
+}
+
+/*!
+ * \brief Longitud de la intersección de dos conjuntos de intervalos ordenados
+ * Los intervalos se dan como pares consecutivos de abscisas (regla par-impar).
+ */
+inline double intervalsOverlap(const std::vector<double> &a,
+                               const std::vector<double> &b)
+{
+  double length = 0.;
+  size_t i = 0;
+  size_t j = 0;
+  while (i + 1 < a.size() && j + 1 < b.size()) {
+    double lo = std::max(a[i], b[j]);
+    double hi = std::min(a[i + 1], b[j + 1]);
+    if (hi > lo) length += hi - lo;
+    if (a[i + 1] < b[j + 1]) i += 2;
+    else j += 2;
+  }
+  return length;
+}
+
+/*!
+ * \brief Área de la intersección de dos conjuntos de aristas mediante barrido en y
+ *
+ * Los eventos del barrido son las ordenadas de los vértices. Dentro de cada
+ * franja se mantiene la lista de aristas activas de cada polígono y se
+ * añaden como eventos los cruces entre aristas de ambos polígonos. Entre dos
+ * eventos consecutivos la longitud de la sección común varía linealmente,
+ * por lo que la evaluación en la ordenada media es exacta.
+ * \param[in] edges1 Aristas del primer polígono (anillo exterior y huecos)
+ * \param[in] edges2 Aristas del segundo polígono (anillo exterior y huecos)
+ * \param[in] stopOnOverlap Termina en cuanto se encuentra área común
+ * \return Área de la intersección
+ */
+inline double sweepIntersectionArea(const std::vector<PolygonEdge> &edges1,
+                                    const std::vector<PolygonEdge> &edges2,
+                                    bool stopOnOverlap = false)
+{
+  if (edges1.empty() || edges2.empty()) return 0.;
+
+  // Aristas no horizontales de ambos polígonos ordenadas por su ymin
+  std::vector<std::pair<const PolygonEdge *, int>> edges;
+  edges.reserve(edges1.size() + edges2.size());
+  for (const auto &edge : edges1)
+    if (edge.y1 != edge.y2) edges.emplace_back(&edge, 0);
+  for (const auto &edge : edges2)
+    if (edge.y1 != edge.y2) edges.emplace_back(&edge, 1);
+
+  std::sort(edges.begin(), edges.end(), [](const std::pair<const PolygonEdge *, int> &e1,
+                                           const std::pair<const PolygonEdge *, int> &e2) {
+    return e1.first->ymin() < e2.first->ymin();
+  });
+
+  std::vector<double> events;
+  events.reserve(edges.size() * 2);
+  for (const auto &edge : edges) {
+    events.push_back(edge.first->y1);
+    events.push_back(edge.first->y2);
+  }
+  std::sort(events.begin(), events.end());
+  events.erase(std::unique(events.begin(), events.end()), events.end());
+
+  std::vector<const PolygonEdge *> active[2];
+  std::vector<double> cuts;
+  std::vector<double> sections[2];
+  size_t next = 0;
+  double area = 0.;
+
+  for (size_t k = 0; k + 1 < events.size(); k++) {
+
+    double y_bottom = events[k];
+    double y_top = events[k + 1];
+
+    for (auto &list : active) {
+      list.erase(std::remove_if(list.begin(), list.end(), [y_bottom](const PolygonEdge *edge) {
+        return edge->ymax() <= y_bottom;
+      }), list.end());
+    }
+
+    while (next < edges.size() && edges[next].first->ymin() <= y_bottom) {
+      if (edges[next].first->ymax() > y_bottom)
+        active[edges[next].second].push_back(edges[next].first);
+      next++;
+    }
+
+    if (active[0].empty() || active[1].empty()) continue;
+
+    // Cruces entre aristas de ambos polígonos dentro de la franja
+    cuts.clear();
+    cuts.push_back(y_bottom);
+    cuts.push_back(y_top);
+    for (const PolygonEdge *edge1 : active[0]) {
+      double x1_bottom = edge1->x(y_bottom);
+      double x1_top = edge1->x(y_top);
+      for (const PolygonEdge *edge2 : active[1]) {
+        double d_bottom = x1_bottom - edge2->x(y_bottom);
+        double d_top = x1_top - edge2->x(y_top);
+        if ((d_bottom < 0. && d_top > 0.) || (d_bottom > 0. && d_top < 0.)) {
+          cuts.push_back(y_bottom + (y_top - y_bottom) * d_bottom / (d_bottom - d_top));
+        }
+      }
+    }
+    std::sort(cuts.begin(), cuts.end());
+
+    for (size_t c = 0; c + 1 < cuts.size(); c++) {
+      double height = cuts[c + 1] - cuts[c];
+      if (height <= 0.) continue;
+      double y = (cuts[c] + cuts[c + 1]) / 2.;
+
+      for (int p = 0; p < 2; p++) {
+        sections[p].clear();
+        for (const PolygonEdge *edge : active[p]) {
+          sections[p].push_back(edge->x(y));
+        }
+        std::sort(sections[p].begin(), sections[p].end());
+      }
+
+      area += intervalsOverlap(sections[0], sections[1]) * height;
+    }
+
+    if (stopOnOverlap && area > 0.) return area;
+  }
+
+  return area;
+}
+
+} // namespace internal
+
+
+/*!
+ * \brief Polígono preparado para consultas de inclusión masivas
+ *
+ * Las aristas del anillo exterior y de los huecos se reparten en franjas
+ * horizontales de igual altura. Un punto sólo se compara con las aristas de
+ * la franja que le corresponde, con lo que el coste de la consulta deja de
+ * depender del número total de vértices.
+ *
+ * Los puntos situados sobre el contorno se consideran interiores, igual que
+ * en Polygon::isInner.
+ *
+ * \code
+ * PolygonD footprint;
+ * ...
+ * PreparedPolygonD prepared(footprint);
+ * std::vector<bool> inside = prepared.contains(points);
+ * \endcode
+ */
+template<typename Point_t>
+class PreparedPolygon
+{
+
+public:
+
+  using point_type = Point_t;
+
+public:
+
+  /*!
+   * \brief Constructora por defecto
+   */
+  PreparedPolygon();
+
+  /*!
+   * \brief Constructora
+   * \param[in] polygon Polígono
+   * \param[in] buckets Número de franjas. Por defecto una por arista
+   */
+  explicit PreparedPolygon(const Polygon<Point_t> &polygon,
+                           size_t buckets = 0);
+
+  /*!
+   * \brief Constructora
+   * \param[in] multiPolygon Multipolígono. Los polígonos no deben solaparse
+   * \param[in] buckets Número de franjas. Por defecto una por arista
+   */
+  explicit PreparedPolygon(const MultiPolygon<Point_t> &multiPolygon,
+                           size_t buckets = 0);
+
+  ~PreparedPolygon() = default;
+
+  /*!
+   * \brief Prepara un polígono
+   * \param[in] polygon Polígono
+   * \param[in] buckets Número de franjas. Por defecto una por arista
+   */
+  void prepare(const Polygon<Point_t> &polygon,
+               size_t buckets = 0);
+
+  /*!
+   * \brief Prepara un multipolígono
+   * \param[in] multiPolygon Multipolígono. Los polígonos no deben solaparse
+   * \param[in] buckets Número de franjas. Por defecto una por arista
+   */
+  void prepare(const MultiPolygon<Point_t> &multiPolygon,
+               size_t buckets = 0);
+
+  /*!
+   * \brief Comprueba si un punto esta dentro del poligono
+   * \param[in] point Punto
+   */
+  bool contains(const Point_t &point) const;
+
+  /*!
+   * \brief Comprueba si un conjunto de puntos esta dentro del poligono
+   * Los puntos se agrupan por franja y cada franja se evalúa con un bucle
+   * sin saltos sobre los puntos para que el compilador pueda vectorizarlo.
+   * Las franjas se procesan en paralelo cuando hay suficientes puntos.
+   * \param[in] points Puntos
+   * \return Vector con el resultado para cada punto
+   */
+  std::vector<bool> contains(const std::vector<Point_t> &points) const;
+
+  /*!
+   * \brief Área de la intersección con otro polígono preparado
+   */
+  double intersectionArea(const PreparedPolygon<Point_t> &polygon) const;
+
+  /*!
+   * \brief Comprueba si el área de la intersección con otro polígono es no nula
+   * Los polígonos que sólo se tocan en el contorno no se solapan.
+   */
+  bool overlaps(const PreparedPolygon<Point_t> &polygon) const;
+
+  /*!
+   * \brief Área del polígono descontando los huecos
+   */
+  double area() const;
+
+  /*!
+   * \brief Ventana envolvente
+   */
+  Window<Point_t> window() const;
+
+  /*!
+   * \brief Número de aristas (anillo exterior y huecos)
+   */
+  size_t edges() const;
+
+  bool empty() const;
+
+private:
+
+  void buildBuckets(size_t buckets);
+
+  size_t bucket(double y) const;
+
+  void containsBucket(size_t bucket,
+                      const std::vector<size_t> &order,
+                      size_t first,
+                      size_t last,
+                      const std::vector<Point_t> &points,
+                      std::vector<uint8_t> *result) const;
+
+private:
+
+  std::vector<internal::PolygonEdge> mEdges;
+  Window<Point_t> mWindow;
+  double mArea;
+  double mMinY;
+  double mBucketHeight;
+  /*!
+   * \brief Aristas agrupadas por franja. Las aristas de la franja i son
+   * mBucketEdges[mBucketOffsets[i]] ... mBucketEdges[mBucketOffsets[i+1]-1]
+   */
+  std::vector<size_t> mBucketOffsets;
+  std::vector<internal::PolygonEdge> mBucketEdges;
+
+};
+
+template<typename Point_t> inline
+PreparedPolygon<Point_t>::PreparedPolygon()
+  : mArea(0.),
+    mMinY(0.),
+    mBucketHeight(0.)
+{
+}
+
+template<typename Point_t> inline
+PreparedPolygon<Point_t>::PreparedPolygon(const Polygon<Point_t> &polygon,
+                                          size_t buckets)
+  : mArea(0.),
+    mMinY(0.),
+    mBucketHeight(0.)
+{
+  prepare(polygon, buckets);
+}
+
+template<typename Point_t> inline
+PreparedPolygon<Point_t>::PreparedPolygon(const MultiPolygon<Point_t> &multiPolygon,
+                                          size_t buckets)
+  : mArea(0.),
+    mMinY(0.),
+    mBucketHeight(0.)
+{
+  prepare(multiPolygon, buckets);
+}
+
+template<typename Point_t> inline
+void PreparedPolygon<Point_t>::prepare(const Polygon<Point_t> &polygon,
+                                       size_t buckets)
+{
+  mEdges = internal::polygonEdges(polygon);
+  mWindow = polygon.window();
+
+  mArea = internal::ringArea(polygon);
+  for (size_t i = 0; i < polygon.holes(); i++) {
+    mArea -= internal::ringArea(polygon.hole(i));
+  }
+
+  buildBuckets(buckets);
+}
+
+template<typename Point_t> inline
+void PreparedPolygon<Point_t>::prepare(const MultiPolygon<Point_t> &multiPolygon,
+                                       size_t buckets)
+{
+  mEdges.clear();
+  mWindow = multiPolygon.window();
+  mArea = 0.;
+
+  for (size_t i = 0; i < multiPolygon.size(); i++) {
+    const Polygon<Point_t> &polygon = multiPolygon[i];
+    std::vector<internal::PolygonEdge> edges = internal::polygonEdges(polygon);
+    mEdges.insert(mEdges.end(), edges.begin(), edges.end());
+    mArea += internal::ringArea(polygon);
+    for (size_t j = 0; j < polygon.holes(); j++) {
+      mArea -= internal::ringArea(polygon.hole(j));
+    }
+  }
+
+  buildBuckets(buckets);
+}
+
+template<typename Point_t> inline
+void PreparedPolygon<Point_t>::buildBuckets(size_t buckets)
+{
+  mBucketOffsets.clear();
+  mBucketEdges.clear();
+
+  if (mEdges.empty()) return;
+
+  if (buckets == 0) buckets = mEdges.size();
+  mMinY = static_cast<double>(mWindow.pt1.y);
+  double height = static_cast<double>(mWindow.pt2.y) - mMinY;
+  if (height <= 0.) buckets = 1;
+  mBucketHeight = height / static_cast<double>(buckets);
+
+  // Reparto de las aristas en franjas en dos pasadas (recuento y volcado)
+  mBucketOffsets.assign(buckets + 1, 0);
+  for (const auto &edge : mEdges) {
+    for (size_t b = bucket(edge.ymin()), last = bucket(edge.ymax()); b <= last; b++)
+      mBucketOffsets[b + 1]++;
+  }
+
+  for (size_t b = 0; b < buckets; b++)
+    mBucketOffsets[b + 1] += mBucketOffsets[b];
+
+  std::vector<size_t> position(mBucketOffsets.begin(), mBucketOffsets.end() - 1);
+  mBucketEdges.resize(mBucketOffsets.back(), mEdges.front());
+  for (const auto &edge : mEdges) {
+    for (size_t b = bucket(edge.ymin()), last = bucket(edge.ymax()); b <= last; b++)
+      mBucketEdges[position[b]++] = edge;
+  }
+}
+
+template<typename Point_t> inline
+size_t PreparedPolygon<Point_t>::bucket(double y) const
+{
+  size_t buckets = mBucketOffsets.size() - 1;
+  if (buckets <= 1 || mBucketHeight <= 0.) return 0;
+
+  double b = std::floor((y - mMinY) / mBucketHeight);
+  if (b <= 0.) return 0;
+  if (b >= static_cast<double>(buckets)) return buckets - 1;
+  return static_cast<size_t>(b);
+}
+
+template<typename Point_t> inline
+bool PreparedPolygon<Point_t>::contains(const Point_t &point) const
+{
+  if (mEdges.empty() || !mWindow.containsPoint(point)) return false;
+
+  double x = static_cast<double>(point.x);
+  double y = static_cast<double>(point.y);
+
+  size_t b = bucket(y);
+  bool inside = false;
+
+  for (size_t i = mBucketOffsets[b]; i < mBucketOffsets[b + 1]; i++) {
+    const internal::PolygonEdge &edge = mBucketEdges[i];
+
+    if (y < edge.ymin() || y > edge.ymax()) continue;
+
+    // Punto sobre el contorno
+    double cross = (edge.x2 - edge.x1) * (y - edge.y1) - (edge.y2 - edge.y1) * (x - edge.x1);
+    if (cross == 0. &&
+        x >= std::min(edge.x1, edge.x2) &&
+        x <= std::max(edge.x1, edge.x2)) return true;
+
+    if ((edge.y1 > y) != (edge.y2 > y) && x < edge.x(y))
+      inside = !inside;
+  }
+
+  return inside;
+}
+
+template<typename Point_t> inline
+std::vector<bool> PreparedPolygon<Point_t>::contains(const std::vector<Point_t> &points) const
+{
+  std::vector<bool> inside(points.size(), false);
+  if (mEdges.empty() || points.empty()) return inside;
+
+  size_t buckets = mBucketOffsets.size() - 1;
+
+  // Ordenación de los puntos interiores a la ventana por franja (counting sort)
+  std::vector<size_t> offsets(buckets + 1, 0);
+  std::vector<size_t> point_bucket(points.size(), buckets);
+  for (size_t i = 0; i < points.size(); i++) {
+    if (!mWindow.containsPoint(points[i])) continue;
+    point_bucket[i] = bucket(static_cast<double>(points[i].y));
+    offsets[point_bucket[i] + 1]++;
+  }
+
+  for (size_t b = 0; b < buckets; b++)
+    offsets[b + 1] += offsets[b];
+
+  std::vector<size_t> order(offsets.back());
+  std::vector<size_t> position(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < points.size(); i++) {
+    if (point_bucket[i] < buckets)
+      order[position[point_bucket[i]]++] = i;
+  }
+
+  std::vector<uint8_t> result(points.size(), 0);
+
+  if (order.size() < 10000) {
+    for (size_t b = 0; b < buckets; b++) {
+      containsBucket(b, order, offsets[b], offsets[b + 1], points, &result);
+    }
+  } else {
+    // Cada franja escribe en posiciones distintas de result
+    size_t chunks = std::min(buckets, static_cast<size_t>(optimalNumberOfThreads()) * 4);
+    parallel_for(0, chunks, [&](size_t chunk) {
+      for (size_t b = chunk; b < buckets; b += chunks) {
+        containsBucket(b, order, offsets[b], offsets[b + 1], points, &result);
+      }
+    });
+  }
+
+  for (size_t i = 0; i < points.size(); i++) {
+    inside[i] = result[i] != 0;
+  }
+
+  return inside;
+}
+
+template<typename Point_t> inline
+void PreparedPolygon<Point_t>::containsBucket(size_t bucket,
+                                              const std::vector<size_t> &order,
+                                              size_t first,
+                                              size_t last,
+                                              const std::vector<Point_t> &points,
+                                              std::vector<uint8_t> *result) const
+{
+  size_t size = last - first;
+  if (size == 0) return;
+
+  std::vector<double> xs(size);
+  std::vector<double> ys(size);
+  std::vector<uint8_t> inside(size, 0);
+  std::vector<uint8_t> boundary(size, 0);
+
+  for (size_t j = 0; j < size; j++) {
+    const Point_t &point = points[order[first + j]];
+    xs[j] = static_cast<double>(point.x);
+    ys[j] = static_cast<double>(point.y);
+  }
+
+  const double *x = xs.data();
+  const double *y = ys.data();
+  uint8_t *in = inside.data();
+  uint8_t *on = boundary.data();
+
+  for (size_t i = mBucketOffsets[bucket]; i < mBucketOffsets[bucket + 1]; i++) {
+
+    const internal::PolygonEdge edge = mBucketEdges[i];
+    const double dx = edge.x2 - edge.x1;
+    const double dy = edge.y2 - edge.y1;
+    const double xmin = std::min(edge.x1, edge.x2);
+    const double xmax = std::max(edge.x1, edge.x2);
+    const double ymin = std::min(edge.y1, edge.y2);
+    const double ymax = std::max(edge.y1, edge.y2);
+
+    // Bucle sin saltos sobre los puntos de la franja
+    for (size_t j = 0; j < size; j++) {
+      bool crosses = (edge.y1 > y[j]) != (edge.y2 > y[j]);
+      bool left = x[j] < edge.x1 + (y[j] - edge.y1) * edge.dxdy;
+      in[j] ^= static_cast<uint8_t>(crosses & left);
+
+      bool collinear = dx * (y[j] - edge.y1) - dy * (x[j] - edge.x1) == 0.;
+      bool within = (x[j] >= xmin) & (x[j] <= xmax) & (y[j] >= ymin) & (y[j] <= ymax);
+      on[j] |= static_cast<uint8_t>(collinear & within);
+    }
+  }
+
+  for (size_t j = 0; j < size; j++) {
+    (*result)[order[first + j]] = in[j] | on[j];
+  }
+}
+
+template<typename Point_t> inline
+double PreparedPolygon<Point_t>::intersectionArea(const PreparedPolygon<Point_t> &polygon) const
+{
+  if (empty() || polygon.empty()) return 0.;
+  if (!intersectWindows(mWindow, polygon.mWindow)) return 0.;
+  return internal::sweepIntersectionArea(mEdges, polygon.mEdges);
+}
+
+template<typename Point_t> inline
+bool PreparedPolygon<Point_t>::overlaps(const PreparedPolygon<Point_t> &polygon) const
+{
+  if (empty() || polygon.empty()) return false;
+  if (!intersectWindows(mWindow, polygon.mWindow)) return false;
+  return internal::sweepIntersectionArea(mEdges, polygon.mEdges, true) > 0.;
+}
+
+template<typename Point_t> inline
+double PreparedPolygon<Point_t>::area() const
+{
+  return mArea;
+}
+
+template<typename Point_t> inline
+Window<Point_t> PreparedPolygon<Point_t>::window() const
+{
+  return mWindow;
+}
+
+template<typename Point_t> inline
+size_t PreparedPolygon<Point_t>::edges() const
+{
+  return mEdges.size();
+}
+
+template<typename Point_t> inline
+bool PreparedPolygon<Point_t>::empty() const
+{
+  return mEdges.empty();
+}
+
+
+using PreparedPolygonI = PreparedPolygon<Point<int>>;
+using PreparedPolygonD = PreparedPolygon<Point<double>>;
+using PreparedPolygonF = PreparedPolygon<Point<float>>;
+
+
+/*!
+ * \brief Área de la intersección de dos polígonos
+ * Se calcula mediante un barrido de las aristas de ambos polígonos (incluidos
+ * los huecos). Los polígonos tienen que ser simples.
+ * \param[in] polygon1 Primer polígono
+ * \param[in] polygon2 Segundo polígono
+ * \return Área común
+ */
+template<typename Point_t> inline
+double intersectionArea(const Polygon<Point_t> &polygon1,
+                        const Polygon<Point_t> &polygon2)
+{
+  if (!intersectWindows(polygon1.window(), polygon2.window())) return 0.;
+  return internal::sweepIntersectionArea(internal::polygonEdges(polygon1),
+                                         internal::polygonEdges(polygon2));
+}
+
+/*!
+ * \brief Comprueba si dos polígonos se solapan
+ * Los polígonos que sólo se tocan en el contorno no se solapan.
+ */
+template<typename Point_t> inline
+bool overlaps(const Polygon<Point_t> &polygon1,
+              const Polygon<Point_t> &polygon2)
+{
+  if (!intersectWindows(polygon1.window(), polygon2.window())) return false;
+  return internal::sweepIntersectionArea(internal::polygonEdges(polygon1),
+                                         internal::polygonEdges(polygon2), true) > 0.;
+}
+
+
+/*!
+ * \brief Conjunto de polígonos preparados indexados mediante un R-tree
+ *
+ * Pensado para contrastar muchos puntos o teselas contra miles de huellas.
+ * \code
+ * std::vector<PolygonD> footprints;
+ * ...
+ * PreparedPolygonSet<PointD> index(footprints);
+ * std::vector<int> owner = index.locate(points);
+ * \endcode
+ */
+template<typename Point_t>
+class PreparedPolygonSet
+{
+
+public:
+
+  PreparedPolygonSet();
+  explicit PreparedPolygonSet(const std::vector<Polygon<Point_t>> &polygons);
+  ~PreparedPolygonSet() = default;
+
+  void build(const std::vector<Polygon<Point_t>> &polygons);
+
+  size_t size() const;
+  bool empty() const;
+
+  const PreparedPolygon<Point_t> &polygon(size_t id) const;
+
+  /*!
+   * \brief Polígonos que contienen un punto
+   * \param[in] point Punto
+   * \return Índices de los polígonos
+   */
+  std::vector<size_t> search(const Point_t &point) const;
+
+  /*!
+   * \brief Polígono que contiene cada punto
+   * Si un punto está en varios polígonos se devuelve el de menor índice.
+   * \param[in] points Puntos
+   * \return Índice del polígono para cada punto o -1 si no está en ninguno
+   */
+  std::vector<int> locate(const std::vector<Point_t> &points) const;
+
+  /*!
+   * \brief Polígonos que se solapan con un polígono
+   * \param[in] polygon Polígono (por ejemplo la huella de una tesela)
+   * \return Pares índice del polígono y área común
+   */
+  std::vector<std::pair<size_t, double>> overlapping(const Polygon<Point_t> &polygon) const;
+
+private:
+
+  std::vector<PreparedPolygon<Point_t>> mPolygons;
+  RTree<Window<Point_t>> mRTree;
+
+};
+
+template<typename Point_t> inline
+PreparedPolygonSet<Point_t>::PreparedPolygonSet()
+{
+}
+
+template<typename Point_t> inline
+PreparedPolygonSet<Point_t>::PreparedPolygonSet(const std::vector<Polygon<Point_t>> &polygons)
+{
+  build(polygons);
+}
+
+template<typename Point_t> inline
+void PreparedPolygonSet<Point_t>::build(const std::vector<Polygon<Point_t>> &polygons)
+{
+  mPolygons.clear();
+  mPolygons.resize(polygons.size());
+
+  parallel_for(0, polygons.size(), [&](size_t i) {
+    mPolygons[i].prepare(polygons[i]);
+  });
+
+  mRTree = createRTree(polygons);
+}
+
+template<typename Point_t> inline
+size_t PreparedPolygonSet<Point_t>::size() const
+{
+  return mPolygons.size();
+}
+
+template<typename Point_t> inline
+bool PreparedPolygonSet<Point_t>::empty() const
+{
+  return mPolygons.empty();
+}
+
+template<typename Point_t> inline
+const PreparedPolygon<Point_t> &PreparedPolygonSet<Point_t>::polygon(size_t id) const
+{
+  return mPolygons.at(id);
+}
+
+template<typename Point_t> inline
+std::vector<size_t> PreparedPolygonSet<Point_t>::search(const Point_t &point) const
+{
+  std::vector<size_t> ids;
+  for (size_t id : mRTree.search(point)) {
+    if (mPolygons[id].contains(point)) ids.push_back(id);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+template<typename Point_t> inline
+std::vector<int> PreparedPolygonSet<Point_t>::locate(const std::vector<Point_t> &points) const
+{
+  std::vector<int> owner(points.size(), -1);
+  if (mPolygons.empty() || points.empty()) return owner;
+
+  // Se agrupan los puntos candidatos de cada polígono para evaluarlos en bloque
+  std::vector<std::vector<size_t>> candidates(mPolygons.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    mRTree.search(Window<Point_t>(points[i], points[i]), [&candidates, i](size_t id) {
+      candidates[id].push_back(i);
+      return true;
+    });
+  }
+
+  std::vector<std::vector<bool>> inside(mPolygons.size());
+  parallel_for(0, mPolygons.size(), [&](size_t id) {
+    if (candidates[id].empty()) return;
+    std::vector<Point_t> subset;
+    subset.reserve(candidates[id].size());
+    for (size_t i : candidates[id]) subset.push_back(points[i]);
+    inside[id] = mPolygons[id].contains(subset);
+  });
+
+  for (size_t id = 0; id < mPolygons.size(); id++) {
+    for (size_t k = 0; k < inside[id].size(); k++) {
+      int &point_owner = owner[candidates[id][k]];
+      if (inside[id][k] && point_owner == -1) point_owner = static_cast<int>(id);
+    }
+  }
+
+  return owner;
+}
+
+template<typename Point_t> inline
+std::vector<std::pair<size_t, double>> PreparedPolygonSet<Point_t>::overlapping(const Polygon<Point_t> &polygon) const
+{
+  std::vector<std::pair<size_t, double>> result;
+
+  PreparedPolygon<Point_t> prepared(polygon);
+  for (size_t id : mRTree.search(prepared.window())) {
+    double area = mPolygons[id].intersectionArea(prepared);
+    if (area > 0.) result.emplace_back(id, area);
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+/*! \} */ // end of geometry
+
+} // End namespace tl
+
+#endif // TL_GEOMETRY_PREPARED_POLYGON_H
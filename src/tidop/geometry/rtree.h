@@ -0,0 +1,573 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOMETRY_RTREE_H
+#define TL_GEOMETRY_RTREE_H
+
+#include "config_tl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/geometry/entities/window.h"
+#include "tidop/geometry/entities/bbox.h"
+
+namespace tl
+{
+
+/*! \addtogroup geometry
+ *  \{
+ */
+
+namespace internal
+{
+
+/*!
+ * \brief Acceso por dimensión a las cajas indexadas por RTree
+ */
+template<typename Box_t>
+struct RTreeBoxTraits;
+
+template<typename Point_t>
+struct RTreeBoxTraits<Window<Point_t>>
+{
+  using point_type = Point_t;
+
+  static constexpr size_t dimensions = 2;
+
+  static double min(const Window<Point_t> &box, size_t dim)
+  {
+    return static_cast<double>(dim == 0 ? box.pt1.x : box.pt1.y);
+  }
+
+  static double max(const Window<Point_t> &box, size_t dim)
+  {
+    return static_cast<double>(dim == 0 ? box.pt2.x : box.pt2.y);
+  }
+
+  static double coordinate(const Point_t &point, size_t dim)
+  {
+    return static_cast<double>(dim == 0 ? point.x : point.y);
+  }
+
+  static Window<Point_t> join(const Window<Point_t> &box1, const Window<Point_t> &box2)
+  {
+    return joinWindow(box1, box2);
+  }
+};
+
+template<typename Point3_t>
+struct RTreeBoxTraits<BoundingBox<Point3_t>>
+{
+  using point_type = Point3_t;
+
+  static constexpr size_t dimensions = 3;
+
+  static double min(const BoundingBox<Point3_t> &box, size_t dim)
+  {
+    return static_cast<double>(dim == 0 ? box.pt1.x : dim == 1 ? box.pt1.y : box.pt1.z);
+  }
+
+  static double max(const BoundingBox<Point3_t> &box, size_t dim)
+  {
+    return static_cast<double>(dim == 0 ? box.pt2.x : dim == 1 ? box.pt2.y : box.pt2.z);
+  }
+
+  static double coordinate(const Point3_t &point, size_t dim)
+  {
+    return static_cast<double>(dim == 0 ? point.x : dim == 1 ? point.y : point.z);
+  }
+
+  static BoundingBox<Point3_t> join(const BoundingBox<Point3_t> &box1, const BoundingBox<Point3_t> &box2)
+  {
+    return joinBoundingBoxes(box1, box2);
+  }
+};
+
+} // End namespace internal
+
+
+/*!
+ * \brief R-tree empaquetado de sólo lectura
+ *
+ * El árbol se construye de una vez (bulk-load) mediante Sort-Tile-Recursive
+ * y se almacena en vectores contiguos sin punteros: las hojas son las cajas
+ * de los elementos y cada nivel superior agrupa nodos consecutivos del
+ * nivel inferior. Las consultas devuelven la posición del elemento en el
+ * vector con el que se construyó el árbol.
+ *
+ * Admite ventanas (Window) y cajas envolventes (BoundingBox). Para indexar
+ * polígonos u otras entidades se usa su ventana envolvente (ver createRTree).
+ * Las consultas son de sólo lectura y pueden hacerse desde varios hilos.
+ *
+ * \code
+ * std::vector<WindowD> windows;
+ * ...
+ * RTree<WindowD> rtree(windows);
+ * std::vector<size_t> candidates = rtree.search(PointD(x, y));
+ * \endcode
+ */
+template<typename Box_t>
+class RTree
+{
+
+public:
+
+  using box_type = Box_t;
+  using point_type = typename internal::RTreeBoxTraits<Box_t>::point_type;
+
+public:
+
+  /*!
+   * \brief Constructor por defecto. Árbol vacío
+   * \param[in] nodeSize Número máximo de hijos por nodo
+   */
+  explicit RTree(size_t nodeSize = 16);
+
+  /*!
+   * \brief Construye el árbol a partir de un conjunto de cajas
+   * \param[in] boxes Cajas envolventes de los elementos
+   * \param[in] nodeSize Número máximo de hijos por nodo
+   */
+  explicit RTree(const std::vector<Box_t> &boxes,
+                 size_t nodeSize = 16);
+
+  ~RTree() = default;
+
+  /*!
+   * \brief Construye (o reconstruye) el árbol
+   * \param[in] boxes Cajas envolventes de los elementos
+   */
+  void build(const std::vector<Box_t> &boxes);
+
+  /*!
+   * \brief Número de elementos indexados
+   */
+  size_t size() const;
+  bool empty() const;
+
+  /*!
+   * \brief Caja envolvente de todos los elementos
+   */
+  Box_t bounds() const;
+
+  /*!
+   * \brief Elementos cuya caja intersecta con una caja
+   * \param[in] box Caja de búsqueda
+   * \return Índices de los elementos
+   */
+  std::vector<size_t> search(const Box_t &box) const;
+
+  /*!
+   * \brief Recorre los elementos cuya caja intersecta con una caja
+   * La función recibe el índice del elemento. Si devuelve falso se detiene la búsqueda
+   * \param[in] box Caja de búsqueda
+   * \param[in] visitor Función llamada para cada elemento
+   */
+  template<typename Func>
+  void search(const Box_t &box, Func visitor) const;
+
+  /*!
+   * \brief Elementos cuya caja contiene un punto
+   * \param[in] point Punto
+   * \return Índices de los elementos
+   */
+  std::vector<size_t> search(const point_type &point) const;
+
+  /*!
+   * \brief Vecinos más próximos a un punto
+   * La distancia es la distancia del punto a la caja de cada elemento (cero si
+   * la contiene). Los elementos se devuelven ordenados de menor a mayor distancia.
+   * \param[in] point Punto
+   * \param[in] k Número de vecinos
+   * \param[in] maxDistance Distancia máxima de búsqueda
+   * \return Índices de los elementos
+   */
+  std::vector<size_t> nearest(const point_type &point,
+                              size_t k = 1,
+                              double maxDistance = std::numeric_limits<double>::max()) const;
+
+private:
+
+  struct Item
+  {
+    Box_t box;
+    size_t index;
+  };
+
+  void sortTileRecursive(typename std::vector<Item>::iterator first,
+                         typename std::vector<Item>::iterator last,
+                         size_t dim) const;
+
+  static bool intersects(const Box_t &box1, const Box_t &box2);
+  static bool contains(const Box_t &box, const point_type &point);
+  static double distance2(const Box_t &box, const point_type &point);
+
+  /*!
+   * \brief Rango [first, last) de los hijos de un nodo
+   */
+  std::pair<size_t, size_t> children(size_t position, size_t level) const;
+
+private:
+
+  size_t mNodeSize;
+  size_t mSize;
+  /// Cajas de todos los nodos, nivel a nivel. Las hojas ocupan las primeras posiciones
+  std::vector<Box_t> mBoxes;
+  /// Índice del elemento en las hojas y posición del primer hijo en el resto de nodos
+  std::vector<size_t> mIndices;
+  /// Posición final de cada nivel
+  std::vector<size_t> mLevelBounds;
+
+};
+
+
+template<typename Box_t> inline
+RTree<Box_t>::RTree(size_t nodeSize)
+  : mNodeSize(std::max<size_t>(2, nodeSize)),
+    mSize(0)
+{
+}
+
+template<typename Box_t> inline
+RTree<Box_t>::RTree(const std::vector<Box_t> &boxes,
+                    size_t nodeSize)
+  : mNodeSize(std::max<size_t>(2, nodeSize)),
+    mSize(0)
+{
+  build(boxes);
+}
+
+template<typename Box_t> inline
+void RTree<Box_t>::build(const std::vector<Box_t> &boxes)
+{
+  mSize = boxes.size();
+  mBoxes.clear();
+  mIndices.clear();
+  mLevelBounds.clear();
+
+  if (mSize == 0) return;
+
+  std::vector<Item> level(mSize);
+  for (size_t i = 0; i < mSize; i++) {
+    level[i].box = boxes[i];
+    level[i].index = i;
+  }
+
+  size_t level_start = 0;
+
+  /// Al menos un nivel por encima de las hojas para que la raíz sea siempre un nodo
+  do {
+
+    sortTileRecursive(level.begin(), level.end(), 0);
+
+    for (const auto &item : level) {
+      mBoxes.push_back(item.box);
+      mIndices.push_back(item.index);
+    }
+    mLevelBounds.push_back(mBoxes.size());
+
+    std::vector<Item> parents;
+    parents.reserve((level.size() + mNodeSize - 1) / mNodeSize);
+
+    for (size_t i = 0; i < level.size(); i += mNodeSize) {
+      Item parent;
+      parent.box = level[i].box;
+      size_t end = std::min(i + mNodeSize, level.size());
+      for (size_t j = i + 1; j < end; j++) {
+        parent.box = internal::RTreeBoxTraits<Box_t>::join(parent.box, level[j].box);
+      }
+      parent.index = level_start + i;
+      parents.push_back(parent);
+    }
+
+    level_start += level.size();
+    level = std::move(parents);
+
+  } while (level.size() > 1);
+
+  mBoxes.push_back(level[0].box);
+  mIndices.push_back(level[0].index);
+  mLevelBounds.push_back(mBoxes.size());
+}
+
+template<typename Box_t> inline
+size_t RTree<Box_t>::size() const
+{
+  return mSize;
+}
+
+template<typename Box_t> inline
+bool RTree<Box_t>::empty() const
+{
+  return mSize == 0;
+}
+
+template<typename Box_t> inline
+Box_t RTree<Box_t>::bounds() const
+{
+  return mBoxes.empty() ? Box_t() : mBoxes.back();
+}
+
+template<typename Box_t> inline
+std::vector<size_t> RTree<Box_t>::search(const Box_t &box) const
+{
+  std::vector<size_t> indices;
+  search(box, [&indices](size_t index) {
+    indices.push_back(index);
+    return true;
+  });
+  return indices;
+}
+
+template<typename Box_t> template<typename Func> inline
+void RTree<Box_t>::search(const Box_t &box, Func visitor) const
+{
+  if (mSize == 0) return;
+
+  std::vector<std::pair<size_t, size_t>> stack;
+  stack.emplace_back(mBoxes.size() - 1, mLevelBounds.size() - 1);
+
+  while (!stack.empty()) {
+
+    size_t position = stack.back().first;
+    size_t level = stack.back().second;
+    stack.pop_back();
+
+    std::pair<size_t, size_t> range = children(position, level);
+
+    for (size_t i = range.first; i < range.second; i++) {
+      if (!intersects(mBoxes[i], box)) continue;
+      if (level == 1) {
+        if (!visitor(mIndices[i])) return;
+      } else {
+        stack.emplace_back(i, level - 1);
+      }
+    }
+  }
+}
+
+template<typename Box_t> inline
+std::vector<size_t> RTree<Box_t>::search(const point_type &point) const
+{
+  std::vector<size_t> indices;
+
+  if (mSize == 0) return indices;
+
+  std::vector<std::pair<size_t, size_t>> stack;
+  stack.emplace_back(mBoxes.size() - 1, mLevelBounds.size() - 1);
+
+  while (!stack.empty()) {
+
+    size_t position = stack.back().first;
+    size_t level = stack.back().second;
+    stack.pop_back();
+
+    std::pair<size_t, size_t> range = children(position, level);
+
+    for (size_t i = range.first; i < range.second; i++) {
+      if (!contains(mBoxes[i], point)) continue;
+      if (level == 1)
+        indices.push_back(mIndices[i]);
+      else
+        stack.emplace_back(i, level - 1);
+    }
+  }
+
+  return indices;
+}
+
+template<typename Box_t> inline
+std::vector<size_t> RTree<Box_t>::nearest(const point_type &point,
+                                          size_t k,
+                                          double maxDistance) const
+{
+  std::vector<size_t> indices;
+
+  if (mSize == 0 || k == 0) return indices;
+
+  double max_distance2 = maxDistance < std::sqrt(std::numeric_limits<double>::max()) ?
+                         maxDistance * maxDistance : std::numeric_limits<double>::max();
+
+  /// Cola de prioridad con (distancia², posición, nivel). Nivel 0 son elementos
+  using Entry = std::pair<double, std::pair<size_t, size_t>>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  queue.emplace(0., std::make_pair(mBoxes.size() - 1, mLevelBounds.size() - 1));
+
+  while (!queue.empty()) {
+
+    Entry entry = queue.top();
+    queue.pop();
+
+    if (entry.first > max_distance2) break;
+
+    size_t position = entry.second.first;
+    size_t level = entry.second.second;
+
+    if (level == 0) {
+      indices.push_back(mIndices[position]);
+      if (indices.size() == k) break;
+      continue;
+    }
+
+    std::pair<size_t, size_t> range = children(position, level);
+
+    for (size_t i = range.first; i < range.second; i++) {
+      double d2 = distance2(mBoxes[i], point);
+      if (d2 <= max_distance2)
+        queue.emplace(d2, std::make_pair(i, level - 1));
+    }
+  }
+
+  return indices;
+}
+
+template<typename Box_t> inline
+void RTree<Box_t>::sortTileRecursive(typename std::vector<Item>::iterator first,
+                                     typename std::vector<Item>::iterator last,
+                                     size_t dim) const
+{
+  using Traits = internal::RTreeBoxTraits<Box_t>;
+
+  auto by_center = [dim](const Item &item1, const Item &item2) {
+    return Traits::min(item1.box, dim) + Traits::max(item1.box, dim) <
+           Traits::min(item2.box, dim) + Traits::max(item2.box, dim);
+  };
+
+  std::sort(first, last, by_center);
+
+  size_t dimensions = Traits::dimensions;
+  if (dim + 1 >= dimensions) return;
+
+  /// Número de nodos que se formarán y número de franjas en esta dimensión
+  size_t count = static_cast<size_t>(std::distance(first, last));
+  size_t nodes = (count + mNodeSize - 1) / mNodeSize;
+  size_t slices = static_cast<size_t>(std::ceil(std::pow(static_cast<double>(nodes),
+                                                         1. / static_cast<double>(dimensions - dim))));
+  slices = std::max<size_t>(1, slices);
+  size_t slice_size = mNodeSize * ((nodes + slices - 1) / slices);
+
+  for (size_t i = 0; i < count; i += slice_size) {
+    size_t end = std::min(i + slice_size, count);
+    sortTileRecursive(first + static_cast<std::ptrdiff_t>(i),
+                      first + static_cast<std::ptrdiff_t>(end),
+                      dim + 1);
+  }
+}
+
+template<typename Box_t> inline
+bool RTree<Box_t>::intersects(const Box_t &box1, const Box_t &box2)
+{
+  using Traits = internal::RTreeBoxTraits<Box_t>;
+
+  for (size_t dim = 0; dim < Traits::dimensions; dim++) {
+    if (Traits::max(box1, dim) < Traits::min(box2, dim) ||
+        Traits::min(box1, dim) > Traits::max(box2, dim)) return false;
+  }
+
+  return true;
+}
+
+template<typename Box_t> inline
+bool RTree<Box_t>::contains(const Box_t &box, const point_type &point)
+{
+  using Traits = internal::RTreeBoxTraits<Box_t>;
+
+  for (size_t dim = 0; dim < Traits::dimensions; dim++) {
+    double coordinate = Traits::coordinate(point, dim);
+    if (coordinate < Traits::min(box, dim) ||
+        coordinate > Traits::max(box, dim)) return false;
+  }
+
+  return true;
+}
+
+template<typename Box_t> inline
+double RTree<Box_t>::distance2(const Box_t &box, const point_type &point)
+{
+  using Traits = internal::RTreeBoxTraits<Box_t>;
+
+  double d2 = 0.;
+  for (size_t dim = 0; dim < Traits::dimensions; dim++) {
+    double coordinate = Traits::coordinate(point, dim);
+    double d = 0.;
+    if (coordinate < Traits::min(box, dim))
+      d = Traits::min(box, dim) - coordinate;
+    else if (coordinate > Traits::max(box, dim))
+      d = coordinate - Traits::max(box, dim);
+    d2 += d * d;
+  }
+
+  return d2;
+}
+
+template<typename Box_t> inline
+std::pair<size_t, size_t> RTree<Box_t>::children(size_t position, size_t level) const
+{
+  size_t first = mIndices[position];
+  size_t last = std::min(first + mNodeSize, mLevelBounds[level - 1]);
+  return std::make_pair(first, last);
+}
+
+
+/*!
+ * \brief Crea un R-tree a partir de las ventanas envolventes de un conjunto de entidades
+ * Las entidades tienen que tener un método window() (Polygon, LineString, MultiPoint, ...)
+ * \code
+ * std::vector<PolygonD> polygons;
+ * ...
+ * RTree<WindowD> rtree = createRTree(polygons);
+ * for (size_t i : rtree.search(point)) {
+ *   if (polygons[i].isInner(point)) ...
+ * }
+ * \endcode
+ */
+template<typename Entity_t> inline
+auto createRTree(const std::vector<Entity_t> &entities,
+                 size_t nodeSize = 16) -> RTree<typename std::decay<decltype(entities.front().window())>::type>
+{
+  using Box_t = typename std::decay<decltype(entities.front().window())>::type;
+
+  std::vector<Box_t> boxes;
+  boxes.reserve(entities.size());
+  for (const auto &entity : entities) {
+    boxes.push_back(entity.window());
+  }
+
+  return RTree<Box_t>(boxes, nodeSize);
+}
+
+/*! \} */ // end of geometry
+
+} // End namespace tl
+
+#endif // TL_GEOMETRY_RTREE_H
@@ -142,6 +142,40 @@ Point<double> DifferentialRectification::backwardProjection(const Point3<double>
   return photo_coordinates;
 }
 
+void DifferentialRectification::backwardProjection(const std::vector<Point3<double>> &groundPoints,
+                                                   std::vector<Point<double>> &imagePoints) const
+{
+  try {
+
+    const double r00 = mRotationMatrix.at(0, 0);
+    const double r01 = mRotationMatrix.at(0, 1);
+    const double r02 = mRotationMatrix.at(0, 2);
+    const double r10 = mRotationMatrix.at(1, 0);
+    const double r11 = mRotationMatrix.at(1, 1);
+    const double r12 = mRotationMatrix.at(1, 2);
+    const double r20 = mRotationMatrix.at(2, 0);
+    const double r21 = mRotationMatrix.at(2, 1);
+    const double r22 = mRotationMatrix.at(2, 2);
+
+    size_t size = groundPoints.size();
+    imagePoints.resize(size);
+
+    for (size_t i = 0; i < size; i++) {
+
+      double dx = groundPoints[i].x - mCameraPosition.x;
+      double dy = groundPoints[i].y - mCameraPosition.y;
+      double dz = groundPoints[i].z - mCameraPosition.z;
+      double factor = -mFocal / (r20 * dx + r21 * dy + r22 * dz);
+
+      imagePoints[i].x = factor * (r00 * dx + r01 * dy + r02 * dz);
+      imagePoints[i].y = factor * (r10 * dx + r11 * dy + r12 * dz);
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
 
 } // End namespace geospatial
 
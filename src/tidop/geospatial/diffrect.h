@@ -27,6 +27,8 @@
 
 #include "config_tl.h"
 
+#include <vector>
+
 #include "tidop/core/messages.h"
 #include "tidop/geometry/transform/transform.h"
 #include "tidop/geometry/entities/point.h"
@@ -60,6 +62,15 @@ public:
   Point3<double> forwardProjection(const Point<double> &imagePoint, double z) const;
   Point<double> backwardProjection(const Point3<double> &groundPoint) const;
 
+  /*!
+   * \brief Proyección inversa de un conjunto de puntos
+   * Los coeficientes de la matriz de rotación se cargan una sola vez para todo el lote
+   * \param[in] groundPoints Puntos terreno
+   * \param[out] imagePoints Coordenadas imagen
+   */
+  void backwardProjection(const std::vector<Point3<double>> &groundPoints,
+                          std::vector<Point<double>> &imagePoints) const;
+
 private:
 
   math::RotationMatrix<double> mRotationMatrix;
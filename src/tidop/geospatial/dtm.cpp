@@ -25,6 +25,13 @@
 #include "dtm.h"
 
 #include "tidop/core/utils.h"
+#include "tidop/img/imgwriter.h"
+#include "tidop/geometry/transform/affine.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cmath>
 
 
 
@@ -180,6 +187,110 @@ void Dtm::compute(const std::string &fileIn, const std::string &fileOut)
 
 }
 
+void Dtm::compute(PointCloudReader &reader, 
+                  const std::string &fileOut,
+                  int tileSize)
+{
+  try {
+
+    TL_ASSERT(mXResolution > 0. && mYResolution > 0., "Invalid resolution");
+    TL_ASSERT(tileSize > 0, "Invalid tile size");
+
+    /// Algoritmo y opciones en el formato de gdal_grid (invdist:power=2:...)
+    std::string algorithm_options = mInterpolation->algorithmName();
+    double search_radius = 0.;
+    for (auto it = mInterpolation->parametersBegin(); it != mInterpolation->parametersEnd(); ++it) {
+      if (it->second.empty()) continue;
+      algorithm_options.append(":").append(mInterpolation->parameterName(it->first)).append("=").append(it->second);
+      if (it->first == Interpolation::Parameter::radius ||
+          it->first == Interpolation::Parameter::radius1 ||
+          it->first == Interpolation::Parameter::radius2) {
+        search_radius = std::max(search_radius, std::stod(it->second));
+      }
+    }
+
+    GDALGridAlgorithm grid_algorithm;
+    void *grid_options = nullptr;
+    TL_ASSERT(ParseAlgorithmAndOptions(algorithm_options.c_str(), &grid_algorithm, &grid_options) == CE_None,
+              "Invalid interpolation options");
+
+    /// Buckets con el tamaño de tesela en coordenadas terreno
+    double tile_size_x = tileSize * mXResolution;
+    double tile_size_y = tileSize * mYResolution;
+    PointCloudTiler tiler(std::max(tile_size_x, tile_size_y));
+    if (!mBbox.isEmpty()) tiler.setWindow(mBbox);
+    tiler.build(&reader);
+
+    WindowD window = mBbox.isEmpty() ? tiler.window() : mBbox;
+    int cols = static_cast<int>(std::ceil(window.width() / mXResolution));
+    int rows = static_cast<int>(std::ceil(window.height() / mYResolution));
+
+    std::unique_ptr<ImageWriter> image_writer = ImageWriterFactory::create(fileOut);
+    image_writer->open();
+    TL_ASSERT(image_writer->isOpen(), "Can't create the output file");
+    image_writer->create(rows, cols, 1, DataType::TL_32F);
+    image_writer->setGeoreference(Affine<PointD>(window.pt1.x, window.pt2.y, mXResolution, -mYResolution, 0.));
+    if (!mEPSGCode.empty()) image_writer->setCRS(mEPSGCode);
+    image_writer->setNoDataValue(-9999.);
+
+    /// Margen para que la interpolación sea continua entre teselas
+    double margin = std::max(search_radius, 16. * std::max(mXResolution, mYResolution));
+
+    std::vector<Point3D> points;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+
+    for (int r = 0; r < rows; r += tileSize) {
+      for (int c = 0; c < cols; c += tileSize) {
+
+        int tile_rows = std::min(tileSize, rows - r);
+        int tile_cols = std::min(tileSize, cols - c);
+
+        WindowD tile_window(PointD(window.pt1.x + c * mXResolution, 
+                                   window.pt2.y - (r + tile_rows) * mYResolution),
+                            PointD(window.pt1.x + (c + tile_cols) * mXResolution,
+                                   window.pt2.y - r * mYResolution));
+
+        tiler.read(expandWindow(tile_window, margin), points);
+
+        cv::Mat tile(tile_rows, tile_cols, CV_32F, cv::Scalar(-9999.f));
+
+        if (!points.empty()) {
+
+          x.resize(points.size());
+          y.resize(points.size());
+          z.resize(points.size());
+          for (size_t i = 0; i < points.size(); i++) {
+            x[i] = points[i].x;
+            y[i] = points[i].y;
+            z[i] = points[i].z;
+          }
+
+          /// GDALGridCreate devuelve las filas de abajo a arriba
+          cv::Mat grid(tile_rows, tile_cols, CV_32F);
+          if (GDALGridCreate(grid_algorithm, grid_options, 
+                             static_cast<GUInt32>(points.size()),
+                             x.data(), y.data(), z.data(),
+                             tile_window.pt1.x, tile_window.pt2.x,
+                             tile_window.pt1.y, tile_window.pt2.y,
+                             static_cast<GUInt32>(tile_cols), static_cast<GUInt32>(tile_rows),
+                             GDT_Float32, grid.data, nullptr, nullptr) == CE_None) {
+            cv::flip(grid, tile, 0);
+          }
+        }
+
+        image_writer->write(tile, WindowI(PointI(c, r), PointI(c + tile_cols, r + tile_rows)));
+      }
+    }
+
+    image_writer->close();
+    CPLFree(grid_options);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
 
 } // End namespace  geospatial
 
@@ -36,6 +36,7 @@
 #include "tidop/core/messages.h"
 #include "tidop/geometry/entities/window.h"
 #include "tidop/geospatial/dtminterpolation.h"
+#include "tidop/geospatial/pointcloud.h"
 
 
 namespace tl
@@ -62,6 +63,20 @@ public:
 
   void compute(const std::string &fileIn, const std::string &fileOut);
 
+  /*!
+   * \brief Computes the DTM from a streamed point cloud
+   *
+   * The cloud is distributed in buckets with PointCloudTiler and every
+   * DTM tile is interpolated only with the points of its bucket plus a
+   * margin, so the memory used doesn't depend on the size of the cloud.
+   * \param[in] reader Point cloud reader
+   * \param[in] fileOut Output DTM
+   * \param[in] tileSize Tile size in pixels
+   */
+  void compute(PointCloudReader &reader, 
+               const std::string &fileOut,
+               int tileSize = 1024);
+
 protected:
 
   std::shared_ptr<Interpolation> mInterpolation;
@@ -0,0 +1,285 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "tidop/geospatial/footprint.h"
+
+#ifdef TL_HAVE_OPENCV
+
+#include "tidop/core/concurrency.h"
+#include "tidop/core/exception.h"
+#include "tidop/core/progress.h"
+#include "tidop/geospatial/util.h"
+#include "tidop/vect/vectwriter.h"
+#include "tidop/graphic/layer.h"
+#include "tidop/graphic/datamodel.h"
+#include "tidop/graphic/entities/polygon.h"
+
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <mutex>
+
+namespace tl
+{
+
+namespace geospatial
+{
+
+
+Footprint::Footprint(const Path &dtm,
+                     const std::string &crs)
+  : Footprint(std::make_shared<DtmCache>(dtm), crs)
+{
+}
+
+Footprint::Footprint(std::shared_ptr<DtmCache> dtm,
+                     const std::string &crs)
+  : mDtm(std::move(dtm)),
+    mCRS(crs),
+    mDensification(10),
+    mTolerance(0.05),
+    mMaxIterations(10),
+    mInitialized(false)
+{
+  TL_ASSERT(mDtm, "Invalid DTM");
+}
+
+Footprint::~Footprint() = default;
+
+void Footprint::setDensification(int pointsPerSide)
+{
+  TL_ASSERT(pointsPerSide > 0, "Invalid densification");
+  mDensification = pointsPerSide;
+}
+
+void Footprint::setTolerance(double tolerance)
+{
+  mTolerance = tolerance;
+}
+
+void Footprint::setMaxIterations(int maxIterations)
+{
+  mMaxIterations = maxIterations;
+}
+
+void Footprint::init()
+{
+  if (mInitialized) return;
+
+  if (!mDtm->isOpen()) mDtm->open();
+
+  /// Pirámides de menor a mayor resolución. El último nivel es el MDT completo
+  int dtm_size = std::max(mDtm->rows(), mDtm->cols());
+  for (int size : {256, 2048}) {
+    if (size >= dtm_size) break;
+    Affine<PointD> georeference;
+    mPyramid.push_back(mDtm->overview(size, &georeference));
+    mPyramidGeoreference.push_back(georeference);
+  }
+
+  mInitialized = true;
+}
+
+double Footprint::height(size_t level, const PointD &point) const
+{
+  if (level >= mPyramid.size())
+    return mDtm->height(point);
+
+  const cv::Mat &dtm = mPyramid[level];
+  double nodata = mDtm->noDataValue();
+
+  PointD pixel = mPyramidGeoreference[level].transform(point, Transform::Order::inverse);
+  double u = pixel.x - 0.5;
+  double v = pixel.y - 0.5;
+  int col = static_cast<int>(std::floor(u));
+  int row = static_cast<int>(std::floor(v));
+
+  if (col < 0 || row < 0 || col + 1 >= dtm.cols || row + 1 >= dtm.rows) return nodata;
+
+  const float *ptr0 = dtm.ptr<float>(row);
+  const float *ptr1 = dtm.ptr<float>(row + 1);
+  float z00 = ptr0[col];
+  float z01 = ptr0[col + 1];
+  float z10 = ptr1[col];
+  float z11 = ptr1[col + 1];
+
+  if (z00 == nodata || z01 == nodata || z10 == nodata || z11 == nodata) return nodata;
+
+  double du = u - col;
+  double dv = v - row;
+  return (z00 * (1. - du) + z01 * du) * (1. - dv) +
+         (z10 * (1. - du) + z11 * du) * dv;
+}
+
+PolygonD Footprint::compute(const Image &image)
+{
+  PolygonD footprint;
+
+  try {
+
+    init();
+
+    double nodata = mDtm->noDataValue();
+    size_t levels = mPyramid.size() + 1;
+
+    /// Altura inicial bajo la cámara
+    PointD nadir(image.cameraPosition.x, image.cameraPosition.y);
+    double z_ini = height(0, nadir);
+    if (z_ini == nodata) z_ini = height(0, mDtm->window().center());
+    if (z_ini == nodata) z_ini = 0.;
+
+    /// Borde densificado de la imagen en sentido horario
+    std::vector<PointD> border;
+    border.reserve(4 * static_cast<size_t>(mDensification));
+    double step_x = static_cast<double>(image.cols) / mDensification;
+    double step_y = static_cast<double>(image.rows) / mDensification;
+    for (int i = 0; i < mDensification; i++) border.emplace_back(i * step_x, 0.);
+    for (int i = 0; i < mDensification; i++) border.emplace_back(image.cols, i * step_y);
+    for (int i = 0; i < mDensification; i++) border.emplace_back(image.cols - i * step_x, image.rows);
+    for (int i = 0; i < mDensification; i++) border.emplace_back(0., image.rows - i * step_y);
+
+    footprint.reserve(border.size());
+
+    for (const auto &image_point : border) {
+
+      PointD photo_point(image_point.x - image.principalPoint.x,
+                         image.principalPoint.y - image_point.y);
+
+      double z = z_ini;
+
+      for (size_t level = 0; level < levels; level++) {
+
+        double previous_diff = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < mMaxIterations; i++) {
+
+          Point3D terrain_point = projectPhotoToTerrain(image.rotationMatrix,
+                                                        image.cameraPosition,
+                                                        photo_point,
+                                                        image.focal, z);
+
+          double z_dtm = height(level, PointD(terrain_point.x, terrain_point.y));
+          if (z_dtm == nodata) break;
+
+          double diff = std::abs(z_dtm - z);
+          if (diff < mTolerance) {
+            z = z_dtm;
+            break;
+          }
+
+          /// Amortiguación si la iteración oscila (pendientes fuertes)
+          z = diff < previous_diff ? z_dtm : 0.5 * (z + z_dtm);
+          previous_diff = diff;
+        }
+      }
+
+      Point3D terrain_point = projectPhotoToTerrain(image.rotationMatrix,
+                                                    image.cameraPosition,
+                                                    photo_point,
+                                                    image.focal, z);
+      footprint.push_back(PointD(terrain_point.x, terrain_point.y));
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return footprint;
+}
+
+void Footprint::run(const std::vector<Image> &images,
+                    const Path &footprintFile,
+                    Progress *progress)
+{
+  try {
+
+    init();
+
+    if (progress) {
+      progress->setRange(0, images.size());
+      progress->setText("Footprint");
+    }
+
+    std::vector<PolygonD> footprints(images.size());
+    std::mutex mutex;
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+
+    parallel_for(0, images.size(), [&](size_t i) {
+
+      if (failed) return;
+
+      try {
+        footprints[i] = compute(images[i]);
+      } catch (...) {
+        std::lock_guard<std::mutex> lck(mutex);
+        if (!failed) error = std::current_exception();
+        failed = true;
+        return;
+      }
+
+      if (progress) {
+        std::lock_guard<std::mutex> lck(mutex);
+        (*progress)();
+      }
+    });
+
+    if (error) std::rethrow_exception(error);
+
+    /// Escritura de todas las huellas
+    std::shared_ptr<TableField> field = std::make_shared<TableField>("image", TableField::Type::STRING, 254);
+    std::vector<std::shared_ptr<TableField>> fields{field};
+
+    graph::GLayer layer;
+    layer.setName("footprint");
+    layer.addDataField(field);
+
+    for (size_t i = 0; i < images.size(); i++) {
+      if (footprints[i].empty()) continue;
+      std::shared_ptr<graph::GraphicEntity> polygon = std::make_shared<graph::GPolygon>(footprints[i]);
+      std::shared_ptr<TableRegister> data = std::make_shared<TableRegister>(fields);
+      data->setValue(0, images[i].name);
+      polygon->setData(data);
+      layer.push_back(polygon);
+    }
+
+    std::unique_ptr<VectorWriter> vector_writer = VectorWriterFactory::createWriter(footprintFile);
+    vector_writer->open();
+    TL_ASSERT(vector_writer->isOpen(), "Can't create the footprint file");
+    vector_writer->create();
+    if (!mCRS.empty()) vector_writer->setCRS(mCRS);
+    vector_writer->write(layer);
+    vector_writer->close();
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+} // End namespace geospatial
+
+} // End namespace tl
+
+#endif // TL_HAVE_OPENCV
@@ -0,0 +1,152 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOSPATIAL_FOOTPRINT_H
+#define TL_GEOSPATIAL_FOOTPRINT_H
+
+#include "config_tl.h"
+
+#ifdef TL_HAVE_OPENCV
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/path.h"
+#include "tidop/geometry/entities/point.h"
+#include "tidop/geometry/entities/polygon.h"
+#include "tidop/math/algebra/rotation_matrix.h"
+#include "tidop/geospatial/ortho.h"
+
+namespace tl
+{
+
+class Progress;
+
+namespace geospatial
+{
+
+/*!
+ * \brief Huella de vuelo
+ *
+ * El borde de cada imagen se densifica y cada punto se intersecta con el
+ * MDT de forma iterativa (projectPhotoToTerrain). La intersección empieza
+ * en las pirámides del MDT, que se mantienen en memoria, y sólo las
+ * últimas iteraciones se hacen con el MDT a resolución completa.
+ * Las imágenes se procesan en paralelo y los polígonos se escriben en
+ * una sola operación.
+ * \code
+ * Footprint footprint("mdt.tif", "EPSG:25830");
+ * footprint.run(images, "footprint.shp");
+ * \endcode
+ */
+class TL_EXPORT Footprint
+{
+
+public:
+
+  /*!
+   * \brief Orientación de una imagen
+   * Las coordenadas foto tienen origen en el punto principal:
+   * \f[ x = col - cx \f]
+   * \f[ y = cy - row \f]
+   */
+  struct Image
+  {
+    std::string name;
+    math::RotationMatrix<double> rotationMatrix;
+    Point3D cameraPosition;
+    double focal;
+    PointD principalPoint;
+    int rows;
+    int cols;
+  };
+
+public:
+
+  Footprint(const Path &dtm,
+            const std::string &crs = std::string());
+  Footprint(std::shared_ptr<DtmCache> dtm,
+            const std::string &crs = std::string());
+  ~Footprint();
+
+  TL_DISABLE_COPY(Footprint)
+  TL_DISABLE_MOVE(Footprint)
+
+  /*!
+   * \brief Número de puntos por lado del borde de la imagen
+   */
+  void setDensification(int pointsPerSide);
+
+  /*!
+   * \brief Tolerancia en altura para la convergencia de la intersección
+   */
+  void setTolerance(double tolerance);
+
+  /*!
+   * \brief Número máximo de iteraciones por nivel de pirámide
+   */
+  void setMaxIterations(int maxIterations);
+
+  /*!
+   * \brief Huella de una imagen
+   */
+  PolygonD compute(const Image &image);
+
+  /*!
+   * \brief Calcula las huellas de un conjunto de imágenes y las escribe
+   * \param[in] images Imágenes
+   * \param[in] footprintFile Fichero vectorial de salida
+   * \param[in] progress Barra de progreso
+   */
+  void run(const std::vector<Image> &images,
+           const Path &footprintFile,
+           Progress *progress = nullptr);
+
+private:
+
+  void init();
+  double height(size_t level, const PointD &point) const;
+
+private:
+
+  std::shared_ptr<DtmCache> mDtm;
+  std::string mCRS;
+  int mDensification;
+  double mTolerance;
+  int mMaxIterations;
+  std::vector<cv::Mat> mPyramid;
+  std::vector<Affine<PointD>> mPyramidGeoreference;
+  bool mInitialized;
+
+};
+
+} // End namespace geospatial
+
+} // End namespace tl
+
+#endif // TL_HAVE_OPENCV
+
+#endif // TL_GEOSPATIAL_FOOTPRINT_H
@@ -0,0 +1,573 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "tidop/geospatial/mosaic.h"
+
+#ifdef TL_HAVE_OPENCV
+
+#include "tidop/core/concurrency.h"
+#include "tidop/core/exception.h"
+#include "tidop/core/messages.h"
+#include "tidop/core/progress.h"
+#include "tidop/geometry/rtree.h"
+#include "tidop/img/imgreader.h"
+#include "tidop/img/imgwriter.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <set>
+
+namespace tl
+{
+
+namespace geospatial
+{
+
+namespace internal
+{
+
+/*!
+ * \brief Arista del grafo de solapes
+ */
+struct Overlap
+{
+  size_t image;
+  double area;
+  double meanFrom;
+  double meanTo;
+};
+
+/// Desviación típica del error de intensidad y de la ganancia (ver OpenCV GainCompensator)
+constexpr double gain_alpha = 1. / (10. * 10.);
+constexpr double gain_beta = 1. / (0.1 * 0.1);
+
+} // namespace internal
+
+
+Mosaic::Mosaic(const std::vector<Path> &orthos)
+  : mOrthos(orthos),
+    mResolution(0.),
+    mOverviewSize(256),
+    mSeamFactor(16),
+    mBlendWidth(64),
+    mCellSize(2048),
+    mGainCompensation(true),
+    mChannels(0),
+    mType(0)
+{
+  TL_ASSERT(!orthos.empty(), "Empty ortho list");
+}
+
+Mosaic::~Mosaic() = default;
+
+void Mosaic::setResolution(double resolution)
+{
+  mResolution = resolution;
+}
+
+void Mosaic::setCRS(const std::string &crs)
+{
+  mCRS = crs;
+}
+
+void Mosaic::setOverviewSize(int size)
+{
+  TL_ASSERT(size > 0, "Invalid overview size");
+  mOverviewSize = size;
+}
+
+void Mosaic::setSeamFactor(int factor)
+{
+  TL_ASSERT(factor > 0, "Invalid seam factor");
+  mSeamFactor = factor;
+}
+
+void Mosaic::setBlendWidth(int width)
+{
+  mBlendWidth = std::max(0, width);
+}
+
+void Mosaic::setCellSize(int size)
+{
+  TL_ASSERT(size > 0, "Invalid cell size");
+  mCellSize = size;
+}
+
+void Mosaic::setGainCompensation(bool active)
+{
+  mGainCompensation = active;
+}
+
+std::vector<double> Mosaic::gains() const
+{
+  return mGains;
+}
+
+void Mosaic::readOverviews()
+{
+  size_t size = mOrthos.size();
+  mWindows.resize(size);
+  mOverviews.resize(size);
+  mOverviewGeoreferences.resize(size);
+  mOverviewResolutions.resize(size);
+  std::vector<double> resolutions(size);
+
+  std::mutex mutex;
+  std::exception_ptr error;
+
+  parallel_for(0, size, [&](size_t i) {
+
+    try {
+
+      std::unique_ptr<ImageReader> image_reader = ImageReaderFactory::create(mOrthos[i]);
+      image_reader->open();
+      if (!image_reader->isOpen()) TL_THROW_EXCEPTION("Can't open %s", mOrthos[i].toString().c_str());
+
+      Affine<PointD> georeference = image_reader->georeference();
+      int rows = image_reader->rows();
+      int cols = image_reader->cols();
+      mWindows[i] = image_reader->window();
+      resolutions[i] = std::abs(georeference.scaleX());
+
+      double scale = std::min(1., static_cast<double>(mOverviewSize) / std::max(rows, cols));
+      cv::Mat image = image_reader->read(scale, scale);
+
+      if (i == 0) {
+        mChannels = image.channels();
+        mType = image.type();
+      }
+
+      image_reader->close();
+
+      cv::Mat gray;
+      if (image.channels() >= 3) {
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+      } else if (image.channels() == 1) {
+        gray = image;
+      } else {
+        cv::extractChannel(image, gray, 0);
+      }
+      gray.convertTo(mOverviews[i], CV_8U, gray.depth() == CV_16U ? 1. / 257. : 1.);
+
+      math::Matrix<double, 2, 3> parameters = georeference.parameters();
+      double scale_x = static_cast<double>(cols) / mOverviews[i].cols;
+      double scale_y = static_cast<double>(rows) / mOverviews[i].rows;
+      mOverviewGeoreferences[i].setParameters(parameters.at(0, 0) * scale_x, parameters.at(0, 1) * scale_y,
+                                              parameters.at(1, 0) * scale_x, parameters.at(1, 1) * scale_y,
+                                              parameters.at(0, 2), parameters.at(1, 2));
+      mOverviewResolutions[i] = resolutions[i] * scale_x;
+
+    } catch (...) {
+      std::lock_guard<std::mutex> lck(mutex);
+      if (!error) error = std::current_exception();
+    }
+
+  });
+
+  if (error) std::rethrow_exception(error);
+
+  if (mResolution <= 0.) {
+    mResolution = *std::min_element(resolutions.begin(), resolutions.end());
+  }
+
+  mWindow = WindowD();
+  for (const auto &window : mWindows) {
+    mWindow = joinWindow(mWindow, window);
+  }
+}
+
+void Mosaic::computeGains()
+{
+  size_t size = mOrthos.size();
+  mGains.assign(size, 1.);
+
+  if (!mGainCompensation || size < 2) return;
+
+  /// Grafo de solapes con el área y las medias de intensidad de cada solape
+  std::vector<std::vector<internal::Overlap>> graph(size);
+  std::mutex mutex;
+  RTree<WindowD> rtree(mWindows);
+
+  parallel_for(0, size, [&](size_t i) {
+
+    std::vector<internal::Overlap> overlaps;
+
+    std::vector<size_t> candidates = rtree.search(mWindows[i]);
+    std::sort(candidates.begin(), candidates.end());
+
+    for (size_t j : candidates) {
+
+      if (j <= i) continue;
+
+      WindowD overlap = windowIntersection(mWindows[i], mWindows[j]);
+      double step = std::max(mOverviewResolutions[i], mOverviewResolutions[j]);
+
+      const cv::Mat &overview_i = mOverviews[i];
+      const cv::Mat &overview_j = mOverviews[j];
+
+      size_t count = 0;
+      double sum_i = 0.;
+      double sum_j = 0.;
+
+      for (double y = overlap.pt1.y + step / 2.; y < overlap.pt2.y; y += step) {
+        for (double x = overlap.pt1.x + step / 2.; x < overlap.pt2.x; x += step) {
+
+          PointD pixel_i = mOverviewGeoreferences[i].transform(PointD(x, y), Transform::Order::inverse);
+          int c_i = static_cast<int>(pixel_i.x);
+          int r_i = static_cast<int>(pixel_i.y);
+          if (c_i < 0 || r_i < 0 || c_i >= overview_i.cols || r_i >= overview_i.rows) continue;
+
+          PointD pixel_j = mOverviewGeoreferences[j].transform(PointD(x, y), Transform::Order::inverse);
+          int c_j = static_cast<int>(pixel_j.x);
+          int r_j = static_cast<int>(pixel_j.y);
+          if (c_j < 0 || r_j < 0 || c_j >= overview_j.cols || r_j >= overview_j.rows) continue;
+
+          uchar value_i = overview_i.at<uchar>(r_i, c_i);
+          uchar value_j = overview_j.at<uchar>(r_j, c_j);
+          if (value_i == 0 || value_j == 0) continue;
+
+          count++;
+          sum_i += value_i;
+          sum_j += value_j;
+        }
+      }
+
+      if (count == 0) continue;
+
+      overlaps.push_back({j, count * step * step, sum_i / count, sum_j / count});
+    }
+
+    std::lock_guard<std::mutex> lck(mutex);
+    for (const auto &overlap : overlaps) {
+      graph[i].push_back(overlap);
+      graph[overlap.image].push_back({i, overlap.area, overlap.meanTo, overlap.meanFrom});
+    }
+
+  });
+
+  /// Sistema de ecuaciones normales del GainCompensator resuelto por Gauss-Seidel.
+  /// La matriz es dispersa (sólo solapes) y diagonal dominante.
+  std::vector<double> diagonal(size);
+  std::vector<double> b(size);
+
+  for (size_t i = 0; i < size; i++) {
+    double area = cv::countNonZero(mOverviews[i]) * mOverviewResolutions[i] * mOverviewResolutions[i];
+    diagonal[i] = internal::gain_beta * area;
+    b[i] = internal::gain_beta * area;
+    for (const auto &overlap : graph[i]) {
+      diagonal[i] += internal::gain_beta * overlap.area +
+                     2. * internal::gain_alpha * overlap.meanFrom * overlap.meanFrom * overlap.area;
+      b[i] += internal::gain_beta * overlap.area;
+    }
+  }
+
+  for (int iteration = 0; iteration < 1000; iteration++) {
+
+    double max_change = 0.;
+
+    for (size_t i = 0; i < size; i++) {
+      double sum = b[i];
+      for (const auto &overlap : graph[i]) {
+        sum += 2. * internal::gain_alpha * overlap.meanFrom * overlap.meanTo * overlap.area * mGains[overlap.image];
+      }
+      double gain = sum / diagonal[i];
+      max_change = std::max(max_change, std::abs(gain - mGains[i]));
+      mGains[i] = gain;
+    }
+
+    if (max_change < 1.e-8) break;
+  }
+}
+
+void Mosaic::computeSeams()
+{
+  int rows = static_cast<int>(std::ceil(mWindow.height() / mResolution));
+  int cols = static_cast<int>(std::ceil(mWindow.width() / mResolution));
+  int seam_rows = (rows + mSeamFactor - 1) / mSeamFactor;
+  int seam_cols = (cols + mSeamFactor - 1) / mSeamFactor;
+  double seam_resolution = mResolution * mSeamFactor;
+
+  mLabels = cv::Mat(seam_rows, seam_cols, CV_32S, cv::Scalar(-1));
+  cv::Mat distances(seam_rows, seam_cols, CV_32F, cv::Scalar(0));
+  std::mutex mutex;
+
+  /// Cada celda de la rejilla se asigna a la ortoimagen en la que está más lejos del borde
+  parallel_for(0, mOrthos.size(), [&](size_t i) {
+
+    cv::Mat distance;
+    cv::distanceTransform(mOverviews[i] > 0, distance, cv::DIST_L2, 3);
+
+    const WindowD &window = mWindows[i];
+    int c_ini = std::max(0, static_cast<int>(std::floor((window.pt1.x - mWindow.pt1.x) / seam_resolution)));
+    int c_end = std::min(seam_cols, static_cast<int>(std::ceil((window.pt2.x - mWindow.pt1.x) / seam_resolution)));
+    int r_ini = std::max(0, static_cast<int>(std::floor((mWindow.pt2.y - window.pt2.y) / seam_resolution)));
+    int r_end = std::min(seam_rows, static_cast<int>(std::ceil((mWindow.pt2.y - window.pt1.y) / seam_resolution)));
+    if (c_ini >= c_end || r_ini >= r_end) return;
+
+    cv::Mat ortho_distance(r_end - r_ini, c_end - c_ini, CV_32F, cv::Scalar(0));
+
+    for (int r = r_ini; r < r_end; r++) {
+      float *ptr = ortho_distance.ptr<float>(r - r_ini);
+      double y = mWindow.pt2.y - (r + 0.5) * seam_resolution;
+      for (int c = c_ini; c < c_end; c++) {
+        double x = mWindow.pt1.x + (c + 0.5) * seam_resolution;
+        PointD pixel = mOverviewGeoreferences[i].transform(PointD(x, y), Transform::Order::inverse);
+        int col = static_cast<int>(pixel.x);
+        int row = static_cast<int>(pixel.y);
+        if (pixel.x < 0 || pixel.y < 0 || col >= distance.cols || row >= distance.rows) continue;
+        ptr[c - c_ini] = static_cast<float>(distance.at<float>(row, col) * mOverviewResolutions[i]);
+      }
+    }
+
+    std::lock_guard<std::mutex> lck(mutex);
+
+    for (int r = r_ini; r < r_end; r++) {
+      const float *ptr = ortho_distance.ptr<float>(r - r_ini);
+      float *ptr_distance = distances.ptr<float>(r);
+      int *ptr_label = mLabels.ptr<int>(r);
+      for (int c = c_ini; c < c_end; c++) {
+        if (ptr[c - c_ini] > ptr_distance[c]) {
+          ptr_distance[c] = ptr[c - c_ini];
+          ptr_label[c] = static_cast<int>(i);
+        }
+      }
+    }
+
+  });
+}
+
+cv::Mat Mosaic::blendCell(const WindowI &cell)
+{
+  int width = cell.width();
+  int height = cell.height();
+
+  /// Región de la rejilla de costuras con margen para suavizar los pesos
+  int radius = mBlendWidth > 0 ? std::max(1, mBlendWidth / (2 * mSeamFactor)) : 0;
+  int seam_r_ini = cell.pt1.y / mSeamFactor;
+  int seam_c_ini = cell.pt1.x / mSeamFactor;
+  int seam_r_end = (cell.pt2.y + mSeamFactor - 1) / mSeamFactor;
+  int seam_c_end = (cell.pt2.x + mSeamFactor - 1) / mSeamFactor;
+  int margin_r_ini = std::max(0, seam_r_ini - radius);
+  int margin_c_ini = std::max(0, seam_c_ini - radius);
+  int margin_r_end = std::min(mLabels.rows, seam_r_end + radius);
+  int margin_c_end = std::min(mLabels.cols, seam_c_end + radius);
+
+  cv::Mat labels = mLabels(cv::Rect(margin_c_ini, margin_r_ini,
+                                    margin_c_end - margin_c_ini,
+                                    margin_r_end - margin_r_ini));
+  cv::Rect inner(seam_c_ini - margin_c_ini, seam_r_ini - margin_r_ini,
+                 seam_c_end - seam_c_ini, seam_r_end - seam_r_ini);
+
+  std::set<int> images;
+  for (int r = 0; r < labels.rows; r++) {
+    const int *ptr = labels.ptr<int>(r);
+    for (int c = 0; c < labels.cols; c++) {
+      if (ptr[c] >= 0) images.insert(ptr[c]);
+    }
+  }
+
+  cv::Mat accumulated(height, width, CV_32FC(mChannels), cv::Scalar::all(0));
+  cv::Mat weights(height, width, CV_32F, cv::Scalar(0));
+
+  WindowD cell_window(PointD(mWindow.pt1.x + cell.pt1.x * mResolution, mWindow.pt2.y - cell.pt2.y * mResolution),
+                      PointD(mWindow.pt1.x + cell.pt2.x * mResolution, mWindow.pt2.y - cell.pt1.y * mResolution));
+
+  for (int i : images) {
+
+    if (!intersectWindows(mWindows[i], cell_window)) continue;
+
+    /// Peso suavizado a partir de las etiquetas de la rejilla de costuras
+    cv::Mat weight;
+    cv::Mat(labels == i).convertTo(weight, CV_32F, 1. / 255.);
+    if (radius > 0) cv::blur(weight, weight, cv::Size(2 * radius + 1, 2 * radius + 1));
+    cv::resize(weight(inner), weight, cv::Size(inner.width * mSeamFactor, inner.height * mSeamFactor), 0, 0, cv::INTER_LINEAR);
+    weight = weight(cv::Rect(cell.pt1.x - seam_c_ini * mSeamFactor, cell.pt1.y - seam_r_ini * mSeamFactor, width, height));
+
+    std::unique_ptr<ImageReader> image_reader = ImageReaderFactory::create(mOrthos[i]);
+    image_reader->open();
+    if (!image_reader->isOpen()) TL_THROW_EXCEPTION("Can't open %s", mOrthos[i].toString().c_str());
+
+    double scale = std::abs(image_reader->georeference().scaleX()) / mResolution;
+    Affine<PointI> offset;
+    cv::Mat image;
+    try {
+      image = image_reader->read(cell_window, scale, scale, &offset);
+    } catch (...) {
+      msgWarning("Can't read %s", mOrthos[i].toString().c_str());
+      continue;
+    }
+    image_reader->close();
+
+    if (image.empty()) continue;
+
+    cv::Mat image_float;
+    image.convertTo(image_float, CV_32F, mGains[i]);
+
+    int x_ini = std::max(0, static_cast<int>(offset.tx));
+    int y_ini = std::max(0, static_cast<int>(offset.ty));
+    int x_end = std::min(width, static_cast<int>(offset.tx) + image.cols);
+    int y_end = std::min(height, static_cast<int>(offset.ty) + image.rows);
+    int channels = mChannels;
+
+    for (int r = y_ini; r < y_end; r++) {
+
+      const uchar *ptr_image = image.ptr<uchar>(r - static_cast<int>(offset.ty));
+      const float *ptr_value = image_float.ptr<float>(r - static_cast<int>(offset.ty));
+      const float *ptr_weight = weight.ptr<float>(r);
+      float *ptr_accumulated = accumulated.ptr<float>(r);
+      float *ptr_weights = weights.ptr<float>(r);
+      size_t elem_size = image.elemSize();
+
+      for (int c = x_ini; c < x_end; c++) {
+
+        int c_image = c - static_cast<int>(offset.tx);
+
+        /// Pixel sin datos si todos sus bytes son 0
+        const uchar *pixel = ptr_image + c_image * elem_size;
+        bool valid = false;
+        for (size_t b = 0; b < elem_size && !valid; b++) valid = pixel[b] != 0;
+        if (!valid) continue;
+
+        /// Peso mínimo para no dejar huecos junto a las costuras
+        float w = ptr_weight[c] + 1.e-4f;
+        for (int ch = 0; ch < channels; ch++) {
+          ptr_accumulated[c * channels + ch] += w * ptr_value[c_image * channels + ch];
+        }
+        ptr_weights[c] += w;
+      }
+    }
+  }
+
+  for (int r = 0; r < height; r++) {
+    float *ptr_accumulated = accumulated.ptr<float>(r);
+    const float *ptr_weights = weights.ptr<float>(r);
+    for (int c = 0; c < width; c++) {
+      float w = ptr_weights[c] > 0.f ? 1.f / ptr_weights[c] : 0.f;
+      for (int ch = 0; ch < mChannels; ch++) {
+        ptr_accumulated[c * mChannels + ch] *= w;
+      }
+    }
+  }
+
+  cv::Mat cell_image;
+  accumulated.convertTo(cell_image, mType);
+
+  return cell_image;
+}
+
+void Mosaic::run(const Path &mosaic, Progress *progress)
+{
+  try {
+
+    msgInfo("Mosaic: reading overviews");
+    readOverviews();
+
+    msgInfo("Mosaic: exposure compensation");
+    computeGains();
+
+    msgInfo("Mosaic: seamlines");
+    computeSeams();
+
+    int rows = static_cast<int>(std::ceil(mWindow.height() / mResolution));
+    int cols = static_cast<int>(std::ceil(mWindow.width() / mResolution));
+
+    std::unique_ptr<ImageWriter> image_writer = ImageWriterFactory::create(mosaic);
+    image_writer->open();
+    TL_ASSERT(image_writer->isOpen(), "Can't create the mosaic");
+    image_writer->create(rows, cols, mChannels, openCVDataTypeToDataType(CV_MAT_DEPTH(mType)));
+    image_writer->setGeoreference(Affine<PointD>(mWindow.pt1.x, mWindow.pt2.y, mResolution, -mResolution, 0.));
+    if (!mCRS.empty()) image_writer->setCRS(mCRS);
+    image_writer->setNoDataValue(0.);
+
+    /// Las celdas se alinean con la rejilla de costuras
+    int cell_size = ((mCellSize + mSeamFactor - 1) / mSeamFactor) * mSeamFactor;
+    int cell_rows = (rows + cell_size - 1) / cell_size;
+    int cell_cols = (cols + cell_size - 1) / cell_size;
+    size_t cell_count = static_cast<size_t>(cell_rows) * static_cast<size_t>(cell_cols);
+
+    if (progress) {
+      progress->setRange(0, cell_count);
+      progress->setText("Mosaic");
+    }
+
+    msgInfo("Mosaic: blending %i cells", static_cast<int>(cell_count));
+
+    std::mutex writer_mutex;
+    std::atomic<size_t> next_cell(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+
+    /// Cada hilo toma la siguiente celda libre. La memoria usada depende del
+    /// tamaño de celda y del número de hilos, no del tamaño del mosaico
+    auto worker = [&](size_t) {
+
+      try {
+
+        for (size_t cell = next_cell++; cell < cell_count && !failed; cell = next_cell++) {
+
+          int r0 = static_cast<int>(cell / cell_cols) * cell_size;
+          int c0 = static_cast<int>(cell % cell_cols) * cell_size;
+          WindowI cell_window(PointI(c0, r0),
+                              PointI(std::min(c0 + cell_size, cols), std::min(r0 + cell_size, rows)));
+
+          cv::Mat cell_image = blendCell(cell_window);
+
+          std::lock_guard<std::mutex> lck(writer_mutex);
+          image_writer->write(cell_image, cell_window);
+          if (progress) (*progress)();
+        }
+
+      } catch (...) {
+        std::lock_guard<std::mutex> lck(writer_mutex);
+        if (!failed) error = std::current_exception();
+        failed = true;
+      }
+    };
+
+    size_t num_threads = std::min(static_cast<size_t>(optimalNumberOfThreads()), cell_count);
+    parallel_for(0, num_threads, worker);
+
+    if (error) std::rethrow_exception(error);
+
+    image_writer->close();
+
+    mOverviews.clear();
+    mLabels.release();
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+} // End namespace geospatial
+
+} // End namespace tl
+
+#endif // TL_HAVE_OPENCV
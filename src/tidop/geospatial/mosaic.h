@@ -0,0 +1,159 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOSPATIAL_MOSAIC_H
+#define TL_GEOSPATIAL_MOSAIC_H
+
+#include "config_tl.h"
+
+#ifdef TL_HAVE_OPENCV
+
+#include <string>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+
+#include "tidop/core/defs.h"
+#include "tidop/core/path.h"
+#include "tidop/geometry/entities/window.h"
+#include "tidop/geometry/transform/affine.h"
+
+namespace tl
+{
+
+class Progress;
+
+namespace geospatial
+{
+
+/*!
+ * \brief Mosaico de ortoimagenes
+ *
+ * El proceso se divide en tres pasos:
+ * - Compensación de la exposición: se calcula una ganancia por ortoimagen
+ *   a partir de las medias de intensidad en los solapes del grafo de
+ *   solapes. Se hace una sola vez y a baja resolución.
+ * - Líneas de costura: cada celda de una rejilla de baja resolución se
+ *   asigna a la ortoimagen en la que está más alejada del borde.
+ * - Mezcla: el mosaico se divide en celdas que se procesan en paralelo.
+ *   En cada celda se leen sólo las ortoimagenes que aportan pixeles y se
+ *   mezclan con pesos suavizados alrededor de las costuras. Cada celda se
+ *   escribe en cuanto se termina, sin ficheros intermedios.
+ *
+ * Los pixeles con valor 0 en todas las bandas se consideran sin datos.
+ * \code
+ * Mosaic mosaic(orthos);
+ * mosaic.setResolution(0.1);
+ * mosaic.run("mosaic.tif");
+ * \endcode
+ */
+class TL_EXPORT Mosaic
+{
+
+public:
+
+  Mosaic(const std::vector<Path> &orthos);
+  ~Mosaic();
+
+  TL_DISABLE_COPY(Mosaic)
+  TL_DISABLE_MOVE(Mosaic)
+
+  /*!
+   * \brief Tamaño de pixel del mosaico. Por defecto el de la ortoimagen de mayor resolución
+   */
+  void setResolution(double resolution);
+
+  void setCRS(const std::string &crs);
+
+  /*!
+   * \brief Tamaño máximo (filas o columnas) de las ortoimagenes a baja resolución
+   * usadas para la compensación de la exposición y el cálculo de costuras
+   */
+  void setOverviewSize(int size);
+
+  /*!
+   * \brief Número de pixeles del mosaico por pixel de la rejilla de costuras
+   */
+  void setSeamFactor(int factor);
+
+  /*!
+   * \brief Anchura de la zona de mezcla alrededor de las costuras en pixeles del mosaico
+   */
+  void setBlendWidth(int width);
+
+  /*!
+   * \brief Tamaño de las celdas de mezcla en pixeles del mosaico
+   */
+  void setCellSize(int size);
+
+  void setGainCompensation(bool active);
+
+  /*!
+   * \brief Ganancias calculadas en la compensación de la exposición
+   */
+  std::vector<double> gains() const;
+
+  /*!
+   * \brief Genera el mosaico
+   * \param[in] mosaic Fichero de salida
+   * \param[in] progress Barra de progreso
+   */
+  void run(const Path &mosaic, Progress *progress = nullptr);
+
+private:
+
+  void readOverviews();
+  void computeGains();
+  void computeSeams();
+  cv::Mat blendCell(const WindowI &cell);
+
+private:
+
+  std::vector<Path> mOrthos;
+  double mResolution;
+  std::string mCRS;
+  int mOverviewSize;
+  int mSeamFactor;
+  int mBlendWidth;
+  int mCellSize;
+  bool mGainCompensation;
+  int mChannels;
+  int mType;
+  std::vector<WindowD> mWindows;
+  std::vector<cv::Mat> mOverviews;
+  std::vector<Affine<PointD>> mOverviewGeoreferences;
+  std::vector<double> mOverviewResolutions;
+  std::vector<double> mGains;
+  WindowD mWindow;
+  cv::Mat mLabels;
+
+};
+
+} // End namespace geospatial
+
+} // End namespace tl
+
+#endif // TL_HAVE_OPENCV
+
+#endif // TL_GEOSPATIAL_MOSAIC_H
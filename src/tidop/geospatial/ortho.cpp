@@ -0,0 +1,639 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "tidop/geospatial/ortho.h"
+
+#ifdef TL_HAVE_OPENCV
+
+#include "tidop/core/concurrency.h"
+#include "tidop/core/exception.h"
+#include "tidop/core/progress.h"
+#include "tidop/img/imgreader.h"
+#include "tidop/img/imgwriter.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <limits>
+
+namespace tl
+{
+
+namespace geospatial
+{
+
+/* DtmCache */
+
+DtmCache::DtmCache(const Path &dtm,
+                   int tileSize,
+                   size_t cacheSize)
+  : mImageReader(ImageReaderFactory::create(dtm)),
+    mTileSize(tileSize),
+    mCacheSize(cacheSize),
+    mRows(0),
+    mCols(0),
+    mNoDataValue(-9999.)
+{
+  TL_ASSERT(tileSize > 0, "Invalid tile size");
+  TL_ASSERT(cacheSize > 0, "Invalid cache size");
+}
+
+DtmCache::~DtmCache()
+{
+  close();
+}
+
+void DtmCache::open()
+{
+  try {
+
+    std::lock_guard<std::mutex> lck(mMutex);
+
+    mImageReader->open();
+    TL_ASSERT(mImageReader->isOpen(), "Can't open the DTM");
+
+    mRows = mImageReader->rows();
+    mCols = mImageReader->cols();
+    mGeoreference = mImageReader->georeference();
+
+    bool exist_nodata = false;
+    double nodata = mImageReader->noDataValue(&exist_nodata);
+    if (exist_nodata) mNoDataValue = nodata;
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+bool DtmCache::isOpen() const
+{
+  return mImageReader && mImageReader->isOpen();
+}
+
+void DtmCache::close()
+{
+  std::lock_guard<std::mutex> lck(mMutex);
+
+  if (mImageReader) mImageReader->close();
+  mTiles.clear();
+  mTilesIndex.clear();
+}
+
+int DtmCache::rows() const
+{
+  return mRows;
+}
+
+int DtmCache::cols() const
+{
+  return mCols;
+}
+
+Affine<PointD> DtmCache::georeference() const
+{
+  return mGeoreference;
+}
+
+WindowD DtmCache::window() const
+{
+  std::vector<PointD> corners{
+    mGeoreference.transform(PointD(0, 0)),
+    mGeoreference.transform(PointD(mCols, 0)),
+    mGeoreference.transform(PointD(mCols, mRows)),
+    mGeoreference.transform(PointD(0, mRows))
+  };
+
+  return WindowD(corners);
+}
+
+double DtmCache::noDataValue() const
+{
+  return mNoDataValue;
+}
+
+cv::Mat DtmCache::read(const WindowI &window)
+{
+  cv::Mat block;
+
+  try {
+
+    TL_ASSERT(isOpen(), "The DTM has not been opened. Use DtmCache::open() method");
+
+    block = cv::Mat(window.height(), window.width(), CV_32F, cv::Scalar(mNoDataValue));
+
+    WindowI dtm_window(PointI(0, 0), PointI(mCols, mRows));
+    WindowI read_window = windowIntersection(dtm_window, window);
+    if (read_window.width() <= 0 || read_window.height() <= 0) return block;
+
+    int tile_row_ini = read_window.pt1.y / mTileSize;
+    int tile_row_end = (read_window.pt2.y - 1) / mTileSize;
+    int tile_col_ini = read_window.pt1.x / mTileSize;
+    int tile_col_end = (read_window.pt2.x - 1) / mTileSize;
+
+    std::lock_guard<std::mutex> lck(mMutex);
+
+    for (int r = tile_row_ini; r <= tile_row_end; r++) {
+      for (int c = tile_col_ini; c <= tile_col_end; c++) {
+
+        cv::Mat dtm_tile = tile(r, c);
+
+        WindowI tile_window(PointI(c * mTileSize, r * mTileSize),
+                            PointI(c * mTileSize + dtm_tile.cols, r * mTileSize + dtm_tile.rows));
+        WindowI intersection = windowIntersection(tile_window, read_window);
+
+        cv::Rect src(intersection.pt1.x - tile_window.pt1.x,
+                     intersection.pt1.y - tile_window.pt1.y,
+                     intersection.width(), intersection.height());
+        cv::Rect dst(intersection.pt1.x - window.pt1.x,
+                     intersection.pt1.y - window.pt1.y,
+                     intersection.width(), intersection.height());
+
+        dtm_tile(src).copyTo(block(dst));
+      }
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return block;
+}
+
+cv::Mat DtmCache::read(const WindowD &terrainWindow,
+                       WindowI *window)
+{
+  cv::Mat block;
+
+  try {
+
+    std::vector<PointD> corners{
+      mGeoreference.transform(terrainWindow.pt1, Transform::Order::inverse),
+      mGeoreference.transform(PointD(terrainWindow.pt2.x, terrainWindow.pt1.y), Transform::Order::inverse),
+      mGeoreference.transform(terrainWindow.pt2, Transform::Order::inverse),
+      mGeoreference.transform(PointD(terrainWindow.pt1.x, terrainWindow.pt2.y), Transform::Order::inverse)
+    };
+    WindowD pixel_window(corners);
+
+    /// Un pixel de margen para la interpolación bilineal
+    WindowI read_window(PointI(static_cast<int>(std::floor(pixel_window.pt1.x)) - 1,
+                               static_cast<int>(std::floor(pixel_window.pt1.y)) - 1),
+                        PointI(static_cast<int>(std::ceil(pixel_window.pt2.x)) + 1,
+                               static_cast<int>(std::ceil(pixel_window.pt2.y)) + 1));
+
+    block = read(read_window);
+
+    if (window) *window = read_window;
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return block;
+}
+
+double DtmCache::height(const PointD &point)
+{
+  double z = mNoDataValue;
+
+  try {
+
+    PointD pixel = mGeoreference.transform(point, Transform::Order::inverse);
+
+    /// Coordenadas respecto al centro del pixel
+    double u = pixel.x - 0.5;
+    double v = pixel.y - 0.5;
+    int col = static_cast<int>(std::floor(u));
+    int row = static_cast<int>(std::floor(v));
+
+    cv::Mat block = read(WindowI(PointI(col, row), PointI(col + 2, row + 2)));
+
+    float z00 = block.at<float>(0, 0);
+    float z01 = block.at<float>(0, 1);
+    float z10 = block.at<float>(1, 0);
+    float z11 = block.at<float>(1, 1);
+
+    if (z00 != mNoDataValue && z01 != mNoDataValue &&
+        z10 != mNoDataValue && z11 != mNoDataValue) {
+      double du = u - col;
+      double dv = v - row;
+      z = (z00 * (1. - du) + z01 * du) * (1. - dv) +
+          (z10 * (1. - du) + z11 * du) * dv;
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return z;
+}
+
+cv::Mat DtmCache::overview(int maxSize, Affine<PointD> *georeference)
+{
+  cv::Mat image;
+
+  try {
+
+    TL_ASSERT(isOpen(), "The DTM has not been opened. Use DtmCache::open() method");
+    TL_ASSERT(maxSize > 0, "Invalid size");
+
+    double scale = std::min(1., static_cast<double>(maxSize) / std::max(mRows, mCols));
+
+    {
+      std::lock_guard<std::mutex> lck(mMutex);
+      mImageReader->read(scale, scale).convertTo(image, CV_32F);
+    }
+
+    if (image.channels() > 1) {
+      cv::extractChannel(image, image, 0);
+    }
+
+    if (georeference) {
+      /// Georeferencia de la imagen reducida: pixel reducido -> pixel MDT -> terreno
+      math::Matrix<double, 2, 3> parameters = mGeoreference.parameters();
+      double scale_x = static_cast<double>(mCols) / image.cols;
+      double scale_y = static_cast<double>(mRows) / image.rows;
+      georeference->setParameters(parameters.at(0, 0) * scale_x, parameters.at(0, 1) * scale_y,
+                                  parameters.at(1, 0) * scale_x, parameters.at(1, 1) * scale_y,
+                                  parameters.at(0, 2), parameters.at(1, 2));
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return image;
+}
+
+cv::Mat DtmCache::tile(int row, int col)
+{
+  long long key = (static_cast<long long>(row) << 32) | static_cast<unsigned int>(col);
+
+  auto it = mTilesIndex.find(key);
+  if (it != mTilesIndex.end()) {
+    mTiles.splice(mTiles.begin(), mTiles, it->second);
+    return it->second->second;
+  }
+
+  int x = col * mTileSize;
+  int y = row * mTileSize;
+  int width = std::min(mTileSize, mCols - x);
+  int height = std::min(mTileSize, mRows - y);
+
+  cv::Mat dtm_tile;
+  mImageReader->read(RectI(x, y, width, height)).convertTo(dtm_tile, CV_32F);
+  if (dtm_tile.channels() > 1) {
+    cv::extractChannel(dtm_tile, dtm_tile, 0);
+  }
+
+  mTiles.emplace_front(key, dtm_tile);
+  mTilesIndex[key] = mTiles.begin();
+
+  if (mTiles.size() > mCacheSize) {
+    mTilesIndex.erase(mTiles.back().first);
+    mTiles.pop_back();
+  }
+
+  return dtm_tile;
+}
+
+
+
+/* Orthorectification */
+
+Orthorectification::Orthorectification(const Path &dtm)
+  : Orthorectification(std::make_shared<DtmCache>(dtm))
+{
+}
+
+Orthorectification::Orthorectification(std::shared_ptr<DtmCache> dtm)
+  : mDtm(std::move(dtm)),
+    mResampling(Resampling::bilinear),
+    mTileSize(512),
+    mNoDataValue(0.)
+{
+  TL_ASSERT(mDtm, "Invalid DTM");
+}
+
+Orthorectification::~Orthorectification() = default;
+
+Orthorectification::Resampling Orthorectification::resampling() const
+{
+  return mResampling;
+}
+
+void Orthorectification::setResampling(Resampling resampling)
+{
+  mResampling = resampling;
+}
+
+int Orthorectification::tileSize() const
+{
+  return mTileSize;
+}
+
+void Orthorectification::setTileSize(int tileSize)
+{
+  TL_ASSERT(tileSize > 0, "Invalid tile size");
+  mTileSize = tileSize;
+}
+
+double Orthorectification::noDataValue() const
+{
+  return mNoDataValue;
+}
+
+void Orthorectification::setNoDataValue(double noDataValue)
+{
+  mNoDataValue = noDataValue;
+}
+
+void Orthorectification::setCRS(const std::string &crs)
+{
+  mCRS = crs;
+}
+
+WindowD Orthorectification::orthoWindow(const DifferentialRectification &differentialRectification,
+                                        const PointD &principalPoint,
+                                        int rows,
+                                        int cols)
+{
+  WindowD window;
+
+  try {
+
+    if (!mDtm->isOpen()) mDtm->open();
+
+    double nodata = mDtm->noDataValue();
+    Point3D camera_position = differentialRectification.cameraPosition();
+
+    double z_ini = mDtm->height(PointD(camera_position.x, camera_position.y));
+    if (z_ini == nodata) z_ini = mDtm->height(mDtm->window().center());
+    if (z_ini == nodata) z_ini = 0.;
+
+    /// Esquinas y puntos medios de los lados
+    std::vector<PointD> image_points{
+      PointD(0, 0), PointD(cols / 2., 0), PointD(cols, 0),
+      PointD(cols, rows / 2.), PointD(cols, rows),
+      PointD(cols / 2., rows), PointD(0, rows), PointD(0, rows / 2.)
+    };
+
+    std::vector<PointD> terrain_points;
+    terrain_points.reserve(image_points.size());
+
+    for (const auto &image_point : image_points) {
+
+      PointD photo_point(image_point.x - principalPoint.x,
+                         principalPoint.y - image_point.y);
+
+      double z = z_ini;
+      Point3D terrain_point;
+      for (int i = 0; i < 10; i++) {
+        terrain_point = differentialRectification.forwardProjection(photo_point, z);
+        double z_dtm = mDtm->height(PointD(terrain_point.x, terrain_point.y));
+        if (z_dtm == nodata || std::abs(z_dtm - z) < 0.01) break;
+        z = z_dtm;
+      }
+
+      terrain_points.emplace_back(terrain_point.x, terrain_point.y);
+    }
+
+    window = WindowD(terrain_points);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return window;
+}
+
+void Orthorectification::run(const Path &image,
+                             const DifferentialRectification &differentialRectification,
+                             const PointD &principalPoint,
+                             const Path &ortho,
+                             double resolution,
+                             const WindowD &window,
+                             Progress *progress)
+{
+  try {
+
+    TL_ASSERT(resolution > 0., "Invalid resolution");
+
+    if (!mDtm->isOpen()) mDtm->open();
+
+    std::unique_ptr<ImageReader> image_reader = ImageReaderFactory::create(image);
+    image_reader->open();
+    TL_ASSERT(image_reader->isOpen(), "Can't open the image");
+
+    int image_rows = image_reader->rows();
+    int image_cols = image_reader->cols();
+
+    WindowD ortho_window = window.isEmpty() ?
+      orthoWindow(differentialRectification, principalPoint, image_rows, image_cols) : window;
+
+    int rows = static_cast<int>(std::ceil(ortho_window.height() / resolution));
+    int cols = static_cast<int>(std::ceil(ortho_window.width() / resolution));
+    TL_ASSERT(rows > 0 && cols > 0, "Empty orthoimage");
+
+    std::unique_ptr<ImageWriter> image_writer = ImageWriterFactory::create(ortho);
+    image_writer->open();
+    TL_ASSERT(image_writer->isOpen(), "Can't create the orthoimage");
+    image_writer->create(rows, cols, image_reader->channels(), image_reader->dataType());
+    image_writer->setGeoreference(Affine<PointD>(ortho_window.pt1.x, ortho_window.pt2.y,
+                                                 resolution, -resolution, 0.));
+    if (!mCRS.empty()) image_writer->setCRS(mCRS);
+    image_writer->setNoDataValue(mNoDataValue);
+
+    int tile_rows = (rows + mTileSize - 1) / mTileSize;
+    int tile_cols = (cols + mTileSize - 1) / mTileSize;
+    size_t tile_count = static_cast<size_t>(tile_rows) * static_cast<size_t>(tile_cols);
+
+    if (progress) {
+      progress->setRange(0, tile_count);
+      progress->setText("Orthorectification");
+    }
+
+    int interpolation = mResampling == Resampling::nearest ? cv::INTER_NEAREST :
+                        mResampling == Resampling::bilinear ? cv::INTER_LINEAR : cv::INTER_CUBIC;
+
+    Affine<PointD> dtm_georeference = mDtm->georeference();
+    double nodata_dtm = mDtm->noDataValue();
+    cv::Scalar nodata_ortho = cv::Scalar::all(mNoDataValue);
+    int image_type = CV_MAKETYPE(dataTypeToOpenCVDataType(image_reader->dataType()), image_reader->channels());
+
+    std::mutex reader_mutex;
+    std::mutex writer_mutex;
+    std::atomic<size_t> next_tile(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+
+    /// Cada hilo toma la siguiente tesela libre
+    auto worker = [&](size_t) {
+
+      std::vector<Point3D> terrain_points;
+      std::vector<PointD> photo_points;
+
+      try {
+
+        for (size_t tile = next_tile++; tile < tile_count && !failed; tile = next_tile++) {
+
+          int r0 = static_cast<int>(tile / tile_cols) * mTileSize;
+          int c0 = static_cast<int>(tile % tile_cols) * mTileSize;
+          int height = std::min(mTileSize, rows - r0);
+          int width = std::min(mTileSize, cols - c0);
+
+          double x0 = ortho_window.pt1.x + c0 * resolution;
+          double y0 = ortho_window.pt2.y - r0 * resolution;
+          WindowD tile_window(PointD(x0, y0 - height * resolution),
+                              PointD(x0 + width * resolution, y0));
+
+          /// Altura de cada pixel interpolada del MDT
+          WindowI dtm_window;
+          cv::Mat dtm = mDtm->read(tile_window, &dtm_window);
+
+          cv::Mat map_x(height, width, CV_32F);
+          cv::Mat map_y(height, width, CV_32F);
+
+          for (int r = 0; r < height; r++) {
+            float *ptr_x = map_x.ptr<float>(r);
+            float *ptr_y = map_y.ptr<float>(r);
+            double y = y0 - (r + 0.5) * resolution;
+            for (int c = 0; c < width; c++) {
+              PointD pixel = dtm_georeference.transform(PointD(x0 + (c + 0.5) * resolution, y),
+                                                        Transform::Order::inverse);
+              ptr_x[c] = static_cast<float>(pixel.x - 0.5 - dtm_window.pt1.x);
+              ptr_y[c] = static_cast<float>(pixel.y - 0.5 - dtm_window.pt1.y);
+            }
+          }
+
+          cv::Mat z;
+          cv::remap(dtm, z, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(nodata_dtm));
+          cv::Mat nodata_mask;
+          cv::remap(dtm == nodata_dtm, nodata_mask, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(255));
+
+          /// Proyección en bloque de la tesela a la imagen
+          terrain_points.resize(static_cast<size_t>(width) * height);
+          for (int r = 0; r < height; r++) {
+            const float *ptr_z = z.ptr<float>(r);
+            double y = y0 - (r + 0.5) * resolution;
+            for (int c = 0; c < width; c++) {
+              Point3D &terrain_point = terrain_points[static_cast<size_t>(r) * width + c];
+              terrain_point.x = x0 + (c + 0.5) * resolution;
+              terrain_point.y = y;
+              terrain_point.z = ptr_z[c];
+            }
+          }
+
+          differentialRectification.backwardProjection(terrain_points, photo_points);
+
+          double col_min = std::numeric_limits<double>::max();
+          double row_min = std::numeric_limits<double>::max();
+          double col_max = -std::numeric_limits<double>::max();
+          double row_max = -std::numeric_limits<double>::max();
+
+          for (int r = 0; r < height; r++) {
+            const uchar *ptr_mask = nodata_mask.ptr<uchar>(r);
+            for (int c = 0; c < width; c++) {
+              PointD &point = photo_points[static_cast<size_t>(r) * width + c];
+              point.x = principalPoint.x + point.x - 0.5;
+              point.y = principalPoint.y - point.y - 0.5;
+              if (ptr_mask[c] != 0 ||
+                  point.x < -1. || point.x > image_cols ||
+                  point.y < -1. || point.y > image_rows) {
+                point.x = -1.e6;
+                continue;
+              }
+              col_min = std::min(col_min, point.x);
+              row_min = std::min(row_min, point.y);
+              col_max = std::max(col_max, point.x);
+              row_max = std::max(row_max, point.y);
+            }
+          }
+
+          cv::Mat ortho_tile;
+
+          if (col_min <= col_max) {
+
+            /// Ventana de la imagen que cubre la tesela con margen para el kernel bicúbico
+            WindowI image_window(PointI(static_cast<int>(std::floor(col_min)) - 2,
+                                        static_cast<int>(std::floor(row_min)) - 2),
+                                 PointI(static_cast<int>(std::ceil(col_max)) + 3,
+                                        static_cast<int>(std::ceil(row_max)) + 3));
+            image_window = windowIntersection(image_window, WindowI(PointI(0, 0), PointI(image_cols, image_rows)));
+
+            cv::Mat image_block;
+            {
+              std::lock_guard<std::mutex> lck(reader_mutex);
+              image_block = image_reader->read(RectI(image_window.pt1.x, image_window.pt1.y,
+                                                     image_window.width(), image_window.height()));
+            }
+
+            for (int r = 0; r < height; r++) {
+              float *ptr_x = map_x.ptr<float>(r);
+              float *ptr_y = map_y.ptr<float>(r);
+              for (int c = 0; c < width; c++) {
+                const PointD &point = photo_points[static_cast<size_t>(r) * width + c];
+                ptr_x[c] = static_cast<float>(point.x - image_window.pt1.x);
+                ptr_y[c] = static_cast<float>(point.y - image_window.pt1.y);
+              }
+            }
+
+            cv::remap(image_block, ortho_tile, map_x, map_y, interpolation, cv::BORDER_CONSTANT, nodata_ortho);
+
+          } else {
+            ortho_tile = cv::Mat(height, width, image_type, nodata_ortho);
+          }
+
+          std::lock_guard<std::mutex> lck(writer_mutex);
+          image_writer->write(ortho_tile, WindowI(PointI(c0, r0), PointI(c0 + width, r0 + height)));
+          if (progress) (*progress)();
+        }
+
+      } catch (...) {
+        std::lock_guard<std::mutex> lck(writer_mutex);
+        if (!failed) error = std::current_exception();
+        failed = true;
+      }
+    };
+
+    size_t num_threads = std::min(static_cast<size_t>(optimalNumberOfThreads()), tile_count);
+    parallel_for(0, num_threads, worker);
+
+    if (error) std::rethrow_exception(error);
+
+    image_writer->close();
+    image_reader->close();
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+} // End namespace geospatial
+
+} // End namespace tl
+
+#endif // TL_HAVE_OPENCV
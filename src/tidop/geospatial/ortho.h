@@ -0,0 +1,258 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOSPATIAL_ORTHO_H
+#define TL_GEOSPATIAL_ORTHO_H
+
+#include "config_tl.h"
+
+#ifdef TL_HAVE_OPENCV
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "opencv2/core/core.hpp"
+
+#include "tidop/core/defs.h"
+#include "tidop/core/path.h"
+#include "tidop/geometry/entities/point.h"
+#include "tidop/geometry/entities/window.h"
+#include "tidop/geometry/transform/affine.h"
+#include "tidop/geospatial/diffrect.h"
+
+namespace tl
+{
+
+class ImageReader;
+class Progress;
+
+namespace geospatial
+{
+
+/*!
+ * \brief Lectura de un MDT por teselas con caché LRU
+ *
+ * El MDT se divide en teselas cuadradas que se leen bajo demanda y se
+ * mantienen en memoria hasta que se supera el tamaño de la caché.
+ * Todos los métodos de lectura son seguros para su uso desde varios hilos.
+ */
+class TL_EXPORT DtmCache
+{
+
+public:
+
+  /*!
+   * \brief Constructor
+   * \param[in] dtm Fichero del MDT
+   * \param[in] tileSize Tamaño de tesela en pixeles
+   * \param[in] cacheSize Número máximo de teselas en memoria
+   */
+  DtmCache(const Path &dtm,
+           int tileSize = 256,
+           size_t cacheSize = 64);
+  ~DtmCache();
+
+  TL_DISABLE_COPY(DtmCache)
+  TL_DISABLE_MOVE(DtmCache)
+
+  void open();
+  bool isOpen() const;
+  void close();
+
+  int rows() const;
+  int cols() const;
+
+  /*!
+   * \brief Georeferencia del MDT (pixel a terreno)
+   */
+  Affine<PointD> georeference() const;
+
+  /*!
+   * \brief Ventana envolvente del MDT en coordenadas terreno
+   */
+  WindowD window() const;
+
+  double noDataValue() const;
+
+  /*!
+   * \brief Lee una ventana del MDT como imagen CV_32F
+   * Las zonas fuera del MDT se rellenan con el valor NoData
+   * \param[in] window Ventana en coordenadas pixel del MDT
+   */
+  cv::Mat read(const WindowI &window);
+
+  /*!
+   * \brief Lee la ventana del MDT que cubre una ventana terreno
+   * \param[in] terrainWindow Ventana en coordenadas terreno
+   * \param[out] window Ventana leida en coordenadas pixel del MDT
+   */
+  cv::Mat read(const WindowD &terrainWindow, WindowI *window);
+
+  /*!
+   * \brief Altura interpolada (bilineal) en un punto
+   * \param[in] point Punto en coordenadas terreno
+   * \return Altura o el valor NoData si el punto está fuera del MDT o no tiene valor
+   */
+  double height(const PointD &point);
+
+  /*!
+   * \brief Lee el MDT completo a resolución reducida
+   * Si el fichero tiene pirámides se leen de ellas
+   * \param[in] maxSize Tamaño máximo en filas o columnas
+   * \param[out] georeference Georeferencia de la imagen reducida
+   */
+  cv::Mat overview(int maxSize, Affine<PointD> *georeference);
+
+private:
+
+  cv::Mat tile(int row, int col);
+
+private:
+
+  std::unique_ptr<ImageReader> mImageReader;
+  int mTileSize;
+  size_t mCacheSize;
+  int mRows;
+  int mCols;
+  Affine<PointD> mGeoreference;
+  double mNoDataValue;
+  std::list<std::pair<long long, cv::Mat>> mTiles;
+  std::unordered_map<long long, std::list<std::pair<long long, cv::Mat>>::iterator> mTilesIndex;
+  std::mutex mMutex;
+
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+/*!
+ * \brief Ortorectificación de imágenes
+ *
+ * La ortoimagen se divide en teselas que se procesan en paralelo. Para
+ * cada tesela se interpola la altura de todos sus pixeles a partir del MDT,
+ * se proyectan en bloque a la imagen mediante la rectificación diferencial
+ * y se remuestrea la imagen. Cada tesela se escribe en cuanto se termina
+ * por lo que la ortoimagen nunca se mantiene completa en memoria.
+ *
+ * Las coordenadas imagen de la rectificación diferencial son coordenadas
+ * foto con origen en el punto principal:
+ * \f[ x = col - cx \f]
+ * \f[ y = cy - row \f]
+ * \code
+ * Orthorectification ortho("mdt.tif");
+ * ortho.setResampling(Orthorectification::Resampling::bilinear);
+ * ortho.run("image.jpg", DifferentialRectification(rotation, position, focal),
+ *           PointD(cx, cy), "ortho.tif", 0.1);
+ * \endcode
+ */
+class TL_EXPORT Orthorectification
+{
+
+public:
+
+  enum class Resampling
+  {
+    nearest,
+    bilinear,
+    bicubic
+  };
+
+public:
+
+  Orthorectification(const Path &dtm);
+  Orthorectification(std::shared_ptr<DtmCache> dtm);
+  ~Orthorectification();
+
+  TL_DISABLE_COPY(Orthorectification)
+  TL_DISABLE_MOVE(Orthorectification)
+
+  Resampling resampling() const;
+  void setResampling(Resampling resampling);
+
+  /*!
+   * \brief Tamaño de las teselas de la ortoimagen en pixeles
+   */
+  int tileSize() const;
+  void setTileSize(int tileSize);
+
+  double noDataValue() const;
+  void setNoDataValue(double noDataValue);
+
+  /*!
+   * \brief Sistema de referencia de la ortoimagen
+   */
+  void setCRS(const std::string &crs);
+
+  /*!
+   * \brief Ventana terreno que cubre la imagen
+   * Las esquinas de la imagen se intersectan de forma iterativa con el MDT
+   * \param[in] differentialRectification Rectificación diferencial de la imagen
+   * \param[in] principalPoint Punto principal en pixeles
+   * \param[in] rows Filas de la imagen
+   * \param[in] cols Columnas de la imagen
+   */
+  WindowD orthoWindow(const DifferentialRectification &differentialRectification,
+                      const PointD &principalPoint,
+                      int rows,
+                      int cols);
+
+  /*!
+   * \brief Genera la ortoimagen
+   * \param[in] image Imagen
+   * \param[in] differentialRectification Rectificación diferencial de la imagen
+   * \param[in] principalPoint Punto principal en pixeles
+   * \param[in] ortho Ortoimagen de salida
+   * \param[in] resolution Tamaño de pixel de la ortoimagen
+   * \param[in] window Ventana de la ortoimagen. Por defecto la que cubre la imagen
+   * \param[in] progress Barra de progreso
+   */
+  void run(const Path &image,
+           const DifferentialRectification &differentialRectification,
+           const PointD &principalPoint,
+           const Path &ortho,
+           double resolution,
+           const WindowD &window = WindowD(),
+           Progress *progress = nullptr);
+
+private:
+
+  std::shared_ptr<DtmCache> mDtm;
+  Resampling mResampling;
+  int mTileSize;
+  double mNoDataValue;
+  std::string mCRS;
+
+};
+
+} // End namespace geospatial
+
+} // End namespace tl
+
+#endif // TL_HAVE_OPENCV
+
+#endif // TL_GEOSPATIAL_ORTHO_H
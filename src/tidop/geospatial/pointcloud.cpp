@@ -0,0 +1,855 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "tidop/geospatial/pointcloud.h"
+
+#include "tidop/core/exception.h"
+#include "tidop/core/messages.h"
+#include "tidop/core/utils.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+namespace tl
+{
+
+namespace geospatial
+{
+
+namespace internal
+{
+
+constexpr size_t las_header_size_max = 375;
+
+/*!
+ * \brief Exact powers of ten representable as double
+ */
+constexpr double pow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*!
+ * \brief Parses a decimal number
+ *
+ * Numbers with up to 19 significant digits and a power of ten in the exact
+ * range are converted with a single multiplication or division, which gives
+ * the correctly rounded result when the mantissa fits in 53 bits. Any other
+ * number falls back to strtod.
+ * \param[in,out] ptr Start of the number. On success it points to the first character after the number
+ * \param[in] end End of the buffer
+ * \param[out] value Parsed value
+ * \return true if a number was parsed
+ */
+inline bool parseDouble(const char *&ptr, const char *end, double *value)
+{
+  const char *p = ptr;
+  bool negative = false;
+
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any_digit = false;
+
+  while (p < end && *p >= '0' && *p <= '9') {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+      if (mantissa) digits++;
+    } else {
+      exponent++;
+    }
+    any_digit = true;
+    p++;
+  }
+
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && *p >= '0' && *p <= '9') {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        if (mantissa) digits++;
+        exponent--;
+      }
+      any_digit = true;
+      p++;
+    }
+  }
+
+  if (!any_digit) return false;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char *p_exp = p + 1;
+    bool negative_exp = false;
+    if (p_exp < end && (*p_exp == '-' || *p_exp == '+')) {
+      negative_exp = (*p_exp == '-');
+      p_exp++;
+    }
+    if (p_exp < end && *p_exp >= '0' && *p_exp <= '9') {
+      int exp = 0;
+      while (p_exp < end && *p_exp >= '0' && *p_exp <= '9') {
+        if (exp < 10000) exp = exp * 10 + (*p_exp - '0');
+        p_exp++;
+      }
+      exponent += negative_exp ? -exp : exp;
+      p = p_exp;
+    }
+  }
+
+  if (mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+    double v = static_cast<double>(mantissa);
+    v = exponent < 0 ? v / pow10[-exponent] : v * pow10[exponent];
+    *value = negative ? -v : v;
+  } else {
+    std::string number(ptr, p);
+    *value = std::strtod(number.c_str(), nullptr);
+  }
+
+  ptr = p;
+  return true;
+}
+
+inline bool isBlank(char c)
+{
+  return c == ' ' || c == '\t';
+}
+
+template<typename T> inline
+T readLittleEndian(const char *data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+inline int fileSeek(std::FILE *file, uint64_t offset)
+{
+#ifdef WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+} // namespace internal
+
+
+
+PointCloudReader::PointCloudReader(Path file)
+  : mFile(std::move(file))
+{
+}
+
+Path PointCloudReader::file() const
+{
+  return mFile;
+}
+
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+
+PointCloudReaderCsv::PointCloudReaderCsv(Path file, char delimiter)
+  : PointCloudReader(std::move(file)),
+    mFileHandle(nullptr),
+    mDelimiter(delimiter),
+    mColumnX(0),
+    mColumnY(1),
+    mColumnZ(2),
+    mSkipLines(0),
+    mBlockSize(1 << 20),
+    mBufferBegin(0),
+    mBufferEnd(0),
+    mEof(false),
+    mLine(0)
+{
+}
+
+PointCloudReaderCsv::~PointCloudReaderCsv()
+{
+  this->close();
+}
+
+void PointCloudReaderCsv::open()
+{
+  try {
+
+    this->close();
+
+    mFileHandle = std::fopen(mFile.toString().c_str(), "rb");
+    TL_ASSERT(mFileHandle != nullptr, "Can't open the file");
+
+    this->rewind();
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+bool PointCloudReaderCsv::isOpen() const
+{
+  return mFileHandle != nullptr;
+}
+
+void PointCloudReaderCsv::close()
+{
+  if (mFileHandle) {
+    std::fclose(mFileHandle);
+    mFileHandle = nullptr;
+  }
+  mBuffer.clear();
+  mBuffer.shrink_to_fit();
+}
+
+size_t PointCloudReaderCsv::read(std::vector<Point3D> &points, size_t maxPoints)
+{
+  points.clear();
+
+  try {
+
+    TL_ASSERT(isOpen(), "The file has not been opened. Try to use PointCloudReaderCsv::open() method");
+
+    points.reserve(std::min(maxPoints, static_cast<size_t>(1 << 20)));
+    Point3D point;
+
+    while (points.size() < maxPoints) {
+
+      const char *begin = mBuffer.data() + mBufferBegin;
+      const char *end = mBuffer.data() + mBufferEnd;
+      const char *line_end = static_cast<const char *>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+
+      if (line_end == nullptr) {
+        if (mEof) {
+          if (begin == end) break;
+          /// Last line without end of line character
+          line_end = end;
+        } else {
+          fillBuffer();
+          continue;
+        }
+      }
+
+      if (mLine++ >= static_cast<size_t>(mSkipLines) &&
+          parseLine(begin, line_end, &point)) {
+        points.push_back(point);
+      }
+
+      mBufferBegin = std::min(static_cast<size_t>(line_end - mBuffer.data()) + 1, mBufferEnd);
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return points.size();
+}
+
+void PointCloudReaderCsv::rewind()
+{
+  TL_ASSERT(isOpen(), "The file has not been opened. Try to use PointCloudReaderCsv::open() method");
+
+  std::rewind(mFileHandle);
+  mBuffer.resize(mBlockSize);
+  mBufferBegin = 0;
+  mBufferEnd = 0;
+  mEof = false;
+  mLine = 0;
+}
+
+size_t PointCloudReaderCsv::size() const
+{
+  return 0;
+}
+
+BoundingBoxD PointCloudReaderCsv::boundingBox() const
+{
+  return BoundingBoxD();
+}
+
+char PointCloudReaderCsv::delimiter() const
+{
+  return mDelimiter;
+}
+
+void PointCloudReaderCsv::setDelimiter(char delimiter)
+{
+  mDelimiter = delimiter;
+}
+
+void PointCloudReaderCsv::setColumns(int x, int y, int z)
+{
+  mColumnX = x;
+  mColumnY = y;
+  mColumnZ = z;
+}
+
+void PointCloudReaderCsv::setSkipLines(int skipLines)
+{
+  mSkipLines = skipLines;
+}
+
+void PointCloudReaderCsv::setBlockSize(size_t blockSize)
+{
+  mBlockSize = std::max(blockSize, static_cast<size_t>(1024));
+}
+
+bool PointCloudReaderCsv::fillBuffer()
+{
+  /// Se mueve la línea incompleta al inicio del buffer
+  size_t remaining = mBufferEnd - mBufferBegin;
+  if (mBufferBegin > 0 && remaining > 0) {
+    std::memmove(mBuffer.data(), mBuffer.data() + mBufferBegin, remaining);
+  }
+  mBufferBegin = 0;
+  mBufferEnd = remaining;
+
+  /// Línea mas larga que el buffer
+  if (mBufferEnd == mBuffer.size()) {
+    mBuffer.resize(mBuffer.size() * 2);
+  }
+
+  size_t bytes = std::fread(mBuffer.data() + mBufferEnd, 1, mBuffer.size() - mBufferEnd, mFileHandle);
+  mBufferEnd += bytes;
+  if (bytes == 0) mEof = true;
+
+  return bytes > 0;
+}
+
+bool PointCloudReaderCsv::parseLine(const char *begin, const char *end, Point3D *point) const
+{
+  if (end > begin && *(end - 1) == '\r') end--;
+
+  int last_column = std::max(mColumnX, std::max(mColumnY, mColumnZ));
+  bool blank_delimiter = internal::isBlank(mDelimiter);
+  int found = 0;
+  const char *ptr = begin;
+
+  for (int column = 0; column <= last_column; column++) {
+
+    while (ptr < end && internal::isBlank(*ptr)) ptr++;
+
+    if (ptr >= end) return false;
+
+    if (column == mColumnX || column == mColumnY || column == mColumnZ) {
+      double value;
+      if (!internal::parseDouble(ptr, end, &value)) return false;
+      if (column == mColumnX) point->x = value;
+      if (column == mColumnY) point->y = value;
+      if (column == mColumnZ) point->z = value;
+      found++;
+    }
+
+    /// Salto al siguiente campo
+    if (blank_delimiter) {
+      while (ptr < end && !internal::isBlank(*ptr) && *ptr != ',' && *ptr != ';') ptr++;
+      if (ptr < end && (*ptr == ',' || *ptr == ';')) ptr++;
+    } else {
+      while (ptr < end && *ptr != mDelimiter) ptr++;
+      if (ptr < end) ptr++;
+    }
+  }
+
+  return found == 3;
+}
+
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+
+PointCloudReaderXYZ::PointCloudReaderXYZ(Path file)
+  : PointCloudReaderCsv(std::move(file), ' ')
+{
+}
+
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+
+PointCloudReaderLas::PointCloudReaderLas(Path file)
+  : PointCloudReader(std::move(file)),
+    mFileHandle(nullptr),
+    mVersionMajor(0),
+    mVersionMinor(0),
+    mPointDataFormat(0),
+    mPointDataOffset(0),
+    mPointRecordLength(0),
+    mPointCount(0),
+    mPointsRead(0),
+    mScale(1., 1., 1.),
+    mOffset(0., 0., 0.)
+{
+}
+
+PointCloudReaderLas::~PointCloudReaderLas()
+{
+  this->close();
+}
+
+void PointCloudReaderLas::open()
+{
+  try {
+
+    this->close();
+
+    mFileHandle = std::fopen(mFile.toString().c_str(), "rb");
+    TL_ASSERT(mFileHandle != nullptr, "Can't open the file");
+
+    this->readHeader();
+    this->rewind();
+
+  } catch (...) {
+    this->close();
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+bool PointCloudReaderLas::isOpen() const
+{
+  return mFileHandle != nullptr;
+}
+
+void PointCloudReaderLas::close()
+{
+  if (mFileHandle) {
+    std::fclose(mFileHandle);
+    mFileHandle = nullptr;
+  }
+  mBuffer.clear();
+  mBuffer.shrink_to_fit();
+}
+
+size_t PointCloudReaderLas::read(std::vector<Point3D> &points, size_t maxPoints)
+{
+  points.clear();
+
+  try {
+
+    TL_ASSERT(isOpen(), "The file has not been opened. Try to use PointCloudReaderLas::open() method");
+
+    size_t count = std::min(maxPoints, mPointCount - mPointsRead);
+    if (count == 0) return 0;
+
+    mBuffer.resize(count * mPointRecordLength);
+    size_t records = std::fread(mBuffer.data(), mPointRecordLength, count, mFileHandle);
+    TL_ASSERT(records == count, "Unexpected end of file");
+
+    points.resize(records);
+    const char *record = mBuffer.data();
+    for (size_t i = 0; i < records; i++, record += mPointRecordLength) {
+      points[i].x = internal::readLittleEndian<int32_t>(record) * mScale.x + mOffset.x;
+      points[i].y = internal::readLittleEndian<int32_t>(record + 4) * mScale.y + mOffset.y;
+      points[i].z = internal::readLittleEndian<int32_t>(record + 8) * mScale.z + mOffset.z;
+    }
+
+    mPointsRead += records;
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return points.size();
+}
+
+void PointCloudReaderLas::rewind()
+{
+  TL_ASSERT(isOpen(), "The file has not been opened. Try to use PointCloudReaderLas::open() method");
+  TL_ASSERT(internal::fileSeek(mFileHandle, mPointDataOffset) == 0, "Seek error");
+  mPointsRead = 0;
+}
+
+size_t PointCloudReaderLas::size() const
+{
+  return mPointCount;
+}
+
+BoundingBoxD PointCloudReaderLas::boundingBox() const
+{
+  return mBoundingBox;
+}
+
+int PointCloudReaderLas::versionMajor() const
+{
+  return mVersionMajor;
+}
+
+int PointCloudReaderLas::versionMinor() const
+{
+  return mVersionMinor;
+}
+
+int PointCloudReaderLas::pointDataFormat() const
+{
+  return mPointDataFormat;
+}
+
+void PointCloudReaderLas::readHeader()
+{
+  char header[internal::las_header_size_max];
+  std::memset(header, 0, internal::las_header_size_max);
+
+  size_t bytes = std::fread(header, 1, internal::las_header_size_max, mFileHandle);
+  TL_ASSERT(bytes >= 227, "Invalid LAS header");
+  TL_ASSERT(std::memcmp(header, "LASF", 4) == 0, "Invalid LAS file signature");
+
+  mVersionMajor = static_cast<uint8_t>(header[24]);
+  mVersionMinor = static_cast<uint8_t>(header[25]);
+  mPointDataOffset = internal::readLittleEndian<uint32_t>(header + 96);
+
+  uint8_t format = static_cast<uint8_t>(header[104]);
+  TL_ASSERT((format & 0xC0) == 0, "Compressed LAS files (LAZ) are not supported");
+  mPointDataFormat = format;
+  if (mPointDataFormat > 10) TL_THROW_EXCEPTION("Point data record format %i not supported", mPointDataFormat);
+
+  mPointRecordLength = internal::readLittleEndian<uint16_t>(header + 105);
+  TL_ASSERT(mPointRecordLength >= 12, "Invalid point data record length");
+
+  mPointCount = internal::readLittleEndian<uint32_t>(header + 107);
+  if (mVersionMajor == 1 && mVersionMinor >= 4 && bytes >= 255) {
+    uint64_t point_count = internal::readLittleEndian<uint64_t>(header + 247);
+    if (point_count > 0) mPointCount = static_cast<size_t>(point_count);
+  }
+
+  mScale.x = internal::readLittleEndian<double>(header + 131);
+  mScale.y = internal::readLittleEndian<double>(header + 139);
+  mScale.z = internal::readLittleEndian<double>(header + 147);
+  mOffset.x = internal::readLittleEndian<double>(header + 155);
+  mOffset.y = internal::readLittleEndian<double>(header + 163);
+  mOffset.z = internal::readLittleEndian<double>(header + 171);
+
+  mBoundingBox.pt2.x = internal::readLittleEndian<double>(header + 179);
+  mBoundingBox.pt1.x = internal::readLittleEndian<double>(header + 187);
+  mBoundingBox.pt2.y = internal::readLittleEndian<double>(header + 195);
+  mBoundingBox.pt1.y = internal::readLittleEndian<double>(header + 203);
+  mBoundingBox.pt2.z = internal::readLittleEndian<double>(header + 211);
+  mBoundingBox.pt1.z = internal::readLittleEndian<double>(header + 219);
+}
+
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+
+std::unique_ptr<PointCloudReader> PointCloudReaderFactory::create(const Path &file)
+{
+  std::unique_ptr<PointCloudReader> point_cloud_reader;
+
+  try {
+
+    std::string extension = file.extension().toString();
+
+    if (compareInsensitiveCase(extension, ".las")) {
+      point_cloud_reader = std::make_unique<PointCloudReaderLas>(file);
+    } else if (compareInsensitiveCase(extension, ".csv")) {
+      point_cloud_reader = std::make_unique<PointCloudReaderCsv>(file);
+    } else if (compareInsensitiveCase(extension, ".xyz") ||
+               compareInsensitiveCase(extension, ".txt") ||
+               compareInsensitiveCase(extension, ".pts")) {
+      point_cloud_reader = std::make_unique<PointCloudReaderXYZ>(file);
+    } else {
+      TL_THROW_EXCEPTION("Invalid point cloud reader: %s", file.fileName().toString().c_str());
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return point_cloud_reader;
+}
+
+bool PointCloudReaderFactory::isExtensionSupported(const std::string &extension)
+{
+  return compareInsensitiveCase(extension, ".las") ||
+         compareInsensitiveCase(extension, ".csv") ||
+         compareInsensitiveCase(extension, ".xyz") ||
+         compareInsensitiveCase(extension, ".txt") ||
+         compareInsensitiveCase(extension, ".pts");
+}
+
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+
+PointCloudTiler::PointCloudTiler(double tileSize,
+                                 Path bucketsPath)
+  : mTileSize(tileSize),
+    mBucketsPath(std::move(bucketsPath)),
+    mRows(0),
+    mCols(0),
+    mMemoryLimit(256 << 20)
+{
+  TL_ASSERT(mTileSize > 0., "Invalid tile size");
+
+  if (mBucketsPath.empty()) {
+    mTemporalDir = std::make_unique<TemporalDir>();
+    mBucketsPath = mTemporalDir->path();
+  } else if (!mBucketsPath.exists()) {
+    mBucketsPath.createDirectories();
+  }
+}
+
+PointCloudTiler::~PointCloudTiler()
+{
+  if (!mTemporalDir) {
+    for (int r = 0; r < mRows; r++) {
+      for (int c = 0; c < mCols; c++) {
+        Path file = bucketFile(r, c);
+        if (file.exists()) Path::removeFile(file);
+      }
+    }
+  }
+}
+
+void PointCloudTiler::setWindow(const WindowD &window)
+{
+  mWindow = window;
+}
+
+void PointCloudTiler::setMemoryLimit(size_t bytes)
+{
+  mMemoryLimit = bytes;
+}
+
+void PointCloudTiler::build(PointCloudReader *reader, size_t chunkSize)
+{
+  try {
+
+    TL_ASSERT(reader != nullptr, "Null point cloud reader");
+
+    if (!reader->isOpen()) reader->open();
+    TL_ASSERT(reader->isOpen(), "The point cloud has not been opened");
+
+    std::vector<Point3D> points;
+
+    /// Ventana de trabajo. Si no se conoce de antemano se hace una pasada previa
+    if (mWindow.isEmpty()) {
+      BoundingBoxD bbox = reader->boundingBox();
+      if (!bbox.isEmpty()) {
+        mWindow = WindowD(PointD(bbox.pt1.x, bbox.pt1.y), PointD(bbox.pt2.x, bbox.pt2.y));
+      } else {
+        reader->rewind();
+        while (reader->read(points, chunkSize) > 0) {
+          for (const auto &point : points) {
+            if (mWindow.pt1.x > point.x) mWindow.pt1.x = point.x;
+            if (mWindow.pt1.y > point.y) mWindow.pt1.y = point.y;
+            if (mWindow.pt2.x < point.x) mWindow.pt2.x = point.x;
+            if (mWindow.pt2.y < point.y) mWindow.pt2.y = point.y;
+          }
+        }
+      }
+      TL_ASSERT(!mWindow.isEmpty(), "Empty point cloud");
+    }
+
+    mCols = std::max(1, static_cast<int>(std::ceil(mWindow.width() / mTileSize)));
+    mRows = std::max(1, static_cast<int>(std::ceil(mWindow.height() / mTileSize)));
+
+    size_t tiles = static_cast<size_t>(mRows) * static_cast<size_t>(mCols);
+    mPointCount.assign(tiles, 0);
+
+    for (int r = 0; r < mRows; r++) {
+      for (int c = 0; c < mCols; c++) {
+        Path file = bucketFile(r, c);
+        if (file.exists()) Path::removeFile(file);
+      }
+    }
+
+    /// Pasada de reparto en cubos
+
+    std::vector<std::vector<double>> buffers(tiles);
+    size_t buffered_points = 0;
+    size_t max_buffered_points = std::max(mMemoryLimit / (3 * sizeof(double)), static_cast<size_t>(1024));
+    WindowD window_margin = expandWindow(mWindow, mTileSize);
+
+    reader->rewind();
+    while (reader->read(points, chunkSize) > 0) {
+
+      for (const auto &point : points) {
+
+        if (!window_margin.containsPoint(point)) continue;
+
+        int col = static_cast<int>(std::floor((point.x - mWindow.pt1.x) / mTileSize));
+        int row = static_cast<int>(std::floor((mWindow.pt2.y - point.y) / mTileSize));
+        col = std::min(std::max(col, 0), mCols - 1);
+        row = std::min(std::max(row, 0), mRows - 1);
+
+        std::vector<double> &buffer = buffers[static_cast<size_t>(row) * mCols + col];
+        buffer.push_back(point.x);
+        buffer.push_back(point.y);
+        buffer.push_back(point.z);
+
+        if (++buffered_points >= max_buffered_points) {
+          flush(buffers);
+          buffered_points = 0;
+        }
+      }
+
+    }
+
+    flush(buffers);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+int PointCloudTiler::rows() const
+{
+  return mRows;
+}
+
+int PointCloudTiler::cols() const
+{
+  return mCols;
+}
+
+double PointCloudTiler::tileSize() const
+{
+  return mTileSize;
+}
+
+WindowD PointCloudTiler::window() const
+{
+  return mWindow;
+}
+
+WindowD PointCloudTiler::tileWindow(int row, int col) const
+{
+  PointD pt1(mWindow.pt1.x + col * mTileSize,
+             mWindow.pt2.y - (row + 1) * mTileSize);
+  PointD pt2(pt1.x + mTileSize, pt1.y + mTileSize);
+  return WindowD(pt1, pt2);
+}
+
+size_t PointCloudTiler::pointCount() const
+{
+  size_t count = 0;
+  for (auto tile_count : mPointCount)
+    count += tile_count;
+  return count;
+}
+
+size_t PointCloudTiler::pointCount(int row, int col) const
+{
+  TL_ASSERT(row >= 0 && row < mRows && col >= 0 && col < mCols, "Tile out of range");
+  return mPointCount[static_cast<size_t>(row) * mCols + col];
+}
+
+void PointCloudTiler::read(int row, int col, std::vector<Point3D> &points) const
+{
+  points.clear();
+
+  size_t count = pointCount(row, col);
+  if (count == 0) return;
+
+  std::vector<double> buffer(count * 3);
+  std::FILE *file = std::fopen(bucketFile(row, col).toString().c_str(), "rb");
+  TL_ASSERT(file != nullptr, "Can't open bucket file");
+  size_t values = std::fread(buffer.data(), sizeof(double), buffer.size(), file);
+  std::fclose(file);
+  TL_ASSERT(values == buffer.size(), "Corrupt bucket file");
+
+  points.resize(count);
+  for (size_t i = 0, j = 0; i < count; i++, j += 3) {
+    points[i].x = buffer[j];
+    points[i].y = buffer[j + 1];
+    points[i].z = buffer[j + 2];
+  }
+}
+
+void PointCloudTiler::read(const WindowD &window, std::vector<Point3D> &points) const
+{
+  points.clear();
+
+  if (mRows == 0 || mCols == 0 || !intersectWindows(window, expandWindow(mWindow, mTileSize))) return;
+
+  int col_ini = static_cast<int>(std::floor((window.pt1.x - mWindow.pt1.x) / mTileSize));
+  int col_end = static_cast<int>(std::floor((window.pt2.x - mWindow.pt1.x) / mTileSize));
+  int row_ini = static_cast<int>(std::floor((mWindow.pt2.y - window.pt2.y) / mTileSize));
+  int row_end = static_cast<int>(std::floor((mWindow.pt2.y - window.pt1.y) / mTileSize));
+  col_ini = std::min(std::max(col_ini, 0), mCols - 1);
+  col_end = std::min(std::max(col_end, 0), mCols - 1);
+  row_ini = std::min(std::max(row_ini, 0), mRows - 1);
+  row_end = std::min(std::max(row_end, 0), mRows - 1);
+
+  std::vector<Point3D> tile_points;
+  for (int r = row_ini; r <= row_end; r++) {
+    for (int c = col_ini; c <= col_end; c++) {
+      read(r, c, tile_points);
+      for (const auto &point : tile_points) {
+        if (window.containsPoint(point))
+          points.push_back(point);
+      }
+    }
+  }
+}
+
+Path PointCloudTiler::bucketFile(int row, int col) const
+{
+  Path file(mBucketsPath);
+  file.append("tile_" + std::to_string(row) + "_" + std::to_string(col) + ".bin");
+  return file;
+}
+
+void PointCloudTiler::flush(std::vector<std::vector<double>> &buffers)
+{
+  for (size_t i = 0; i < buffers.size(); i++) {
+
+    std::vector<double> &buffer = buffers[i];
+    if (buffer.empty()) continue;
+
+    int row = static_cast<int>(i / mCols);
+    int col = static_cast<int>(i % mCols);
+
+    std::FILE *file = std::fopen(bucketFile(row, col).toString().c_str(), "ab");
+    TL_ASSERT(file != nullptr, "Can't open bucket file");
+    size_t values = std::fwrite(buffer.data(), sizeof(double), buffer.size(), file);
+    std::fclose(file);
+    TL_ASSERT(values == buffer.size(), "Bucket file write error");
+
+    mPointCount[i] += buffer.size() / 3;
+
+    /// Se libera la memoria para que el total no supere el límite
+    std::vector<double>().swap(buffer);
+  }
+}
+
+} // End namespace geospatial
+
+} // End namespace tl
@@ -0,0 +1,385 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GEOSPATIAL_POINT_CLOUD_H
+#define TL_GEOSPATIAL_POINT_CLOUD_H
+
+#include "config_tl.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/core/path.h"
+#include "tidop/geometry/entities/point.h"
+#include "tidop/geometry/entities/bbox.h"
+#include "tidop/geometry/entities/window.h"
+
+namespace tl
+{
+
+namespace geospatial
+{
+
+/*!
+ * \brief Streaming point cloud reader
+ *
+ * Points are returned in chunks so that the whole cloud never has to be
+ * kept in memory.
+ * \code
+ * std::unique_ptr<PointCloudReader> reader = PointCloudReaderFactory::create("points.las");
+ * reader->open();
+ * std::vector<Point3D> points;
+ * while (reader->read(points, 100000) > 0) {
+ *   ...
+ * }
+ * \endcode
+ */
+class TL_EXPORT PointCloudReader
+{
+
+public:
+
+  PointCloudReader(Path file);
+  virtual ~PointCloudReader() = default;
+
+  /*!
+   * \brief Abre el fichero
+   */
+  virtual void open() = 0;
+
+  /*!
+   * \brief Comprueba si el fichero se ha cargado correctamente
+   */
+  virtual bool isOpen() const = 0;
+
+  /*!
+   * \brief Cierra el fichero
+   */
+  virtual void close() = 0;
+
+  /*!
+   * \brief Reads the next chunk of points
+   * \param[out] points Points read. The vector is cleared before reading
+   * \param[in] maxPoints Maximum number of points to read
+   * \return Number of points read. 0 when the end of the file is reached
+   */
+  virtual size_t read(std::vector<Point3D> &points, size_t maxPoints) = 0;
+
+  /*!
+   * \brief Restarts the reading from the first point
+   */
+  virtual void rewind() = 0;
+
+  /*!
+   * \brief Number of points if the format stores it in its header
+   * \return Number of points or 0 if it is unknown
+   */
+  virtual size_t size() const = 0;
+
+  /*!
+   * \brief Bounding box if the format stores it in its header
+   * \return Bounding box. Empty if it is unknown
+   */
+  virtual BoundingBoxD boundingBox() const = 0;
+
+  Path file() const;
+
+protected:
+
+  Path mFile;
+
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+/*!
+ * \brief Delimited text point cloud reader
+ *
+ * The file is read in fixed size blocks and the numbers are parsed in place,
+ * avoiding the stream and string overhead of line by line reading.
+ * Lines that can't be parsed (headers, comments) are skipped.
+ */
+class TL_EXPORT PointCloudReaderCsv
+  : public PointCloudReader
+{
+
+public:
+
+  PointCloudReaderCsv(Path file, char delimiter = ',');
+  ~PointCloudReaderCsv() override;
+
+  TL_DISABLE_COPY(PointCloudReaderCsv)
+  TL_DISABLE_MOVE(PointCloudReaderCsv)
+
+  void open() override;
+  bool isOpen() const override;
+  void close() override;
+  size_t read(std::vector<Point3D> &points, size_t maxPoints) override;
+  void rewind() override;
+  size_t size() const override;
+  BoundingBoxD boundingBox() const override;
+
+  /*!
+   * \brief Field delimiter. A blank space matches any sequence of spaces and tabs
+   */
+  char delimiter() const;
+  void setDelimiter(char delimiter);
+
+  /*!
+   * \brief Columns (zero based) of the x, y and z coordinates
+   */
+  void setColumns(int x, int y, int z);
+
+  /*!
+   * \brief Number of lines to skip at the beginning of the file
+   */
+  void setSkipLines(int skipLines);
+
+  /*!
+   * \brief Size in bytes of the read block
+   */
+  void setBlockSize(size_t blockSize);
+
+private:
+
+  bool fillBuffer();
+  bool parseLine(const char *begin, const char *end, Point3D *point) const;
+
+private:
+
+  std::FILE *mFileHandle;
+  char mDelimiter;
+  int mColumnX;
+  int mColumnY;
+  int mColumnZ;
+  int mSkipLines;
+  size_t mBlockSize;
+  std::vector<char> mBuffer;
+  size_t mBufferBegin;
+  size_t mBufferEnd;
+  bool mEof;
+  size_t mLine;
+
+};
+
+
+/*!
+ * \brief XYZ point cloud reader (whitespace delimited text)
+ */
+class TL_EXPORT PointCloudReaderXYZ
+  : public PointCloudReaderCsv
+{
+
+public:
+
+  PointCloudReaderXYZ(Path file);
+  ~PointCloudReaderXYZ() override = default;
+
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+/*!
+ * \brief ASPRS LAS point cloud reader
+ *
+ * Supports LAS 1.0 to 1.4 and point data record formats 0 to 10.
+ * Compressed files (LAZ) are not supported.
+ */
+class TL_EXPORT PointCloudReaderLas
+  : public PointCloudReader
+{
+
+public:
+
+  PointCloudReaderLas(Path file);
+  ~PointCloudReaderLas() override;
+
+  TL_DISABLE_COPY(PointCloudReaderLas)
+  TL_DISABLE_MOVE(PointCloudReaderLas)
+
+  void open() override;
+  bool isOpen() const override;
+  void close() override;
+  size_t read(std::vector<Point3D> &points, size_t maxPoints) override;
+  void rewind() override;
+  size_t size() const override;
+  BoundingBoxD boundingBox() const override;
+
+  int versionMajor() const;
+  int versionMinor() const;
+  int pointDataFormat() const;
+
+private:
+
+  void readHeader();
+
+private:
+
+  std::FILE *mFileHandle;
+  int mVersionMajor;
+  int mVersionMinor;
+  int mPointDataFormat;
+  size_t mPointDataOffset;
+  size_t mPointRecordLength;
+  size_t mPointCount;
+  size_t mPointsRead;
+  Point3D mScale;
+  Point3D mOffset;
+  BoundingBoxD mBoundingBox;
+  std::vector<char> mBuffer;
+
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+/*!
+ * \brief Factoría de clases para la lectura de nubes de puntos
+ */
+class TL_EXPORT PointCloudReaderFactory
+{
+
+private:
+
+  PointCloudReaderFactory() = default;
+
+public:
+
+  static std::unique_ptr<PointCloudReader> create(const Path &file);
+  static bool isExtensionSupported(const std::string &extension);
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+/*!
+ * \brief External memory spatial bucketing of a point cloud
+ *
+ * The cloud is streamed once and every point is spilled to the bucket file
+ * of the square tile that contains it. Afterwards a tile plus its
+ * neighbourhood can be loaded independently, so the memory needed to
+ * process the cloud depends on the tile size and not on the number of points.
+ *
+ * Rows are counted from the top (maximum y) as in raster images.
+ * \code
+ * PointCloudTiler tiler(100.);
+ * tiler.build(reader.get());
+ * std::vector<Point3D> points;
+ * for (int r = 0; r < tiler.rows(); r++) {
+ *   for (int c = 0; c < tiler.cols(); c++) {
+ *     tiler.read(expandWindow(tiler.tileWindow(r, c), 10.), points);
+ *     ...
+ *   }
+ * }
+ * \endcode
+ */
+class TL_EXPORT PointCloudTiler
+{
+
+public:
+
+  /*!
+   * \brief Constructor
+   * \param[in] tileSize Tile side in ground units
+   * \param[in] bucketsPath Directory for the bucket files. If it is empty
+   * a temporary directory is created and removed on destruction.
+   */
+  explicit PointCloudTiler(double tileSize,
+                           Path bucketsPath = Path());
+  ~PointCloudTiler();
+
+  TL_DISABLE_COPY(PointCloudTiler)
+  TL_DISABLE_MOVE(PointCloudTiler)
+
+  /*!
+   * \brief Area to tile. By default the bounding box of the point cloud.
+   * Points farther than one tile from the window are discarded
+   */
+  void setWindow(const WindowD &window);
+
+  /*!
+   * \brief Maximum memory in bytes used to buffer points before they are spilled to disk
+   */
+  void setMemoryLimit(size_t bytes);
+
+  /*!
+   * \brief Distributes the points of the reader in the tile buckets
+   * \param[in] reader Point cloud reader. It is opened if necessary
+   * \param[in] chunkSize Number of points read in each call to PointCloudReader::read
+   */
+  void build(PointCloudReader *reader, size_t chunkSize = 1000000);
+
+  int rows() const;
+  int cols() const;
+  double tileSize() const;
+  WindowD window() const;
+  WindowD tileWindow(int row, int col) const;
+
+  size_t pointCount() const;
+  size_t pointCount(int row, int col) const;
+
+  /*!
+   * \brief Reads the points of a tile
+   */
+  void read(int row, int col, std::vector<Point3D> &points) const;
+
+  /*!
+   * \brief Reads the points inside a window from the buckets it overlaps
+   * \param[in] window Window in ground coordinates
+   * \param[out] points Points inside the window
+   */
+  void read(const WindowD &window, std::vector<Point3D> &points) const;
+
+private:
+
+  Path bucketFile(int row, int col) const;
+  void flush(std::vector<std::vector<double>> &buffers);
+
+private:
+
+  double mTileSize;
+  Path mBucketsPath;
+  std::unique_ptr<TemporalDir> mTemporalDir;
+  WindowD mWindow;
+  int mRows;
+  int mCols;
+  size_t mMemoryLimit;
+  std::vector<size_t> mPointCount;
+
+};
+
+} // End namespace geospatial
+
+} // End namespace tl
+
+#endif // TL_GEOSPATIAL_POINT_CLOUD_H
@@ -0,0 +1,1317 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#include "tidop/graphic/columnar.h"
+
+#include "tidop/core/exception.h"
+#include "tidop/graphic/layer.h"
+#include "tidop/graphic/entities/point.h"
+#include "tidop/graphic/entities/linestring.h"
+#include "tidop/graphic/entities/polygon.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace tl
+{
+
+namespace graph
+{
+
+
+MemoryArena::MemoryArena(size_t blockSize)
+  : mBlockSize(std::max<size_t>(blockSize, 64)),
+    mOffset(0),
+    mSize(0)
+{
+}
+
+MemoryArena::~MemoryArena() = default;
+
+MemoryArena::MemoryArena(MemoryArena &&arena) TL_NOEXCEPT
+  : mBlockSize(arena.mBlockSize),
+    mBlocks(std::move(arena.mBlocks)),
+    mOffset(arena.mOffset),
+    mSize(arena.mSize)
+{
+  arena.mOffset = 0;
+  arena.mSize = 0;
+}
+
+MemoryArena &MemoryArena::operator = (MemoryArena &&arena) TL_NOEXCEPT
+{
+  if (this != &arena) {
+    mBlockSize = arena.mBlockSize;
+    mBlocks = std::move(arena.mBlocks);
+    mOffset = arena.mOffset;
+    mSize = arena.mSize;
+    arena.mOffset = 0;
+    arena.mSize = 0;
+  }
+  return *this;
+}
+
+void *MemoryArena::allocate(size_t size, size_t alignment)
+{
+  size_t offset = 0;
+
+  if (!mBlocks.empty()) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(mBlocks.back().first.get()) + mOffset;
+    size_t padding = (alignment - address % alignment) % alignment;
+    offset = mOffset + padding;
+  }
+
+  if (mBlocks.empty() || offset + size > mBlocks.back().second) {
+    /// Las reservas mayores que el tamaño de bloque tienen su propio bloque
+    size_t block_size = std::max(mBlockSize, size + alignment);
+    mBlocks.emplace_back(std::unique_ptr<char[]>(new char[block_size]), block_size);
+    uintptr_t address = reinterpret_cast<uintptr_t>(mBlocks.back().first.get());
+    offset = (alignment - address % alignment) % alignment;
+  }
+
+  void *ptr = mBlocks.back().first.get() + offset;
+  mOffset = offset + size;
+  mSize += size;
+
+  return ptr;
+}
+
+void MemoryArena::clear()
+{
+  mBlocks.clear();
+  mOffset = 0;
+  mSize = 0;
+}
+
+size_t MemoryArena::size() const
+{
+  return mSize;
+}
+
+size_t MemoryArena::capacity() const
+{
+  size_t capacity = 0;
+  for (const auto &block : mBlocks)
+    capacity += block.second;
+  return capacity;
+}
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+size_t StringDictionary::KeyHash::operator()(const Key &key) const
+{
+  /// FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < key.size; i++) {
+    hash ^= static_cast<unsigned char>(key.data[i]);
+    hash *= 1099511628211ull;
+  }
+  return static_cast<size_t>(hash);
+}
+
+bool StringDictionary::KeyEqual::operator()(const Key &key1, const Key &key2) const
+{
+  return key1.size == key2.size &&
+         std::memcmp(key1.data, key2.data, key1.size) == 0;
+}
+
+StringDictionary::StringDictionary()
+  : mArena(16384)
+{
+}
+
+StringDictionary::~StringDictionary() = default;
+
+StringDictionary::StringDictionary(StringDictionary &&dictionary) TL_NOEXCEPT
+  : mArena(std::move(dictionary.mArena)),
+    mStrings(std::move(dictionary.mStrings)),
+    mIndex(std::move(dictionary.mIndex))
+{
+}
+
+StringDictionary &StringDictionary::operator = (StringDictionary &&dictionary) TL_NOEXCEPT
+{
+  if (this != &dictionary) {
+    mArena = std::move(dictionary.mArena);
+    mStrings = std::move(dictionary.mStrings);
+    mIndex = std::move(dictionary.mIndex);
+  }
+  return *this;
+}
+
+uint32_t StringDictionary::insert(const std::string &value)
+{
+  Key key{value.data(), value.size()};
+
+  auto it = mIndex.find(key);
+  if (it != mIndex.end()) return it->second;
+
+  TL_ASSERT(mStrings.size() < std::numeric_limits<uint32_t>::max(), "String dictionary is full");
+
+  char *data = static_cast<char *>(mArena.allocate(value.size() + 1, 1));
+  std::memcpy(data, value.data(), value.size());
+  data[value.size()] = '\0';
+
+  Key stored_key{data, value.size()};
+  uint32_t id = static_cast<uint32_t>(mStrings.size());
+  mStrings.push_back(stored_key);
+  mIndex.emplace(stored_key, id);
+
+  return id;
+}
+
+std::string StringDictionary::at(uint32_t id) const
+{
+  const Key &key = mStrings.at(id);
+  return std::string(key.data, key.size);
+}
+
+const char *StringDictionary::data(uint32_t id) const
+{
+  return mStrings.at(id).data;
+}
+
+size_t StringDictionary::length(uint32_t id) const
+{
+  return mStrings.at(id).size;
+}
+
+size_t StringDictionary::size() const
+{
+  return mStrings.size();
+}
+
+void StringDictionary::clear()
+{
+  mIndex.clear();
+  mStrings.clear();
+  mArena.clear();
+}
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+FieldColumn::FieldColumn(const std::shared_ptr<TableField> &field)
+  : mField(field)
+{
+  TL_ASSERT(mField, "Invalid field");
+}
+
+FieldColumn::~FieldColumn() = default;
+
+FieldColumn::FieldColumn(FieldColumn &&column) TL_NOEXCEPT
+  : mField(std::move(column.mField)),
+    mInts(std::move(column.mInts)),
+    mInts64(std::move(column.mInts64)),
+    mDoubles(std::move(column.mDoubles)),
+    mStringIds(std::move(column.mStringIds)),
+    mNulls(std::move(column.mNulls)),
+    mDictionary(std::move(column.mDictionary))
+{
+}
+
+FieldColumn &FieldColumn::operator = (FieldColumn &&column) TL_NOEXCEPT
+{
+  if (this != &column) {
+    mField = std::move(column.mField);
+    mInts = std::move(column.mInts);
+    mInts64 = std::move(column.mInts64);
+    mDoubles = std::move(column.mDoubles);
+    mStringIds = std::move(column.mStringIds);
+    mNulls = std::move(column.mNulls);
+    mDictionary = std::move(column.mDictionary);
+  }
+  return *this;
+}
+
+std::shared_ptr<TableField> FieldColumn::field() const
+{
+  return mField;
+}
+
+TableField::Type FieldColumn::type() const
+{
+  return mField->type();
+}
+
+size_t FieldColumn::size() const
+{
+  return mNulls.size();
+}
+
+void FieldColumn::reserve(size_t size)
+{
+  mNulls.reserve(size);
+
+  switch (type()) {
+    case TableField::Type::INT:
+      mInts.reserve(size);
+      break;
+    case TableField::Type::INT64:
+      mInts64.reserve(size);
+      break;
+    case TableField::Type::DOUBLE:
+    case TableField::Type::FLOAT:
+      mDoubles.reserve(size);
+      break;
+    case TableField::Type::STRING:
+      mStringIds.reserve(size);
+      break;
+  }
+}
+
+void FieldColumn::clear()
+{
+  mInts.clear();
+  mInts64.clear();
+  mDoubles.clear();
+  mStringIds.clear();
+  mNulls.clear();
+  mDictionary.clear();
+}
+
+void FieldColumn::pushNull()
+{
+  mNulls.push_back(1);
+
+  switch (type()) {
+    case TableField::Type::INT:
+      mInts.push_back(0);
+      break;
+    case TableField::Type::INT64:
+      mInts64.push_back(0);
+      break;
+    case TableField::Type::DOUBLE:
+    case TableField::Type::FLOAT:
+      mDoubles.push_back(0.);
+      break;
+    case TableField::Type::STRING:
+      mStringIds.push_back(0);
+      break;
+  }
+}
+
+void FieldColumn::setInt(size_t id, int value)
+{
+  switch (type()) {
+    case TableField::Type::INT:
+      mInts.at(id) = value;
+      break;
+    case TableField::Type::INT64:
+      mInts64.at(id) = value;
+      break;
+    case TableField::Type::DOUBLE:
+    case TableField::Type::FLOAT:
+      mDoubles.at(id) = value;
+      break;
+    case TableField::Type::STRING:
+      mStringIds.at(id) = mDictionary.insert(std::to_string(value));
+      break;
+  }
+
+  mNulls[id] = 0;
+}
+
+void FieldColumn::setInt64(size_t id, int64_t value)
+{
+  switch (type()) {
+    case TableField::Type::INT:
+      mInts.at(id) = static_cast<int32_t>(value);
+      break;
+    case TableField::Type::INT64:
+      mInts64.at(id) = value;
+      break;
+    case TableField::Type::DOUBLE:
+    case TableField::Type::FLOAT:
+      mDoubles.at(id) = static_cast<double>(value);
+      break;
+    case TableField::Type::STRING:
+      mStringIds.at(id) = mDictionary.insert(std::to_string(value));
+      break;
+  }
+
+  mNulls[id] = 0;
+}
+
+void FieldColumn::setDouble(size_t id, double value)
+{
+  switch (type()) {
+    case TableField::Type::INT:
+      mInts.at(id) = static_cast<int32_t>(value);
+      break;
+    case TableField::Type::INT64:
+      mInts64.at(id) = static_cast<int64_t>(value);
+      break;
+    case TableField::Type::DOUBLE:
+    case TableField::Type::FLOAT:
+      mDoubles.at(id) = value;
+      break;
+    case TableField::Type::STRING:
+      mStringIds.at(id) = mDictionary.insert(std::to_string(value));
+      break;
+  }
+
+  mNulls[id] = 0;
+}
+
+void FieldColumn::setString(size_t id, const std::string &value)
+{
+  if (type() == TableField::Type::STRING) {
+    mStringIds.at(id) = mDictionary.insert(value);
+    mNulls[id] = 0;
+  } else {
+    setValue(id, value);
+  }
+}
+
+void FieldColumn::setValue(size_t id, const std::string &value)
+{
+  try {
+
+    if (type() == TableField::Type::STRING) {
+      setString(id, value);
+      return;
+    }
+
+    if (value.empty()) {
+      mNulls.at(id) = 1;
+      return;
+    }
+
+    switch (type()) {
+      case TableField::Type::INT:
+        setInt(id, std::stoi(value));
+        break;
+      case TableField::Type::INT64:
+        setInt64(id, std::stoll(value));
+        break;
+      case TableField::Type::DOUBLE:
+      case TableField::Type::FLOAT:
+        setDouble(id, std::stod(value));
+        break;
+      case TableField::Type::STRING:
+        break;
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Invalid value '%s' for field %s", value.c_str(), mField->name().c_str());
+  }
+}
+
+void FieldColumn::append(const FieldColumn &column)
+{
+  try {
+
+    size_t offset = size();
+    size_t count = column.size();
+
+    if (type() == column.type()) {
+
+      mNulls.insert(mNulls.end(), column.mNulls.begin(), column.mNulls.end());
+
+      switch (type()) {
+        case TableField::Type::INT:
+          mInts.insert(mInts.end(), column.mInts.begin(), column.mInts.end());
+          break;
+        case TableField::Type::INT64:
+          mInts64.insert(mInts64.end(), column.mInts64.begin(), column.mInts64.end());
+          break;
+        case TableField::Type::DOUBLE:
+        case TableField::Type::FLOAT:
+          mDoubles.insert(mDoubles.end(), column.mDoubles.begin(), column.mDoubles.end());
+          break;
+        case TableField::Type::STRING:
+        {
+          /// Los identificadores se traducen al diccionario de esta columna
+          std::vector<uint32_t> ids(column.mDictionary.size());
+          for (size_t i = 0; i < ids.size(); i++)
+            ids[i] = mDictionary.insert(column.mDictionary.at(static_cast<uint32_t>(i)));
+
+          mStringIds.reserve(offset + count);
+          for (size_t i = 0; i < count; i++)
+            mStringIds.push_back(column.mNulls[i] ? 0 : ids[column.mStringIds[i]]);
+          break;
+        }
+      }
+
+    } else {
+
+      reserve(offset + count);
+      for (size_t i = 0; i < count; i++) {
+        pushNull();
+        if (!column.isNull(i)) setValue(offset + i, column.toString(i));
+      }
+
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+bool FieldColumn::isNull(size_t id) const
+{
+  return mNulls.at(id) != 0;
+}
+
+int FieldColumn::toInt(size_t id) const
+{
+  return static_cast<int>(toInt64(id));
+}
+
+int64_t FieldColumn::toInt64(size_t id) const
+{
+  int64_t value = 0;
+
+  switch (type()) {
+    case TableField::Type::INT:
+      value = mInts.at(id);
+      break;
+    case TableField::Type::INT64:
+      value = mInts64.at(id);
+      break;
+    case TableField::Type::DOUBLE:
+    case TableField::Type::FLOAT:
+      value = static_cast<int64_t>(mDoubles.at(id));
+      break;
+    case TableField::Type::STRING:
+      if (!isNull(id)) value = std::stoll(mDictionary.at(mStringIds.at(id)));
+      break;
+  }
+
+  return value;
+}
+
+double FieldColumn::toDouble(size_t id) const
+{
+  double value = 0.;
+
+  switch (type()) {
+    case TableField::Type::INT:
+      value = mInts.at(id);
+      break;
+    case TableField::Type::INT64:
+      value = static_cast<double>(mInts64.at(id));
+      break;
+    case TableField::Type::DOUBLE:
+    case TableField::Type::FLOAT:
+      value = mDoubles.at(id);
+      break;
+    case TableField::Type::STRING:
+      if (!isNull(id)) value = std::stod(mDictionary.at(mStringIds.at(id)));
+      break;
+  }
+
+  return value;
+}
+
+std::string FieldColumn::toString(size_t id) const
+{
+  if (isNull(id)) return std::string();
+
+  std::string value;
+
+  switch (type()) {
+    case TableField::Type::INT:
+      value = std::to_string(mInts[id]);
+      break;
+    case TableField::Type::INT64:
+      value = std::to_string(mInts64[id]);
+      break;
+    case TableField::Type::DOUBLE:
+    case TableField::Type::FLOAT:
+    {
+      std::ostringstream stream;
+      stream << std::setprecision(std::numeric_limits<double>::digits10) << mDoubles[id];
+      value = stream.str();
+      break;
+    }
+    case TableField::Type::STRING:
+      value = mDictionary.at(mStringIds[id]);
+      break;
+  }
+
+  return value;
+}
+
+const std::vector<int32_t> &FieldColumn::ints() const
+{
+  return mInts;
+}
+
+const std::vector<int64_t> &FieldColumn::ints64() const
+{
+  return mInts64;
+}
+
+const std::vector<double> &FieldColumn::doubles() const
+{
+  return mDoubles;
+}
+
+const std::vector<uint32_t> &FieldColumn::stringIds() const
+{
+  return mStringIds;
+}
+
+const StringDictionary &FieldColumn::dictionary() const
+{
+  return mDictionary;
+}
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+FeatureView::FeatureView(const ColumnarLayer *layer, size_t id)
+  : mLayer(layer),
+    mId(id)
+{
+}
+
+size_t FeatureView::id() const
+{
+  return mId;
+}
+
+GraphicEntity::Type FeatureView::type() const
+{
+  return mLayer->type(mId);
+}
+
+size_t FeatureView::geometries() const
+{
+  return mLayer->geometries(mId);
+}
+
+size_t FeatureView::parts(size_t geometry) const
+{
+  return mLayer->parts(mId, geometry);
+}
+
+size_t FeatureView::points(size_t geometry, size_t part) const
+{
+  return mLayer->points(mId, geometry, part);
+}
+
+Point3<double> FeatureView::point(size_t geometry, size_t part, size_t id) const
+{
+  return mLayer->point(mId, geometry, part, id);
+}
+
+WindowD FeatureView::window() const
+{
+  return mLayer->window(mId);
+}
+
+std::string FeatureView::value(size_t field) const
+{
+  return mLayer->column(field).toString(mId);
+}
+
+std::shared_ptr<GraphicEntity> FeatureView::toEntity() const
+{
+  return mLayer->entity(mId);
+}
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+namespace internal
+{
+
+template<typename Container_t>
+void addPoints2D(ColumnarLayer &layer, const Container_t &points)
+{
+  layer.beginPart();
+  for (const auto &point : points)
+    layer.addPoint(point.x, point.y);
+}
+
+template<typename Container_t>
+void addPoints3D(ColumnarLayer &layer, const Container_t &points)
+{
+  layer.beginPart();
+  for (const auto &point : points)
+    layer.addPoint(point.x, point.y, point.z);
+}
+
+template<typename Polygon_t>
+void addPolygon2D(ColumnarLayer &layer, const Polygon_t &polygon)
+{
+  layer.beginGeometry();
+  addPoints2D(layer, polygon);
+  for (size_t i = 0; i < polygon.holes(); i++)
+    addPoints2D(layer, polygon.hole(i));
+}
+
+template<typename Polygon_t>
+void addPolygon3D(ColumnarLayer &layer, const Polygon_t &polygon)
+{
+  layer.beginGeometry();
+  addPoints3D(layer, polygon);
+  for (size_t i = 0; i < polygon.holes(); i++)
+    addPoints3D(layer, polygon.hole(i));
+}
+
+} // namespace internal
+
+
+ColumnarLayer::ColumnarLayer()
+  : mFeatureOffsets(1, 0),
+    mGeometryOffsets(1, 0),
+    mPartOffsets(1, 0),
+    mOpenGeometry(false),
+    mOpenPart(false)
+{
+}
+
+ColumnarLayer::ColumnarLayer(const GLayer &layer)
+  : ColumnarLayer()
+{
+  try {
+
+    mName = layer.name();
+
+    for (const auto &field : layer.tableFields())
+      addDataField(field);
+
+    for (const auto &entity : layer) {
+      if (entity) push_back(*entity);
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+ColumnarLayer::~ColumnarLayer() = default;
+
+ColumnarLayer::ColumnarLayer(ColumnarLayer &&layer) TL_NOEXCEPT
+  : mName(std::move(layer.mName)),
+    mColumns(std::move(layer.mColumns)),
+    mTypes(std::move(layer.mTypes)),
+    mFeatureOffsets(std::move(layer.mFeatureOffsets)),
+    mGeometryOffsets(std::move(layer.mGeometryOffsets)),
+    mPartOffsets(std::move(layer.mPartOffsets)),
+    mX(std::move(layer.mX)),
+    mY(std::move(layer.mY)),
+    mZ(std::move(layer.mZ)),
+    mOpenGeometry(layer.mOpenGeometry),
+    mOpenPart(layer.mOpenPart)
+{
+  layer.clear();
+}
+
+ColumnarLayer &ColumnarLayer::operator = (ColumnarLayer &&layer) TL_NOEXCEPT
+{
+  if (this != &layer) {
+    mName = std::move(layer.mName);
+    mColumns = std::move(layer.mColumns);
+    mTypes = std::move(layer.mTypes);
+    mFeatureOffsets = std::move(layer.mFeatureOffsets);
+    mGeometryOffsets = std::move(layer.mGeometryOffsets);
+    mPartOffsets = std::move(layer.mPartOffsets);
+    mX = std::move(layer.mX);
+    mY = std::move(layer.mY);
+    mZ = std::move(layer.mZ);
+    mOpenGeometry = layer.mOpenGeometry;
+    mOpenPart = layer.mOpenPart;
+    layer.clear();
+  }
+  return *this;
+}
+
+std::string ColumnarLayer::name() const
+{
+  return mName;
+}
+
+void ColumnarLayer::setName(const std::string &name)
+{
+  mName = name;
+}
+
+void ColumnarLayer::addDataField(const std::shared_ptr<TableField> &field)
+{
+  TL_ASSERT(mTypes.empty(), "Fields must be added before features");
+  mColumns.emplace_back(field);
+}
+
+std::vector<std::shared_ptr<TableField>> ColumnarLayer::tableFields() const
+{
+  std::vector<std::shared_ptr<TableField>> fields;
+  fields.reserve(mColumns.size());
+  for (const auto &column : mColumns)
+    fields.push_back(column.field());
+  return fields;
+}
+
+size_t ColumnarLayer::fieldCount() const
+{
+  return mColumns.size();
+}
+
+FieldColumn &ColumnarLayer::column(size_t id)
+{
+  return mColumns.at(id);
+}
+
+const FieldColumn &ColumnarLayer::column(size_t id) const
+{
+  return mColumns.at(id);
+}
+
+int ColumnarLayer::fieldIndex(const std::string &name) const
+{
+  for (size_t i = 0; i < mColumns.size(); i++) {
+    if (mColumns[i].field()->name() == name) return static_cast<int>(i);
+  }
+  return -1;
+}
+
+size_t ColumnarLayer::size() const
+{
+  return mTypes.size();
+}
+
+bool ColumnarLayer::empty() const
+{
+  return mTypes.empty();
+}
+
+void ColumnarLayer::clear()
+{
+  for (auto &column : mColumns)
+    column.clear();
+  mTypes.clear();
+  mFeatureOffsets.assign(1, 0);
+  mGeometryOffsets.assign(1, 0);
+  mPartOffsets.assign(1, 0);
+  mX.clear();
+  mY.clear();
+  mZ.clear();
+  mOpenGeometry = false;
+  mOpenPart = false;
+}
+
+void ColumnarLayer::reserve(size_t features, size_t points)
+{
+  mTypes.reserve(features);
+  mFeatureOffsets.reserve(features + 1);
+  mGeometryOffsets.reserve(features + 1);
+  mPartOffsets.reserve(features + 1);
+  mX.reserve(points);
+  mY.reserve(points);
+  for (auto &column : mColumns)
+    column.reserve(features);
+}
+
+size_t ColumnarLayer::beginFeature(GraphicEntity::Type type)
+{
+  mTypes.push_back(type);
+  mFeatureOffsets.push_back(mFeatureOffsets.back());
+  for (auto &column : mColumns)
+    column.pushNull();
+  mOpenGeometry = false;
+  mOpenPart = false;
+  return mTypes.size() - 1;
+}
+
+void ColumnarLayer::beginGeometry()
+{
+  TL_ASSERT(!mTypes.empty(), "There is no feature. Use ColumnarLayer::beginFeature()");
+  mFeatureOffsets.back()++;
+  mGeometryOffsets.push_back(mGeometryOffsets.back());
+  mOpenGeometry = true;
+  mOpenPart = false;
+}
+
+void ColumnarLayer::beginPart()
+{
+  if (!mOpenGeometry) beginGeometry();
+  mGeometryOffsets.back()++;
+  mPartOffsets.push_back(mPartOffsets.back());
+  mOpenPart = true;
+}
+
+void ColumnarLayer::addPoint(double x, double y)
+{
+  if (!mOpenPart) beginPart();
+  mPartOffsets.back()++;
+  mX.push_back(x);
+  mY.push_back(y);
+  if (!mZ.empty()) mZ.push_back(0.);
+}
+
+void ColumnarLayer::addPoint(double x, double y, double z)
+{
+  if (!mOpenPart) beginPart();
+  mPartOffsets.back()++;
+  /// La coordenada z sólo se almacena a partir de la primera entidad 3D
+  if (mZ.size() < mX.size()) mZ.resize(mX.size(), 0.);
+  mX.push_back(x);
+  mY.push_back(y);
+  mZ.push_back(z);
+}
+
+void ColumnarLayer::push_back(const GraphicEntity &entity)
+{
+  try {
+
+    GraphicEntity::Type type = entity.type();
+
+    switch (type) {
+      case GraphicEntity::Type::point_2d:
+      {
+        const auto &point = dynamic_cast<const GPoint &>(entity);
+        beginFeature(type);
+        addPoint(point.x, point.y);
+        break;
+      }
+      case GraphicEntity::Type::point_3d:
+      {
+        const auto &point = dynamic_cast<const GPoint3D &>(entity);
+        beginFeature(type);
+        addPoint(point.x, point.y, point.z);
+        break;
+      }
+      case GraphicEntity::Type::linestring_2d:
+        beginFeature(type);
+        internal::addPoints2D(*this, dynamic_cast<const GLineString &>(entity));
+        break;
+      case GraphicEntity::Type::linestring_3d:
+        beginFeature(type);
+        internal::addPoints3D(*this, dynamic_cast<const GLineString3D &>(entity));
+        break;
+      case GraphicEntity::Type::polygon_2d:
+        beginFeature(type);
+        internal::addPolygon2D(*this, dynamic_cast<const GPolygon &>(entity));
+        break;
+      case GraphicEntity::Type::polygon_3d:
+        beginFeature(type);
+        internal::addPolygon3D(*this, dynamic_cast<const GPolygon3D &>(entity));
+        break;
+      case GraphicEntity::Type::multipoint_2d:
+        beginFeature(type);
+        internal::addPoints2D(*this, dynamic_cast<const GMultiPoint &>(entity));
+        break;
+      case GraphicEntity::Type::multipoint_3d:
+        beginFeature(type);
+        internal::addPoints3D(*this, dynamic_cast<const GMultiPoint3D &>(entity));
+        break;
+      case GraphicEntity::Type::multiline_2d:
+        beginFeature(type);
+        beginGeometry();
+        for (const auto &line_string : dynamic_cast<const GMultiLineString &>(entity))
+          internal::addPoints2D(*this, line_string);
+        break;
+      case GraphicEntity::Type::multiline_3d:
+        beginFeature(type);
+        beginGeometry();
+        for (const auto &line_string : dynamic_cast<const GMultiLineString3D &>(entity))
+          internal::addPoints3D(*this, line_string);
+        break;
+      case GraphicEntity::Type::multipolygon_2d:
+        beginFeature(type);
+        for (const auto &polygon : dynamic_cast<const GMultiPolygon &>(entity))
+          internal::addPolygon2D(*this, polygon);
+        break;
+      case GraphicEntity::Type::multipolygon_3d:
+        beginFeature(type);
+        for (const auto &polygon : dynamic_cast<const GMultiPolygon3D &>(entity))
+          internal::addPolygon3D(*this, polygon);
+        break;
+      default:
+        TL_THROW_EXCEPTION("Unsupported entity type");
+    }
+
+    if (std::shared_ptr<TableRegister> data = entity.data()) {
+      size_t id = mTypes.size() - 1;
+      size_t size = std::min(data->size(), mColumns.size());
+      for (size_t i = 0; i < size; i++) {
+        mColumns[i].setValue(id, data->value(static_cast<int>(i)));
+      }
+    }
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void ColumnarLayer::append(const ColumnarLayer &layer)
+{
+  try {
+
+    size_t features = layer.size();
+    size_t geometry_base = mFeatureOffsets.back();
+    size_t part_base = mGeometryOffsets.back();
+    size_t point_base = mPartOffsets.back();
+
+    mTypes.insert(mTypes.end(), layer.mTypes.begin(), layer.mTypes.end());
+
+    for (size_t i = 1; i < layer.mFeatureOffsets.size(); i++)
+      mFeatureOffsets.push_back(geometry_base + layer.mFeatureOffsets[i]);
+    for (size_t i = 1; i < layer.mGeometryOffsets.size(); i++)
+      mGeometryOffsets.push_back(part_base + layer.mGeometryOffsets[i]);
+    for (size_t i = 1; i < layer.mPartOffsets.size(); i++)
+      mPartOffsets.push_back(point_base + layer.mPartOffsets[i]);
+
+    if (!layer.mZ.empty()) {
+      mZ.resize(point_base, 0.);
+      mZ.insert(mZ.end(), layer.mZ.begin(), layer.mZ.end());
+    } else if (!mZ.empty()) {
+      mZ.resize(point_base + layer.mX.size(), 0.);
+    }
+
+    mX.insert(mX.end(), layer.mX.begin(), layer.mX.end());
+    mY.insert(mY.end(), layer.mY.begin(), layer.mY.end());
+
+    for (auto &column : mColumns) {
+
+      int index = layer.fieldIndex(column.field()->name());
+
+      if (index >= 0) {
+        column.append(layer.column(static_cast<size_t>(index)));
+      } else {
+        column.reserve(column.size() + features);
+        for (size_t i = 0; i < features; i++)
+          column.pushNull();
+      }
+    }
+
+    mOpenGeometry = false;
+    mOpenPart = false;
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+GraphicEntity::Type ColumnarLayer::type(size_t feature) const
+{
+  return mTypes.at(feature);
+}
+
+size_t ColumnarLayer::geometries(size_t feature) const
+{
+  return mFeatureOffsets.at(feature + 1) - mFeatureOffsets[feature];
+}
+
+size_t ColumnarLayer::parts(size_t feature, size_t geometry) const
+{
+  size_t id = geometryIndex(feature, geometry);
+  return mGeometryOffsets[id + 1] - mGeometryOffsets[id];
+}
+
+size_t ColumnarLayer::points(size_t feature, size_t geometry, size_t part) const
+{
+  size_t id = partIndex(feature, geometry, part);
+  return mPartOffsets[id + 1] - mPartOffsets[id];
+}
+
+std::pair<size_t, size_t> ColumnarLayer::pointRange(size_t feature, size_t geometry, size_t part) const
+{
+  size_t id = partIndex(feature, geometry, part);
+  return std::make_pair(mPartOffsets[id], mPartOffsets[id + 1]);
+}
+
+Point3<double> ColumnarLayer::point(size_t feature, size_t geometry, size_t part, size_t id) const
+{
+  std::pair<size_t, size_t> range = pointRange(feature, geometry, part);
+  size_t position = range.first + id;
+  TL_ASSERT(position < range.second, "Point index out of range");
+  return Point3<double>(mX[position], mY[position], mZ.empty() ? 0. : mZ[position]);
+}
+
+const std::vector<double> &ColumnarLayer::x() const
+{
+  return mX;
+}
+
+const std::vector<double> &ColumnarLayer::y() const
+{
+  return mY;
+}
+
+const std::vector<double> &ColumnarLayer::z() const
+{
+  return mZ;
+}
+
+WindowD ColumnarLayer::window(size_t feature) const
+{
+  WindowD window;
+
+  size_t geometry_ini = mFeatureOffsets.at(feature);
+  size_t geometry_end = mFeatureOffsets.at(feature + 1);
+  if (geometry_ini == geometry_end) return window;
+
+  size_t point_ini = mPartOffsets[mGeometryOffsets[geometry_ini]];
+  size_t point_end = mPartOffsets[mGeometryOffsets[geometry_end]];
+
+  for (size_t i = point_ini; i < point_end; i++) {
+    if (mX[i] < window.pt1.x) window.pt1.x = mX[i];
+    if (mY[i] < window.pt1.y) window.pt1.y = mY[i];
+    if (mX[i] > window.pt2.x) window.pt2.x = mX[i];
+    if (mY[i] > window.pt2.y) window.pt2.y = mY[i];
+  }
+
+  return window;
+}
+
+FeatureView ColumnarLayer::feature(size_t feature) const
+{
+  TL_ASSERT(feature < mTypes.size(), "Feature index out of range");
+  return FeatureView(this, feature);
+}
+
+std::shared_ptr<TableRegister> ColumnarLayer::data(size_t feature) const
+{
+  std::shared_ptr<TableRegister> data;
+
+  if (!mColumns.empty()) {
+    data = std::make_shared<TableRegister>(tableFields());
+    for (size_t i = 0; i < mColumns.size(); i++) {
+      data->setValue(static_cast<int>(i), mColumns[i].toString(feature));
+    }
+  }
+
+  return data;
+}
+
+std::shared_ptr<GraphicEntity> ColumnarLayer::entity(size_t feature) const
+{
+  std::shared_ptr<GraphicEntity> entity;
+
+  try {
+
+    GraphicEntity::Type entity_type = type(feature);
+    size_t geometry_count = geometries(feature);
+
+    auto point2d = [&](size_t geometry, size_t part, size_t id) {
+      Point3<double> point = this->point(feature, geometry, part, id);
+      return PointD(point.x, point.y);
+    };
+
+    auto point3d = [&](size_t geometry, size_t part, size_t id) {
+      return this->point(feature, geometry, part, id);
+    };
+
+    auto polygon2d = [&](size_t geometry) {
+      Polygon<PointD> polygon;
+      size_t part_count = parts(feature, geometry);
+      for (size_t part = 0; part < part_count; part++) {
+        size_t point_count = points(feature, geometry, part);
+        if (part == 0) {
+          polygon.reserve(point_count);
+          for (size_t i = 0; i < point_count; i++)
+            polygon.push_back(point2d(geometry, part, i));
+        } else {
+          PolygonHole<PointD> hole;
+          hole.reserve(point_count);
+          for (size_t i = 0; i < point_count; i++)
+            hole.push_back(point2d(geometry, part, i));
+          polygon.addHole(hole);
+        }
+      }
+      return polygon;
+    };
+
+    auto polygon3d = [&](size_t geometry) {
+      Polygon3D<Point3D> polygon;
+      size_t part_count = parts(feature, geometry);
+      for (size_t part = 0; part < part_count; part++) {
+        size_t point_count = points(feature, geometry, part);
+        if (part == 0) {
+          polygon.reserve(point_count);
+          for (size_t i = 0; i < point_count; i++)
+            polygon.push_back(point3d(geometry, part, i));
+        } else {
+          Polygon3DHole<Point3D> hole;
+          hole.reserve(point_count);
+          for (size_t i = 0; i < point_count; i++)
+            hole.push_back(point3d(geometry, part, i));
+          polygon.addHole(hole);
+        }
+      }
+      return polygon;
+    };
+
+    switch (entity_type) {
+      case GraphicEntity::Type::point_2d:
+        entity = std::make_shared<GPoint>(point2d(0, 0, 0));
+        break;
+      case GraphicEntity::Type::point_3d:
+        entity = std::make_shared<GPoint3D>(point3d(0, 0, 0));
+        break;
+      case GraphicEntity::Type::linestring_2d:
+      {
+        auto line_string = std::make_shared<GLineString>();
+        size_t point_count = geometry_count ? points(feature, 0, 0) : 0;
+        line_string->reserve(point_count);
+        for (size_t i = 0; i < point_count; i++)
+          line_string->push_back(point2d(0, 0, i));
+        entity = line_string;
+        break;
+      }
+      case GraphicEntity::Type::linestring_3d:
+      {
+        auto line_string = std::make_shared<GLineString3D>();
+        size_t point_count = geometry_count ? points(feature, 0, 0) : 0;
+        line_string->reserve(point_count);
+        for (size_t i = 0; i < point_count; i++)
+          line_string->push_back(point3d(0, 0, i));
+        entity = line_string;
+        break;
+      }
+      case GraphicEntity::Type::polygon_2d:
+        entity = std::make_shared<GPolygon>(geometry_count ? polygon2d(0) : Polygon<PointD>());
+        break;
+      case GraphicEntity::Type::polygon_3d:
+        entity = std::make_shared<GPolygon3D>(geometry_count ? polygon3d(0) : Polygon3D<Point3D>());
+        break;
+      case GraphicEntity::Type::multipoint_2d:
+      {
+        auto multi_point = std::make_shared<GMultiPoint>();
+        size_t point_count = geometry_count ? points(feature, 0, 0) : 0;
+        for (size_t i = 0; i < point_count; i++)
+          multi_point->push_back(point2d(0, 0, i));
+        entity = multi_point;
+        break;
+      }
+      case GraphicEntity::Type::multipoint_3d:
+      {
+        auto multi_point = std::make_shared<GMultiPoint3D>();
+        size_t point_count = geometry_count ? points(feature, 0, 0) : 0;
+        for (size_t i = 0; i < point_count; i++)
+          multi_point->push_back(point3d(0, 0, i));
+        entity = multi_point;
+        break;
+      }
+      case GraphicEntity::Type::multiline_2d:
+      {
+        auto multi_line_string = std::make_shared<GMultiLineString>();
+        size_t part_count = geometry_count ? parts(feature, 0) : 0;
+        for (size_t part = 0; part < part_count; part++) {
+          LineString<PointD> line_string;
+          size_t point_count = points(feature, 0, part);
+          line_string.reserve(point_count);
+          for (size_t i = 0; i < point_count; i++)
+            line_string.push_back(point2d(0, part, i));
+          multi_line_string->push_back(line_string);
+        }
+        entity = multi_line_string;
+        break;
+      }
+      case GraphicEntity::Type::multiline_3d:
+      {
+        auto multi_line_string = std::make_shared<GMultiLineString3D>();
+        size_t part_count = geometry_count ? parts(feature, 0) : 0;
+        for (size_t part = 0; part < part_count; part++) {
+          LineString3D<Point3D> line_string;
+          size_t point_count = points(feature, 0, part);
+          line_string.reserve(point_count);
+          for (size_t i = 0; i < point_count; i++)
+            line_string.push_back(point3d(0, part, i));
+          multi_line_string->push_back(line_string);
+        }
+        entity = multi_line_string;
+        break;
+      }
+      case GraphicEntity::Type::multipolygon_2d:
+      {
+        auto multi_polygon = std::make_shared<GMultiPolygon>();
+        for (size_t geometry = 0; geometry < geometry_count; geometry++)
+          multi_polygon->push_back(polygon2d(geometry));
+        entity = multi_polygon;
+        break;
+      }
+      case GraphicEntity::Type::multipolygon_3d:
+      {
+        auto multi_polygon = std::make_shared<GMultiPolygon3D>();
+        for (size_t geometry = 0; geometry < geometry_count; geometry++)
+          multi_polygon->push_back(polygon3d(geometry));
+        entity = multi_polygon;
+        break;
+      }
+      default:
+        TL_THROW_EXCEPTION("Unsupported entity type");
+    }
+
+    std::shared_ptr<TableRegister> data = this->data(feature);
+    if (data) entity->setData(data);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return entity;
+}
+
+GLayer ColumnarLayer::toLayer() const
+{
+  GLayer layer;
+
+  try {
+
+    layer.setName(mName);
+    for (const auto &column : mColumns)
+      layer.addDataField(column.field());
+
+    for (size_t i = 0; i < mTypes.size(); i++)
+      layer.push_back(entity(i));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return layer;
+}
+
+size_t ColumnarLayer::geometryIndex(size_t feature, size_t geometry) const
+{
+  size_t id = mFeatureOffsets.at(feature) + geometry;
+  TL_ASSERT(id < mFeatureOffsets.at(feature + 1), "Geometry index out of range");
+  return id;
+}
+
+size_t ColumnarLayer::partIndex(size_t feature, size_t geometry, size_t part) const
+{
+  size_t geometry_id = geometryIndex(feature, geometry);
+  size_t id = mGeometryOffsets[geometry_id] + part;
+  TL_ASSERT(id < mGeometryOffsets[geometry_id + 1], "Part index out of range");
+  return id;
+}
+
+} // namespace graph
+
+} // namespace tl
@@ -0,0 +1,496 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef TL_GRAPHIC_COLUMNAR_H
+#define TL_GRAPHIC_COLUMNAR_H
+
+#include "config_tl.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tidop/core/defs.h"
+#include "tidop/geometry/entities/point.h"
+#include "tidop/geometry/entities/window.h"
+#include "tidop/graphic/datamodel.h"
+#include "tidop/graphic/entities/entity.h"
+
+namespace tl
+{
+
+/*! \addtogroup GraphicEntities
+ *  \{
+ */
+
+namespace graph
+{
+
+class GLayer;
+
+
+/*!
+ * \brief Reserva de memoria por bloques (arena)
+ *
+ * Las reservas se hacen de forma consecutiva dentro de bloques grandes y
+ * no se liberan de forma individual. Toda la memoria se libera a la vez
+ * con clear() o al destruir el objeto. Las direcciones devueltas son
+ * estables aunque se reserven nuevos bloques.
+ */
+class TL_EXPORT MemoryArena
+{
+
+public:
+
+  /*!
+   * \brief Constructor
+   * \param[in] blockSize Tamaño de bloque en bytes
+   */
+  explicit MemoryArena(size_t blockSize = 65536);
+  ~MemoryArena();
+
+  TL_DISABLE_COPY(MemoryArena)
+
+  MemoryArena(MemoryArena &&arena) TL_NOEXCEPT;
+  MemoryArena &operator = (MemoryArena &&arena) TL_NOEXCEPT;
+
+  /*!
+   * \brief Reserva memoria
+   * \param[in] size Tamaño en bytes
+   * \param[in] alignment Alineación
+   */
+  void *allocate(size_t size, size_t alignment = alignof(double));
+
+  /*!
+   * \brief Libera toda la memoria reservada
+   */
+  void clear();
+
+  /*!
+   * \brief Bytes reservados
+   */
+  size_t size() const;
+
+  /*!
+   * \brief Bytes ocupados por los bloques
+   */
+  size_t capacity() const;
+
+private:
+
+  size_t mBlockSize;
+  std::vector<std::pair<std::unique_ptr<char[]>, size_t>> mBlocks;
+  size_t mOffset;
+  size_t mSize;
+
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+/*!
+ * \brief Diccionario de cadenas
+ *
+ * Cada cadena distinta se almacena una sola vez en una arena y se
+ * identifica por un entero.
+ */
+class TL_EXPORT StringDictionary
+{
+
+public:
+
+  StringDictionary();
+  ~StringDictionary();
+
+  TL_DISABLE_COPY(StringDictionary)
+
+  StringDictionary(StringDictionary &&dictionary) TL_NOEXCEPT;
+  StringDictionary &operator = (StringDictionary &&dictionary) TL_NOEXCEPT;
+
+  /*!
+   * \brief Añade una cadena si no existe
+   * \return Identificador de la cadena
+   */
+  uint32_t insert(const std::string &value);
+
+  /*!
+   * \brief Cadena a partir de su identificador
+   */
+  std::string at(uint32_t id) const;
+
+  const char *data(uint32_t id) const;
+  size_t length(uint32_t id) const;
+
+  /*!
+   * \brief Número de cadenas distintas
+   */
+  size_t size() const;
+
+  void clear();
+
+private:
+
+  struct Key
+  {
+    const char *data;
+    size_t size;
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key &key) const;
+  };
+
+  struct KeyEqual
+  {
+    bool operator()(const Key &key1, const Key &key2) const;
+  };
+
+  MemoryArena mArena;
+  std::vector<Key> mStrings;
+  std::unordered_map<Key, uint32_t, KeyHash, KeyEqual> mIndex;
+
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+/*!
+ * \brief Columna de datos tipada
+ *
+ * Los valores se almacenan de forma contigua según el tipo del campo:
+ * - INT: int32_t
+ * - INT64: int64_t
+ * - DOUBLE y FLOAT: double
+ * - STRING: identificador en un diccionario de cadenas
+ */
+class TL_EXPORT FieldColumn
+{
+
+public:
+
+  FieldColumn(const std::shared_ptr<TableField> &field);
+  ~FieldColumn();
+
+  TL_DISABLE_COPY(FieldColumn)
+
+  FieldColumn(FieldColumn &&column) TL_NOEXCEPT;
+  FieldColumn &operator = (FieldColumn &&column) TL_NOEXCEPT;
+
+  std::shared_ptr<TableField> field() const;
+  TableField::Type type() const;
+
+  size_t size() const;
+  void reserve(size_t size);
+  void clear();
+
+  /*!
+   * \brief Añade un valor nulo al final de la columna
+   */
+  void pushNull();
+
+  void setInt(size_t id, int value);
+  void setInt64(size_t id, int64_t value);
+  void setDouble(size_t id, double value);
+  void setString(size_t id, const std::string &value);
+
+  /*!
+   * \brief Establece un valor a partir de su representación como texto
+   * La cadena se convierte al tipo de la columna. Una cadena vacía es un valor nulo
+   */
+  void setValue(size_t id, const std::string &value);
+
+  /*!
+   * \brief Añade al final los valores de otra columna
+   * Si los tipos no coinciden los valores se convierten
+   */
+  void append(const FieldColumn &column);
+
+  bool isNull(size_t id) const;
+
+  int toInt(size_t id) const;
+  int64_t toInt64(size_t id) const;
+  double toDouble(size_t id) const;
+  std::string toString(size_t id) const;
+
+  /*!
+   * \brief Datos de la columna
+   * Sólo el vector correspondiente al tipo de la columna contiene datos
+   */
+  const std::vector<int32_t> &ints() const;
+  const std::vector<int64_t> &ints64() const;
+  const std::vector<double> &doubles() const;
+  const std::vector<uint32_t> &stringIds() const;
+  const StringDictionary &dictionary() const;
+
+private:
+
+  std::shared_ptr<TableField> mField;
+  std::vector<int32_t> mInts;
+  std::vector<int64_t> mInts64;
+  std::vector<double> mDoubles;
+  std::vector<uint32_t> mStringIds;
+  std::vector<uint8_t> mNulls;
+  StringDictionary mDictionary;
+
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+class ColumnarLayer;
+
+/*!
+ * \brief Vista de una entidad de una capa columnar
+ *
+ * No copia la geometría. Sólo guarda la capa y el índice de la entidad.
+ * Es válida mientras la capa no se modifique.
+ */
+class TL_EXPORT FeatureView
+{
+
+public:
+
+  FeatureView(const ColumnarLayer *layer, size_t id);
+
+  size_t id() const;
+  GraphicEntity::Type type() const;
+
+  size_t geometries() const;
+  size_t parts(size_t geometry) const;
+  size_t points(size_t geometry, size_t part) const;
+  Point3<double> point(size_t geometry, size_t part, size_t id) const;
+
+  WindowD window() const;
+
+  /*!
+   * \brief Valor de un campo como texto
+   */
+  std::string value(size_t field) const;
+
+  /*!
+   * \brief Entidad gráfica equivalente con sus datos asociados
+   */
+  std::shared_ptr<GraphicEntity> toEntity() const;
+
+private:
+
+  const ColumnarLayer *mLayer;
+  size_t mId;
+
+};
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+/*!
+ * \brief Capa en formato columnar
+ *
+ * Alternativa a GLayer para capas grandes. Las coordenadas se almacenan en
+ * vectores contiguos (x, y y z sólo si hay entidades 3D) y la estructura
+ * de cada entidad mediante desplazamientos:
+ * entidad -> geometrías -> partes -> puntos
+ *
+ * - Punto: una geometría con una parte de un punto
+ * - Multipunto: una geometría con una parte de n puntos
+ * - Polilínea: una geometría con una parte
+ * - Multi-polilínea: una geometría con una parte por polilínea
+ * - Polígono: una geometría con una parte por anillo. El primero es el exterior
+ * - Multi-polígono: una geometría por polígono
+ *
+ * Los atributos se almacenan en columnas tipadas (FieldColumn).
+ *
+ * \code
+ * ColumnarLayer layer;
+ * layer.addDataField(std::make_shared<TableField>("id", TableField::Type::INT, 10));
+ * size_t id = layer.beginFeature(GraphicEntity::Type::polygon_2d);
+ * layer.addPoint(0., 0.);
+ * layer.addPoint(10., 0.);
+ * layer.addPoint(10., 10.);
+ * layer.column(0).setInt(id, 1);
+ * \endcode
+ */
+class TL_EXPORT ColumnarLayer
+{
+
+public:
+
+  ColumnarLayer();
+
+  /*!
+   * \brief Crea una capa columnar a partir de una capa
+   */
+  explicit ColumnarLayer(const GLayer &layer);
+
+  ~ColumnarLayer();
+
+  TL_DISABLE_COPY(ColumnarLayer)
+
+  ColumnarLayer(ColumnarLayer &&layer) TL_NOEXCEPT;
+  ColumnarLayer &operator = (ColumnarLayer &&layer) TL_NOEXCEPT;
+
+  std::string name() const;
+  void setName(const std::string &name);
+
+  /*!
+   * \brief Añade un campo de datos
+   * Los campos se tienen que añadir antes que las entidades
+   */
+  void addDataField(const std::shared_ptr<TableField> &field);
+  std::vector<std::shared_ptr<TableField>> tableFields() const;
+
+  size_t fieldCount() const;
+  FieldColumn &column(size_t id);
+  const FieldColumn &column(size_t id) const;
+
+  /*!
+   * \brief Índice de un campo a partir de su nombre
+   * \return Índice del campo o -1 si no existe
+   */
+  int fieldIndex(const std::string &name) const;
+
+  /*!
+   * \brief Número de entidades
+   */
+  size_t size() const;
+  bool empty() const;
+  void clear();
+
+  /*!
+   * \brief Reserva memoria
+   * \param[in] features Número de entidades
+   * \param[in] points Número total de puntos
+   */
+  void reserve(size_t features, size_t points);
+
+  /*!
+   * \brief Comienza una entidad nueva
+   * Los campos de datos de la entidad se inicializan como nulos
+   * \return Índice de la entidad
+   */
+  size_t beginFeature(GraphicEntity::Type type);
+
+  /*!
+   * \brief Comienza una geometría en la entidad actual (polígono de un multi-polígono)
+   */
+  void beginGeometry();
+
+  /*!
+   * \brief Comienza una parte en la geometría actual (anillo o polilínea)
+   */
+  void beginPart();
+
+  /*!
+   * \brief Añade un punto a la parte actual
+   * Si la entidad no tiene geometrías o partes se crean
+   */
+  void addPoint(double x, double y);
+  void addPoint(double x, double y, double z);
+
+  /*!
+   * \brief Añade una entidad gráfica con sus datos asociados
+   */
+  void push_back(const GraphicEntity &entity);
+
+  /*!
+   * \brief Añade las entidades de otra capa
+   * Los campos se asocian por nombre. Los campos que no existen en esta capa
+   * se ignoran y los que no existen en la otra quedan nulos
+   */
+  void append(const ColumnarLayer &layer);
+
+  GraphicEntity::Type type(size_t feature) const;
+  size_t geometries(size_t feature) const;
+  size_t parts(size_t feature, size_t geometry) const;
+  size_t points(size_t feature, size_t geometry, size_t part) const;
+
+  /*!
+   * \brief Rango [first, last) de puntos de una parte en los vectores de coordenadas
+   */
+  std::pair<size_t, size_t> pointRange(size_t feature, size_t geometry, size_t part) const;
+
+  Point3<double> point(size_t feature, size_t geometry, size_t part, size_t id) const;
+
+  /*!
+   * \brief Coordenadas de todos los puntos de la capa
+   * z está vacío si no hay entidades 3D
+   */
+  const std::vector<double> &x() const;
+  const std::vector<double> &y() const;
+  const std::vector<double> &z() const;
+
+  WindowD window(size_t feature) const;
+
+  FeatureView feature(size_t feature) const;
+
+  /*!
+   * \brief Datos asociados a una entidad
+   */
+  std::shared_ptr<TableRegister> data(size_t feature) const;
+
+  /*!
+   * \brief Entidad gráfica equivalente con sus datos asociados
+   */
+  std::shared_ptr<GraphicEntity> entity(size_t feature) const;
+
+  /*!
+   * \brief Convierte la capa a GLayer
+   */
+  GLayer toLayer() const;
+
+private:
+
+  size_t geometryIndex(size_t feature, size_t geometry) const;
+  size_t partIndex(size_t feature, size_t geometry, size_t part) const;
+
+private:
+
+  std::string mName;
+  std::vector<FieldColumn> mColumns;
+  std::vector<GraphicEntity::Type> mTypes;
+  /// Desplazamientos de entidades en geometrías, de geometrías en partes y de partes en puntos
+  std::vector<size_t> mFeatureOffsets;
+  std::vector<size_t> mGeometryOffsets;
+  std::vector<size_t> mPartOffsets;
+  std::vector<double> mX;
+  std::vector<double> mY;
+  std::vector<double> mZ;
+  bool mOpenGeometry;
+  bool mOpenPart;
+
+};
+
+} // namespace graph
+
+/*! \} */ //  GraphicEntities
+
+} // namespace tl
+
+#endif // TL_GRAPHIC_COLUMNAR_H
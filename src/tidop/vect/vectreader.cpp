@@ -28,11 +28,17 @@
 #include "tidop/core/messages.h"
 #include "tidop/core/gdalreg.h"
 #include "tidop/core/path.h"
+#include "tidop/core/concurrency.h"
 #include "tidop/graphic/layer.h"
+#include "tidop/graphic/columnar.h"
 #include "tidop/graphic/entities/point.h"
 #include "tidop/graphic/entities/linestring.h"
 #include "tidop/graphic/entities/polygon.h"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 
 #ifdef TL_HAVE_GDAL
 TL_SUPPRESS_WARNINGS
@@ -50,17 +56,290 @@ constexpr auto mm_to_m = 0.001;
 
 using namespace graph;
 
+/// Une varias capas columnares. Los campos se asocian por nombre
+static void mergeLayers(std::vector<graph::ColumnarLayer> &layers, graph::ColumnarLayer &layer)
+{
+  layer = graph::ColumnarLayer();
+
+  if (layers.empty()) return;
+
+  if (layers.size() == 1) {
+    layer = std::move(layers[0]);
+    return;
+  }
+
+  layer.setName(layers[0].name());
+
+  size_t features = 0;
+  size_t points = 0;
+
+  for (const auto &_layer : layers) {
+    for (const auto &field : _layer.tableFields()) {
+      if (layer.fieldIndex(field->name()) < 0)
+        layer.addDataField(field);
+    }
+    features += _layer.size();
+    points += _layer.x().size();
+  }
+
+  layer.reserve(features, points);
+
+  for (auto &_layer : layers) {
+    layer.append(_layer);
+    _layer.clear();
+  }
+}
+
 VectorReader::VectorReader(Path file)
   : mFile(std::move(file))
 {
 }
 
+void VectorReader::read(int layerId, graph::ColumnarLayer &layer)
+{
+  try {
+
+    std::shared_ptr<graph::GLayer> g_layer = this->read(layerId);
+    TL_ASSERT(g_layer, "Layer not found");
+    layer = graph::ColumnarLayer(*g_layer);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorReader::read(const std::string &layerName, graph::ColumnarLayer &layer)
+{
+  try {
+
+    std::shared_ptr<graph::GLayer> g_layer = this->read(layerName);
+    TL_ASSERT(g_layer, "Layer not found");
+    layer = graph::ColumnarLayer(*g_layer);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+std::vector<std::shared_ptr<graph::GLayer>> VectorReader::readLayers(const std::vector<int> &layerIds)
+{
+  std::vector<std::shared_ptr<graph::GLayer>> layers;
+
+  try {
+
+    layers.reserve(layerIds.size());
+    for (int layer_id : layerIds)
+      layers.push_back(this->read(layer_id));
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return layers;
+}
+
+void VectorReader::readLayers(const std::vector<int> &layerIds, graph::ColumnarLayer &layer)
+{
+  try {
+
+    std::vector<graph::ColumnarLayer> layers(layerIds.size());
+    for (size_t i = 0; i < layerIds.size(); i++)
+      this->read(layerIds[i], layers[i]);
+
+    mergeLayers(layers, layer);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorReader::readParallel(int layerId, graph::ColumnarLayer &layer)
+{
+  try {
+
+    this->read(layerId, layer);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+
+/* ---------------------------------------------------------------------------------- */
+
+
+VectorQuery::VectorQuery()
+  : mSpatialFilter(),
+    mAttributeFilter(),
+    mFields(),
+    mFieldSelection(false),
+    mReadStyles(false),
+    mBatchSize(1000)
+{
+}
+
+WindowD VectorQuery::spatialFilter() const
+{
+  return mSpatialFilter;
+}
+
+void VectorQuery::setSpatialFilter(const WindowD &window)
+{
+  mSpatialFilter = window;
+}
+
+bool VectorQuery::hasSpatialFilter() const
+{
+  return mSpatialFilter.isValid();
+}
+
+std::string VectorQuery::attributeFilter() const
+{
+  return mAttributeFilter;
+}
+
+void VectorQuery::setAttributeFilter(const std::string &filter)
+{
+  mAttributeFilter = filter;
+}
+
+std::vector<std::string> VectorQuery::fields() const
+{
+  return mFields;
+}
+
+void VectorQuery::selectFields(const std::vector<std::string> &fields)
+{
+  mFields = fields;
+  mFieldSelection = true;
+}
+
+bool VectorQuery::isFieldSelectionEnabled() const
+{
+  return mFieldSelection;
+}
+
+bool VectorQuery::readStyles() const
+{
+  return mReadStyles;
+}
+
+void VectorQuery::setReadStyles(bool readStyles)
+{
+  mReadStyles = readStyles;
+}
+
+size_t VectorQuery::batchSize() const
+{
+  return mBatchSize;
+}
+
+void VectorQuery::setBatchSize(size_t batchSize)
+{
+  mBatchSize = batchSize > 0 ? batchSize : 1;
+}
+
 
 /* ---------------------------------------------------------------------------------- */
 
 
 #ifdef TL_HAVE_GDAL
 
+static TableField::Type tableFieldType(OGRFieldType ogrType)
+{
+  TableField::Type type;
+
+  switch (ogrType) {
+    case OFTInteger:
+      type = TableField::Type::INT;
+      break;
+    case OFTInteger64:
+      type = TableField::Type::INT64;
+      break;
+    case OFTReal:
+      type = TableField::Type::DOUBLE;
+      break;
+    default:
+      type = TableField::Type::STRING;
+      break;
+  }
+
+  return type;
+}
+
+/*!
+ * \brief Conjunto de conexiones a un fichero vectorial
+ *
+ * Una conexión GDAL no se puede usar desde varios hilos a la vez. Cada hilo
+ * toma una conexión y la devuelve al terminar. Las conexiones se abren bajo
+ * demanda y se reutilizan hasta que se vacía el conjunto.
+ */
+class GdalDatasetPool
+{
+
+public:
+
+  explicit GdalDatasetPool(std::string file)
+    : mFile(std::move(file))
+  {
+  }
+
+  ~GdalDatasetPool()
+  {
+    clear();
+  }
+
+  TL_DISABLE_COPY(GdalDatasetPool)
+  TL_DISABLE_MOVE(GdalDatasetPool)
+
+  GDALDataset *acquire()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    GDALDataset *dataset = nullptr;
+
+    if (mFree.empty()) {
+      dataset = static_cast<GDALDataset *>(GDALOpenEx(mFile.c_str(),
+                                                      GDAL_OF_VECTOR | GDAL_OF_READONLY,
+                                                      nullptr, nullptr, nullptr));
+      TL_ASSERT(dataset != nullptr, "Open vector file failed");
+      mDatasets.push_back(dataset);
+    } else {
+      dataset = mFree.back();
+      mFree.pop_back();
+    }
+
+    return dataset;
+  }
+
+  void release(GDALDataset *dataset)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFree.push_back(dataset);
+  }
+
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto dataset : mDatasets)
+      GDALClose(dataset);
+
+    mDatasets.clear();
+    mFree.clear();
+  }
+
+private:
+
+  std::string mFile;
+  std::mutex mMutex;
+  std::vector<GDALDataset *> mDatasets;
+  std::vector<GDALDataset *> mFree;
+
+};
+
+class FeatureCursorGdal;
+
 class VectorReaderGdal
   : public VectorReader
 {
@@ -102,6 +381,11 @@ public:
 
   void close() override
   {
+    if (mPool) {
+      mPool->clear();
+      mPool.reset();
+    }
+
     if (mDataset) {
       GDALClose(mDataset);
       mDataset = nullptr;
@@ -150,7 +434,7 @@ public:
       OGRLayer *ogrLayer = mDataset->GetLayerByName(layerName.c_str());
       TL_ASSERT(ogrLayer != nullptr, "Layer not found");
     
-      this->read(ogrLayer);
+      layer = this->read(ogrLayer);
 
     } catch (...) {
       TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
@@ -159,6 +443,47 @@ public:
     return layer;
   }
 
+  void read(int layerId, graph::ColumnarLayer &layer) override
+  {
+    try {
+
+      TL_ASSERT(isOpen(), "The file has not been opened. Try to use VectorReaderGdal::open() method");
+
+      OGRLayer *ogrLayer = mDataset->GetLayer(layerId);
+      TL_ASSERT(ogrLayer != nullptr, "Layer not found");
+
+      this->read(ogrLayer, layer);
+
+    } catch (...) {
+      TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+    }
+  }
+
+  void read(const std::string &layerName, graph::ColumnarLayer &layer) override
+  {
+    try {
+
+      TL_ASSERT(isOpen(), "The file has not been opened. Try to use VectorReaderGdal::open() method");
+
+      OGRLayer *ogrLayer = mDataset->GetLayerByName(layerName.c_str());
+      TL_ASSERT(ogrLayer != nullptr, "Layer not found");
+
+      this->read(ogrLayer, layer);
+
+    } catch (...) {
+      TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+    }
+  }
+
+  std::vector<std::shared_ptr<graph::GLayer>> readLayers(const std::vector<int> &layerIds) override;
+  void readLayers(const std::vector<int> &layerIds, graph::ColumnarLayer &layer) override;
+  void readParallel(int layerId, graph::ColumnarLayer &layer) override;
+
+  std::unique_ptr<FeatureCursor> cursor(int layerId,
+                                        const VectorQuery &query) override;
+  std::unique_ptr<FeatureCursor> cursor(const std::string &layerName,
+                                        const VectorQuery &query) override;
+
   std::string crsWkt() const override
   {
     std::string crs_wkt;
@@ -231,7 +556,9 @@ public:
         compareInsensitiveCase(extension, ".kml") ||
         compareInsensitiveCase(extension, ".kmz") ||
         compareInsensitiveCase(extension, ".json") ||
-        compareInsensitiveCase(extension, ".osm")) {
+        compareInsensitiveCase(extension, ".osm") ||
+        compareInsensitiveCase(extension, ".gpkg") ||
+        compareInsensitiveCase(extension, ".sqlite")) {
       bSupported = true;
     }
 
@@ -241,6 +568,10 @@ public:
 private:
 
   std::shared_ptr<graph::GLayer> read(OGRLayer *ogrLayer);
+  void read(OGRLayer *ogrLayer, graph::ColumnarLayer &layer);
+  void read(OGRLayer *ogrLayer, graph::ColumnarLayer &layer, GIntBig first, GIntBig count);
+  void parallelRead(size_t tasks, const std::function<void(GDALDataset *, size_t)> &readTask);
+  bool readGeometry(OGRGeometry *ogrGeometry, graph::ColumnarLayer &layer);
   std::shared_ptr<graph::GraphicEntity> readEntity(OGRGeometry *ogrGeometry);
   std::shared_ptr<graph::GPoint> readPoint(OGRPoint *ogrPoint);
   std::shared_ptr<graph::GPoint3D> readPoint3D(OGRPoint *ogrPoint);
@@ -270,48 +601,460 @@ private:
   void readData(OGRFeature *ogrFeature,
                 OGRFeatureDefn *ogrFeatureDefinition,
                 std::shared_ptr<TableRegister> &data);
+  void readData(OGRFeature *ogrFeature,
+                const std::vector<int> &fieldIndexes,
+                const std::vector<OGRFieldType> &fieldTypes,
+                graph::ColumnarLayer &layer,
+                size_t id);
 
 private:
 
   GDALDataset *mDataset;
+  std::unique_ptr<GdalDatasetPool> mPool;
+
+  friend class FeatureCursorGdal;
 
 };
 
 
-std::shared_ptr<graph::GLayer> VectorReaderGdal::read(OGRLayer *ogrLayer)
+
+/*!
+ * \brief Cursor para capas OGR
+ *
+ * Los filtros se establecen en la capa OGR para que el driver descarte las
+ * entidades (uso de índices espaciales cuando el formato los tiene) y los
+ * campos no seleccionados se marcan como ignorados para que no se lean.
+ * Al destruirse el cursor se restablece el estado de la capa.
+ */
+class FeatureCursorGdal
+  : public FeatureCursor
 {
-  std::shared_ptr<graph::GLayer> layer(new graph::GLayer);
 
-  ////////////////////////////////////////////////////////////////////
-  // Definición de campos asociados a las entidades
+public:
 
-  OGRFeatureDefn *featureDefinition = ogrLayer->GetLayerDefn();
-  int size = featureDefinition->GetFieldCount();
-  for (int i = 0; i < size; i++) {
+  FeatureCursorGdal(VectorReaderGdal *reader,
+                    OGRLayer *ogrLayer,
+                    const VectorQuery &query)
+    : mReader(reader),
+      mLayer(ogrLayer),
+      mQuery(query)
+  {
+    init();
+  }
 
-    if (OGRFieldDefn *fieldDefinition = featureDefinition->GetFieldDefn(i)) {
+  ~FeatureCursorGdal() override
+  {
+    mLayer->SetSpatialFilter(nullptr);
+    mLayer->SetAttributeFilter(nullptr);
+    mLayer->SetIgnoredFields(nullptr);
+    mLayer->ResetReading();
+  }
+
+  std::vector<std::shared_ptr<TableField>> tableFields() const override
+  {
+    return mFields;
+  }
 
-      TableField::Type type;
+  int64_t featureCount() const override
+  {
+    return static_cast<int64_t>(mLayer->GetFeatureCount(FALSE));
+  }
 
-      const char *name = fieldDefinition->GetNameRef();
-      OGRFieldType ogr_type = fieldDefinition->GetType();
-      switch (ogr_type) {
+  size_t next(std::vector<std::shared_ptr<graph::GraphicEntity>> &entities) override
+  {
+    entities.clear();
+
+    try {
+
+      size_t batch_size = mQuery.batchSize();
+      entities.reserve(batch_size);
+
+      OGRFeature *ogrFeature = nullptr;
+      while (entities.size() < batch_size &&
+             (ogrFeature = mLayer->GetNextFeature()) != nullptr) {
+
+        try {
+
+          if (OGRGeometry *ogrGeometry = ogrFeature->GetGeometryRef()) {
+
+            std::shared_ptr<graph::GraphicEntity> entity = mReader->readEntity(ogrGeometry);
+
+            if (entity) {
+
+              if (mQuery.readStyles()) {
+                OGRStyleMgr ogrStyleMgr;
+                ogrStyleMgr.GetStyleString(ogrFeature);
+                mReader->readStyles(&ogrStyleMgr, entity);
+              }
+
+              if (!mFields.empty()) {
+                std::shared_ptr<TableRegister> data = std::make_shared<TableRegister>(mFields);
+                readData(ogrFeature, data);
+                entity->setData(data);
+              }
+
+              entities.push_back(entity);
+            }
+
+          }
+
+        } catch (std::exception &e) {
+          msgError(e.what());
+        }
+
+        OGRFeature::DestroyFeature(ogrFeature);
+      }
+
+    } catch (...) {
+      TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+    }
+
+    return entities.size();
+  }
+
+  size_t next(graph::ColumnarLayer &layer) override
+  {
+    size_t size = 0;
+
+    try {
+
+      if (layer.fieldCount() != mFields.size()) {
+        layer = graph::ColumnarLayer();
+        for (const auto &field : mFields)
+          layer.addDataField(field);
+      } else {
+        layer.clear();
+      }
+
+      layer.setName(mLayer->GetName());
+
+      size_t batch_size = mQuery.batchSize();
+      layer.reserve(batch_size, 0);
+
+      OGRFeature *ogrFeature = nullptr;
+      while (layer.size() < batch_size &&
+             (ogrFeature = mLayer->GetNextFeature()) != nullptr) {
+
+        OGRGeometry *ogrGeometry = ogrFeature->GetGeometryRef();
+
+        if (ogrGeometry && mReader->readGeometry(ogrGeometry, layer)) {
+          mReader->readData(ogrFeature, mFieldIndexes, mFieldTypes, layer, layer.size() - 1);
+        }
+
+        OGRFeature::DestroyFeature(ogrFeature);
+      }
+
+      size = layer.size();
+
+    } catch (...) {
+      TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+    }
+
+    return size;
+  }
+
+  void reset() override
+  {
+    mLayer->ResetReading();
+  }
+
+private:
+
+  void init()
+  {
+    OGRFeatureDefn *featureDefinition = mLayer->GetLayerDefn();
+    int field_count = featureDefinition->GetFieldCount();
+
+    std::vector<bool> selected(static_cast<size_t>(field_count), !mQuery.isFieldSelectionEnabled());
+
+    if (mQuery.isFieldSelectionEnabled()) {
+      for (const auto &name : mQuery.fields()) {
+        int index = featureDefinition->GetFieldIndex(name.c_str());
+        if (index < 0) TL_THROW_EXCEPTION("Field not found: %s", name.c_str());
+        selected[static_cast<size_t>(index)] = true;
+      }
+    }
+
+    /// Los campos no seleccionados y los estilos no se leen
+
+    std::vector<const char *> ignored_fields;
+
+    for (int i = 0; i < field_count; i++) {
+
+      OGRFieldDefn *fieldDefinition = featureDefinition->GetFieldDefn(i);
+
+      if (selected[static_cast<size_t>(i)]) {
+        mFieldIndexes.push_back(i);
+        mFieldTypes.push_back(fieldDefinition->GetType());
+        mFields.push_back(std::make_shared<TableField>(fieldDefinition->GetNameRef(),
+                                                       tableFieldType(fieldDefinition->GetType()),
+                                                       fieldDefinition->GetWidth()));
+      } else {
+        ignored_fields.push_back(fieldDefinition->GetNameRef());
+      }
+    }
+
+    if (!mQuery.readStyles())
+      ignored_fields.push_back("OGR_STYLE");
+
+    ignored_fields.push_back(nullptr);
+
+    if (mLayer->SetIgnoredFields(ignored_fields.data()) != OGRERR_NONE) {
+      msgWarning("Ignored fields are not supported by layer %s", mLayer->GetName());
+    }
+
+    /// Filtros
+
+    if (mQuery.hasSpatialFilter()) {
+      WindowD window = mQuery.spatialFilter();
+      mLayer->SetSpatialFilterRect(window.pt1.x, window.pt1.y, window.pt2.x, window.pt2.y);
+    } else {
+      mLayer->SetSpatialFilter(nullptr);
+    }
+
+    std::string attribute_filter = mQuery.attributeFilter();
+    if (attribute_filter.empty()) {
+      mLayer->SetAttributeFilter(nullptr);
+    } else if (mLayer->SetAttributeFilter(attribute_filter.c_str()) != OGRERR_NONE) {
+      mLayer->SetSpatialFilter(nullptr);
+      mLayer->SetIgnoredFields(nullptr);
+      TL_THROW_EXCEPTION("Invalid attribute filter: %s", attribute_filter.c_str());
+    }
+
+    mLayer->ResetReading();
+  }
+
+  void readData(OGRFeature *ogrFeature,
+                std::shared_ptr<TableRegister> &data)
+  {
+    for (size_t i = 0; i < mFieldIndexes.size(); i++) {
+
+      int index = mFieldIndexes[i];
+      if (!ogrFeature->IsFieldSet(index)) continue;
+
+      switch (mFieldTypes[i]) {
         case OFTInteger:
-          type = TableField::Type::INT;
+          data->setValue(static_cast<int>(i), std::to_string(ogrFeature->GetFieldAsInteger(index)));
           break;
         case OFTInteger64:
-          type = TableField::Type::INT64;
+          data->setValue(static_cast<int>(i), std::to_string(ogrFeature->GetFieldAsInteger64(index)));
           break;
         case OFTReal:
-          type = TableField::Type::DOUBLE;
-          break;
-        case OFTString:
-          type = TableField::Type::STRING;
+          data->setValue(static_cast<int>(i), std::to_string(ogrFeature->GetFieldAsDouble(index)));
           break;
         default:
-          type = TableField::Type::STRING;
+          data->setValue(static_cast<int>(i), ogrFeature->GetFieldAsString(index));
           break;
       }
+    }
+  }
+
+private:
+
+  VectorReaderGdal *mReader;
+  OGRLayer *mLayer;
+  VectorQuery mQuery;
+  std::vector<int> mFieldIndexes;
+  std::vector<OGRFieldType> mFieldTypes;
+  std::vector<std::shared_ptr<TableField>> mFields;
+
+};
+
+
+
+std::unique_ptr<FeatureCursor> VectorReaderGdal::cursor(int layerId,
+                                                        const VectorQuery &query)
+{
+  std::unique_ptr<FeatureCursor> feature_cursor;
+
+  try {
+
+    TL_ASSERT(isOpen(), "The file has not been opened. Try to use VectorReaderGdal::open() method");
+
+    OGRLayer *ogrLayer = mDataset->GetLayer(layerId);
+    TL_ASSERT(ogrLayer != nullptr, "Layer not found");
+
+    feature_cursor = std::make_unique<FeatureCursorGdal>(this, ogrLayer, query);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return feature_cursor;
+}
+
+std::unique_ptr<FeatureCursor> VectorReaderGdal::cursor(const std::string &layerName,
+                                                        const VectorQuery &query)
+{
+  std::unique_ptr<FeatureCursor> feature_cursor;
+
+  try {
+
+    TL_ASSERT(isOpen(), "The file has not been opened. Try to use VectorReaderGdal::open() method");
+
+    OGRLayer *ogrLayer = mDataset->GetLayerByName(layerName.c_str());
+    TL_ASSERT(ogrLayer != nullptr, "Layer not found");
+
+    feature_cursor = std::make_unique<FeatureCursorGdal>(this, ogrLayer, query);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return feature_cursor;
+}
+
+
+std::vector<std::shared_ptr<graph::GLayer>> VectorReaderGdal::readLayers(const std::vector<int> &layerIds)
+{
+  std::vector<std::shared_ptr<graph::GLayer>> layers(layerIds.size());
+
+  try {
+
+    TL_ASSERT(isOpen(), "The file has not been opened. Try to use VectorReaderGdal::open() method");
+
+    parallelRead(layerIds.size(), [&](GDALDataset *dataset, size_t i) {
+      OGRLayer *ogrLayer = dataset->GetLayer(layerIds[i]);
+      TL_ASSERT(ogrLayer != nullptr, "Layer not found");
+      layers[i] = this->read(ogrLayer);
+    });
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return layers;
+}
+
+void VectorReaderGdal::readLayers(const std::vector<int> &layerIds, graph::ColumnarLayer &layer)
+{
+  try {
+
+    TL_ASSERT(isOpen(), "The file has not been opened. Try to use VectorReaderGdal::open() method");
+
+    std::vector<graph::ColumnarLayer> layers(layerIds.size());
+
+    parallelRead(layerIds.size(), [&](GDALDataset *dataset, size_t i) {
+      OGRLayer *ogrLayer = dataset->GetLayer(layerIds[i]);
+      TL_ASSERT(ogrLayer != nullptr, "Layer not found");
+      this->read(ogrLayer, layers[i]);
+    });
+
+    mergeLayers(layers, layer);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorReaderGdal::readParallel(int layerId, graph::ColumnarLayer &layer)
+{
+  try {
+
+    TL_ASSERT(isOpen(), "The file has not been opened. Try to use VectorReaderGdal::open() method");
+
+    OGRLayer *ogrLayer = mDataset->GetLayer(layerId);
+    TL_ASSERT(ogrLayer != nullptr, "Layer not found");
+
+    /// Tamaño mínimo de rango para compensar la apertura de conexiones
+    constexpr GIntBig min_range_size = 10000;
+
+    GIntBig feature_count = ogrLayer->GetFeatureCount(TRUE);
+    size_t threads = optimalNumberOfThreads();
+
+    if (threads < 2 || feature_count < 2 * min_range_size ||
+        !ogrLayer->TestCapability(OLCFastSetNextByIndex)) {
+      this->read(ogrLayer, layer);
+      return;
+    }
+
+    /// Más rangos que hilos para repartir mejor la carga
+    GIntBig range_count = std::min(static_cast<GIntBig>(threads * 4), feature_count / min_range_size);
+    GIntBig range_size = (feature_count + range_count - 1) / range_count;
+
+    std::vector<graph::ColumnarLayer> layers(static_cast<size_t>(range_count));
+
+    parallelRead(layers.size(), [&](GDALDataset *dataset, size_t i) {
+      OGRLayer *_ogrLayer = dataset->GetLayer(layerId);
+      TL_ASSERT(_ogrLayer != nullptr, "Layer not found");
+      GIntBig first = static_cast<GIntBig>(i) * range_size;
+      this->read(_ogrLayer, layers[i], first, std::min(range_size, feature_count - first));
+    });
+
+    mergeLayers(layers, layer);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorReaderGdal::parallelRead(size_t tasks,
+                                    const std::function<void(GDALDataset *, size_t)> &readTask)
+{
+  if (tasks == 0) return;
+
+  if (!mPool) mPool = std::make_unique<GdalDatasetPool>(mFile.toString());
+
+  size_t num_threads = std::min(static_cast<size_t>(optimalNumberOfThreads()), tasks);
+  std::atomic<size_t> next_task(0);
+  std::mutex mutex;
+  std::exception_ptr error;
+
+  auto worker = [&]() {
+
+    GDALDataset *dataset = nullptr;
+
+    try {
+
+      dataset = mPool->acquire();
+
+      size_t task;
+      while ((task = next_task++) < tasks) {
+
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (error) break;
+        }
+
+        readTask(dataset, task);
+      }
+
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) error = std::current_exception();
+    }
+
+    if (dataset) mPool->release(dataset);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (size_t i = 1; i < num_threads; i++)
+    threads.emplace_back(worker);
+
+  worker();
+
+  for (auto &thread : threads)
+    thread.join();
+
+  if (error) std::rethrow_exception(error);
+}
+
+std::shared_ptr<graph::GLayer> VectorReaderGdal::read(OGRLayer *ogrLayer)
+{
+  std::shared_ptr<graph::GLayer> layer(new graph::GLayer);
+
+  ////////////////////////////////////////////////////////////////////
+  // Definición de campos asociados a las entidades
+
+  OGRFeatureDefn *featureDefinition = ogrLayer->GetLayerDefn();
+  int size = featureDefinition->GetFieldCount();
+  for (int i = 0; i < size; i++) {
+
+    if (OGRFieldDefn *fieldDefinition = featureDefinition->GetFieldDefn(i)) {
+
+      const char *name = fieldDefinition->GetNameRef();
+      TableField::Type type = tableFieldType(fieldDefinition->GetType());
       int width = fieldDefinition->GetWidth();
 
       std::shared_ptr<TableField> field(new TableField(name, type, width));
@@ -323,21 +1066,26 @@ std::shared_ptr<graph::GLayer> VectorReaderGdal::read(OGRLayer *ogrLayer)
   ////////////////////////////////////////////////////////////////////
 
 
+  /// En DXF y DGN el nombre de la capa se almacena como campo de la entidad
+  const char *driver_name = mDataset->GetDriverName();
+  int layer_name_field = -1;
+  if (strcmp(driver_name, "DXF") == 0) {
+    layer_name_field = 0;
+  } else if (strcmp(driver_name, "DGN") == 0) {
+    layer_name_field = 1;
+  } else {
+    layer->setName(ogrLayer->GetName());
+  }
+
+  ogrLayer->ResetReading();
+
   OGRFeature *ogrFeature;
   while ((ogrFeature = ogrLayer->GetNextFeature()) != nullptr) {
 
-    const char *driver_name = mDataset->GetDriverName();
-    const char *layerName = nullptr;
-    if (strcmp(driver_name, "DXF") == 0) {
-      layerName = ogrFeature->GetFieldAsString(0);
-    } else if (strcmp(driver_name, "DGN") == 0) {
-      layerName = ogrFeature->GetFieldAsString(1);
-    } else {
-      layerName = ogrLayer->GetName();
+    if (layer_name_field >= 0) {
+      layer->setName(ogrFeature->GetFieldAsString(layer_name_field));
     }
 
-    layer->setName(layerName);
-
     if (OGRGeometry *pGeometry = ogrFeature->GetGeometryRef()) {
 
       OGRStyleMgr *ogrStyleMgr = nullptr;
@@ -364,12 +1112,144 @@ std::shared_ptr<graph::GLayer> VectorReaderGdal::read(OGRLayer *ogrLayer)
 
     }
 
+    OGRFeature::DestroyFeature(ogrFeature);
   }
-  OGRFeature::DestroyFeature(ogrFeature);
 
   return layer;
 }
 
+void VectorReaderGdal::read(OGRLayer *ogrLayer, graph::ColumnarLayer &layer)
+{
+  this->read(ogrLayer, layer, 0, -1);
+}
+
+void VectorReaderGdal::read(OGRLayer *ogrLayer, 
+                            graph::ColumnarLayer &layer, 
+                            GIntBig first, 
+                            GIntBig count)
+{
+  layer = graph::ColumnarLayer();
+  layer.setName(ogrLayer->GetName());
+
+  OGRFeatureDefn *featureDefinition = ogrLayer->GetLayerDefn();
+  int size = featureDefinition->GetFieldCount();
+  std::vector<int> field_indexes(static_cast<size_t>(size));
+  std::vector<OGRFieldType> field_types(static_cast<size_t>(size));
+
+  for (int i = 0; i < size; i++) {
+
+    OGRFieldDefn *fieldDefinition = featureDefinition->GetFieldDefn(i);
+    OGRFieldType ogr_type = fieldDefinition->GetType();
+    field_indexes[static_cast<size_t>(i)] = i;
+    field_types[static_cast<size_t>(i)] = ogr_type;
+
+    layer.addDataField(std::make_shared<TableField>(fieldDefinition->GetNameRef(), 
+                                                    tableFieldType(ogr_type), 
+                                                    fieldDefinition->GetWidth()));
+  }
+
+  GIntBig feature_count = count >= 0 ? count : ogrLayer->GetFeatureCount(FALSE);
+  if (feature_count > 0) layer.reserve(static_cast<size_t>(feature_count), 0);
+
+  ogrLayer->ResetReading();
+
+  if (first > 0 && ogrLayer->SetNextByIndex(first) != OGRERR_NONE)
+    throw TL_ERROR("GDAL ERROR (%i): %s", CPLGetLastErrorNo(), CPLGetLastErrorMsg());
+
+  OGRFeature *ogrFeature;
+  GIntBig feature_read = 0;
+  while ((count < 0 || feature_read < count) &&
+         (ogrFeature = ogrLayer->GetNextFeature()) != nullptr) {
+
+    feature_read++;
+
+    OGRGeometry *ogrGeometry = ogrFeature->GetGeometryRef();
+
+    if (ogrGeometry && readGeometry(ogrGeometry, layer)) {
+      readData(ogrFeature, field_indexes, field_types, layer, layer.size() - 1);
+    }
+
+    OGRFeature::DestroyFeature(ogrFeature);
+  }
+}
+
+bool VectorReaderGdal::readGeometry(OGRGeometry *ogrGeometry, graph::ColumnarLayer &layer)
+{
+  bool is_3d = ogrGeometry->getCoordinateDimension() == 3;
+
+  auto read_line = [&layer, is_3d](const OGRSimpleCurve *ogrCurve) {
+    layer.beginPart();
+    int size = ogrCurve->getNumPoints();
+    for (int i = 0; i < size; i++) {
+      if (is_3d)
+        layer.addPoint(ogrCurve->getX(i), ogrCurve->getY(i), ogrCurve->getZ(i));
+      else
+        layer.addPoint(ogrCurve->getX(i), ogrCurve->getY(i));
+    }
+  };
+
+  auto read_polygon = [&layer, &read_line](const OGRPolygon *ogrPolygon) {
+    layer.beginGeometry();
+    if (const OGRLinearRing *ring = ogrPolygon->getExteriorRing()) {
+      read_line(ring);
+      for (int i = 0; i < ogrPolygon->getNumInteriorRings(); i++)
+        read_line(ogrPolygon->getInteriorRing(i));
+    }
+  };
+
+  auto add_point = [&layer, is_3d](const OGRPoint *ogrPoint) {
+    if (is_3d)
+      layer.addPoint(ogrPoint->getX(), ogrPoint->getY(), ogrPoint->getZ());
+    else
+      layer.addPoint(ogrPoint->getX(), ogrPoint->getY());
+  };
+
+  switch (wkbFlatten(ogrGeometry->getGeometryType())) {
+    case wkbPoint:
+      layer.beginFeature(is_3d ? GraphicEntity::Type::point_3d : GraphicEntity::Type::point_2d);
+      add_point(static_cast<OGRPoint *>(ogrGeometry));
+      break;
+    case wkbLineString:
+      layer.beginFeature(is_3d ? GraphicEntity::Type::linestring_3d : GraphicEntity::Type::linestring_2d);
+      read_line(static_cast<OGRLineString *>(ogrGeometry));
+      break;
+    case wkbPolygon:
+      layer.beginFeature(is_3d ? GraphicEntity::Type::polygon_3d : GraphicEntity::Type::polygon_2d);
+      read_polygon(static_cast<OGRPolygon *>(ogrGeometry));
+      break;
+    case wkbMultiPoint:
+    {
+      auto ogrMultiPoint = static_cast<OGRMultiPoint *>(ogrGeometry);
+      layer.beginFeature(is_3d ? GraphicEntity::Type::multipoint_3d : GraphicEntity::Type::multipoint_2d);
+      layer.beginPart();
+      for (int i = 0; i < ogrMultiPoint->getNumGeometries(); i++)
+        add_point(static_cast<OGRPoint *>(ogrMultiPoint->getGeometryRef(i)));
+      break;
+    }
+    case wkbMultiLineString:
+    {
+      auto ogrMultiLineString = static_cast<OGRMultiLineString *>(ogrGeometry);
+      layer.beginFeature(is_3d ? GraphicEntity::Type::multiline_3d : GraphicEntity::Type::multiline_2d);
+      layer.beginGeometry();
+      for (int i = 0; i < ogrMultiLineString->getNumGeometries(); i++)
+        read_line(static_cast<OGRLineString *>(ogrMultiLineString->getGeometryRef(i)));
+      break;
+    }
+    case wkbMultiPolygon:
+    {
+      auto ogrMultiPolygon = static_cast<OGRMultiPolygon *>(ogrGeometry);
+      layer.beginFeature(is_3d ? GraphicEntity::Type::multipolygon_3d : GraphicEntity::Type::multipolygon_2d);
+      for (int i = 0; i < ogrMultiPolygon->getNumGeometries(); i++)
+        read_polygon(static_cast<OGRPolygon *>(ogrMultiPolygon->getGeometryRef(i)));
+      break;
+    }
+    default:
+      return false;
+  }
+
+  return true;
+}
+
 std::shared_ptr<graph::GraphicEntity> VectorReaderGdal::readEntity(OGRGeometry *ogrGeometry)
 {
   std::shared_ptr<graph::GraphicEntity> gEntity;
@@ -1327,6 +2207,36 @@ void VectorReaderGdal::readData(OGRFeature *ogrFeature,
   }
 }
 
+void VectorReaderGdal::readData(OGRFeature *ogrFeature,
+                                const std::vector<int> &fieldIndexes,
+                                const std::vector<OGRFieldType> &fieldTypes,
+                                graph::ColumnarLayer &layer,
+                                size_t id)
+{
+  for (size_t i = 0; i < fieldIndexes.size(); i++) {
+
+    int index = fieldIndexes[i];
+    if (!ogrFeature->IsFieldSet(index)) continue;
+
+    graph::FieldColumn &column = layer.column(i);
+
+    switch (fieldTypes[i]) {
+      case OFTInteger:
+        column.setInt(id, ogrFeature->GetFieldAsInteger(index));
+        break;
+      case OFTInteger64:
+        column.setInt64(id, ogrFeature->GetFieldAsInteger64(index));
+        break;
+      case OFTReal:
+        column.setDouble(id, ogrFeature->GetFieldAsDouble(index));
+        break;
+      default:
+        column.setString(id, ogrFeature->GetFieldAsString(index));
+        break;
+    }
+  }
+}
+
 #endif // TL_HAVE_GDAL
 
 
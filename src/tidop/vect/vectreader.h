@@ -30,9 +30,11 @@
 #include <memory>
 #include <list>
 #include <string>
+#include <vector>
 
 #include "tidop/core/defs.h"
 #include "tidop/core/path.h"
+#include "tidop/geometry/entities/window.h"
 //#ifdef TL_HAVE_GEOSPATIAL 
 //#include "tidop/geospatial/crs.h"
 //#endif
@@ -43,8 +45,148 @@ namespace tl
 namespace graph
 {
 class GLayer;
+class ColumnarLayer;
+class GraphicEntity;
 }
 
+class TableField;
+
+
+/*!
+ * \brief Consulta sobre una capa vectorial
+ *
+ * Los filtros espacial y de atributos se trasladan al driver, de forma que
+ * sólo se leen las entidades que los cumplen. Permite además seleccionar
+ * los campos que se leen y omitir la lectura de estilos.
+ *
+ * \code
+ * VectorQuery query;
+ * query.setSpatialFilter(WindowD(PointD(0., 0.), PointD(100., 100.)));
+ * query.setAttributeFilter("area > 10");
+ * query.selectFields({"image"});
+ * \endcode
+ */
+class TL_EXPORT VectorQuery
+{
+
+public:
+
+  VectorQuery();
+  ~VectorQuery() = default;
+
+  /*!
+   * \brief Filtro espacial
+   * Se leen las entidades cuya envolvente intersecta con la ventana
+   */
+  WindowD spatialFilter() const;
+  void setSpatialFilter(const WindowD &window);
+  bool hasSpatialFilter() const;
+
+  /*!
+   * \brief Filtro de atributos
+   * Cláusula WHERE en formato OGR SQL
+   */
+  std::string attributeFilter() const;
+  void setAttributeFilter(const std::string &filter);
+
+  /*!
+   * \brief Campos que se leen
+   * Por defecto se leen todos los campos. Con una lista vacía sólo se lee
+   * la geometría
+   */
+  std::vector<std::string> fields() const;
+  void selectFields(const std::vector<std::string> &fields);
+  bool isFieldSelectionEnabled() const;
+
+  /*!
+   * \brief Lectura de estilos
+   * Por defecto no se leen los estilos
+   */
+  bool readStyles() const;
+  void setReadStyles(bool readStyles);
+
+  /*!
+   * \brief Número máximo de entidades por lote
+   */
+  size_t batchSize() const;
+  void setBatchSize(size_t batchSize);
+
+private:
+
+  WindowD mSpatialFilter;
+  std::string mAttributeFilter;
+  std::vector<std::string> mFields;
+  bool mFieldSelection;
+  bool mReadStyles;
+  size_t mBatchSize;
+
+};
+
+
+/*!
+ * \brief Cursor para la lectura por lotes de las entidades de una capa
+ *
+ * Se obtiene con VectorReader::cursor(). Las entidades se leen bajo demanda
+ * sin cargar la capa completa. El cursor no debe usarse después de cerrar
+ * el fichero y sólo puede haber un cursor activo por capa.
+ *
+ * \code
+ * std::unique_ptr<FeatureCursor> cursor = vectorReader->cursor(0, query);
+ * std::vector<std::shared_ptr<graph::GraphicEntity>> entities;
+ * while (cursor->next(entities)) {
+ *   for (auto &entity : entities) {
+ *     ...
+ *   }
+ * }
+ * \endcode
+ */
+class TL_EXPORT FeatureCursor
+{
+
+public:
+
+  FeatureCursor() = default;
+  virtual ~FeatureCursor() = default;
+
+  TL_DISABLE_COPY(FeatureCursor)
+  TL_DISABLE_MOVE(FeatureCursor)
+
+  /*!
+   * \brief Campos que se leen
+   */
+  virtual std::vector<std::shared_ptr<TableField>> tableFields() const = 0;
+
+  /*!
+   * \brief Número de entidades que cumplen la consulta
+   * \return Número de entidades o -1 si el driver no lo puede calcular sin
+   * recorrer la capa
+   */
+  virtual int64_t featureCount() const = 0;
+
+  /*!
+   * \brief Lee el siguiente lote de entidades
+   * \param[out] entities Entidades leidas. Se vacía antes de la lectura
+   * \return Número de entidades leidas. 0 al final de la capa
+   */
+  virtual size_t next(std::vector<std::shared_ptr<graph::GraphicEntity>> &entities) = 0;
+
+  /*!
+   * \brief Lee el siguiente lote de entidades en una capa columnar
+   * La capa se vacía antes de la lectura. Si sus campos no coinciden con los
+   * del cursor se reinicia.
+   * \param[out] layer Capa columnar
+   * \return Número de entidades leidas. 0 al final de la capa
+   */
+  virtual size_t next(graph::ColumnarLayer &layer) = 0;
+
+  /*!
+   * \brief Vuelve al comienzo de la capa
+   */
+  virtual void reset() = 0;
+
+};
+
+
 
 class TL_EXPORT VectorReader
 {
@@ -73,6 +215,53 @@ public:
   virtual std::shared_ptr<graph::GLayer> read(int layerId) = 0;
   virtual std::shared_ptr<graph::GLayer> read(const std::string &layerName) = 0;
 
+  /*!
+   * \brief Lee una capa en formato columnar
+   * Por defecto se lee la capa como GLayer y se convierte. Los lectores que
+   * lo soportan rellenan la capa directamente sin crear entidades intermedias.
+   * \param[in] layerId Índice de la capa
+   * \param[out] layer Capa columnar
+   */
+  virtual void read(int layerId, graph::ColumnarLayer &layer);
+  virtual void read(const std::string &layerName, graph::ColumnarLayer &layer);
+
+  /*!
+   * \brief Lectura en paralelo de varias capas
+   * Los lectores que lo soportan abren una conexión al fichero por hilo.
+   * Por defecto las capas se leen de forma secuencial.
+   * \param[in] layerIds Índices de las capas
+   * \return Capas leidas en el mismo orden que los índices
+   */
+  virtual std::vector<std::shared_ptr<graph::GLayer>> readLayers(const std::vector<int> &layerIds);
+
+  /*!
+   * \brief Lectura en paralelo de varias capas en una capa columnar
+   * Las capas se unen en una. Los campos se asocian por nombre
+   * \param[in] layerIds Índices de las capas
+   * \param[out] layer Capa columnar
+   */
+  virtual void readLayers(const std::vector<int> &layerIds, graph::ColumnarLayer &layer);
+
+  /*!
+   * \brief Lectura en paralelo de una capa
+   * La capa se divide en rangos de entidades que se leen en paralelo y se
+   * unen en el orden original. Si el formato no permite posicionarse de
+   * forma eficiente en una entidad la capa se lee de forma secuencial.
+   * \param[in] layerId Índice de la capa
+   * \param[out] layer Capa columnar
+   */
+  virtual void readParallel(int layerId, graph::ColumnarLayer &layer);
+
+  /*!
+   * \brief Cursor para la lectura por lotes de una capa
+   * \param[in] layerId Índice de la capa
+   * \param[in] query Filtros, campos y tamaño de lote
+   */
+  virtual std::unique_ptr<FeatureCursor> cursor(int layerId,
+                                                const VectorQuery &query) = 0;
+  virtual std::unique_ptr<FeatureCursor> cursor(const std::string &layerName,
+                                                const VectorQuery &query) = 0;
+
   /*!
    * \brief Sistema de referencia en formato WKT
    */
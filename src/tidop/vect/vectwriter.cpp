@@ -26,11 +26,17 @@
 
 #include "tidop/core/utils.h"
 #include "tidop/core/gdalreg.h"
+#include "tidop/core/concurrency.h"
 #include "tidop/graphic/layer.h"
+#include "tidop/graphic/columnar.h"
 #include "tidop/graphic/entities/point.h"
 #include "tidop/graphic/entities/linestring.h"
 #include "tidop/graphic/entities/polygon.h"
 
+#include <thread>
+#include <mutex>
+#include <exception>
+
 #ifdef TL_HAVE_GDAL
 TL_SUPPRESS_WARNINGS
 #include "ogrsf_frmts.h"
@@ -43,8 +49,28 @@ namespace tl
 using namespace graph;
 
 VectorWriter::VectorWriter(Path file)
-  : mFile(std::move(file))
+  : mFile(std::move(file)),
+    mTransactionSize(100000)
+{
+}
+
+size_t VectorWriter::transactionSize() const
+{
+  return mTransactionSize;
+}
+
+void VectorWriter::setTransactionSize(size_t transactionSize)
 {
+  mTransactionSize = transactionSize > 0 ? transactionSize : 1;
+}
+
+void VectorWriter::write(const graph::ColumnarLayer &layer)
+{
+  try {
+    this->write(layer.toLayer());
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
 }
 
 
@@ -52,6 +78,9 @@ VectorWriter::VectorWriter(Path file)
 
 #ifdef TL_HAVE_GDAL
 
+/// Lotes en cola entre append(), el hilo de codificación y el de escritura
+constexpr size_t vector_writer_queue_capacity = 4;
+
 class VectorWriterGdal
   : public VectorWriter
 {
@@ -66,6 +95,12 @@ public:
   void close() override;
   void create() override;
   void write(const GLayer &layer) override;
+  void write(const ColumnarLayer &layer) override;
+  void beginLayer(const std::string &layerName,
+                  const std::vector<std::shared_ptr<TableField>> &fields) override;
+  void append(ColumnarLayer &&batch) override;
+  void append(const std::vector<std::shared_ptr<GraphicEntity>> &entities) override;
+  void commit() override;
   void setCRS(const std::string &crs) override;
 
 //#ifdef TL_HAVE_GEOSPATIAL
@@ -74,8 +109,43 @@ public:
 
 private:
 
+  /*!
+   * \brief Lote pendiente de codificar
+   */
+  struct Batch
+  {
+    std::shared_ptr<const ColumnarLayer> layer;
+    std::vector<std::shared_ptr<GraphicEntity>> entities;
+  };
+
+  /*!
+   * \brief Lote codificado pendiente de escribir
+   */
+  struct FeatureBatch
+  {
+    std::vector<OGRFeature *> features;
+
+    ~FeatureBatch()
+    {
+      for (auto ogrFeature : features)
+        OGRFeature::DestroyFeature(ogrFeature);
+    }
+  };
+
   std::string driverFromExt(const std::string &extension) const;
   OGRLayer *createLayer(const std::string &layerName);
+  std::vector<int> createFields(OGRLayer *ogrLayer, const std::vector<std::shared_ptr<TableField>> &fields);
+  void appendBatch(const std::shared_ptr<Batch> &batch);
+  std::exception_ptr finishSession();
+  void setSessionError(std::exception_ptr error);
+  bool hasSessionError();
+  void encodeBatches();
+  void writeBatches();
+  OGRErr startTransaction();
+  OGRErr commitTransaction();
+  OGRErr rollbackTransaction();
+  OGRFeature *createFeature(OGRFeatureDefn *ogrFeatureDefn, const GraphicEntity *entity);
+  OGRFeature *createFeature(OGRFeatureDefn *ogrFeatureDefn, const ColumnarLayer &layer, size_t feature);
   void writePoint(OGRFeature *ogrFeature, const GPoint *gPoint);
   void writePoint(OGRFeature *ogrFeature, const GPoint3D *gPoint3D);
   void writeLineString(OGRFeature *ogrFeature, const GLineString *gLineString);
@@ -97,6 +167,16 @@ private:
   GDALDataset *mDataset;
   GDALDriver *mDriver;
   OGRSpatialReference *mSpatialReference;
+  OGRLayer *mSessionLayer;
+  std::vector<int> mSessionFields;
+  size_t mSessionFeatures;
+  bool mDatasetTransactions;
+  std::unique_ptr<QueueMPMC<std::shared_ptr<Batch>>> mBatchQueue;
+  std::unique_ptr<QueueMPMC<std::shared_ptr<FeatureBatch>>> mFeatureQueue;
+  std::thread mEncoderThread;
+  std::thread mWriterThread;
+  std::mutex mSessionMutex;
+  std::exception_ptr mSessionError;
 };
 
 
@@ -105,10 +185,13 @@ VectorWriterGdal::VectorWriterGdal(Path file)
     mDataset(nullptr),
     mDriver(nullptr),
 #if _DEBUG
-    mSpatialReference((OGRSpatialReference *)OSRNewSpatialReference(nullptr))
+    mSpatialReference((OGRSpatialReference *)OSRNewSpatialReference(nullptr)),
 #else
-    mSpatialReference(new OGRSpatialReference(nullptr))
+    mSpatialReference(new OGRSpatialReference(nullptr)),
 #endif
+    mSessionLayer(nullptr),
+    mSessionFeatures(0),
+    mDatasetTransactions(false)
 {
   RegisterGdal::init();
 }
@@ -153,6 +236,14 @@ inline bool VectorWriterGdal::isOpen() const
 
 inline void VectorWriterGdal::close()
 {
+  if (mSessionLayer) {
+    msgWarning("Layer writing not commited. Changes are discarded");
+    this->finishSession();
+    this->rollbackTransaction();
+    mSessionLayer = nullptr;
+    mSessionFields.clear();
+  }
+
   if (mDataset) {
     GDALClose(mDataset);
     mDataset = nullptr;
@@ -183,129 +274,469 @@ void VectorWriterGdal::write(const GLayer &layer)
 {
   try {
 
+    auto batch = std::make_shared<Batch>();
+    batch->entities.assign(layer.begin(), layer.end());
+
+    this->beginLayer(layer.name(), layer.tableFields());
+    this->appendBatch(batch);
+    this->commit();
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorWriterGdal::write(const ColumnarLayer &layer)
+{
+  try {
+
+    /// La capa no se copia. commit() espera a que termine la escritura
+    auto batch = std::make_shared<Batch>();
+    batch->layer = std::shared_ptr<const ColumnarLayer>(&layer, [](const ColumnarLayer *) {});
+
+    this->beginLayer(layer.name(), layer.tableFields());
+    this->appendBatch(batch);
+    this->commit();
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorWriterGdal::beginLayer(const std::string &layerName,
+                                  const std::vector<std::shared_ptr<TableField>> &fields)
+{
+  try {
+
     TL_ASSERT(mDataset, "The file has not been created. Use VectorWriter::create() method");
+    TL_ASSERT(mSessionLayer == nullptr, "A layer is already being written. Use VectorWriter::commit() method");
 
-    OGRLayer *ogrLayer = mDataset->GetLayerByName(layer.name().c_str());
+    OGRLayer *ogrLayer = mDataset->GetLayerByName(layerName.c_str());
     if (!ogrLayer) {
-      ogrLayer = this->createLayer(layer.name());
+      ogrLayer = this->createLayer(layerName);
     }
 
-    std::vector<std::shared_ptr<TableField>> fields = layer.tableFields();
+    TL_ASSERT(ogrLayer, "Layer creation failed");
 
-    for (auto & field : fields) {
+    mSessionFields = this->createFields(ogrLayer, fields);
+    mSessionLayer = ogrLayer;
+    mSessionError = nullptr;
+    mSessionFeatures = 0;
 
-      TableField::Type type = field->type();
-      OGRFieldType ogr_type;
-      switch (type) {
-        case TableField::Type::INT:
-          ogr_type = OFTInteger;
-          break;
-        case TableField::Type::INT64:
-          ogr_type = OFTInteger64;
-          break;
-        case TableField::Type::DOUBLE:
-          ogr_type = OFTReal;
-          break;
-        case TableField::Type::STRING:
-          ogr_type = OFTString;
-          break;
-        default:
-          ogr_type = OFTString;
-          break;
-      }
+    mDatasetTransactions = mDataset->TestCapability(ODsCTransactions) != 0;
+    if (this->startTransaction() != OGRERR_NONE) {
+      msgWarning("GDAL ERROR (%i): %s", CPLGetLastErrorNo(), CPLGetLastErrorMsg());
+    }
+
+    mBatchQueue = std::make_unique<QueueMPMC<std::shared_ptr<Batch>>>(vector_writer_queue_capacity);
+    mFeatureQueue = std::make_unique<QueueMPMC<std::shared_ptr<FeatureBatch>>>(vector_writer_queue_capacity);
+    mEncoderThread = std::thread(&VectorWriterGdal::encodeBatches, this);
+    mWriterThread = std::thread(&VectorWriterGdal::writeBatches, this);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorWriterGdal::append(ColumnarLayer &&batch)
+{
+  try {
+
+    TL_ASSERT(batch.fieldCount() == mSessionFields.size(), "The fields of the batch do not match those of the layer");
+
+    auto _batch = std::make_shared<Batch>();
+    _batch->layer = std::make_shared<const ColumnarLayer>(std::move(batch));
+    this->appendBatch(_batch);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorWriterGdal::append(const std::vector<std::shared_ptr<GraphicEntity>> &entities)
+{
+  try {
+
+    auto batch = std::make_shared<Batch>();
+    batch->entities = entities;
+    this->appendBatch(batch);
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorWriterGdal::commit()
+{
+  try {
+
+    TL_ASSERT(mSessionLayer, "No layer is being written. Use VectorWriter::beginLayer() method");
+
+    std::exception_ptr error = this->finishSession();
+    OGRErr ogr_error = error ? this->rollbackTransaction() : this->commitTransaction();
+
+    mSessionLayer = nullptr;
+    mSessionFields.clear();
+
+    if (error) std::rethrow_exception(error);
 
-      OGRFieldDefn fieldDefinition(field->name().c_str(), ogr_type);
-      fieldDefinition.SetWidth(field->size());
-      OGRErr error = ogrLayer->CreateField(&fieldDefinition);
-      TL_ASSERT(error == OGRERR_NONE, "Creating field failed");
+    if (ogr_error != OGRERR_NONE)
+      throw TL_ERROR("GDAL ERROR (%i): %s", CPLGetLastErrorNo(), CPLGetLastErrorMsg());
+
+  } catch (...) {
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+}
+
+void VectorWriterGdal::appendBatch(const std::shared_ptr<Batch> &batch)
+{
+  TL_ASSERT(mSessionLayer, "No layer is being written. Use VectorWriter::beginLayer() method");
+
+  {
+    std::lock_guard<std::mutex> lock(mSessionMutex);
+    if (mSessionError) std::rethrow_exception(mSessionError);
+  }
+
+  mBatchQueue->push(batch);
+}
+
+std::exception_ptr VectorWriterGdal::finishSession()
+{
+  mBatchQueue->stop();
+  if (mEncoderThread.joinable()) mEncoderThread.join();
+
+  mFeatureQueue->stop();
+  if (mWriterThread.joinable()) mWriterThread.join();
+
+  mBatchQueue.reset();
+  mFeatureQueue.reset();
+
+  std::lock_guard<std::mutex> lock(mSessionMutex);
+  std::exception_ptr error = mSessionError;
+  mSessionError = nullptr;
+
+  return error;
+}
+
+void VectorWriterGdal::setSessionError(std::exception_ptr error)
+{
+  {
+    std::lock_guard<std::mutex> lock(mSessionMutex);
+    if (!mSessionError) mSessionError = error;
+  }
+
+  /// Se desbloquean los hilos. Los lotes pendientes se descartan
+  mBatchQueue->stop();
+  mFeatureQueue->stop();
+}
+
+bool VectorWriterGdal::hasSessionError()
+{
+  std::lock_guard<std::mutex> lock(mSessionMutex);
+  return static_cast<bool>(mSessionError);
+}
 
+void VectorWriterGdal::encodeBatches()
+{
+  try {
+
+    OGRFeatureDefn *ogrFeatureDefn = mSessionLayer->GetLayerDefn();
+
+    std::shared_ptr<Batch> batch;
+    while (mBatchQueue->pop(batch)) {
+
+      if (hasSessionError()) break;
+
+      auto features = std::make_shared<FeatureBatch>();
+
+      if (batch->layer) {
+        const ColumnarLayer &layer = *batch->layer;
+        features->features.reserve(layer.size());
+        for (size_t i = 0; i < layer.size(); i++) {
+          features->features.push_back(this->createFeature(ogrFeatureDefn, layer, i));
+        }
+      } else {
+        features->features.reserve(batch->entities.size());
+        for (const auto &entity : batch->entities) {
+          features->features.push_back(this->createFeature(ogrFeatureDefn, entity.get()));
+        }
+      }
+
+      batch.reset();
+      mFeatureQueue->push(features);
     }
 
-    OGRStyleTable oStyleTable;
-    auto *ogrStyleMgr = new OGRStyleMgr(&oStyleTable);
+  } catch (...) {
+    setSessionError(std::current_exception());
+  }
+
+  mFeatureQueue->stop();
+}
+
+void VectorWriterGdal::writeBatches()
+{
+  try {
 
-    OGRFeature *ogrFeature = nullptr;
+    std::shared_ptr<FeatureBatch> features;
+    while (mFeatureQueue->pop(features)) {
 
-    for (auto &entity : layer) {
+      if (hasSessionError()) break;
 
-      ogrFeature = OGRFeature::CreateFeature(ogrLayer->GetLayerDefn());
+      for (auto ogrFeature : features->features) {
 
-      if (std::shared_ptr<TableRegister> data = entity->data()) {
-        for (size_t i = 0; i < data->size(); i++) {
-          TL_TODO("En función del tipo de dato. Por ahora sólo cadenas")
-            ogrFeature->SetField(static_cast<int>(i), data->value(static_cast<int>(i)).c_str());
+        if (mSessionLayer->CreateFeature(ogrFeature) != OGRERR_NONE)
+          throw TL_ERROR("Create Feature Error");
+
+        if (++mSessionFeatures % mTransactionSize == 0) {
+          if (this->commitTransaction() != OGRERR_NONE ||
+              this->startTransaction() != OGRERR_NONE)
+            throw TL_ERROR("GDAL ERROR (%i): %s", CPLGetLastErrorNo(), CPLGetLastErrorMsg());
         }
       }
 
-      GraphicEntity::Type type = entity->type();
-      switch (type) {
-        case GraphicEntity::Type::point_2d:
-          this->writePoint(ogrFeature, dynamic_cast<GPoint *>(entity.get()));
-          break;
-        case GraphicEntity::Type::point_3d:
-          this->writePoint(ogrFeature, dynamic_cast<GPoint3D *>(entity.get()));
-          break;
-        case GraphicEntity::Type::linestring_2d:
-          this->writeLineString(ogrFeature, dynamic_cast<GLineString *>(entity.get()));
-          break;
-        case GraphicEntity::Type::linestring_3d:
-          this->writeLineString(ogrFeature, dynamic_cast<GLineString3D *>(entity.get()));
-          break;
-        case GraphicEntity::Type::polygon_2d:
-          this->writePolygon(ogrFeature, dynamic_cast<GPolygon *>(entity.get()));
-          break;
-        case GraphicEntity::Type::polygon_3d:
-          this->writePolygon(ogrFeature, dynamic_cast<GPolygon3D *>(entity.get()));
-          break;
-        case GraphicEntity::Type::segment_2d:
-          break;
-        case GraphicEntity::Type::segment_3d:
-          break;
-        case GraphicEntity::Type::window:
-          break;
-        case GraphicEntity::Type::box:
-          break;
-        case GraphicEntity::Type::multipoint_2d:
-          this->writeMultiPoint(ogrFeature, dynamic_cast<GMultiPoint *>(entity.get()));
-          break;
-        case GraphicEntity::Type::multipoint_3d:
-          this->writeMultiPoint(ogrFeature, dynamic_cast<GMultiPoint3D *>(entity.get()));
-          break;
-        case GraphicEntity::Type::multiline_2d:
-          this->writeMultiLineString(ogrFeature, dynamic_cast<GMultiLineString *>(entity.get()));
-          break;
-        case GraphicEntity::Type::multiline_3d:
-          this->writeMultiLineString(ogrFeature, dynamic_cast<GMultiLineString3D *>(entity.get()));
-          break;
-        case GraphicEntity::Type::multipolygon_2d:
-          this->writeMultiPolygon(ogrFeature, dynamic_cast<GMultiPolygon *>(entity.get()));
+    }
+
+  } catch (...) {
+    setSessionError(std::current_exception());
+  }
+}
+
+OGRErr VectorWriterGdal::startTransaction()
+{
+  return mDatasetTransactions ? mDataset->StartTransaction() : mSessionLayer->StartTransaction();
+}
+
+OGRErr VectorWriterGdal::commitTransaction()
+{
+  return mDatasetTransactions ? mDataset->CommitTransaction() : mSessionLayer->CommitTransaction();
+}
+
+OGRErr VectorWriterGdal::rollbackTransaction()
+{
+  return mDatasetTransactions ? mDataset->RollbackTransaction() : mSessionLayer->RollbackTransaction();
+}
+
+OGRFeature *VectorWriterGdal::createFeature(OGRFeatureDefn *ogrFeatureDefn, 
+                                            const GraphicEntity *entity)
+{
+  OGRFeature *ogrFeature = OGRFeature::CreateFeature(ogrFeatureDefn);
+
+  try {
+
+    if (std::shared_ptr<TableRegister> data = entity->data()) {
+      for (size_t i = 0; i < data->size() && i < mSessionFields.size(); i++) {
+        TL_TODO("En función del tipo de dato. Por ahora sólo cadenas")
+        ogrFeature->SetField(mSessionFields[i], data->value(static_cast<int>(i)).c_str());
+      }
+    }
+
+    GraphicEntity::Type type = entity->type();
+    switch (type) {
+      case GraphicEntity::Type::point_2d:
+        this->writePoint(ogrFeature, dynamic_cast<const GPoint *>(entity));
+        break;
+      case GraphicEntity::Type::point_3d:
+        this->writePoint(ogrFeature, dynamic_cast<const GPoint3D *>(entity));
+        break;
+      case GraphicEntity::Type::linestring_2d:
+        this->writeLineString(ogrFeature, dynamic_cast<const GLineString *>(entity));
+        break;
+      case GraphicEntity::Type::linestring_3d:
+        this->writeLineString(ogrFeature, dynamic_cast<const GLineString3D *>(entity));
+        break;
+      case GraphicEntity::Type::polygon_2d:
+        this->writePolygon(ogrFeature, dynamic_cast<const GPolygon *>(entity));
+        break;
+      case GraphicEntity::Type::polygon_3d:
+        this->writePolygon(ogrFeature, dynamic_cast<const GPolygon3D *>(entity));
+        break;
+      case GraphicEntity::Type::segment_2d:
+        break;
+      case GraphicEntity::Type::segment_3d:
+        break;
+      case GraphicEntity::Type::window:
+        break;
+      case GraphicEntity::Type::box:
+        break;
+      case GraphicEntity::Type::multipoint_2d:
+        this->writeMultiPoint(ogrFeature, dynamic_cast<const GMultiPoint *>(entity));
+        break;
+      case GraphicEntity::Type::multipoint_3d:
+        this->writeMultiPoint(ogrFeature, dynamic_cast<const GMultiPoint3D *>(entity));
+        break;
+      case GraphicEntity::Type::multiline_2d:
+        this->writeMultiLineString(ogrFeature, dynamic_cast<const GMultiLineString *>(entity));
+        break;
+      case GraphicEntity::Type::multiline_3d:
+        this->writeMultiLineString(ogrFeature, dynamic_cast<const GMultiLineString3D *>(entity));
+        break;
+      case GraphicEntity::Type::multipolygon_2d:
+        this->writeMultiPolygon(ogrFeature, dynamic_cast<const GMultiPolygon *>(entity));
+        break;
+      case GraphicEntity::Type::multipolygon_3d:
+        this->writeMultiPolygon(ogrFeature, dynamic_cast<const GMultiPolygon3D *>(entity));
+        break;
+      case GraphicEntity::Type::circle:
+        break;
+      case GraphicEntity::Type::ellipse:
+        break;
+    }
+
+    this->writeStyles(nullptr, entity);
+
+  } catch (...) {
+    OGRFeature::DestroyFeature(ogrFeature);
+    TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
+  }
+
+  return ogrFeature;
+}
+
+OGRFeature *VectorWriterGdal::createFeature(OGRFeatureDefn *ogrFeatureDefn,
+                                            const ColumnarLayer &layer,
+                                            size_t feature)
+{
+  OGRFeature *ogrFeature = OGRFeature::CreateFeature(ogrFeatureDefn);
+
+  try {
+
+    const std::vector<double> &x = layer.x();
+    const std::vector<double> &y = layer.y();
+    const std::vector<double> &z = layer.z();
+
+    GraphicEntity::Type type = layer.type(feature);
+    bool is_3d = !z.empty() && (type == GraphicEntity::Type::point_3d ||
+                                type == GraphicEntity::Type::linestring_3d ||
+                                type == GraphicEntity::Type::polygon_3d ||
+                                type == GraphicEntity::Type::multipoint_3d ||
+                                type == GraphicEntity::Type::multiline_3d ||
+                                type == GraphicEntity::Type::multipolygon_3d);
+
+    auto write_line = [&](OGRSimpleCurve *ogrCurve, size_t geometry, size_t part) {
+      std::pair<size_t, size_t> range = layer.pointRange(feature, geometry, part);
+      int size = static_cast<int>(range.second - range.first);
+      if (is_3d)
+        ogrCurve->setPoints(size, x.data() + range.first, y.data() + range.first, z.data() + range.first);
+      else
+        ogrCurve->setPoints(size, x.data() + range.first, y.data() + range.first);
+    };
+
+    auto write_polygon = [&](OGRPolygon *ogrPolygon, size_t geometry) {
+      for (size_t part = 0; part < layer.parts(feature, geometry); part++) {
+        OGRLinearRing ogrLinearRing;
+        write_line(&ogrLinearRing, geometry, part);
+        if (OGRERR_NONE != ogrPolygon->addRing(&ogrLinearRing))
+          throw TL_ERROR("GDAL ERROR (%i): %s", CPLGetLastErrorNo(), CPLGetLastErrorMsg());
+      }
+    };
+
+    auto make_point = [&](size_t position) {
+      return is_3d ? OGRPoint(x[position], y[position], z[position]) : OGRPoint(x[position], y[position]);
+    };
+
+    for (size_t i = 0; i < layer.fieldCount(); i++) {
+
+      const FieldColumn &column = layer.column(i);
+      if (column.isNull(feature)) continue;
+
+      int field = mSessionFields[i];
+
+      switch (column.type()) {
+        case TableField::Type::INT:
+          ogrFeature->SetField(field, column.ints()[feature]);
           break;
-        case GraphicEntity::Type::multipolygon_3d:
-          this->writeMultiPolygon(ogrFeature, dynamic_cast<GMultiPolygon3D *>(entity.get()));
+        case TableField::Type::INT64:
+          ogrFeature->SetField(field, static_cast<GIntBig>(column.ints64()[feature]));
           break;
-        case GraphicEntity::Type::circle:
+        case TableField::Type::DOUBLE:
+        case TableField::Type::FLOAT:
+          ogrFeature->SetField(field, column.doubles()[feature]);
           break;
-        case GraphicEntity::Type::ellipse:
+        case TableField::Type::STRING:
+          ogrFeature->SetField(field, column.dictionary().data(column.stringIds()[feature]));
           break;
       }
-
-      this->writeStyles(ogrStyleMgr, entity.get());
-
-      if (ogrLayer->CreateFeature(ogrFeature) != OGRERR_NONE) throw TL_ERROR("Create Feature Error");
-
     }
 
+    OGRErr error = OGRERR_NONE;
+    size_t geometries = layer.geometries(feature);
 
-    if (ogrStyleMgr) {
-      delete ogrStyleMgr;
-      ogrStyleMgr = nullptr;
+    switch (type) {
+      case GraphicEntity::Type::point_2d:
+      case GraphicEntity::Type::point_3d:
+      {
+        OGRPoint ogrPoint = make_point(layer.pointRange(feature, 0, 0).first);
+        error = ogrFeature->SetGeometry(&ogrPoint);
+        break;
+      }
+      case GraphicEntity::Type::linestring_2d:
+      case GraphicEntity::Type::linestring_3d:
+      {
+        OGRLineString ogrLineString;
+        if (geometries > 0) write_line(&ogrLineString, 0, 0);
+        error = ogrFeature->SetGeometry(&ogrLineString);
+        break;
+      }
+      case GraphicEntity::Type::polygon_2d:
+      case GraphicEntity::Type::polygon_3d:
+      {
+        OGRPolygon ogrPolygon;
+        if (geometries > 0) write_polygon(&ogrPolygon, 0);
+        error = ogrFeature->SetGeometry(&ogrPolygon);
+        break;
+      }
+      case GraphicEntity::Type::multipoint_2d:
+      case GraphicEntity::Type::multipoint_3d:
+      {
+        OGRMultiPoint ogrMultiPoint;
+        if (geometries > 0) {
+          std::pair<size_t, size_t> range = layer.pointRange(feature, 0, 0);
+          for (size_t i = range.first; i < range.second; i++) {
+            OGRPoint ogrPoint = make_point(i);
+            ogrMultiPoint.addGeometry(&ogrPoint);
+          }
+        }
+        error = ogrFeature->SetGeometry(&ogrMultiPoint);
+        break;
+      }
+      case GraphicEntity::Type::multiline_2d:
+      case GraphicEntity::Type::multiline_3d:
+      {
+        OGRMultiLineString ogrMultiLineString;
+        size_t parts = geometries > 0 ? layer.parts(feature, 0) : 0;
+        for (size_t part = 0; part < parts; part++) {
+          OGRLineString ogrLineString;
+          write_line(&ogrLineString, 0, part);
+          ogrMultiLineString.addGeometry(&ogrLineString);
+        }
+        error = ogrFeature->SetGeometry(&ogrMultiLineString);
+        break;
+      }
+      case GraphicEntity::Type::multipolygon_2d:
+      case GraphicEntity::Type::multipolygon_3d:
+      {
+        OGRMultiPolygon ogrMultiPolygon;
+        for (size_t geometry = 0; geometry < geometries; geometry++) {
+          OGRPolygon ogrPolygon;
+          write_polygon(&ogrPolygon, geometry);
+          ogrMultiPolygon.addGeometry(&ogrPolygon);
+        }
+        error = ogrFeature->SetGeometry(&ogrMultiPolygon);
+        break;
+      }
+      default:
+        break;
     }
 
-    OGRFeature::DestroyFeature(ogrFeature);
+    if (error != OGRERR_NONE)
+      throw TL_ERROR("GDAL ERROR (%i): %s", CPLGetLastErrorNo(), CPLGetLastErrorMsg());
 
   } catch (...) {
+    OGRFeature::DestroyFeature(ogrFeature);
     TL_THROW_EXCEPTION_WITH_NESTED("Catched exception");
   }
+
+  return ogrFeature;
 }
 
 void VectorWriterGdal::setCRS(const std::string &crs)
@@ -361,10 +792,60 @@ std::string VectorWriterGdal::driverFromExt(const std::string &extension) const
     format = "GeoJSON";
   else if (compareInsensitiveCase(extension, ".osm" ))
     format = "OSM";
+  else if (compareInsensitiveCase(extension, ".gpkg"))
+    format = "GPKG";
+  else if (compareInsensitiveCase(extension, ".sqlite"))
+    format = "SQLite";
   else format = "";
   return format;
 }
 
+std::vector<int> VectorWriterGdal::createFields(OGRLayer *ogrLayer,
+                                                const std::vector<std::shared_ptr<TableField>> &fields)
+{
+  std::vector<int> indexes;
+  indexes.reserve(fields.size());
+
+  for (auto & field : fields) {
+
+    /// Si la capa ya existe se reutilizan sus campos
+    int index = ogrLayer->GetLayerDefn()->GetFieldIndex(field->name().c_str());
+    if (index >= 0) {
+      indexes.push_back(index);
+      continue;
+    }
+
+    TableField::Type type = field->type();
+    OGRFieldType ogr_type;
+    switch (type) {
+      case TableField::Type::INT:
+        ogr_type = OFTInteger;
+        break;
+      case TableField::Type::INT64:
+        ogr_type = OFTInteger64;
+        break;
+      case TableField::Type::DOUBLE:
+        ogr_type = OFTReal;
+        break;
+      case TableField::Type::STRING:
+        ogr_type = OFTString;
+        break;
+      default:
+        ogr_type = OFTString;
+        break;
+    }
+
+    OGRFieldDefn fieldDefinition(field->name().c_str(), ogr_type);
+    fieldDefinition.SetWidth(field->size());
+    OGRErr error = ogrLayer->CreateField(&fieldDefinition);
+    TL_ASSERT(error == OGRERR_NONE, "Creating field failed");
+
+    indexes.push_back(ogrLayer->GetLayerDefn()->GetFieldCount() - 1);
+  }
+
+  return indexes;
+}
+
 OGRLayer *VectorWriterGdal::createLayer(const std::string &layerName)
 {
   OGRLayer *layer = nullptr;
@@ -773,7 +1254,9 @@ std::unique_ptr<VectorWriter> VectorWriterFactory::createWriter(const Path &file
         compareInsensitiveCase(extension, ".kml") ||
         compareInsensitiveCase(extension, ".kmz") ||
         compareInsensitiveCase(extension, ".json") ||
-        compareInsensitiveCase(extension, ".osm")) {
+        compareInsensitiveCase(extension, ".osm") ||
+        compareInsensitiveCase(extension, ".gpkg") ||
+        compareInsensitiveCase(extension, ".sqlite")) {
       vector_writer = std::make_unique<VectorWriterGdal>(file);
     } else
 #endif
@@ -28,6 +28,7 @@
 #include <memory>
 #include <list>
 #include <string>
+#include <vector>
 
 #include "config_tl.h"
 
@@ -43,8 +44,12 @@ namespace tl
 namespace graph
 {
 class GLayer;
+class ColumnarLayer;
+class GraphicEntity;
 }
 
+class TableField;
+
 class TL_EXPORT VectorWriter
 {
 
@@ -72,6 +77,57 @@ public:
 
   virtual void write(const graph::GLayer &layer) = 0;
 
+  /*!
+   * \brief Escribe una capa en formato columnar
+   * Por defecto se convierte la capa a GLayer. Los escritores que lo
+   * soportan escriben directamente desde los vectores de la capa.
+   */
+  virtual void write(const graph::ColumnarLayer &layer);
+
+  /*!
+   * \brief Comienza la escritura por lotes de una capa
+   *
+   * Las entidades se añaden por lotes con append() y la escritura se
+   * finaliza con commit(). La codificación de geometrías y atributos se
+   * realiza en un hilo de trabajo y la escritura en otro, de forma que
+   * append() sólo bloquea cuando las colas están llenas. Si el driver lo
+   * soporta la escritura se agrupa en transacciones (ver setTransactionSize).
+   *
+   * \code
+   * writer->beginLayer("grid", fields);
+   * while (...) {
+   *   graph::ColumnarLayer batch;
+   *   ...
+   *   writer->append(std::move(batch));
+   * }
+   * writer->commit();
+   * \endcode
+   *
+   * \param[in] layerName Nombre de la capa
+   * \param[in] fields Campos de datos
+   */
+  virtual void beginLayer(const std::string &layerName,
+                          const std::vector<std::shared_ptr<TableField>> &fields) = 0;
+
+  /*!
+   * \brief Añade un lote de entidades a la capa en escritura
+   * Los campos del lote tienen que coincidir con los de beginLayer()
+   */
+  virtual void append(graph::ColumnarLayer &&batch) = 0;
+  virtual void append(const std::vector<std::shared_ptr<graph::GraphicEntity>> &entities) = 0;
+
+  /*!
+   * \brief Espera a que se escriban todos los lotes y confirma la transacción
+   */
+  virtual void commit() = 0;
+
+  /*!
+   * \brief Número de entidades por transacción
+   * Por defecto 100000
+   */
+  size_t transactionSize() const;
+  void setTransactionSize(size_t transactionSize);
+
   /*!
    * \brief Set the Coordinate Reference System
    * \param[in] crs Coordinate Reference System in WKT format
@@ -89,6 +145,7 @@ public:
 protected:
 
   Path mFile;
+  size_t mTransactionSize;
 
 };
 
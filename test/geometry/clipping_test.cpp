@@ -0,0 +1,205 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#define BOOST_TEST_MODULE Tidop polygon clipping test
+#include <boost/test/unit_test.hpp>
+#include <tidop/geometry/algorithms/clipping.h>
+
+#include <cmath>
+#include <random>
+
+using namespace tl;
+
+using Operation = PolygonClipper<PointD>::Operation;
+
+BOOST_AUTO_TEST_SUITE(ClippingTestSuite)
+
+struct ClippingTest
+{
+
+  ClippingTest()
+  {
+
+  }
+
+  ~ClippingTest()
+  {
+
+  }
+
+  void setup()
+  {
+    square = PolygonD{PointD(0., 0.), PointD(10., 0.), PointD(10., 10.), PointD(0., 10.)};
+    shifted = PolygonD{PointD(5., 5.), PointD(15., 5.), PointD(15., 15.), PointD(5., 15.)};
+    touching = PolygonD{PointD(10., 0.), PointD(20., 0.), PointD(20., 10.), PointD(10., 10.)};
+
+    square_with_hole = square;
+    PolygonHole<PointD> hole;
+    hole.push_back(PointD(2., 2.));
+    hole.push_back(PointD(8., 2.));
+    hole.push_back(PointD(8., 8.));
+    hole.push_back(PointD(2., 8.));
+    square_with_hole.addHole(hole);
+
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> radius(20., 60.);
+    std::uniform_real_distribution<double> center(-20., 20.);
+    for (int p = 0; p < 20; p++) {
+      PolygonD star;
+      double cx = center(generator);
+      double cy = center(generator);
+      for (int i = 0; i < 24; i++) {
+        double angle = i * 3.14159265358979 / 12.;
+        double r = radius(generator);
+        star.push_back(PointD(cx + r * std::cos(angle), cy + r * std::sin(angle)));
+      }
+      stars.push_back(star);
+    }
+  }
+
+  void teardown()
+  {
+
+  }
+
+  static double area(const MultiPolygonD &multiPolygon)
+  {
+    return PreparedPolygonD(multiPolygon).area();
+  }
+
+  PolygonD square;
+  PolygonD shifted;
+  PolygonD touching;
+  PolygonD square_with_hole;
+  std::vector<PolygonD> stars;
+};
+
+
+BOOST_FIXTURE_TEST_CASE(clip_window, ClippingTest)
+{
+  PolygonD clipped = clip(square, WindowD(PointD(5., -5.), PointD(20., 5.)));
+  BOOST_CHECK_CLOSE(25., clipped.area(), 0.0001);
+
+  BOOST_CHECK_EQUAL(0, clip(square, WindowD(PointD(20., 20.), PointD(30., 30.))).size());
+
+  PolygonD inner = clip(square, WindowD(PointD(-5., -5.), PointD(20., 20.)));
+  BOOST_CHECK_EQUAL(4, inner.size());
+  BOOST_CHECK_CLOSE(100., inner.area(), 0.0001);
+
+  PolygonD with_hole = clip(square_with_hole, WindowD(PointD(0., 0.), PointD(5., 10.)));
+  BOOST_CHECK_EQUAL(1, with_hole.holes());
+  BOOST_CHECK_CLOSE(50. - 18., PreparedPolygonD(with_hole).area(), 0.0001);
+}
+
+BOOST_FIXTURE_TEST_CASE(clip_window_batch, ClippingTest)
+{
+  WindowD window(PointD(-10., -10.), PointD(15., 25.));
+  std::vector<PolygonD> clipped = clip(stars, window);
+  BOOST_CHECK_EQUAL(stars.size(), clipped.size());
+  for (size_t i = 0; i < stars.size(); i++) {
+    BOOST_CHECK_CLOSE(clip(stars[i], window).area(), clipped[i].area(), 0.0001);
+  }
+
+  std::vector<WindowD> cells;
+  for (int r = 0; r < 4; r++) {
+    for (int c = 0; c < 4; c++) {
+      cells.emplace_back(PointD(c * 2.5, r * 2.5), PointD(c * 2.5 + 2.5, r * 2.5 + 2.5));
+    }
+  }
+  std::vector<PolygonD> pieces = clip(square, cells);
+  double total = 0.;
+  for (const auto &piece : pieces) total += piece.area();
+  BOOST_CHECK_CLOSE(100., total, 0.0001);
+}
+
+BOOST_FIXTURE_TEST_CASE(intersection, ClippingTest)
+{
+  MultiPolygonD result = polygonIntersection(square, shifted);
+  BOOST_CHECK_EQUAL(1, result.size());
+  BOOST_CHECK_EQUAL(4, result[0].size());
+  BOOST_CHECK_CLOSE(25., result[0].area(), 0.0001);
+
+  BOOST_CHECK_EQUAL(0, polygonIntersection(square, touching).size());
+  BOOST_CHECK_CLOSE(100., area(polygonIntersection(square, square)), 0.0001);
+  BOOST_CHECK_CLOSE(16., area(polygonIntersection(square_with_hole, shifted)), 0.0001);
+}
+
+BOOST_FIXTURE_TEST_CASE(join, ClippingTest)
+{
+  MultiPolygonD result = polygonUnion(square, shifted);
+  BOOST_CHECK_EQUAL(1, result.size());
+  BOOST_CHECK_EQUAL(8, result[0].size());
+  BOOST_CHECK_CLOSE(175., area(result), 0.0001);
+
+  // Aristas coincidentes
+  result = polygonUnion(square, touching);
+  BOOST_CHECK_EQUAL(1, result.size());
+  BOOST_CHECK_EQUAL(4, result[0].size());
+  BOOST_CHECK_CLOSE(200., area(result), 0.0001);
+
+  PolygonD far{PointD(50., 50.), PointD(60., 50.), PointD(60., 60.)};
+  BOOST_CHECK_EQUAL(2, polygonUnion(square, far).size());
+}
+
+BOOST_FIXTURE_TEST_CASE(difference, ClippingTest)
+{
+  BOOST_CHECK_CLOSE(75., area(polygonDifference(square, shifted)), 0.0001);
+  BOOST_CHECK_CLOSE(100., area(polygonDifference(square, touching)), 0.0001);
+  BOOST_CHECK_EQUAL(0, polygonDifference(square, square).size());
+
+  PolygonD inner{PointD(3., 3.), PointD(7., 3.), PointD(7., 7.), PointD(3., 7.)};
+  MultiPolygonD result = polygonDifference(square, inner);
+  BOOST_CHECK_EQUAL(1, result.size());
+  BOOST_CHECK_EQUAL(1, result[0].holes());
+  BOOST_CHECK_CLOSE(84., area(result), 0.0001);
+}
+
+BOOST_FIXTURE_TEST_CASE(random_polygons, ClippingTest)
+{
+  PolygonClipper<PointD> clipper;
+
+  for (size_t i = 0; i + 1 < stars.size(); i++) {
+    const PolygonD &a = stars[i];
+    const PolygonD &b = stars[i + 1];
+
+    double inter = area(clipper.execute(a, b, Operation::intersection));
+    double join = area(clipper.execute(a, b, Operation::join));
+    double diff = area(clipper.execute(a, b, Operation::difference));
+
+    BOOST_CHECK_CLOSE(intersectionArea(a, b), inter, 0.0001);
+    BOOST_CHECK_CLOSE(a.area() + b.area(), inter + join, 0.0001);
+    BOOST_CHECK_CLOSE(a.area(), inter + diff, 0.0001);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(boolean_batch, ClippingTest)
+{
+  std::vector<MultiPolygonD> result = booleanOperation(stars, square, Operation::intersection);
+  BOOST_CHECK_EQUAL(stars.size(), result.size());
+  for (size_t i = 0; i < stars.size(); i++) {
+    BOOST_CHECK_CLOSE(intersectionArea(stars[i], square), area(result[i]), 0.0001);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,166 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#define BOOST_TEST_MODULE Tidop convex hull test
+#include <boost/test/unit_test.hpp>
+#include <tidop/geometry/algorithms/hull.h>
+#include <tidop/geometry/entities/multipoint.h>
+
+#include <cmath>
+#include <random>
+
+using namespace tl;
+
+
+BOOST_AUTO_TEST_SUITE(HullTestSuite)
+
+struct HullTest
+{
+
+  HullTest()
+  {
+
+  }
+
+  ~HullTest()
+  {
+
+  }
+
+  void setup()
+  {
+    square = {PointD(0., 0.), PointD(10., 0.), PointD(10., 10.), PointD(0., 10.),
+              PointD(5., 5.), PointD(2., 8.), PointD(5., 0.), PointD(10., 3.)};
+
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> position(-100., 100.);
+    for (size_t i = 0; i < 200000; i++) {
+      PointD point(position(generator), position(generator));
+      // Nube rotada 30º y acotada a una elipse
+      if (point.x * point.x / 10000. + point.y * point.y / 900. > 1.) continue;
+      double angle = 30. * 3.14159265358979 / 180.;
+      cloud.emplace_back(point.x * std::cos(angle) - point.y * std::sin(angle),
+                         point.x * std::sin(angle) + point.y * std::cos(angle));
+    }
+  }
+
+  void teardown()
+  {
+
+  }
+
+  std::vector<PointD> square;
+  std::vector<PointD> cloud;
+};
+
+
+BOOST_FIXTURE_TEST_CASE(convex_hull, HullTest)
+{
+  PolygonD hull = convexHull(square);
+  BOOST_CHECK_EQUAL(4, hull.size());
+  BOOST_CHECK_CLOSE(100., hull.area(), 0.0001);
+  BOOST_CHECK(hull[0] == PointD(0., 0.));
+  BOOST_CHECK(hull[1] == PointD(10., 0.));
+
+  BOOST_CHECK_EQUAL(0, convexHull(std::vector<PointD>()).size());
+  BOOST_CHECK_EQUAL(2, convexHull(std::vector<PointD>{PointD(0., 0.), PointD(1., 1.), PointD(2., 2.)}).size());
+
+  std::vector<PointI> integers{PointI(0, 0), PointI(4, 0), PointI(2, 1), PointI(2, 4)};
+  PolygonI hull_int = convexHull(integers);
+  BOOST_CHECK_EQUAL(3, hull_int.size());
+}
+
+BOOST_FIXTURE_TEST_CASE(convex_hull_parallel, HullTest)
+{
+  PolygonD hull = convexHull(cloud);
+
+  // Todos los puntos quedan a la izquierda (o sobre) de cada arista
+  for (size_t i = 0; i < hull.size(); i++) {
+    const PointD &pt1 = hull[i];
+    const PointD &pt2 = hull[(i + 1) % hull.size()];
+    for (size_t j = 0; j < cloud.size(); j += 97) {
+      double cross = (pt2.x - pt1.x) * (cloud[j].y - pt1.y) - (pt2.y - pt1.y) * (cloud[j].x - pt1.x);
+      BOOST_CHECK(cross >= -1e-9);
+    }
+  }
+
+  // Mismo resultado que la versión secuencial
+  std::vector<PointD> copy(cloud);
+  std::vector<PointD> sequential;
+  internal::monotoneChain(copy, &sequential);
+  BOOST_CHECK_EQUAL(sequential.size(), hull.size());
+}
+
+BOOST_FIXTURE_TEST_CASE(convex_hull_3d, HullTest)
+{
+  MultiPoint3D<Point3D> points;
+  points.push_back(Point3D(0., 0., 5.));
+  points.push_back(Point3D(10., 0., 1.));
+  points.push_back(Point3D(0., 10., 2.));
+  points.push_back(Point3D(2., 2., 100.));
+  PolygonD hull = convexHull(points);
+  BOOST_CHECK_EQUAL(3, hull.size());
+  BOOST_CHECK_CLOSE(50., hull.area(), 0.0001);
+}
+
+BOOST_FIXTURE_TEST_CASE(min_area_rectangle, HullTest)
+{
+  OrientedRectangle rectangle = minAreaRectangle(square);
+  BOOST_CHECK_CLOSE(100., rectangle.area(), 0.0001);
+  BOOST_CHECK_CLOSE(5., rectangle.center.x, 0.0001);
+  BOOST_CHECK_CLOSE(5., rectangle.center.y, 0.0001);
+
+  // Cuadrado girado 45º
+  std::vector<PointD> diamond{PointD(0., -1.), PointD(1., 0.), PointD(0., 1.), PointD(-1., 0.)};
+  rectangle = minAreaRectangle(diamond);
+  BOOST_CHECK_CLOSE(2., rectangle.area(), 0.0001);
+  BOOST_CHECK_CLOSE(2., rectangle.polygon().area(), 0.0001);
+
+  rectangle = minAreaRectangle(cloud);
+  double angle = std::fmod(rectangle.angle + 2. * 3.14159265358979, 3.14159265358979 / 2.);
+  BOOST_CHECK_CLOSE(3.14159265358979 / 6., angle, 5.);
+  BOOST_CHECK(rectangle.area() < 200. * 60. * 1.01);
+  BOOST_CHECK(rectangle.area() > 200. * 60. * 0.95);
+}
+
+BOOST_FIXTURE_TEST_CASE(min_enclosing_circle, HullTest)
+{
+  CircleD circle = minEnclosingCircle(square);
+  BOOST_CHECK_CLOSE(5., circle.center.x, 0.0001);
+  BOOST_CHECK_CLOSE(5., circle.center.y, 0.0001);
+  BOOST_CHECK_CLOSE(std::sqrt(50.), circle.radius, 0.0001);
+
+  std::vector<PointD> triangle{PointD(0., 0.), PointD(10., 0.), PointD(5., 1.)};
+  circle = minEnclosingCircle(triangle);
+  BOOST_CHECK_CLOSE(5., circle.radius, 0.0001);
+
+  circle = minEnclosingCircle(cloud);
+  BOOST_CHECK(circle.radius <= 100.);
+  BOOST_CHECK(circle.radius > 99.);
+  for (const auto &point : cloud) {
+    BOOST_CHECK(distance(point, circle.center) <= circle.radius + 1e-9);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,207 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#define BOOST_TEST_MODULE Tidop segment intersection test
+#include <boost/test/unit_test.hpp>
+#include <tidop/geometry/entities/segment.h>
+#include <tidop/geometry/algorithms/intersect.h>
+
+#include <random>
+#include <set>
+#include <utility>
+
+using namespace tl;
+
+
+BOOST_AUTO_TEST_SUITE(IntersectTestSuite)
+
+struct IntersectTest
+{
+
+  IntersectTest()
+  {
+
+  }
+
+  ~IntersectTest()
+  {
+
+  }
+
+  void setup()
+  {
+    std::mt19937 generator(12345);
+
+    // Rejilla pequeña: extremos compartidos, verticales, horizontales y solapes
+    std::uniform_int_distribution<int> coordinate(0, 20);
+    std::uniform_int_distribution<int> kind(0, 3);
+    for (int i = 0; i < 300; i++) {
+      PointI pt1(coordinate(generator), coordinate(generator));
+      PointI pt2(coordinate(generator), coordinate(generator));
+      int k = kind(generator);
+      if (k == 0) pt2.x = pt1.x;
+      else if (k == 1) pt2.y = pt1.y;
+      grid.emplace_back(pt1, pt2);
+    }
+
+    std::uniform_real_distribution<double> position(0., 1000.);
+    std::uniform_real_distribution<double> offset(-50., 50.);
+    for (int i = 0; i < 2000; i++) {
+      PointD pt1(position(generator), position(generator));
+      PointD pt2(pt1.x + offset(generator), pt1.y + offset(generator));
+      random.emplace_back(pt1, pt2);
+    }
+  }
+
+  void teardown()
+  {
+
+  }
+
+  static long long orientation(const PointI &a, const PointI &b, const PointI &c)
+  {
+    long long cross = static_cast<long long>(b.x - a.x) * (c.y - a.y) -
+                      static_cast<long long>(b.y - a.y) * (c.x - a.x);
+    return (cross > 0) - (cross < 0);
+  }
+
+  static bool onSegment(const PointI &a, const PointI &b, const PointI &c)
+  {
+    return std::min(a.x, b.x) <= c.x && c.x <= std::max(a.x, b.x) &&
+           std::min(a.y, b.y) <= c.y && c.y <= std::max(a.y, b.y);
+  }
+
+  static bool intersects(const SegmentI &s1, const SegmentI &s2)
+  {
+    long long o1 = orientation(s1.pt1, s1.pt2, s2.pt1);
+    long long o2 = orientation(s1.pt1, s1.pt2, s2.pt2);
+    long long o3 = orientation(s2.pt1, s2.pt2, s1.pt1);
+    long long o4 = orientation(s2.pt1, s2.pt2, s1.pt2);
+    if (o1 != o2 && o3 != o4) return true;
+    if (o1 == 0 && onSegment(s1.pt1, s1.pt2, s2.pt1)) return true;
+    if (o2 == 0 && onSegment(s1.pt1, s1.pt2, s2.pt2)) return true;
+    if (o3 == 0 && onSegment(s2.pt1, s2.pt2, s1.pt1)) return true;
+    if (o4 == 0 && onSegment(s2.pt1, s2.pt2, s1.pt2)) return true;
+    return false;
+  }
+
+  static bool intersects(const SegmentD &s1, const SegmentD &s2)
+  {
+    double dx1 = s1.pt2.x - s1.pt1.x;
+    double dy1 = s1.pt2.y - s1.pt1.y;
+    double dx2 = s2.pt2.x - s2.pt1.x;
+    double dy2 = s2.pt2.y - s2.pt1.y;
+    double den = dx1 * dy2 - dy1 * dx2;
+    if (den == 0.) return false;
+    double wx = s2.pt1.x - s1.pt1.x;
+    double wy = s2.pt1.y - s1.pt1.y;
+    double t = (wx * dy2 - wy * dx2) / den;
+    double u = (wx * dy1 - wy * dx1) / den;
+    return t >= 0. && t <= 1. && u >= 0. && u <= 1.;
+  }
+
+  template<typename Segment_t>
+  static std::set<std::pair<size_t, size_t>> bruteForce(const std::vector<Segment_t> &segments)
+  {
+    std::set<std::pair<size_t, size_t>> pairs;
+    for (size_t i = 0; i < segments.size(); i++) {
+      if (segments[i].pt1 == segments[i].pt2) continue;
+      for (size_t j = i + 1; j < segments.size(); j++) {
+        if (segments[j].pt1 == segments[j].pt2) continue;
+        if (intersects(segments[i], segments[j])) pairs.emplace(i, j);
+      }
+    }
+    return pairs;
+  }
+
+  static std::set<std::pair<size_t, size_t>> pairs(const std::vector<SegmentIntersection> &intersections)
+  {
+    std::set<std::pair<size_t, size_t>> pairs;
+    for (const auto &intersection : intersections) {
+      pairs.emplace(intersection.segment1, intersection.segment2);
+    }
+    return pairs;
+  }
+
+  std::vector<SegmentI> grid;
+  std::vector<SegmentD> random;
+};
+
+
+BOOST_FIXTURE_TEST_CASE(simple, IntersectTest)
+{
+  std::vector<SegmentD> segments;
+  segments.emplace_back(PointD(0., 0.), PointD(10., 10.));
+  segments.emplace_back(PointD(0., 10.), PointD(10., 0.));
+  segments.emplace_back(PointD(5., -5.), PointD(5., 20.));
+  segments.emplace_back(PointD(20., 0.), PointD(30., 0.));
+
+  std::vector<SegmentIntersection> intersections = segmentIntersections(segments);
+  BOOST_CHECK_EQUAL(3, intersections.size());
+  for (const auto &intersection : intersections) {
+    BOOST_CHECK_CLOSE(5., intersection.point.x, 0.0001);
+    BOOST_CHECK_CLOSE(5., intersection.point.y, 0.0001);
+  }
+  BOOST_CHECK_EQUAL(0, intersections[0].segment1);
+  BOOST_CHECK_EQUAL(1, intersections[0].segment2);
+  BOOST_CHECK_EQUAL(1, intersections[2].segment1);
+  BOOST_CHECK_EQUAL(2, intersections[2].segment2);
+}
+
+BOOST_FIXTURE_TEST_CASE(degenerate, IntersectTest)
+{
+  std::vector<SegmentI> segments;
+  segments.emplace_back(PointI(0, 0), PointI(10, 0));
+  segments.emplace_back(PointI(5, 0), PointI(15, 0));   // Solape colineal
+  segments.emplace_back(PointI(10, 0), PointI(10, 10)); // Extremo compartido
+  segments.emplace_back(PointI(0, 5), PointI(10, 5));   // En T con la vertical
+  segments.emplace_back(PointI(20, 20), PointI(30, 30));
+
+  std::set<std::pair<size_t, size_t>> result = pairs(segmentIntersections(segments));
+  std::set<std::pair<size_t, size_t>> expected{{0, 1}, {0, 2}, {1, 2}, {2, 3}};
+  BOOST_CHECK(expected == result);
+}
+
+BOOST_FIXTURE_TEST_CASE(grid_segments, IntersectTest)
+{
+  SegmentIntersector<PointI> intersector;
+  std::set<std::pair<size_t, size_t>> result = pairs(intersector.execute(grid));
+  std::set<std::pair<size_t, size_t>> expected = bruteForce(grid);
+  BOOST_CHECK_EQUAL(expected.size(), result.size());
+  BOOST_CHECK(expected == result);
+
+  // Reutilización del motor
+  BOOST_CHECK(expected == pairs(intersector.execute(grid)));
+}
+
+BOOST_FIXTURE_TEST_CASE(random_segments, IntersectTest)
+{
+  std::set<std::pair<size_t, size_t>> result = pairs(segmentIntersections(random));
+  std::set<std::pair<size_t, size_t>> expected = bruteForce(random);
+  BOOST_CHECK(!expected.empty());
+  BOOST_CHECK_EQUAL(expected.size(), result.size());
+  BOOST_CHECK(expected == result);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
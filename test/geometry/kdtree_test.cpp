@@ -0,0 +1,222 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#define BOOST_TEST_MODULE Tidop kdtree test
+#include <boost/test/unit_test.hpp>
+#include <tidop/geometry/kdtree.h>
+#include <tidop/geometry/entities/multipoint.h>
+#include <tidop/geometry/algorithms/distance.h>
+
+#include <random>
+
+using namespace tl;
+
+
+BOOST_AUTO_TEST_SUITE(KDTreeTestSuite)
+
+struct KDTreeTest
+{
+
+  KDTreeTest()
+  {
+
+  }
+
+  ~KDTreeTest()
+  {
+
+  }
+
+  void setup()
+  {
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> position(0., 1000.);
+
+    for (size_t i = 0; i < 20000; i++) {
+      points.emplace_back(position(generator), position(generator));
+    }
+
+    for (size_t i = 0; i < 5000; i++) {
+      points3d.emplace_back(static_cast<float>(position(generator)),
+                            static_cast<float>(position(generator)),
+                            static_cast<float>(position(generator) / 10.));
+    }
+
+    for (size_t i = 0; i < 50; i++) {
+      queries.emplace_back(position(generator), position(generator));
+      queries3d.emplace_back(static_cast<float>(position(generator)),
+                             static_cast<float>(position(generator)),
+                             static_cast<float>(position(generator) / 10.));
+    }
+  }
+
+  void teardown()
+  {
+
+  }
+
+  template<typename Point_t>
+  static std::vector<std::pair<double, size_t>> bruteForce(const std::vector<Point_t> &points,
+                                                           const Point_t &query)
+  {
+    std::vector<std::pair<double, size_t>> distances;
+    for (size_t i = 0; i < points.size(); i++) {
+      Point_t diff = points[i] - query;
+      distances.emplace_back(diff.x * diff.x + diff.y * diff.y + squaredZ(diff), i);
+    }
+    std::sort(distances.begin(), distances.end());
+    return distances;
+  }
+
+  static double squaredZ(const PointD &) { return 0.; }
+  static double squaredZ(const Point3F &point) { return static_cast<double>(point.z) * point.z; }
+
+  std::vector<PointD> points;
+  std::vector<Point3F> points3d;
+  std::vector<PointD> queries;
+  std::vector<Point3F> queries3d;
+};
+
+
+BOOST_FIXTURE_TEST_CASE(empty_tree, KDTreeTest)
+{
+  KDTree<PointD> tree;
+  BOOST_CHECK(tree.empty());
+  BOOST_CHECK(tree.nearest(PointD(0., 0.), 3).empty());
+  BOOST_CHECK(tree.radiusSearch(PointD(0., 0.), 10.).empty());
+
+  std::vector<PointD> few{PointD(0., 0.), PointD(1., 0.), PointD(5., 5.)};
+  tree.build(few);
+  BOOST_CHECK_EQUAL(3, tree.size());
+  std::vector<size_t> all = tree.nearest(PointD(0.1, 0.), 10);
+  BOOST_CHECK_EQUAL(3, all.size());
+  BOOST_CHECK_EQUAL(0, all[0]);
+  BOOST_CHECK_EQUAL(1, all[1]);
+  BOOST_CHECK_EQUAL(2, all[2]);
+}
+
+BOOST_FIXTURE_TEST_CASE(nearest_2d, KDTreeTest)
+{
+  KDTree<PointD> tree(points);
+  BOOST_CHECK_EQUAL(points.size(), tree.size());
+
+  std::vector<size_t> indices;
+  std::vector<double> distances;
+  for (const auto &query : queries) {
+    std::vector<std::pair<double, size_t>> expected = bruteForce(points, query);
+    tree.nearest(query, 10, &indices, &distances);
+    BOOST_CHECK_EQUAL(10, indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+      BOOST_CHECK_EQUAL(expected[i].second, indices[i]);
+      BOOST_CHECK_CLOSE(std::sqrt(expected[i].first), distances[i], 0.0001);
+    }
+  }
+
+  // Distancia máxima
+  std::vector<size_t> near_points = tree.nearest(queries[0], 100, 5.);
+  for (size_t index : near_points) {
+    BOOST_CHECK(distance(points[index], queries[0]) <= 5.);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(nearest_3d, KDTreeTest)
+{
+  MultiPoint3D<Point3F> multipoint;
+  for (const auto &point : points3d) multipoint.push_back(point);
+
+  KDTree<Point3F> tree(multipoint, 4);
+  for (const auto &query : queries3d) {
+    std::vector<std::pair<double, size_t>> expected = bruteForce(points3d, query);
+    std::vector<size_t> indices = tree.nearest(query, 5);
+    BOOST_CHECK_EQUAL(5, indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+      BOOST_CHECK_EQUAL(expected[i].second, indices[i]);
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(radius_search, KDTreeTest)
+{
+  KDTree<PointD> tree(points);
+  KDTree<Point3F> tree3d(points3d);
+
+  for (const auto &query : queries) {
+    std::vector<std::pair<double, size_t>> expected = bruteForce(points, query);
+    std::vector<size_t> indices = tree.radiusSearch(query, 15.);
+    size_t count = 0;
+    while (count < expected.size() && expected[count].first <= 225.) count++;
+    BOOST_CHECK_EQUAL(count, indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+      BOOST_CHECK_EQUAL(expected[i].second, indices[i]);
+    }
+  }
+
+  for (const auto &query : queries3d) {
+    std::vector<std::pair<double, size_t>> expected = bruteForce(points3d, query);
+    size_t count = 0;
+    while (count < expected.size() && expected[count].first <= 2500.) count++;
+    BOOST_CHECK_EQUAL(count, tree3d.radiusSearch(query, 50.).size());
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(batch, KDTreeTest)
+{
+  KDTree<PointD> tree(points);
+
+  std::vector<std::vector<size_t>> neighbors = tree.nearest(points, 2);
+  BOOST_CHECK_EQUAL(points.size(), neighbors.size());
+  for (size_t i = 0; i < points.size(); i += 101) {
+    BOOST_CHECK_EQUAL(i, neighbors[i][0]);
+    BOOST_CHECK(neighbors[i][1] == tree.nearest(points[i], 2)[1]);
+  }
+
+  std::vector<std::vector<size_t>> radius = tree.radiusSearch(queries, 20.);
+  for (size_t i = 0; i < queries.size(); i++) {
+    BOOST_CHECK(radius[i] == tree.radiusSearch(queries[i], 20.));
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(approximate, KDTreeTest)
+{
+  KDTree<PointD> tree(points);
+  tree.setMaxChecks(64);
+  BOOST_CHECK_EQUAL(64, tree.maxChecks());
+
+  size_t hits = 0;
+  for (const auto &query : queries) {
+    std::vector<std::pair<double, size_t>> expected = bruteForce(points, query);
+    std::vector<size_t> indices = tree.nearest(query, 1);
+    BOOST_CHECK_EQUAL(1, indices.size());
+    if (indices[0] == expected[0].second) hits++;
+  }
+  // Las hojas más prometedoras se exploran primero
+  BOOST_CHECK(hits >= queries.size() * 9 / 10);
+
+  tree.setMaxChecks(0);
+  for (const auto &query : queries) {
+    BOOST_CHECK_EQUAL(bruteForce(points, query)[0].second, tree.nearest(query, 1)[0]);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,218 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#define BOOST_TEST_MODULE Tidop PreparedPolygon test
+#include <boost/test/unit_test.hpp>
+#include <tidop/geometry/preparedpolygon.h>
+
+#include <cmath>
+#include <random>
+
+using namespace tl;
+
+
+BOOST_AUTO_TEST_SUITE(PreparedPolygonTestSuite)
+
+struct PreparedPolygonTest
+{
+
+  PreparedPolygonTest()
+  {
+
+  }
+
+  ~PreparedPolygonTest()
+  {
+
+  }
+
+  void setup()
+  {
+    square = PolygonD{PointD(0., 0.), PointD(10., 0.), PointD(10., 10.), PointD(0., 10.)};
+
+    square_with_hole = square;
+    PolygonHole<PointD> hole;
+    hole.push_back(PointD(2., 2.));
+    hole.push_back(PointD(8., 2.));
+    hole.push_back(PointD(8., 8.));
+    hole.push_back(PointD(2., 8.));
+    square_with_hole.addHole(hole);
+
+    // Estrella de 40 puntas (polígono no convexo)
+    for (int i = 0; i < 80; i++) {
+      double angle = i * 3.14159265358979 / 40.;
+      double radius = (i % 2 == 0) ? 100. : 40.;
+      star.push_back(PointD(radius * std::cos(angle), radius * std::sin(angle)));
+    }
+
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> position(-120., 120.);
+    for (size_t i = 0; i < 20000; i++) {
+      points.emplace_back(position(generator), position(generator));
+    }
+  }
+
+  void teardown()
+  {
+
+  }
+
+  PolygonD square;
+  PolygonD square_with_hole;
+  PolygonD star;
+  std::vector<PointD> points;
+};
+
+
+BOOST_FIXTURE_TEST_CASE(empty, PreparedPolygonTest)
+{
+  PreparedPolygonD prepared;
+  BOOST_CHECK(prepared.empty());
+  BOOST_CHECK(!prepared.contains(PointD(0., 0.)));
+  BOOST_CHECK_EQUAL(0, prepared.contains(std::vector<PointD>()).size());
+}
+
+BOOST_FIXTURE_TEST_CASE(contains, PreparedPolygonTest)
+{
+  PreparedPolygonD prepared(square);
+  BOOST_CHECK_EQUAL(4, prepared.edges());
+  BOOST_CHECK(prepared.contains(PointD(5., 5.)));
+  BOOST_CHECK(prepared.contains(PointD(0., 0.)));
+  BOOST_CHECK(prepared.contains(PointD(10., 5.)));
+  BOOST_CHECK(prepared.contains(PointD(5., 10.)));
+  BOOST_CHECK(!prepared.contains(PointD(10.5, 5.)));
+  BOOST_CHECK(!prepared.contains(PointD(-1., -1.)));
+}
+
+BOOST_FIXTURE_TEST_CASE(holes, PreparedPolygonTest)
+{
+  PreparedPolygonD prepared(square_with_hole);
+  BOOST_CHECK_EQUAL(8, prepared.edges());
+  BOOST_CHECK_CLOSE(64., prepared.area(), 0.0001);
+  BOOST_CHECK(prepared.contains(PointD(1., 1.)));
+  BOOST_CHECK(!prepared.contains(PointD(5., 5.)));
+  BOOST_CHECK(prepared.contains(PointD(2., 5.)));
+  BOOST_CHECK(prepared.contains(PointD(9., 9.)));
+}
+
+BOOST_FIXTURE_TEST_CASE(contains_is_inner, PreparedPolygonTest)
+{
+  PreparedPolygonD prepared(star);
+  for (const auto &point : points) {
+    BOOST_CHECK_EQUAL(star.isInner(point), prepared.contains(point));
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(contains_batch, PreparedPolygonTest)
+{
+  std::vector<PolygonD> polygons{square, square_with_hole, star};
+  for (const auto &polygon : polygons) {
+    for (size_t buckets : {size_t{0}, size_t{1}, size_t{7}}) {
+      PreparedPolygonD prepared(polygon, buckets);
+      std::vector<bool> inside = prepared.contains(points);
+      BOOST_CHECK_EQUAL(points.size(), inside.size());
+      for (size_t i = 0; i < points.size(); i++) {
+        BOOST_CHECK_EQUAL(prepared.contains(points[i]), inside[i]);
+      }
+    }
+  }
+
+  std::vector<PointD> boundary{PointD(0., 0.), PointD(10., 3.), PointD(2., 5.), PointD(5., 5.), PointD(11., 1.)};
+  std::vector<bool> inside = PreparedPolygonD(square_with_hole).contains(boundary);
+  BOOST_CHECK(inside[0]);
+  BOOST_CHECK(inside[1]);
+  BOOST_CHECK(inside[2]);
+  BOOST_CHECK(!inside[3]);
+  BOOST_CHECK(!inside[4]);
+}
+
+BOOST_FIXTURE_TEST_CASE(intersection_area, PreparedPolygonTest)
+{
+  PolygonD shifted{PointD(5., 5.), PointD(15., 5.), PointD(15., 15.), PointD(5., 15.)};
+  BOOST_CHECK_CLOSE(25., intersectionArea(square, shifted), 0.0001);
+  BOOST_CHECK_CLOSE(100., intersectionArea(square, square), 0.0001);
+
+  // Rombo inscrito: los cruces entre aristas caen dentro de las franjas
+  PolygonD diamond{PointD(5., -5.), PointD(15., 5.), PointD(5., 15.), PointD(-5., 5.)};
+  BOOST_CHECK_CLOSE(100., intersectionArea(square, diamond), 0.0001);
+
+  // El hueco se descuenta
+  BOOST_CHECK_CLOSE(64., intersectionArea(square_with_hole, square), 0.0001);
+  BOOST_CHECK_CLOSE(25. - 9., intersectionArea(square_with_hole, shifted), 0.0001);
+
+  PreparedPolygonD prepared_star(star);
+  BOOST_CHECK_CLOSE(prepared_star.area(), prepared_star.intersectionArea(prepared_star), 0.0001);
+}
+
+BOOST_FIXTURE_TEST_CASE(overlaps_polygons, PreparedPolygonTest)
+{
+  PolygonD touching{PointD(10., 0.), PointD(20., 0.), PointD(20., 10.), PointD(10., 10.)};
+  PolygonD far{PointD(50., 50.), PointD(60., 50.), PointD(60., 60.)};
+  PolygonD inside_hole{PointD(3., 3.), PointD(7., 3.), PointD(7., 7.), PointD(3., 7.)};
+
+  BOOST_CHECK(overlaps(square, square));
+  BOOST_CHECK(!overlaps(square, touching));
+  BOOST_CHECK(!overlaps(square, far));
+  BOOST_CHECK(!overlaps(square_with_hole, inside_hole));
+  BOOST_CHECK(PreparedPolygonD(square).overlaps(PreparedPolygonD(inside_hole)));
+}
+
+BOOST_FIXTURE_TEST_CASE(polygon_set, PreparedPolygonTest)
+{
+  std::vector<PolygonD> grid;
+  for (int r = 0; r < 10; r++) {
+    for (int c = 0; c < 10; c++) {
+      grid.push_back(PolygonD{PointD(c * 10., r * 10.), PointD(c * 10. + 10., r * 10.),
+                              PointD(c * 10., r * 10. + 10.)});
+    }
+  }
+
+  PreparedPolygonSet<PointD> index(grid);
+  BOOST_CHECK_EQUAL(100, index.size());
+
+  std::vector<size_t> ids = index.search(PointD(32., 41.));
+  BOOST_CHECK_EQUAL(1, ids.size());
+  BOOST_CHECK_EQUAL(43, ids[0]);
+
+  std::vector<int> owner = index.locate(points);
+  for (size_t i = 0; i < points.size(); i++) {
+    int expected = -1;
+    for (size_t j = 0; j < grid.size(); j++) {
+      if (grid[j].isInner(points[i])) {
+        expected = static_cast<int>(j);
+        break;
+      }
+    }
+    BOOST_CHECK_EQUAL(expected, owner[i]);
+  }
+
+  PolygonD tile{PointD(0., 0.), PointD(20., 0.), PointD(20., 10.), PointD(0., 10.)};
+  std::vector<std::pair<size_t, double>> overlapping = index.overlapping(tile);
+  BOOST_CHECK_EQUAL(2, overlapping.size());
+  BOOST_CHECK_EQUAL(0, overlapping[0].first);
+  BOOST_CHECK_CLOSE(50., overlapping[0].second, 0.0001);
+  BOOST_CHECK_EQUAL(1, overlapping[1].first);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,228 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#define BOOST_TEST_MODULE Tidop RTree test
+#include <boost/test/unit_test.hpp>
+#include <tidop/geometry/rtree.h>
+#include <tidop/geometry/entities/polygon.h>
+
+#include <algorithm>
+#include <random>
+
+using namespace tl;
+
+
+BOOST_AUTO_TEST_SUITE(RTreeTestSuite)
+
+struct RTreeTest
+{
+
+  RTreeTest()
+  {
+
+  }
+
+  ~RTreeTest()
+  {
+
+  }
+
+  void setup()
+  {
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> position(0., 1000.);
+    std::uniform_real_distribution<double> size(1., 50.);
+
+    for (size_t i = 0; i < 1000; i++) {
+      PointD pt(position(generator), position(generator));
+      windows.emplace_back(pt, PointD(pt.x + size(generator), pt.y + size(generator)));
+    }
+
+    for (size_t i = 0; i < 200; i++) {
+      Point3D pt(position(generator), position(generator), position(generator));
+      boxes.emplace_back(pt, Point3D(pt.x + size(generator), pt.y + size(generator), pt.z + size(generator)));
+    }
+
+    for (int r = 0; r < 10; r++) {
+      for (int c = 0; c < 10; c++) {
+        PolygonD polygon;
+        polygon.push_back(PointD(c * 10., r * 10.));
+        polygon.push_back(PointD(c * 10. + 10., r * 10.));
+        polygon.push_back(PointD(c * 10., r * 10. + 10.));
+        polygons.push_back(polygon);
+      }
+    }
+  }
+
+  void teardown()
+  {
+
+  }
+
+  std::vector<WindowD> windows;
+  std::vector<BoundingBoxD> boxes;
+  std::vector<PolygonD> polygons;
+};
+
+
+BOOST_FIXTURE_TEST_CASE(empty, RTreeTest)
+{
+  RTree<WindowD> rtree;
+  BOOST_CHECK(rtree.empty());
+  BOOST_CHECK_EQUAL(0, rtree.size());
+  BOOST_CHECK(rtree.search(WindowD(PointD(0., 0.), PointD(10., 10.))).empty());
+  BOOST_CHECK(rtree.search(PointD(5., 5.)).empty());
+  BOOST_CHECK(rtree.nearest(PointD(5., 5.)).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(single, RTreeTest)
+{
+  RTree<WindowD> rtree(std::vector<WindowD>{WindowD(PointD(0., 0.), PointD(10., 10.))});
+  BOOST_CHECK_EQUAL(1, rtree.size());
+  BOOST_CHECK_EQUAL(1, rtree.search(PointD(5., 5.)).size());
+  BOOST_CHECK(rtree.search(PointD(15., 5.)).empty());
+  BOOST_CHECK_EQUAL(0, rtree.nearest(PointD(100., 100.)).at(0));
+  BOOST_CHECK(rtree.nearest(PointD(100., 100.), 1, 10.).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(bounds, RTreeTest)
+{
+  RTree<WindowD> rtree(windows);
+
+  WindowD bounds;
+  for (const auto &window : windows) bounds = joinWindow(bounds, window);
+
+  BOOST_CHECK(bounds == rtree.bounds());
+}
+
+BOOST_FIXTURE_TEST_CASE(search_window, RTreeTest)
+{
+  RTree<WindowD> rtree(windows, 8);
+  BOOST_CHECK_EQUAL(windows.size(), rtree.size());
+
+  std::vector<WindowD> queries{WindowD(PointD(100., 100.), PointD(200., 200.)),
+                               WindowD(PointD(500., 0.), PointD(520., 1000.)),
+                               WindowD(PointD(-10., -10.), PointD(-5., -5.)),
+                               WindowD(PointD(0., 0.), PointD(1100., 1100.))};
+
+  for (const auto &query : queries) {
+
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < windows.size(); i++) {
+      if (intersectWindows(windows[i], query)) expected.push_back(i);
+    }
+
+    std::vector<size_t> result = rtree.search(query);
+    std::sort(result.begin(), result.end());
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), result.begin(), result.end());
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(search_visitor, RTreeTest)
+{
+  RTree<WindowD> rtree(windows);
+
+  size_t count = 0;
+  rtree.search(WindowD(PointD(0., 0.), PointD(1100., 1100.)), [&count](size_t) {
+    return ++count < 10;
+  });
+
+  BOOST_CHECK_EQUAL(10, count);
+}
+
+BOOST_FIXTURE_TEST_CASE(search_point, RTreeTest)
+{
+  RTree<WindowD> rtree(windows);
+
+  std::vector<PointD> points{PointD(250., 250.), PointD(731.5, 12.2), PointD(2000., 0.)};
+
+  for (const auto &point : points) {
+
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < windows.size(); i++) {
+      if (windows[i].containsPoint(point)) expected.push_back(i);
+    }
+
+    std::vector<size_t> result = rtree.search(point);
+    std::sort(result.begin(), result.end());
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), result.begin(), result.end());
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(nearest, RTreeTest)
+{
+  RTree<WindowD> rtree(windows);
+
+  PointD point(1200., 500.);
+
+  std::vector<std::pair<double, size_t>> distances;
+  for (size_t i = 0; i < windows.size(); i++) {
+    double dx = std::max({windows[i].pt1.x - point.x, 0., point.x - windows[i].pt2.x});
+    double dy = std::max({windows[i].pt1.y - point.y, 0., point.y - windows[i].pt2.y});
+    distances.emplace_back(dx * dx + dy * dy, i);
+  }
+  std::sort(distances.begin(), distances.end());
+
+  std::vector<size_t> result = rtree.nearest(point, 5);
+  BOOST_CHECK_EQUAL(5, result.size());
+  for (size_t i = 0; i < result.size(); i++) {
+    BOOST_CHECK_EQUAL(distances[i].second, result[i]);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(bounding_box, RTreeTest)
+{
+  RTree<BoundingBoxD> rtree(boxes, 4);
+
+  BoundingBoxD query(Point3D(200., 200., 200.), Point3D(600., 600., 600.));
+
+  std::vector<size_t> expected;
+  for (size_t i = 0; i < boxes.size(); i++) {
+    const auto &box = boxes[i];
+    if (box.pt2.x >= query.pt1.x && box.pt1.x <= query.pt2.x &&
+        box.pt2.y >= query.pt1.y && box.pt1.y <= query.pt2.y &&
+        box.pt2.z >= query.pt1.z && box.pt1.z <= query.pt2.z) expected.push_back(i);
+  }
+
+  std::vector<size_t> result = rtree.search(query);
+  std::sort(result.begin(), result.end());
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), result.begin(), result.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(polygons_index, RTreeTest)
+{
+  RTree<WindowD> rtree = createRTree(polygons);
+  BOOST_CHECK_EQUAL(100, rtree.size());
+
+  PointD point(32., 41.);
+  std::vector<size_t> candidates = rtree.search(point);
+  BOOST_CHECK_EQUAL(1, candidates.size());
+  BOOST_CHECK_EQUAL(43, candidates[0]);
+  BOOST_CHECK(polygons[candidates[0]].isInner(point));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
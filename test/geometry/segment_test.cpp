@@ -301,4 +301,42 @@ BOOST_AUTO_TEST_CASE(Segment3D_vector)
   BOOST_CHECK_CLOSE(19.8, v.x, 0.1);
   BOOST_CHECK_CLOSE(561.19, v.y, 0.1);
   BOOST_CHECK_CLOSE(5.5, v.z, 0.1);
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(GroupLines_collinear)
+{
+  std::vector<Line> lines;
+  lines.emplace_back(PointI(0, 10), PointI(100, 10));
+  lines.emplace_back(PointI(50, 200), PointI(50, 300));
+  lines.emplace_back(PointI(150, 11), PointI(300, 11));
+  lines.emplace_back(PointI(0, 100), PointI(100, 200));
+  lines.emplace_back(PointI(400, 10), PointI(500, 11));
+  lines.emplace_back(PointI(51, 0), PointI(51, 150));
+  lines.emplace_back(PointI(200, 300), PointI(250, 350));
+  lines.emplace_back(PointI(0, 400), PointI(500, 400));
+
+  std::vector<GroupLines> groups = groupCollinearLines(lines, 0.02, 2.);
+  BOOST_CHECK_EQUAL(4, groups.size());
+  BOOST_CHECK_EQUAL(3, groups[0].size());
+  BOOST_CHECK(groups[0][1].pt1 == lines[2].pt1);
+  BOOST_CHECK(groups[0][2].pt1 == lines[4].pt1);
+  BOOST_CHECK_EQUAL(2, groups[1].size());
+  BOOST_CHECK(groups[1][1].pt1 == lines[5].pt1);
+  BOOST_CHECK_EQUAL(2, groups[2].size());
+  BOOST_CHECK(groups[2][1].pt1 == lines[6].pt1);
+  BOOST_CHECK_EQUAL(1, groups[3].size());
+
+  BOOST_CHECK_EQUAL(0, groupCollinearLines(std::vector<Line>(), 0.02, 2.).size());
+}
+
+BOOST_AUTO_TEST_CASE(GroupLines_wrap_angle)
+{
+  // Direcciones a ambos lados de 0/π
+  std::vector<Line> lines;
+  lines.emplace_back(PointI(0, 0), PointI(1000, 1));
+  lines.emplace_back(PointI(2000, 3), PointI(3000, 1));
+  lines.emplace_back(PointI(0, 500), PointI(3000, 500));
+
+  std::vector<GroupLines> groups = groupCollinearLines(lines, 0.01, 5.);
+  BOOST_CHECK_EQUAL(2, groups.size());
+  BOOST_CHECK_EQUAL(2, groups[0].size());
+}
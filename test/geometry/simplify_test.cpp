@@ -0,0 +1,192 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#define BOOST_TEST_MODULE Tidop simplify test
+#include <boost/test/unit_test.hpp>
+#include <tidop/geometry/algorithms/simplify.h>
+
+#include <cmath>
+#include <random>
+
+using namespace tl;
+
+using Method = LineSimplifier<PointD>::Method;
+
+BOOST_AUTO_TEST_SUITE(SimplifyTestSuite)
+
+struct SimplifyTest
+{
+
+  SimplifyTest()
+  {
+
+  }
+
+  ~SimplifyTest()
+  {
+
+  }
+
+  void setup()
+  {
+    zigzag = LineStringD{PointD(0., 0.), PointD(1., 0.1), PointD(2., -0.1), PointD(3., 5.),
+                         PointD(4., 6.), PointD(5., 7.), PointD(6., 8.1), PointD(7., 9.)};
+
+    square = PolygonD{PointD(0., 0.), PointD(5., 0.01), PointD(10., 0.), PointD(10., 10.),
+                      PointD(5., 9.99), PointD(0., 10.)};
+
+    std::mt19937 generator(12345);
+    std::normal_distribution<double> noise(0., 0.05);
+    for (int l = 0; l < 50; l++) {
+      LineStringD line;
+      for (int i = 0; i < 500; i++) {
+        double x = i * 0.1;
+        line.push_back(PointD(x, std::sin(x + l) + noise(generator)));
+      }
+      lines.push_back(line);
+    }
+  }
+
+  void teardown()
+  {
+
+  }
+
+  LineStringD zigzag;
+  PolygonD square;
+  std::vector<LineStringD> lines;
+};
+
+
+BOOST_FIXTURE_TEST_CASE(douglas_peucker, SimplifyTest)
+{
+  LineStringD simplified = simplifyDouglasPeucker(zigzag, 0.5);
+  BOOST_CHECK_EQUAL(4, simplified.size());
+  BOOST_CHECK(simplified[0] == zigzag[0]);
+  BOOST_CHECK(simplified[1] == zigzag[2]);
+  BOOST_CHECK(simplified[2] == zigzag[3]);
+  BOOST_CHECK(simplified[3] == zigzag[7]);
+
+  BOOST_CHECK_EQUAL(zigzag.size(), simplifyDouglasPeucker(zigzag, 0.).size());
+  BOOST_CHECK_EQUAL(2, simplifyDouglasPeucker(zigzag, 100.).size());
+}
+
+BOOST_FIXTURE_TEST_CASE(douglas_peucker_tolerance, SimplifyTest)
+{
+  LineSimplifier<PointD> simplifier;
+  LineStringD simplified;
+  for (const auto &line : lines) {
+    simplifier.simplify(line, 0.2, Method::douglas_peucker, &simplified);
+    BOOST_CHECK(simplified.size() < line.size());
+    BOOST_CHECK(simplified[0] == line[0]);
+    BOOST_CHECK(simplified[simplified.size() - 1] == line[line.size() - 1]);
+
+    // Ningún vértice original queda a más de la tolerancia de la línea simplificada
+    for (const auto &point : line) {
+      double min_distance = std::numeric_limits<double>::max();
+      for (size_t i = 1; i < simplified.size(); i++) {
+        min_distance = std::min(min_distance, std::sqrt(internal::distancePointToSegment2(point, simplified[i - 1], simplified[i])));
+      }
+      BOOST_CHECK(min_distance <= 0.2 + 1e-9);
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(visvalingam_whyatt, SimplifyTest)
+{
+  LineStringD simplified = simplifyVisvalingamWhyatt(zigzag, 0.5);
+  BOOST_CHECK(simplified.size() < zigzag.size());
+  BOOST_CHECK(simplified[0] == zigzag[0]);
+  BOOST_CHECK(simplified[simplified.size() - 1] == zigzag[zigzag.size() - 1]);
+  // El vértice del salto tiene un área efectiva grande
+  BOOST_CHECK(std::find(simplified.begin(), simplified.end(), zigzag[3]) != simplified.end());
+
+  BOOST_CHECK_EQUAL(2, simplifyVisvalingamWhyatt(zigzag, 1000.).size());
+}
+
+BOOST_FIXTURE_TEST_CASE(polygon, SimplifyTest)
+{
+  PolygonD simplified = simplifyDouglasPeucker(square, 0.1);
+  BOOST_CHECK_EQUAL(4, simplified.size());
+  BOOST_CHECK_CLOSE(100., simplified.area(), 0.0001);
+
+  simplified = simplifyVisvalingamWhyatt(square, 1.);
+  BOOST_CHECK_EQUAL(4, simplified.size());
+
+  // Un anillo nunca baja de tres vértices
+  BOOST_CHECK_EQUAL(3, simplifyDouglasPeucker(square, 100.).size());
+  BOOST_CHECK_EQUAL(3, simplifyVisvalingamWhyatt(square, 1000.).size());
+
+  PolygonD with_hole = square;
+  PolygonHole<PointD> hole;
+  hole.push_back(PointD(4., 4.));
+  hole.push_back(PointD(4.5, 4.));
+  hole.push_back(PointD(4.5, 4.5));
+  hole.push_back(PointD(4., 4.5));
+  with_hole.addHole(hole);
+  BOOST_CHECK_EQUAL(1, simplifyDouglasPeucker(with_hole, 0.1).holes());
+  BOOST_CHECK_EQUAL(0, simplifyVisvalingamWhyatt(with_hole, 1.).holes());
+}
+
+BOOST_FIXTURE_TEST_CASE(densify_entities, SimplifyTest)
+{
+  LineStringD line{PointD(0., 0.), PointD(10., 0.), PointD(10., 1.)};
+  LineStringD densified = densify(line, 2.5);
+  BOOST_CHECK_EQUAL(6, densified.size());
+  BOOST_CHECK(densified[1] == PointD(2.5, 0.));
+  BOOST_CHECK(densified[4] == PointD(10., 0.));
+  BOOST_CHECK_CLOSE(line.length(), densified.length(), 0.0001);
+
+  PolygonD polygon = densify(square, 1.);
+  BOOST_CHECK(polygon.size() > 40);
+  BOOST_CHECK_CLOSE(square.area(), polygon.area(), 0.0001);
+  for (size_t i = 0; i < polygon.size(); i++) {
+    BOOST_CHECK(distance(polygon[i], polygon[(i + 1) % polygon.size()]) <= 1. + 1e-9);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(batch, SimplifyTest)
+{
+  LineSimplifier<PointD> simplifier;
+
+  std::vector<LineStringD> simplified = simplify(lines, 0.2, Method::douglas_peucker);
+  BOOST_CHECK_EQUAL(lines.size(), simplified.size());
+  for (size_t i = 0; i < lines.size(); i++) {
+    LineStringD expected = simplifier.simplify(lines[i], 0.2, Method::douglas_peucker);
+    BOOST_CHECK_EQUAL(expected.size(), simplified[i].size());
+  }
+
+  simplified = simplify(lines, 0.01, Method::visvalingam_whyatt);
+  for (size_t i = 0; i < lines.size(); i++) {
+    LineStringD expected = simplifier.simplify(lines[i], 0.01, Method::visvalingam_whyatt);
+    BOOST_CHECK_EQUAL(expected.size(), simplified[i].size());
+  }
+
+  std::vector<LineStringD> densified = densify(simplified, 0.05);
+  for (size_t i = 0; i < densified.size(); i++) {
+    BOOST_CHECK_CLOSE(simplified[i].length(), densified[i].length(), 0.0001);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,161 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+ 
+#define BOOST_TEST_MODULE Tidop geospatial point cloud test
+#include <boost/test/unit_test.hpp>
+#include <tidop/geospatial/pointcloud.h>
+
+#include <fstream>
+
+using namespace tl;
+using namespace geospatial;
+
+
+BOOST_AUTO_TEST_SUITE(PointCloudTestSuite)
+
+struct PointCloudTest
+{
+
+  PointCloudTest()
+  {
+    xyz_file = temporal_dir.path();
+    xyz_file.append("points.xyz");
+    csv_file = temporal_dir.path();
+    csv_file.append("points.csv");
+  }
+
+  ~PointCloudTest()
+  {
+  }
+
+  void setup()
+  {
+    std::ofstream xyz(xyz_file.toString());
+    xyz << "# x y z\n";
+    for (int i = 0; i < 100; i++) {
+      for (int j = 0; j < 100; j++) {
+        xyz << 1000.5 + i << "\t" << 2000.25 + j << "  " << 0.1 * (i + j) << "\r\n";
+      }
+    }
+    xyz << "1.5e3 2.5E3 -1.25";
+    xyz.close();
+
+    std::ofstream csv(csv_file.toString());
+    csv << "id;x;y;z\n";
+    csv << "1;10.5;20.5;30.5\n";
+    csv << "2;-11.25;21.125;0.001\n";
+    csv.close();
+  }
+
+  void teardown()
+  {
+  }
+
+  TemporalDir temporal_dir;
+  Path xyz_file;
+  Path csv_file;
+};
+
+BOOST_FIXTURE_TEST_CASE(factory, PointCloudTest)
+{
+  BOOST_CHECK(PointCloudReaderFactory::isExtensionSupported(".LAS"));
+  BOOST_CHECK(PointCloudReaderFactory::isExtensionSupported(".xyz"));
+  BOOST_CHECK(PointCloudReaderFactory::isExtensionSupported(".csv"));
+  BOOST_CHECK(!PointCloudReaderFactory::isExtensionSupported(".laz"));
+  BOOST_CHECK(PointCloudReaderFactory::create(xyz_file) != nullptr);
+}
+
+BOOST_FIXTURE_TEST_CASE(read_xyz, PointCloudTest)
+{
+  PointCloudReaderXYZ reader(xyz_file);
+  reader.setBlockSize(1024);
+  reader.open();
+  BOOST_CHECK(reader.isOpen());
+
+  std::vector<Point3D> points;
+  size_t count = 0;
+  Point3D last;
+  while (reader.read(points, 999) > 0) {
+    BOOST_CHECK(points.size() <= 999);
+    count += points.size();
+    last = points.back();
+  }
+
+  BOOST_CHECK_EQUAL(10001, count);
+  BOOST_CHECK_CLOSE(1500., last.x, 0.0001);
+  BOOST_CHECK_CLOSE(2500., last.y, 0.0001);
+  BOOST_CHECK_CLOSE(-1.25, last.z, 0.0001);
+
+  reader.rewind();
+  reader.read(points, 2);
+  BOOST_CHECK_EQUAL(2, points.size());
+  BOOST_CHECK_EQUAL(1000.5, points[0].x);
+  BOOST_CHECK_EQUAL(2000.25, points[0].y);
+  BOOST_CHECK_EQUAL(2001.25, points[1].y);
+}
+
+BOOST_FIXTURE_TEST_CASE(read_csv, PointCloudTest)
+{
+  PointCloudReaderCsv reader(csv_file, ';');
+  reader.setColumns(1, 2, 3);
+  reader.setSkipLines(1);
+  reader.open();
+
+  std::vector<Point3D> points;
+  BOOST_CHECK_EQUAL(2, reader.read(points, 10));
+  BOOST_CHECK_EQUAL(10.5, points[0].x);
+  BOOST_CHECK_EQUAL(20.5, points[0].y);
+  BOOST_CHECK_EQUAL(30.5, points[0].z);
+  BOOST_CHECK_EQUAL(-11.25, points[1].x);
+  BOOST_CHECK_EQUAL(21.125, points[1].y);
+  BOOST_CHECK_EQUAL(0.001, points[1].z);
+  BOOST_CHECK_EQUAL(0, reader.read(points, 10));
+}
+
+BOOST_FIXTURE_TEST_CASE(tiler, PointCloudTest)
+{
+  PointCloudReaderXYZ reader(xyz_file);
+
+  PointCloudTiler tiler(25.);
+  tiler.setMemoryLimit(1000);
+  tiler.setWindow(WindowD(PointD(1000., 2000.), PointD(1100., 2100.)));
+  tiler.build(&reader, 500);
+
+  BOOST_CHECK_EQUAL(4, tiler.rows());
+  BOOST_CHECK_EQUAL(4, tiler.cols());
+  BOOST_CHECK_EQUAL(10000, tiler.pointCount());
+
+  std::vector<Point3D> points;
+  tiler.read(0, 0, points);
+  BOOST_CHECK_EQUAL(tiler.pointCount(0, 0), points.size());
+  WindowD window = tiler.tileWindow(0, 0);
+  for (const auto &point : points) {
+    BOOST_CHECK(window.containsPoint(point));
+  }
+
+  tiler.read(WindowD(PointD(1010., 2010.), PointD(1030., 2030.)), points);
+  BOOST_CHECK_EQUAL(400, points.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
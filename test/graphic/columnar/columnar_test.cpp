@@ -0,0 +1,292 @@
+/**************************************************************************
+ *                                                                        *
+ * Copyright (C) 2021 by Tidop Research Group                             *
+ * Copyright (C) 2021 by Esteban Ruiz de Oña Crespo                       *
+ *                                                                        *
+ * This file is part of TidopLib                                          *
+ *                                                                        *
+ * TidopLib is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU Lesser General Public License as         *
+ * published by the Free Software Foundation, either version 3 of the     *
+ * License, or (at your option) any later version.                        *
+ *                                                                        *
+ * TidopLib is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ * GNU Lesser General Public License for more details.                    *
+ *                                                                        *
+ * You should have received a copy of the GNU Lesser General Public       *
+ * License along with TidopLib. If not, see <http://www.gnu.org/licenses>.*
+ *                                                                        *
+ * @license LGPL-3.0 <https://www.gnu.org/licenses/lgpl-3.0.html>         *
+ *                                                                        *
+ **************************************************************************/
+
+#define BOOST_TEST_MODULE Tidop columnar layer test
+#include <boost/test/unit_test.hpp>
+#include <tidop/graphic/columnar.h>
+#include <tidop/graphic/layer.h>
+#include <tidop/graphic/entities/point.h>
+#include <tidop/graphic/entities/polygon.h>
+
+using namespace tl;
+using namespace tl::graph;
+
+
+BOOST_AUTO_TEST_SUITE(ColumnarTestSuite)
+
+BOOST_AUTO_TEST_CASE(memory_arena)
+{
+  MemoryArena arena(128);
+
+  void *ptr1 = arena.allocate(10, 1);
+  void *ptr2 = arena.allocate(16, 8);
+  BOOST_CHECK(ptr1 != nullptr);
+  BOOST_CHECK_EQUAL(0, reinterpret_cast<uintptr_t>(ptr2) % 8);
+  BOOST_CHECK_EQUAL(26, arena.size());
+  BOOST_CHECK_EQUAL(128, arena.capacity());
+
+  void *ptr3 = arena.allocate(1000, 8);
+  BOOST_CHECK(ptr3 != nullptr);
+  BOOST_CHECK(arena.capacity() >= 1128);
+
+  arena.clear();
+  BOOST_CHECK_EQUAL(0, arena.size());
+  BOOST_CHECK_EQUAL(0, arena.capacity());
+}
+
+BOOST_AUTO_TEST_CASE(string_dictionary)
+{
+  StringDictionary dictionary;
+
+  uint32_t id1 = dictionary.insert("image_001.tif");
+  uint32_t id2 = dictionary.insert("image_002.tif");
+  uint32_t id3 = dictionary.insert("image_001.tif");
+
+  BOOST_CHECK_EQUAL(2, dictionary.size());
+  BOOST_CHECK_EQUAL(id1, id3);
+  BOOST_CHECK(id1 != id2);
+  BOOST_CHECK_EQUAL("image_002.tif", dictionary.at(id2));
+  BOOST_CHECK_EQUAL(13, dictionary.length(id1));
+}
+
+BOOST_AUTO_TEST_CASE(field_column)
+{
+  FieldColumn int_column(std::make_shared<TableField>("id", TableField::Type::INT, 10));
+  int_column.pushNull();
+  int_column.pushNull();
+  int_column.setInt(0, 5);
+  int_column.setValue(1, "");
+  BOOST_CHECK_EQUAL(2, int_column.size());
+  BOOST_CHECK_EQUAL(5, int_column.toInt(0));
+  BOOST_CHECK_EQUAL("5", int_column.toString(0));
+  BOOST_CHECK(int_column.isNull(1));
+  BOOST_CHECK_EQUAL("", int_column.toString(1));
+
+  FieldColumn double_column(std::make_shared<TableField>("area", TableField::Type::DOUBLE, 20));
+  double_column.pushNull();
+  double_column.setValue(0, "12.5");
+  BOOST_CHECK_CLOSE(12.5, double_column.toDouble(0), 0.0001);
+  BOOST_CHECK_EQUAL("12.5", double_column.toString(0));
+
+  FieldColumn string_column(std::make_shared<TableField>("name", TableField::Type::STRING, 254));
+  for (size_t i = 0; i < 100; i++) {
+    string_column.pushNull();
+    string_column.setString(i, i % 2 ? "odd" : "even");
+  }
+  BOOST_CHECK_EQUAL(2, string_column.dictionary().size());
+  BOOST_CHECK_EQUAL("odd", string_column.toString(51));
+
+  BOOST_CHECK_THROW(int_column.setValue(0, "abc"), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(build_features)
+{
+  ColumnarLayer layer;
+  layer.setName("test");
+  layer.addDataField(std::make_shared<TableField>("id", TableField::Type::INT, 10));
+
+  size_t id = layer.beginFeature(GraphicEntity::Type::point_2d);
+  layer.addPoint(1., 2.);
+  layer.column(0).setInt(id, 1);
+
+  /// Polígono con un hueco
+  id = layer.beginFeature(GraphicEntity::Type::polygon_2d);
+  layer.addPoint(0., 0.);
+  layer.addPoint(10., 0.);
+  layer.addPoint(10., 10.);
+  layer.addPoint(0., 10.);
+  layer.beginPart();
+  layer.addPoint(2., 2.);
+  layer.addPoint(4., 2.);
+  layer.addPoint(4., 4.);
+  layer.column(0).setInt(id, 2);
+
+  /// Multi-polígono con dos polígonos
+  layer.beginFeature(GraphicEntity::Type::multipolygon_2d);
+  layer.beginGeometry();
+  layer.addPoint(20., 20.);
+  layer.addPoint(30., 20.);
+  layer.addPoint(30., 30.);
+  layer.beginGeometry();
+  layer.addPoint(40., 40.);
+  layer.addPoint(50., 40.);
+  layer.addPoint(50., 50.);
+
+  BOOST_CHECK_EQUAL(3, layer.size());
+  BOOST_CHECK_EQUAL(14, layer.x().size());
+  BOOST_CHECK(layer.z().empty());
+
+  BOOST_CHECK_EQUAL(1, layer.geometries(0));
+  BOOST_CHECK_EQUAL(1, layer.parts(0, 0));
+  BOOST_CHECK_EQUAL(1, layer.points(0, 0, 0));
+
+  BOOST_CHECK_EQUAL(1, layer.geometries(1));
+  BOOST_CHECK_EQUAL(2, layer.parts(1, 0));
+  BOOST_CHECK_EQUAL(4, layer.points(1, 0, 0));
+  BOOST_CHECK_EQUAL(3, layer.points(1, 0, 1));
+  BOOST_CHECK_EQUAL(4., layer.point(1, 0, 1, 1).x);
+
+  BOOST_CHECK_EQUAL(2, layer.geometries(2));
+  BOOST_CHECK_EQUAL(1, layer.parts(2, 1));
+  BOOST_CHECK_EQUAL(50., layer.point(2, 1, 0, 2).y);
+
+  WindowD window = layer.window(2);
+  BOOST_CHECK_EQUAL(20., window.pt1.x);
+  BOOST_CHECK_EQUAL(50., window.pt2.y);
+
+  BOOST_CHECK(layer.column(0).isNull(2));
+  BOOST_CHECK_EQUAL("2", layer.feature(1).value(0));
+
+  BOOST_CHECK_THROW(layer.point(0, 0, 0, 1), std::exception);
+  BOOST_CHECK_THROW(layer.addDataField(std::make_shared<TableField>("name", TableField::Type::STRING, 254)), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(points_3d)
+{
+  ColumnarLayer layer;
+
+  layer.beginFeature(GraphicEntity::Type::point_2d);
+  layer.addPoint(1., 2.);
+  layer.beginFeature(GraphicEntity::Type::point_3d);
+  layer.addPoint(1., 2., 3.);
+  layer.beginFeature(GraphicEntity::Type::point_2d);
+  layer.addPoint(4., 5.);
+
+  BOOST_CHECK_EQUAL(3, layer.z().size());
+  BOOST_CHECK_EQUAL(0., layer.point(0, 0, 0, 0).z);
+  BOOST_CHECK_EQUAL(3., layer.point(1, 0, 0, 0).z);
+  BOOST_CHECK_EQUAL(0., layer.point(2, 0, 0, 0).z);
+}
+
+BOOST_AUTO_TEST_CASE(layer_conversion)
+{
+  std::shared_ptr<TableField> field = std::make_shared<TableField>("image", TableField::Type::STRING, 254);
+  std::vector<std::shared_ptr<TableField>> fields{field};
+
+  GLayer g_layer;
+  g_layer.setName("footprint");
+  g_layer.addDataField(field);
+
+  PolygonD polygon;
+  polygon.push_back(PointD(0., 0.));
+  polygon.push_back(PointD(10., 0.));
+  polygon.push_back(PointD(10., 10.));
+  PolygonHole<PointD> hole;
+  hole.push_back(PointD(1., 1.));
+  hole.push_back(PointD(2., 1.));
+  hole.push_back(PointD(2., 2.));
+  polygon.addHole(hole);
+
+  std::shared_ptr<GraphicEntity> g_polygon = std::make_shared<GPolygon>(polygon);
+  std::shared_ptr<TableRegister> data = std::make_shared<TableRegister>(fields);
+  data->setValue(0, "image_001.tif");
+  g_polygon->setData(data);
+  g_layer.push_back(g_polygon);
+
+  std::shared_ptr<GraphicEntity> g_point = std::make_shared<GPoint3D>(1., 2., 3.);
+  g_layer.push_back(g_point);
+
+  ColumnarLayer layer(g_layer);
+  BOOST_CHECK_EQUAL("footprint", layer.name());
+  BOOST_CHECK_EQUAL(2, layer.size());
+  BOOST_CHECK_EQUAL(1, layer.fieldCount());
+  BOOST_CHECK_EQUAL("image_001.tif", layer.column(0).toString(0));
+  BOOST_CHECK(layer.column(0).isNull(1));
+  BOOST_CHECK_EQUAL(2, layer.parts(0, 0));
+
+  GLayer g_layer2 = layer.toLayer();
+  BOOST_CHECK_EQUAL(2, g_layer2.size());
+
+  std::shared_ptr<GPolygon> g_polygon2 = std::dynamic_pointer_cast<GPolygon>(*g_layer2.begin());
+  BOOST_REQUIRE(g_polygon2);
+  BOOST_CHECK_EQUAL(3, g_polygon2->size());
+  BOOST_CHECK_EQUAL(1, g_polygon2->holes());
+  BOOST_CHECK_EQUAL(2., g_polygon2->hole(0)[2].y);
+  BOOST_CHECK_EQUAL("image_001.tif", g_polygon2->data()->value(0));
+
+  std::shared_ptr<GPoint3D> g_point2 = std::dynamic_pointer_cast<GPoint3D>(layer.feature(1).toEntity());
+  BOOST_REQUIRE(g_point2);
+  BOOST_CHECK_EQUAL(3., g_point2->z);
+}
+
+BOOST_AUTO_TEST_CASE(append)
+{
+  ColumnarLayer layer1;
+  layer1.addDataField(std::make_shared<TableField>("id", TableField::Type::INT, 10));
+  layer1.addDataField(std::make_shared<TableField>("name", TableField::Type::STRING, 254));
+
+  size_t id = layer1.beginFeature(GraphicEntity::Type::point_2d);
+  layer1.addPoint(1., 2.);
+  layer1.column(0).setInt(id, 1);
+  layer1.column(1).setString(id, "a");
+
+  ColumnarLayer layer2;
+  layer2.addDataField(std::make_shared<TableField>("name", TableField::Type::STRING, 254));
+  layer2.addDataField(std::make_shared<TableField>("id", TableField::Type::INT64, 10));
+  layer2.addDataField(std::make_shared<TableField>("area", TableField::Type::DOUBLE, 20));
+
+  id = layer2.beginFeature(GraphicEntity::Type::polygon_3d);
+  layer2.addPoint(0., 0., 1.);
+  layer2.addPoint(10., 0., 2.);
+  layer2.addPoint(10., 10., 3.);
+  layer2.column(0).setString(id, "b");
+  layer2.column(1).setInt64(id, 2);
+
+  id = layer2.beginFeature(GraphicEntity::Type::point_2d);
+  layer2.addPoint(5., 5.);
+  layer2.column(0).setString(id, "a");
+
+  layer1.append(layer2);
+
+  BOOST_CHECK_EQUAL(3, layer1.size());
+  BOOST_CHECK_EQUAL(2, layer1.fieldCount());
+  BOOST_CHECK_EQUAL(5, layer1.x().size());
+  BOOST_CHECK_EQUAL(5, layer1.z().size());
+  BOOST_CHECK_EQUAL(0., layer1.point(0, 0, 0, 0).z);
+  BOOST_CHECK_EQUAL(3, layer1.points(1, 0, 0));
+  BOOST_CHECK_EQUAL(2., layer1.point(1, 0, 0, 1).z);
+  BOOST_CHECK_EQUAL(5., layer1.point(2, 0, 0, 0).x);
+
+  BOOST_CHECK_EQUAL(2, layer1.column(0).toInt(1));
+  BOOST_CHECK(layer1.column(0).isNull(2));
+  BOOST_CHECK_EQUAL("b", layer1.column(1).toString(1));
+  BOOST_CHECK_EQUAL("a", layer1.column(1).toString(2));
+  BOOST_CHECK_EQUAL(2, layer1.column(1).dictionary().size());
+}
+
+BOOST_AUTO_TEST_CASE(move)
+{
+  ColumnarLayer layer;
+  layer.addDataField(std::make_shared<TableField>("name", TableField::Type::STRING, 254));
+  size_t id = layer.beginFeature(GraphicEntity::Type::point_2d);
+  layer.addPoint(1., 2.);
+  layer.column(0).setString(id, "a");
+
+  ColumnarLayer layer2(std::move(layer));
+  BOOST_CHECK_EQUAL(1, layer2.size());
+  BOOST_CHECK_EQUAL("a", layer2.column(0).toString(0));
+  BOOST_CHECK(layer.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()